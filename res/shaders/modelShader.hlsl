@@ -2,31 +2,68 @@ cbuffer CONSTANTS : register(b0)
 {
 	float4x4 modelViewProj;
 };
+// Bound per draw at an offset into the material library's id table.
+cbuffer MATERIAL : register(b1)
+{
+	uint materialId;
+};
+
+// Same layout as MaterialConstants.
+struct Material
+{
+	float4 BaseColor;
+	float4 UVTransform; // Scale xy, offset zw.
+	uint DiffuseLayer;
+	uint Flags;
+	float Roughness;
+	float Metallic;
+};
+#define MATERIAL_FLAG_DIFFUSE 1
 
 struct INPUT
 {
 	float3 Position : POSITION;
 	float2 UV : TEXCOORD;
+#ifdef INSTANCED
+	// Per-instance model view projection, one row per element.
+	float4 Row0 : INSTANCE0;
+	float4 Row1 : INSTANCE1;
+	float4 Row2 : INSTANCE2;
+	float4 Row3 : INSTANCE3;
+#endif
 };
 
 struct OUTPUT
 {
 	float4 Position : SV_POSITION;
 	float2 UV : TEXCOORD;
+	nointerpolation uint Material : MATERIAL;
 };
 
-Texture2D diffuse1	: register(t0);
+Texture2DArray diffuse1	: register(t0);
+StructuredBuffer<Material> materials	: register(t1);
 SamplerState samp1	: register(s0);
 
 OUTPUT vs_main(INPUT input)
 {
 	OUTPUT output;
+#ifdef INSTANCED
+	// Rows arrive as the CPU stores them, the constant buffer reads the same memory column major, so the multiply is swapped.
+	float4x4 instanceModelViewProj = float4x4(input.Row0, input.Row1, input.Row2, input.Row3);
+	output.Position = mul(instanceModelViewProj, float4(input.Position, 1.0f));
+#else
 	output.Position = mul(float4(input.Position, 1.0f), modelViewProj);
-	output.UV = input.UV;
+#endif
+	output.UV = input.UV * materials[materialId].UVTransform.xy + materials[materialId].UVTransform.zw;
+	output.Material = materialId;
 	return output;
 }
 
 float4 ps_main(OUTPUT input) : SV_TARGET
 {
-	return diffuse1.Sample(samp1, input.UV);
+	Material material = materials[input.Material];
+	float4 color = material.BaseColor;
+	if (material.Flags & MATERIAL_FLAG_DIFFUSE)
+		color *= diffuse1.Sample(samp1, float3(input.UV, material.DiffuseLayer));
+	return color;
 }
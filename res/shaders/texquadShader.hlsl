@@ -15,7 +15,7 @@ struct OUTPUT
 	float2 UV : TEXCOORD;
 };
 
-Texture2D myTex			: register(t0);
+Texture2DArray myTex		: register(t0);
 SamplerState mySampler	: register(s0);
 
 OUTPUT vs_main(INPUT input)
@@ -28,5 +28,5 @@ OUTPUT vs_main(INPUT input)
 
 float4 ps_main(OUTPUT input) : SV_TARGET
 {
-	return myTex.Sample(mySampler, input.UV);
+	return myTex.Sample(mySampler, float3(input.UV, 0.0f));
 }
@@ -0,0 +1,141 @@
+#include "Assets.h"
+#include "Profiler.h"
+
+namespace Assets
+{
+	void AssetManager::Create(int workerCount)
+	{
+		if (workerCount <= 0)
+			workerCount = (int)std::thread::hardware_concurrency() / 2;
+		if (workerCount <= 0)
+			workerCount = 1;
+
+		m_running = true;
+		for (int i = 0; i < workerCount; ++i)
+			m_threads.emplace_back(&AssetManager::WorkerMain, this);
+	}
+	void AssetManager::Destroy()
+	{
+		if (!m_running)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_requestLock);
+			m_running = false;
+			m_requests = {};
+		}
+		m_requestWake.notify_all();
+		for (auto& t : m_threads)
+			t.join();
+		m_threads.clear();
+
+		// Anything not yet completed is dropped, its owner may already be gone.
+		{
+			std::lock_guard<std::mutex> lock(m_completeLock);
+			m_completed.clear();
+		}
+		m_pending = 0;
+	}
+
+	AssetHandle AssetManager::Request(const char* name, LoadFunction load, CompleteFunction complete, AssetPriority priority)
+	{
+		AssetHandle handle;
+		{
+			std::lock_guard<std::mutex> lock(m_stateLock);
+			handle = (AssetHandle)m_states.size();
+			m_states.push_back(ASSET_QUEUED);
+		}
+		m_pending.fetch_add(1);
+
+		if (!m_running)
+		{
+			// Not created, load and complete inline.
+			SetState(handle, ASSET_LOADING);
+			bool result = load();
+			SetState(handle, result ? ASSET_READY : ASSET_FAILED);
+			if (complete)
+				complete(result);
+			m_pending.fetch_sub(1);
+			return handle;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_requestLock);
+			m_requests.push({ handle, priority, m_sequence++, name ? name : "", std::move(load), std::move(complete) });
+		}
+		m_requestWake.notify_one();
+		return handle;
+	}
+
+	void AssetManager::Update()
+	{
+		std::vector<Completion> completed;
+		{
+			std::lock_guard<std::mutex> lock(m_completeLock);
+			completed.swap(m_completed);
+		}
+		for (auto& c : completed)
+		{
+			SetState(c.m_handle, c.m_result ? ASSET_READY : ASSET_FAILED);
+			if (c.m_complete)
+				c.m_complete(c.m_result);
+			m_pending.fetch_sub(1);
+		}
+	}
+	void AssetManager::WaitAll()
+	{
+		// Completions may request more assets (a model's textures), so loop until nothing is left.
+		while (m_pending.load() > 0)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_completeLock);
+				m_completeWake.wait(lock, [this]() { return !m_completed.empty(); });
+			}
+			Update();
+		}
+	}
+
+	AssetState AssetManager::GetState(AssetHandle handle)
+	{
+		std::lock_guard<std::mutex> lock(m_stateLock);
+		if (handle < 0 || handle >= (AssetHandle)m_states.size())
+			return ASSET_FAILED;
+		return m_states[handle];
+	}
+	void AssetManager::SetState(AssetHandle handle, AssetState state)
+	{
+		std::lock_guard<std::mutex> lock(m_stateLock);
+		m_states[handle] = state;
+	}
+
+	void AssetManager::WorkerMain()
+	{
+		Profiler.SetThreadName("Asset Worker");
+		while (true)
+		{
+			AssetRequest request;
+			{
+				std::unique_lock<std::mutex> lock(m_requestLock);
+				m_requestWake.wait(lock, [this]() { return !m_running || !m_requests.empty(); });
+				if (!m_running)
+					return;
+				request = m_requests.top();
+				m_requests.pop();
+			}
+
+			// File I/O and decode.
+			SetState(request.m_handle, ASSET_LOADING);
+			bool result;
+			{
+				PROFILE_SCOPE("Asset Load");
+				result = request.m_load();
+			}
+			SetState(request.m_handle, ASSET_LOADED);
+
+			// Hand back to the main thread for upload.
+			{
+				std::lock_guard<std::mutex> lock(m_completeLock);
+				m_completed.push_back({ request.m_handle, result, std::move(request.m_complete) });
+			}
+			m_completeWake.notify_all();
+		}
+	}
+}
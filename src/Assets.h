@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define AssetLoader (Assets::AssetManager::Instance())
+
+namespace Assets
+{
+	typedef int AssetHandle;
+	const AssetHandle InvalidAsset = -1;
+
+	enum AssetState
+	{
+		ASSET_QUEUED,
+		ASSET_LOADING,
+		ASSET_LOADED, // Decoded, waiting for the main thread.
+		ASSET_READY,
+		ASSET_FAILED,
+	};
+	enum AssetPriority
+	{
+		PRIORITY_LOW,
+		PRIORITY_NORMAL,
+		PRIORITY_HIGH,
+	};
+
+	// Load runs on a streaming thread and must not touch the device.
+	// Complete runs on the main thread inside Update() and does the GPU upload.
+	typedef std::function<bool()> LoadFunction;
+	typedef std::function<void(bool)> CompleteFunction;
+
+	// Asset Streaming // Requests are served highest priority first, in request order within a priority.
+	class AssetManager
+	{
+	public:
+		void Create(int workerCount = ASSET_WORKER_COUNT);
+		void Destroy();
+
+		AssetHandle Request(const char* name, LoadFunction load, CompleteFunction complete = nullptr, AssetPriority priority = PRIORITY_NORMAL);
+
+		void Update();
+		void WaitAll();
+
+		AssetState GetState(AssetHandle handle);
+		int GetPendingCount() { return m_pending.load(); }
+		int GetWorkerCount() { return (int)m_threads.size(); }
+
+	private:
+		struct AssetRequest
+		{
+			AssetHandle m_handle;
+			AssetPriority m_priority;
+			uint64_t m_sequence;
+			std::string m_name;
+			LoadFunction m_load;
+			CompleteFunction m_complete;
+		};
+		struct Completion
+		{
+			AssetHandle m_handle;
+			bool m_result;
+			CompleteFunction m_complete;
+		};
+		struct RequestOrder
+		{
+			bool operator()(const AssetRequest& a, const AssetRequest& b) const
+			{
+				if (a.m_priority != b.m_priority)
+					return a.m_priority < b.m_priority;
+				return a.m_sequence > b.m_sequence;
+			}
+		};
+
+		void SetState(AssetHandle handle, AssetState state);
+		void WorkerMain();
+
+	private:
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_requestLock;
+		std::condition_variable m_requestWake;
+		std::priority_queue<AssetRequest, std::vector<AssetRequest>, RequestOrder> m_requests;
+		uint64_t m_sequence = 0;
+
+		std::mutex m_completeLock;
+		std::condition_variable m_completeWake;
+		std::vector<Completion> m_completed;
+
+		std::mutex m_stateLock;
+		std::vector<AssetState> m_states;
+
+		std::atomic<int> m_pending = 0;
+		std::atomic<bool> m_running = false;
+
+	private:
+		AssetManager() { }
+
+	public:
+		// Singleton Design Pattern
+		static AssetManager& Instance()
+		{
+			static AssetManager instance;
+			return instance;
+		}
+
+		AssetManager(AssetManager const&) = delete;
+		void operator=(AssetManager const&) = delete;
+
+	};
+}
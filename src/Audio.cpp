@@ -1,4 +1,5 @@
 #include "Audio.h"
+#include "Profiler.h"
 
 #include <assert.h>
 
@@ -20,14 +21,24 @@ namespace AudioEngine
 		ErrorCheck(FMOD_Debug_Initialize(dFlags, FMOD_DEBUG_MODE::FMOD_DEBUG_MODE_TTY, nullptr, nullptr));
 #endif
 	}
+	void AudioEngine::CreateNull()
+	{
+		// Stub // Every call becomes a no-op while there is no FMOD system.
+		m_fmodSys = nullptr;
+	}
 	void AudioEngine::Destroy()
 	{
+		if (!m_fmodSys)
+			return;
 		FMOD_System_Release(m_fmodSys);
 	}
 
 	void AudioEngine::Update()
 	{
-		std::vector<ChannelMap::iterator> stoppedChannels;
+		PROFILE_FUNCTION();
+		if (!m_fmodSys)
+			return;
+		Memory::FrameVector<ChannelMap::iterator> stoppedChannels(FrameMemory.GetAllocator());
 		for (auto it = m_channels.begin(), itEnd = m_channels.end(); it != itEnd; ++it)
 		{
 			FMOD_BOOL isPlaying = false;
@@ -46,6 +57,8 @@ namespace AudioEngine
 
 	void AudioEngine::LoadAudio(const char* soundName, bool loop, bool stream)
 	{
+		if (!m_fmodSys)
+			return;
 		auto foundIt = m_sounds.find(soundName);
 		if (foundIt != m_sounds.end())
 			return;
@@ -69,6 +82,8 @@ namespace AudioEngine
 	int AudioEngine::PlayAudio(const char* soundName, float volume)
 	{
 		int channelID = m_nextChannelID;
+		if (!m_fmodSys)
+			return channelID;
 		auto foundIt = m_sounds.find(soundName);
 		if (foundIt == m_sounds.end())
 		{
@@ -93,6 +108,8 @@ namespace AudioEngine
 	int AudioEngine::PlayMusic(const char* soundName, float volume)
 	{
 		int channelID = m_nextChannelID;
+		if (!m_fmodSys)
+			return channelID;
 		auto foundIt = m_sounds.find(soundName);
 		if (foundIt == m_sounds.end())
 		{
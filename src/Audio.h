@@ -2,6 +2,7 @@
 
 #include "Common.h"
 #include "Window.h"
+#include "Memory.h"
 
 #include <fmod.h>
 #include <fmod_errors.h>
@@ -19,6 +20,7 @@ namespace AudioEngine
 		~AudioEngine();
 
 		void Create();
+		void CreateNull();
 		void Destroy();
 
 		void Update();
@@ -44,7 +46,8 @@ namespace AudioEngine
 		int m_nextChannelID;
 
 		typedef std::map<const char*, FMOD_SOUND*> SoundMap;
-		typedef std::map<int, FMOD_CHANNEL*> ChannelMap;
+		// Channels come and go every few frames, their nodes are pooled.
+		typedef std::map<int, FMOD_CHANNEL*, std::less<int>, Memory::PoolAdapter<std::pair<const int, FMOD_CHANNEL*>>> ChannelMap;
 
 		SoundMap m_sounds;
 		ChannelMap m_channels;
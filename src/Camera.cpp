@@ -15,25 +15,29 @@ namespace Renderer
 
 	void Camera::CreatePerspective(Window& window, float fov, float zNear, float zFar)
 	{
-		m_type = CameraTypes::PERSPECTIVE;
-		m_fov = fov;
-		m_zNear = zNear;
-		m_zFar = zFar;
-
 		// Get Apsect Ratio
-		int windowWidth, windowHeight;
-		float aspectRatio;
+		int windowWidth = WINDOW_WIDTH, windowHeight = WINDOW_HEIGHT;
+		if (window.GetWindowHandle())
 		{
 			RECT clientRect;
 			GetClientRect(window.GetWindowHandle(), &clientRect);
 			windowWidth = clientRect.right - clientRect.left;
 			windowHeight = clientRect.bottom - clientRect.top;
-			aspectRatio = (float)windowWidth / (float)windowHeight;
 		}
+		CreatePerspective((float)windowWidth, (float)windowHeight, fov, zNear, zFar);
+	}
+	void Camera::CreatePerspective(float width, float height, float fov, float zNear, float zFar)
+	{
+		m_type = CameraTypes::PERSPECTIVE;
+		m_fov = fov;
+		m_zNear = zNear;
+		m_zFar = zFar;
+		m_viewportWidth = width;
+		m_viewportHeight = height;
 
 		// Setup Perspective Matrix
 		m_projectionMat = Math::Matrix4F(1.0f);
-		m_projectionMat.Perspective(aspectRatio, Math::DegreesToRadians(fov), zNear, zFar);
+		m_projectionMat.Perspective(width / height, Math::DegreesToRadians(fov), zNear, zFar);
 	}
 	void Camera::CreateOrthographic(Window& window, float scale, float zNear, float zFar)
 	{
@@ -41,6 +45,13 @@ namespace Renderer
 		m_scale = scale;
 		m_zNear = zNear;
 		m_zFar = zFar;
+		if (window.GetWindowHandle())
+		{
+			RECT clientRect;
+			GetClientRect(window.GetWindowHandle(), &clientRect);
+			m_viewportWidth = (float)(clientRect.right - clientRect.left);
+			m_viewportHeight = (float)(clientRect.bottom - clientRect.top);
+		}
 
 		// Setup Orthographic Matrix.
 		m_projectionMat = Math::Matrix4F(1.0f);
@@ -51,12 +62,12 @@ namespace Renderer
 
 	void Camera::Update()
 	{ }
-	void Camera::Draw(Math::Matrix4F& viewMat)
+	void Camera::Draw(const Math::Matrix4F& viewMat)
 	{
 		if (m_type != CameraTypes::NONE)
 		{
 			static Math::Vector3F worldUp = { 0.0f, 1.0f, 0.0f }; // Y Up Constant
-			m_viewMat = &viewMat;
+			m_viewMat = viewMat;
 			// Calculate Forward and Right vectors.
 			m_forward = { -viewMat.m[2][0], -viewMat.m[2][1], -viewMat.m[2][2] };
 			m_right = worldUp.Cross(m_forward).Normalise();
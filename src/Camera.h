@@ -24,11 +24,13 @@ namespace Renderer
 		~Camera();
 
 		void CreatePerspective(Window& window, float fov, float zNear, float zFar);
+		// Windowless, for offscreen targets such as the software rasterizer.
+		void CreatePerspective(float width, float height, float fov, float zNear, float zFar);
 		void CreateOrthographic(Window& window, float scale, float zNear, float zFar);
 		void Destroy();
 		 
 		void Update();
-		void Draw(Math::Matrix4F& viewMat);
+		void Draw(const Math::Matrix4F& viewMat);
 
 		// Setters
 		float SetFOV(float fov) { if (m_type == ORTHOGRAPHIC || m_type == NONE) return 0.0f; m_fov = fov; return this->m_fov; }
@@ -43,9 +45,11 @@ namespace Renderer
 		float GetScale() { return m_scale; }
 		float GetNear() { return m_zNear; }
 		float GetFar() { return m_zFar; }
+		float GetViewportWidth() { return m_viewportWidth; }
+		float GetViewportHeight() { return m_viewportHeight; }
 
 		Math::Matrix4F GetProjectionMatrix() { return m_projectionMat; }
-		Math::Matrix4F GetViewMatrix() { return *m_viewMat; }
+		Math::Matrix4F GetViewMatrix() { return m_viewMat; }
 
 	private:
 		CameraTypes m_type;
@@ -56,9 +60,11 @@ namespace Renderer
 		float m_scale; // Orthographic Only
 		float m_zNear;
 		float m_zFar;
+		float m_viewportWidth = WINDOW_WIDTH; // Pixels, for screen space sizes.
+		float m_viewportHeight = WINDOW_HEIGHT;
 
 		Math::Matrix4F m_projectionMat;
-		Math::Matrix4F* m_viewMat;
+		Math::Matrix4F m_viewMat;
 
 	};
 }
@@ -20,3 +20,43 @@
 #define WINDOW_FPS 60
 
 #define MOUSE_LOCK true
+
+#define JOB_WORKER_COUNT 0 // 0 Uses every hardware thread.
+#define JOB_EXTERNAL_QUEUES 8 // Queues for threads outside the scheduler that push jobs, claimed on first push. The last is shared past that.
+#define SCENE_PARALLEL_UPDATE true
+#define SCENE_CULLING true // Models outside the camera frustum are skipped, found through a BVH over their world bounds.
+#define ASSET_WORKER_COUNT 0 // 0 Uses half the hardware threads for streaming.
+#define TEXTURE_CACHE_BUDGET (256 * 1024 * 1024) // Bytes, unreferenced textures above this are evicted.
+#define TEXTURE_ATLAS true // Small textures of an imported model are packed into the slices of one texture array, their meshes' UVs rewritten.
+#define TEXTURE_ATLAS_SIZE 1024 // Texels per side of an atlas page.
+#define TEXTURE_ATLAS_MAX_INPUT 256 // Texels per side above which a texture keeps its own resource.
+#define TEXTURE_ATLAS_GUTTER 8 // Edge texels repeated around each packed texture, a power of two. Pages keep log2 of it plus one mips.
+#define MATERIAL_BUFFER_CAPACITY 256 // Materials the GPU buffers start with, doubled whenever more are live.
+#define SHADER_CACHE_PATH "./res/shaders/cache/" // Compiled bytecode, named by source and options hash.
+#define MESH_INSTANCING true // Models draw through per-instance transform buffers, one draw per mesh and texture. Culled per object, not per meshlet.
+#define INSTANCE_BUFFER_CAPACITY 4096 // Transforms per instanced draw and per ring buffer wrap.
+#define CONSTANT_RING_SIZE (4 * 1024 * 1024) // Bytes of per-object constants shared by every frame in flight.
+#define CONSTANT_RING_FRAMES 3 // Frames the GPU may lag behind before the ring waits on it.
+#define RHI_FRAMES_IN_FLIGHT 3 // Frames the CPU may record ahead of the GPU. Destroyed resources are kept until their frames finish.
+#define RHI_RECORDING_MAX_ERRORS 64 // Validation messages kept by the recording device, the rest are only counted.
+#define RHI_RECORD_CHUNK 512 // Sorted draws per command list. Lists are recorded on job system workers and submitted in queue order.
+#define RHI_RECORD_THREAD_COUNT 0 // Command list recording jobs in flight. 0 Uses every job system worker.
+#define PROFILER_ENABLED true // PROFILE_SCOPE markers are compiled in, the profiler can still be switched off at runtime.
+#define PROFILER_EVENT_CAPACITY 16384 // Scopes per thread between collections, a power of two.
+#define PROFILER_HISTORY 240 // Frames kept for the viewer and trace export.
+#define PROFILER_TRACE_PATH "./profile.json" // Chrome trace JSON.
+#define MEMORY_TRACKING true // Global operator new is counted, per frame heap allocations show in the stats.
+#define FRAME_ARENA_SIZE (1024 * 1024) // Bytes of main thread scratch memory per frame, grown if a frame needs more.
+#define MESH_OPTIMIZE true // Imported meshes are welded and reordered for the vertex cache, overdraw and vertex fetch.
+#define MESH_MESHLETS true // Large meshes are split into meshlets, culled one by one when not instanced.
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+#define MESH_LOD_LEVELS 3 // Coarser levels generated per mesh at import and cook, about half the triangles each. 0 Disables.
+#define LOD_PIXEL_ERROR 1.0f // Simplification error allowed on screen, in pixels.
+#define LOD_HYSTERESIS 0.25f // Fraction under the limit a coarser level must fit before it is taken.
+#define ENTITY_CHUNK_SIZE (16 * 1024) // Bytes per archetype chunk, entity ids and component arrays together.
+#define ENTITY_MAX_COMPONENTS 64 // Component types, one bit each in an archetype mask.
+#define RASTER_TILE_SIZE 64 // Pixels per side of a software rasterizer tile, a multiple of 8. Triangles are binned per tile.
+#define RASTER_THREAD_COUNT 0 // Software rasterizer jobs in flight. 0 Uses every job system worker.
+#define RASTER_SCREENSHOT_PATH "./software.ppm" // Last frame of a software headless run.
+#define KEYBOARD_BUFFER_SIZE 64 // Queued key and char events, the oldest are dropped past this.
@@ -0,0 +1,202 @@
+#include "CookedMesh.h"
+#include "Meshes.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		static uint64_t Align(uint64_t offset)
+		{
+			return (offset + CookedMeshAlignment - 1) & ~(uint64_t)(CookedMeshAlignment - 1);
+		}
+
+		struct CookContext
+		{
+			std::vector<CookedSubmesh> m_submeshes;
+			std::vector<CookedMaterial> m_materials;
+			std::vector<TexVertex3D> m_vertices;
+			std::vector<uint8_t> m_indices; // Mixed widths, every submesh starts 4 byte aligned.
+			std::vector<Meshlet> m_meshlets;
+			std::vector<MeshLod> m_lods;
+		};
+		static int CookMaterial(CookContext& context, aiMaterial* material)
+		{
+			if (material->GetTextureCount(aiTextureType_DIFFUSE) == 0)
+				return -1;
+			aiString str;
+			material->GetTexture(aiTextureType_DIFFUSE, 0, &str);
+			for (size_t i = 0; i < context.m_materials.size(); ++i)
+			{
+				if (strcmp(context.m_materials[i].m_diffusePath, str.C_Str()) == 0)
+					return (int)i;
+			}
+			CookedMaterial m = {};
+			strncpy(m.m_diffusePath, str.C_Str(), CookedMeshPathLength - 1);
+			context.m_materials.push_back(m);
+			return (int)context.m_materials.size() - 1;
+		}
+		static void CookNode(CookContext& context, aiNode* node, const aiScene* scene)
+		{
+			// Same traversal order as MeshRenderer::ProcessNode.
+			for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+			{
+				aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+				CookedSubmesh sub = {};
+				sub.m_firstVertex = (uint32_t)context.m_vertices.size();
+				sub.m_vertexStride = sizeof(TexVertex3D);
+				sub.m_material = CookMaterial(context, scene->mMaterials[mesh->mMaterialIndex]);
+
+				// Vertices
+				std::vector<TexVertex3D> vertices(mesh->mNumVertices);
+				for (unsigned int v = 0; v < mesh->mNumVertices; ++v)
+				{
+					TexVertex3D& vertex = vertices[v];
+					vertex.x = mesh->mVertices[v].x;
+					vertex.y = mesh->mVertices[v].y;
+					vertex.z = mesh->mVertices[v].z;
+					vertex.u = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][v].x : 0.0f;
+					vertex.v = mesh->mTextureCoords[0] ? mesh->mTextureCoords[0][v].y : 0.0f;
+				}
+				// Indices
+				std::vector<uint32_t> indices;
+				indices.reserve(mesh->mNumFaces * 3);
+				for (unsigned int f = 0; f < mesh->mNumFaces; ++f)
+				{
+					const aiFace& face = mesh->mFaces[f];
+					for (unsigned int j = 0; j < face.mNumIndices; ++j)
+						indices.push_back(face.mIndices[j]);
+				}
+				// Optimized once here, cooked files load as they are.
+				if (MESH_OPTIMIZE)
+					OptimizeMesh(vertices, indices);
+				context.m_vertices.insert(context.m_vertices.end(), vertices.begin(), vertices.end());
+				sub.m_vertexCount = (uint32_t)vertices.size();
+				sub.m_indexCount = (uint32_t)indices.size();
+				sub.m_indexSize = SelectIndexSize(vertices.size());
+				// Meshlets
+				sub.m_firstMeshlet = (uint32_t)context.m_meshlets.size();
+				if (MESH_MESHLETS && indices.size() / 3 > MESHLET_MAX_TRIANGLES)
+				{
+					std::vector<Meshlet> meshlets;
+					BuildMeshlets(meshlets, indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(TexVertex3D));
+					context.m_meshlets.insert(context.m_meshlets.end(), meshlets.begin(), meshlets.end());
+					sub.m_meshletCount = (uint32_t)meshlets.size();
+				}
+				// Levels of Detail // Simplified here once, stored after the full detail indices. Welded meshes only, as on import.
+				sub.m_firstLod = (uint32_t)context.m_lods.size();
+				if (MESH_OPTIMIZE && MESH_LOD_LEVELS > 0)
+				{
+					std::vector<MeshLod> lods;
+					GenerateLods(lods, indices, vertices.data(), vertices.size(), sizeof(TexVertex3D));
+					context.m_lods.insert(context.m_lods.end(), lods.begin(), lods.end());
+					sub.m_lodCount = (uint32_t)lods.size();
+				}
+				sub.m_indexOffset = (uint32_t)((context.m_indices.size() + 3) & ~(size_t)3);
+				context.m_indices.resize(sub.m_indexOffset + indices.size() * sub.m_indexSize, 0);
+				PackIndices(&context.m_indices[sub.m_indexOffset], indices.data(), indices.size(), sub.m_indexSize);
+				context.m_submeshes.push_back(sub);
+			}
+			for (unsigned int i = 0; i < node->mNumChildren; ++i)
+				CookNode(context, node->mChildren[i], scene);
+		}
+
+		bool CookMesh(const char* srcPath, const char* dstPath)
+		{
+			Assimp::Importer importer;
+			const aiScene* scene = importer.ReadFile(srcPath, aiProcess_Triangulate | aiProcess_FlipUVs);
+			if (!scene || !scene->mRootNode)
+				return false;
+
+			CookContext context;
+			CookNode(context, scene->mRootNode, scene);
+
+			// Layout
+			CookedMeshHeader header = {};
+			header.m_magic = CookedMeshMagic;
+			header.m_version = CookedMeshVersion;
+			header.m_submeshCount = (uint32_t)context.m_submeshes.size();
+			header.m_materialCount = (uint32_t)context.m_materials.size();
+			header.m_submeshOffset = Align(sizeof(CookedMeshHeader));
+			header.m_materialOffset = Align(header.m_submeshOffset + context.m_submeshes.size() * sizeof(CookedSubmesh));
+			header.m_vertexOffset = Align(header.m_materialOffset + context.m_materials.size() * sizeof(CookedMaterial));
+			header.m_vertexSize = context.m_vertices.size() * sizeof(TexVertex3D);
+			header.m_indexOffset = Align(header.m_vertexOffset + header.m_vertexSize);
+			header.m_indexSize = context.m_indices.size();
+			header.m_meshletOffset = Align(header.m_indexOffset + header.m_indexSize);
+			header.m_meshletCount = (uint32_t)context.m_meshlets.size();
+			header.m_lodOffset = Align(header.m_meshletOffset + context.m_meshlets.size() * sizeof(Meshlet));
+			header.m_lodCount = (uint32_t)context.m_lods.size();
+
+			std::vector<uint8_t> file((size_t)(header.m_lodOffset + context.m_lods.size() * sizeof(MeshLod)), 0);
+			memcpy(&file[0], &header, sizeof(header));
+			if (!context.m_submeshes.empty())
+				memcpy(&file[(size_t)header.m_submeshOffset], context.m_submeshes.data(), context.m_submeshes.size() * sizeof(CookedSubmesh));
+			if (!context.m_materials.empty())
+				memcpy(&file[(size_t)header.m_materialOffset], context.m_materials.data(), context.m_materials.size() * sizeof(CookedMaterial));
+			if (header.m_vertexSize)
+				memcpy(&file[(size_t)header.m_vertexOffset], context.m_vertices.data(), (size_t)header.m_vertexSize);
+			if (header.m_indexSize)
+				memcpy(&file[(size_t)header.m_indexOffset], context.m_indices.data(), (size_t)header.m_indexSize);
+			if (!context.m_meshlets.empty())
+				memcpy(&file[(size_t)header.m_meshletOffset], context.m_meshlets.data(), context.m_meshlets.size() * sizeof(Meshlet));
+			if (!context.m_lods.empty())
+				memcpy(&file[(size_t)header.m_lodOffset], context.m_lods.data(), context.m_lods.size() * sizeof(MeshLod));
+
+			FILE* f = fopen(dstPath, "wb");
+			if (!f)
+				return false;
+			bool written = fwrite(file.data(), 1, file.size(), f) == file.size();
+			fclose(f);
+			return written;
+		}
+
+		const CookedMeshHeader* ReadCookedMesh(const void* data, size_t size)
+		{
+			if (!data || size < sizeof(CookedMeshHeader))
+				return nullptr;
+			const CookedMeshHeader* header = (const CookedMeshHeader*)data;
+			if (header->m_magic != CookedMeshMagic || header->m_version != CookedMeshVersion)
+				return nullptr;
+			if (header->m_submeshOffset + header->m_submeshCount * sizeof(CookedSubmesh) > size
+				|| header->m_materialOffset + header->m_materialCount * sizeof(CookedMaterial) > size
+				|| header->m_vertexOffset + header->m_vertexSize > size
+				|| header->m_indexOffset + header->m_indexSize > size
+				|| header->m_meshletOffset + header->m_meshletCount * sizeof(Meshlet) > size
+				|| header->m_lodOffset + header->m_lodCount * sizeof(MeshLod) > size)
+				return nullptr;
+			// Material paths are used as C strings, each must end inside its field.
+			const CookedMaterial* materials = (const CookedMaterial*)((const uint8_t*)data + header->m_materialOffset);
+			for (uint32_t i = 0; i < header->m_materialCount; ++i)
+			{
+				if (!memchr(materials[i].m_diffusePath, 0, CookedMeshPathLength))
+					return nullptr;
+			}
+			// Submesh ranges, a bad one would have the renderer read past the blobs. Vertices are read as TexVertex3D whatever the stride says.
+			const CookedSubmesh* submeshes = (const CookedSubmesh*)((const uint8_t*)data + header->m_submeshOffset);
+			const MeshLod* lods = (const MeshLod*)((const uint8_t*)data + header->m_lodOffset);
+			for (uint32_t i = 0; i < header->m_submeshCount; ++i)
+			{
+				const CookedSubmesh& sub = submeshes[i];
+				if ((sub.m_indexSize != 2 && sub.m_indexSize != 4)
+					|| sub.m_vertexStride != sizeof(TexVertex3D)
+					|| sub.m_material < -1 || sub.m_material >= (int64_t)header->m_materialCount
+					|| (uint64_t)sub.m_firstVertex * sub.m_vertexStride + (uint64_t)sub.m_vertexCount * sub.m_vertexStride > header->m_vertexSize
+					|| (uint64_t)sub.m_firstMeshlet + sub.m_meshletCount > header->m_meshletCount
+					|| (uint64_t)sub.m_firstLod + sub.m_lodCount > header->m_lodCount)
+					return nullptr;
+				uint64_t indexCount = sub.m_indexCount;
+				for (uint32_t l = 0; l < sub.m_lodCount; ++l)
+					indexCount = std::max(indexCount, (uint64_t)lods[sub.m_firstLod + l].m_firstIndex + lods[sub.m_firstLod + l].m_indexCount);
+				if (sub.m_indexOffset + indexCount * sub.m_indexSize > header->m_indexSize)
+					return nullptr;
+			}
+			return header;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define COOKED_MESH_EXTENSION ".dxmesh"
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// Cooked Mesh Format // Header, submesh table, material table, then 16 byte aligned vertex, index and meshlet blobs.
+		// Version 2 // Indices at the narrowest width per submesh, addressed in bytes, and optional meshlets.
+		// Version 3 // Levels of detail, their indices follow each submesh's full detail indices, described by a LOD table.
+		const uint32_t CookedMeshMagic = 0x534d5844; // "DXMS"
+		const uint32_t CookedMeshVersion = 3;
+		const uint32_t CookedMeshAlignment = 16;
+		const uint32_t CookedMeshPathLength = 256;
+
+		struct CookedMeshHeader
+		{
+			uint32_t m_magic;
+			uint32_t m_version;
+			uint32_t m_submeshCount;
+			uint32_t m_materialCount;
+			uint64_t m_submeshOffset;
+			uint64_t m_materialOffset;
+			uint64_t m_vertexOffset;
+			uint64_t m_vertexSize;
+			uint64_t m_indexOffset;
+			uint64_t m_indexSize;
+			uint64_t m_meshletOffset;
+			uint32_t m_meshletCount;
+			uint32_t m_lodCount;
+			uint64_t m_lodOffset;
+		};
+		struct CookedSubmesh
+		{
+			uint32_t m_firstVertex;
+			uint32_t m_vertexCount;
+			uint32_t m_indexOffset; // Bytes into the index blob.
+			uint32_t m_indexCount; // Full detail, levels follow.
+			uint32_t m_vertexStride;
+			uint32_t m_indexSize; // 2 or 4.
+			int32_t m_material; // -1 when untextured.
+			uint32_t m_firstMeshlet;
+			uint32_t m_meshletCount;
+			uint32_t m_firstLod;
+			uint32_t m_lodCount;
+			uint32_t m_padding;
+		};
+		struct CookedMaterial
+		{
+			char m_diffusePath[CookedMeshPathLength];
+		};
+
+		// Converts any Assimp supported model into the cooked format.
+		bool CookMesh(const char* srcPath, const char* dstPath);
+
+		// Validates a mapped cooked file, returning the header or nullptr.
+		const CookedMeshHeader* ReadCookedMesh(const void* data, size_t size);
+	}
+}
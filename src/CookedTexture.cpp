@@ -0,0 +1,1236 @@
+#include "CookedTexture.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "external/stb_image.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <limits>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// DXGI_FORMAT values, spelled out so this file needs no platform headers.
+		static const uint32_t DxgiFormats[COOKED_FORMAT_MAX] = { 28, 71, 77, 83, 98 }; // R8G8B8A8_UNORM, BC1_UNORM, BC3_UNORM, BC5_UNORM, BC7_UNORM
+		static const uint32_t BlockSizes[COOKED_FORMAT_MAX] = { 0, 8, 16, 16, 16 };
+
+		uint32_t GetBlockSize(CookedTextureFormat format)
+		{
+			return BlockSizes[format];
+		}
+		uint32_t GetDxgiFormat(CookedTextureFormat format)
+		{
+			return DxgiFormats[format];
+		}
+		uint32_t GetRowPitch(CookedTextureFormat format, uint32_t width)
+		{
+			if (format == COOKED_RGBA8)
+				return width * 4;
+			uint32_t blocks = (width + 3) / 4;
+			return (blocks ? blocks : 1) * BlockSizes[format];
+		}
+		uint32_t GetMipSize(CookedTextureFormat format, uint32_t width, uint32_t height)
+		{
+			if (format == COOKED_RGBA8)
+				return width * height * 4;
+			uint32_t blocks = (height + 3) / 4;
+			return GetRowPitch(format, width) * (blocks ? blocks : 1);
+		}
+
+		// Mips
+		static float SrgbToLinear(float c)
+		{
+			return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		static float LinearToSrgb(float c)
+		{
+			return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+		}
+		static double BesselI0(double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for (int k = 1; k < 32; ++k)
+			{
+				term *= (x * x) / (4.0 * k * k);
+				sum += term;
+			}
+			return sum;
+		}
+		static float FilterWeight(MipFilter filter, float t)
+		{
+			// t is the distance from the destination texel centre, in destination texels.
+			if (filter == MIP_FILTER_BOX)
+				return (fabsf(t) <= 0.5f) ? 1.0f : 0.0f;
+			const float radius = 3.0f, alpha = 4.0f;
+			if (fabsf(t) >= radius)
+				return 0.0f;
+			float sinc = (t == 0.0f) ? 1.0f : sinf(3.14159265f * t) / (3.14159265f * t);
+			float x = t / radius;
+			float window = (float)(BesselI0(alpha * sqrt(1.0 - x * x)) / BesselI0(alpha));
+			return sinc * window;
+		}
+		static float FilterSupport(MipFilter filter)
+		{
+			return (filter == MIP_FILTER_BOX) ? 0.5f : 3.0f;
+		}
+		// Resamples lines of 4 channel texels, lineCount lines of srcLength texels each. The taps are built once for every line.
+		static void ResampleLines(const float* src, float* dst, int srcLength, int dstLength, int lineCount, int texelStride, int srcLineStride, int dstLineStride, MipFilter filter)
+		{
+			struct Tap { int m_index; float m_weight; };
+			std::vector<std::vector<Tap>> taps(dstLength);
+			float scale = (float)srcLength / dstLength;
+			float support = FilterSupport(filter) * scale;
+			for (int x = 0; x < dstLength; ++x)
+			{
+				float centre = (x + 0.5f) * scale;
+				int first = (int)floorf(centre - support);
+				int last = (int)ceilf(centre + support);
+				float total = 0.0f;
+				for (int i = first; i <= last; ++i)
+				{
+					float w = FilterWeight(filter, ((i + 0.5f) - centre) / scale);
+					if (w == 0.0f)
+						continue;
+					int clamped = (i < 0) ? 0 : (i >= srcLength ? srcLength - 1 : i);
+					taps[x].push_back({ clamped, w });
+					total += w;
+				}
+				if (taps[x].empty() || total == 0.0f)
+				{
+					int nearest = (int)centre;
+					taps[x].assign(1, { (nearest < srcLength) ? nearest : srcLength - 1, 1.0f });
+					total = 1.0f;
+				}
+				for (auto& t : taps[x])
+					t.m_weight /= total;
+			}
+			for (int line = 0; line < lineCount; ++line)
+			{
+				const float* in = src + (size_t)line * srcLineStride;
+				float* out = dst + (size_t)line * dstLineStride;
+				for (int x = 0; x < dstLength; ++x)
+				{
+					float sum[4] = {};
+					for (const auto& t : taps[x])
+					{
+						const float* texel = in + (size_t)t.m_index * texelStride;
+						for (int c = 0; c < 4; ++c)
+							sum[c] += texel[c] * t.m_weight;
+					}
+					float* texel = out + (size_t)x * texelStride;
+					for (int c = 0; c < 4; ++c)
+						texel[c] = sum[c];
+				}
+			}
+		}
+		void GenerateMips(const uint8_t* rgba, int width, int height, MipFilter filter, bool srgb, std::vector<TextureImage>& mips)
+		{
+			float toLinear[256];
+			for (int i = 0; i < 256; ++i)
+				toLinear[i] = srgb ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+
+			mips.clear();
+			mips.emplace_back();
+			mips[0].m_width = width;
+			mips[0].m_height = height;
+			mips[0].m_pixels.assign(rgba, rgba + (size_t)width * height * 4);
+
+			// Filtered in float from the previous level so error does not accumulate through 8 bit rounding.
+			std::vector<float> level((size_t)width * height * 4);
+			for (size_t i = 0; i < level.size(); ++i)
+				level[i] = ((i & 3) == 3) ? rgba[i] / 255.0f : toLinear[rgba[i]];
+
+			std::vector<float> temp, next;
+			while (width > 1 || height > 1)
+			{
+				int nextWidth = (width > 1) ? width / 2 : 1;
+				int nextHeight = (height > 1) ? height / 2 : 1;
+
+				// Horizontal then vertical.
+				temp.assign((size_t)nextWidth * height * 4, 0.0f);
+				ResampleLines(level.data(), temp.data(), width, nextWidth, height, 4, width * 4, nextWidth * 4, filter);
+				next.assign((size_t)nextWidth * nextHeight * 4, 0.0f);
+				ResampleLines(temp.data(), next.data(), height, nextHeight, nextWidth, nextWidth * 4, 4, 4, filter);
+
+				TextureImage mip;
+				mip.m_width = nextWidth;
+				mip.m_height = nextHeight;
+				mip.m_pixels.resize(next.size());
+				for (size_t i = 0; i < next.size(); ++i)
+				{
+					float v = next[i] < 0.0f ? 0.0f : (next[i] > 1.0f ? 1.0f : next[i]);
+					if (srgb && (i & 3) != 3)
+						v = LinearToSrgb(v);
+					mip.m_pixels[i] = (uint8_t)(v * 255.0f + 0.5f);
+				}
+				mips.push_back(std::move(mip));
+
+				level.swap(next);
+				width = nextWidth;
+				height = nextHeight;
+			}
+		}
+
+		// Block Helpers
+		static int ColorError(const int a[4], const int b[4], int channels)
+		{
+			int error = 0;
+			for (int c = 0; c < channels; ++c)
+				error += (a[c] - b[c]) * (a[c] - b[c]);
+			return error;
+		}
+		// Principal axis of a set of points through power iteration, returns false when they all coincide.
+		static bool PrincipalAxis(const float points[][4], int count, int channels, float mean[4], float axis[4])
+		{
+			for (int c = 0; c < 4; ++c)
+				mean[c] = 0.0f;
+			for (int i = 0; i < count; ++i)
+				for (int c = 0; c < channels; ++c)
+					mean[c] += points[i][c] / count;
+			float covariance[4][4] = {};
+			for (int i = 0; i < count; ++i)
+				for (int a = 0; a < channels; ++a)
+					for (int b = 0; b < channels; ++b)
+						covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+			float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			for (int iteration = 0; iteration < 8; ++iteration)
+			{
+				float r[4] = {};
+				for (int a = 0; a < channels; ++a)
+					for (int b = 0; b < channels; ++b)
+						r[a] += covariance[a][b] * v[b];
+				float length = 0.0f;
+				for (int c = 0; c < channels; ++c)
+					length = fmaxf(length, fabsf(r[c]));
+				if (length < 1e-6f)
+					return false;
+				for (int c = 0; c < channels; ++c)
+					v[c] = r[c] / length;
+			}
+			float length = 0.0f;
+			for (int c = 0; c < channels; ++c)
+				length += v[c] * v[c];
+			length = sqrtf(length);
+			for (int c = 0; c < 4; ++c)
+				axis[c] = (c < channels) ? v[c] / length : 0.0f;
+			return true;
+		}
+		// Endpoints at the extremes of the block along its principal axis.
+		static void FitEndpoints(const float points[][4], int count, int channels, float e0[4], float e1[4])
+		{
+			float mean[4], axis[4];
+			if (!PrincipalAxis(points, count, channels, mean, axis))
+			{
+				for (int c = 0; c < 4; ++c)
+					e0[c] = e1[c] = mean[c];
+				return;
+			}
+			float minT = 1e30f, maxT = -1e30f;
+			for (int i = 0; i < count; ++i)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < channels; ++c)
+					t += (points[i][c] - mean[c]) * axis[c];
+				minT = fminf(minT, t);
+				maxT = fmaxf(maxT, t);
+			}
+			for (int c = 0; c < 4; ++c)
+			{
+				e0[c] = fminf(fmaxf(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+				e1[c] = fminf(fmaxf(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+			}
+		}
+		// Least squares endpoints for fixed interpolation weights, returns false when degenerate.
+		static bool RefineEndpoints(const float points[][4], const float weights[], int count, int channels, float e0[4], float e1[4])
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[4] = {}, bx[4] = {};
+			for (int i = 0; i < count; ++i)
+			{
+				float b = weights[i], a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (int c = 0; c < channels; ++c)
+				{
+					ax[c] += a * points[i][c];
+					bx[c] += b * points[i][c];
+				}
+			}
+			float det = aa * bb - ab * ab;
+			if (fabsf(det) < 1e-6f)
+				return false;
+			for (int c = 0; c < channels; ++c)
+			{
+				e0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+				e1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+			}
+			return true;
+		}
+
+		// BC1 // Two 565 endpoints and 2 bit indices, always encoded in four colour mode.
+		static uint16_t Pack565(const float c[4])
+		{
+			int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+			int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+			int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+			return (uint16_t)((r << 11) | (g << 5) | b);
+		}
+		static void Unpack565(uint16_t v, int c[4])
+		{
+			int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			c[0] = (r << 3) | (r >> 2);
+			c[1] = (g << 2) | (g >> 4);
+			c[2] = (b << 3) | (b >> 2);
+			c[3] = 255;
+		}
+		static void ColorPalette(uint16_t c0, uint16_t c1, bool fourColor, int palette[4][4])
+		{
+			Unpack565(c0, palette[0]);
+			Unpack565(c1, palette[1]);
+			for (int c = 0; c < 3; ++c)
+			{
+				if (fourColor)
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				else
+				{
+					palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+					palette[3][c] = 0;
+				}
+			}
+			palette[2][3] = 255;
+			palette[3][3] = fourColor ? 255 : 0;
+		}
+		static void EncodeColorBlock(const uint8_t block[64], uint8_t* output)
+		{
+			float points[16][4];
+			int pixels[16][4];
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					points[i][c] = block[i * 4 + c];
+					pixels[i][c] = block[i * 4 + c];
+				}
+			}
+			float e0[4] = {}, e1[4] = {};
+			FitEndpoints(points, 16, 3, e0, e1);
+
+			static const float IndexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			uint16_t bestC0 = 0, bestC1 = 0;
+			uint32_t bestIndices = 0;
+			int bestError = INT32_MAX;
+			for (int iteration = 0; iteration < 3; ++iteration)
+			{
+				uint16_t c0 = Pack565(e1), c1 = Pack565(e0);
+				if (c0 < c1)
+				{
+					uint16_t t = c0;
+					c0 = c1;
+					c1 = t;
+				}
+				int palette[4][4];
+				ColorPalette(c0, c1, true, palette);
+				uint32_t indices = 0;
+				int error = 0;
+				float weights[16];
+				for (int i = 0; i < 16; ++i)
+				{
+					int best = 0, bestDistance = INT32_MAX;
+					for (int p = 0; p < ((c0 == c1) ? 1 : 4); ++p)
+					{
+						int distance = ColorError(pixels[i], palette[p], 3);
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							best = p;
+						}
+					}
+					indices |= (uint32_t)best << (i * 2);
+					error += bestDistance;
+					weights[i] = IndexWeights[best];
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestC0 = c0;
+					bestC1 = c1;
+					bestIndices = indices;
+				}
+				if (error == 0 || c0 == c1)
+					break;
+				// Refit towards c0 = e0, c1 = e1 with the chosen weights.
+				float r0[4] = {}, r1[4] = {};
+				if (!RefineEndpoints(points, weights, 16, 3, r0, r1))
+					break;
+				for (int c = 0; c < 3; ++c)
+				{
+					e1[c] = r0[c];
+					e0[c] = r1[c];
+				}
+			}
+			output[0] = (uint8_t)(bestC0 & 0xff);
+			output[1] = (uint8_t)(bestC0 >> 8);
+			output[2] = (uint8_t)(bestC1 & 0xff);
+			output[3] = (uint8_t)(bestC1 >> 8);
+			for (int i = 0; i < 4; ++i)
+				output[4 + i] = (uint8_t)(bestIndices >> (i * 8));
+		}
+		static void DecodeColorBlock(const uint8_t* input, bool allowThreeColor, uint8_t block[64])
+		{
+			uint16_t c0 = (uint16_t)(input[0] | (input[1] << 8));
+			uint16_t c1 = (uint16_t)(input[2] | (input[3] << 8));
+			uint32_t indices = input[4] | (input[5] << 8) | (input[6] << 16) | ((uint32_t)input[7] << 24);
+			int palette[4][4];
+			ColorPalette(c0, c1, !allowThreeColor || c0 > c1, palette);
+			for (int i = 0; i < 16; ++i)
+			{
+				int index = (indices >> (i * 2)) & 3;
+				for (int c = 0; c < 4; ++c)
+					block[i * 4 + c] = (uint8_t)palette[index][c];
+			}
+		}
+
+		// BC4 // One channel, two 8 bit endpoints and 3 bit indices. Used for BC3 alpha and both BC5 channels.
+		static void SinglePalette(int a0, int a1, int palette[8])
+		{
+			palette[0] = a0;
+			palette[1] = a1;
+			if (a0 > a1)
+			{
+				for (int i = 1; i < 7; ++i)
+					palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+			}
+			else
+			{
+				for (int i = 1; i < 5; ++i)
+					palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+		}
+		static void EncodeSingleBlock(const uint8_t block[64], int channel, uint8_t* output)
+		{
+			int minValue = 255, maxValue = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				minValue = (block[i * 4 + channel] < minValue) ? block[i * 4 + channel] : minValue;
+				maxValue = (block[i * 4 + channel] > maxValue) ? block[i * 4 + channel] : maxValue;
+			}
+			int palette[8];
+			SinglePalette(maxValue, minValue, palette);
+			uint64_t indices = 0;
+			for (int i = 0; i < 16 && maxValue != minValue; ++i)
+			{
+				int value = block[i * 4 + channel];
+				int best = 0, bestDistance = INT32_MAX;
+				for (int p = 0; p < 8; ++p)
+				{
+					int distance = abs(value - palette[p]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= (uint64_t)best << (i * 3);
+			}
+			output[0] = (uint8_t)maxValue;
+			output[1] = (uint8_t)minValue;
+			for (int i = 0; i < 6; ++i)
+				output[2 + i] = (uint8_t)(indices >> (i * 8));
+		}
+		static void DecodeSingleBlock(const uint8_t* input, int channel, uint8_t block[64])
+		{
+			int palette[8];
+			SinglePalette(input[0], input[1], palette);
+			uint64_t indices = 0;
+			for (int i = 0; i < 6; ++i)
+				indices |= (uint64_t)input[2 + i] << (i * 8);
+			for (int i = 0; i < 16; ++i)
+				block[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+		}
+
+		// BC7 // Every mode decodes. The cooker tries mode 6 (one RGBA subset) and the two subset modes on the partitions that fit
+		// the block best, 1 and 3 when it is opaque and 7 when it is not, and keeps whichever reproduces the block most closely.
+		struct Bc7Mode
+		{
+			int m_subsets;
+			int m_partitionBits;
+			int m_rotationBits;
+			int m_indexSelectionBits;
+			int m_colorBits;
+			int m_alphaBits; // 0 when alpha is always 255.
+			int m_endpointPBits; // 1 when every endpoint has its own p-bit.
+			int m_sharedPBits; // 1 when both endpoints of a subset share one.
+			int m_indexBits;
+			int m_secondaryIndexBits; // Modes 4 and 5, alpha and colour interpolate apart.
+		};
+		static const Bc7Mode Bc7Modes[8] =
+		{
+			{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+			{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+			{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+			{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+			{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+			{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+			{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+			{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+		};
+		static const int Bc7Weights2[4] = { 0, 21, 43, 64 };
+		static const int Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+		static const int Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		// Two subset partitions, bit i is set when pixel i is in the second subset.
+		static const uint16_t Bc7Partitions2[64] =
+		{
+			0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+			0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+			0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+			0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+		};
+		// Three subset partitions, the subset of each pixel.
+		static const uint8_t Bc7Partitions3[64][16] =
+		{
+			{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+			{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+			{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+			{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+			{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+			{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+			{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+			{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+			{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+			{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+			{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+			{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+			{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+			{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+			{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+			{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+			{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+			{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+			{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+			{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+			{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+			{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+			{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+			{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+			{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+			{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+			{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+			{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+			{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+			{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+			{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+			{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 },
+		};
+		// Anchor pixels, whose index is stored without its top bit. The first subset's is always pixel 0.
+		static const uint8_t Bc7Anchors2[64] =
+		{
+			15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+			15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+		};
+		static const uint8_t Bc7Anchors3[2][64] =
+		{
+			{
+				3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+				8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+			},
+			{
+				15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+				15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+			},
+		};
+		static const int* Bc7Weights(int bits)
+		{
+			return (bits == 2) ? Bc7Weights2 : (bits == 3 ? Bc7Weights3 : Bc7Weights4);
+		}
+		static int Bc7Subset(int subsets, int partition, int pixel)
+		{
+			if (subsets == 2)
+				return (Bc7Partitions2[partition] >> pixel) & 1;
+			return (subsets == 3) ? Bc7Partitions3[partition][pixel] : 0;
+		}
+		static int Bc7Anchor(int subsets, int partition, int subset)
+		{
+			if (subset == 0)
+				return 0;
+			return (subsets == 2) ? Bc7Anchors2[partition] : Bc7Anchors3[subset - 1][partition];
+		}
+		// Stored bits to 8, the top bits repeat into the bottom.
+		static int ExpandBc7(int value, int bits)
+		{
+			return (value << (8 - bits)) | (value >> (2 * bits - 8));
+		}
+		// One quantized endpoint to 8 bits per channel, alpha is 255 in modes without it.
+		static void ExpandBc7Endpoint(const Bc7Mode& mode, const int quantized[4], int pBit, int endpoint[4])
+		{
+			bool hasPBit = mode.m_endpointPBits || mode.m_sharedPBits;
+			for (int c = 0; c < 4; ++c)
+			{
+				int bits = (c < 3) ? mode.m_colorBits : mode.m_alphaBits;
+				if (bits == 0)
+					endpoint[c] = 255;
+				else
+					endpoint[c] = hasPBit ? ExpandBc7((quantized[c] << 1) | pBit, bits + 1) : ExpandBc7(quantized[c], bits);
+			}
+		}
+
+		struct BitWriter
+		{
+			uint64_t m_bits[2] = {};
+			int m_position = 0;
+
+			void Write(uint32_t value, int count)
+			{
+				for (int i = 0; i < count; ++i, ++m_position)
+				{
+					if (value & (1u << i))
+						m_bits[m_position >> 6] |= 1ull << (m_position & 63);
+				}
+			}
+		};
+		struct BitReader
+		{
+			const uint8_t* m_data;
+			int m_position = 0;
+
+			uint32_t Read(int count)
+			{
+				uint32_t value = 0;
+				for (int i = 0; i < count; ++i, ++m_position)
+					value |= (uint32_t)((m_data[m_position >> 3] >> (m_position & 7)) & 1) << i;
+				return value;
+			}
+		};
+		// Quantizes an endpoint at the mode's precision with the given p-bit, returning the squared error of what it expands to.
+		static int QuantizeBc7Endpoint(const Bc7Mode& mode, const float e[4], int pBit, int quantized[4])
+		{
+			bool hasPBit = mode.m_endpointPBits || mode.m_sharedPBits;
+			int error = 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				int bits = (c < 3) ? mode.m_colorBits : mode.m_alphaBits;
+				int target = (int)(e[c] + 0.5f);
+				quantized[c] = 0;
+				if (bits == 0)
+					continue;
+				// The expansion is not linear, so the neighbours of the nearest step are tried too.
+				int levels = (1 << bits) - 1;
+				int guess = hasPBit ? (int)floorf((e[c] * ((2 << bits) - 1) / 255.0f - pBit) / 2.0f + 0.5f) : (int)(e[c] * levels / 255.0f + 0.5f);
+				int bestError = INT32_MAX;
+				for (int q = (guess > 0 ? guess - 1 : 0); q <= (guess < levels ? guess + 1 : levels); ++q)
+				{
+					int v = hasPBit ? ExpandBc7((q << 1) | pBit, bits + 1) : ExpandBc7(q, bits);
+					if ((v - target) * (v - target) < bestError)
+					{
+						bestError = (v - target) * (v - target);
+						quantized[c] = q;
+					}
+				}
+				error += bestError;
+			}
+			return error;
+		}
+		// Both endpoints of a subset, trying each p-bit where the mode has them.
+		static void QuantizeBc7Endpoints(const Bc7Mode& mode, const float e[2][4], int quantized[2][4], int pBits[2])
+		{
+			pBits[0] = pBits[1] = 0;
+			if (mode.m_endpointPBits)
+			{
+				for (int i = 0; i < 2; ++i)
+				{
+					int q[4], bestError = INT32_MAX;
+					for (int p = 0; p < 2; ++p)
+					{
+						int error = QuantizeBc7Endpoint(mode, e[i], p, q);
+						if (error < bestError)
+						{
+							bestError = error;
+							pBits[i] = p;
+							memcpy(quantized[i], q, sizeof(q));
+						}
+					}
+				}
+			}
+			else if (mode.m_sharedPBits)
+			{
+				int q[2][4], bestError = INT32_MAX;
+				for (int p = 0; p < 2; ++p)
+				{
+					int error = QuantizeBc7Endpoint(mode, e[0], p, q[0]) + QuantizeBc7Endpoint(mode, e[1], p, q[1]);
+					if (error < bestError)
+					{
+						bestError = error;
+						pBits[0] = pBits[1] = p;
+						memcpy(quantized, q, sizeof(q));
+					}
+				}
+			}
+			else
+			{
+				QuantizeBc7Endpoint(mode, e[0], 0, quantized[0]);
+				QuantizeBc7Endpoint(mode, e[1], 0, quantized[1]);
+			}
+		}
+		// Fits one subset's pixels at the mode's precision, refining the endpoints against the indices chosen. Returns the squared error.
+		static int EncodeBc7Subset(const Bc7Mode& mode, const int pixels[16][4], const int members[16], int count, int quantized[2][4], int pBits[2], int indices[16])
+		{
+			float points[16][4];
+			for (int i = 0; i < count; ++i)
+				for (int c = 0; c < 4; ++c)
+					points[i][c] = (float)pixels[members[i]][c];
+			int channels = mode.m_alphaBits ? 4 : 3;
+			float e[2][4];
+			FitEndpoints(points, count, channels, e[0], e[1]);
+
+			const int* weights = Bc7Weights(mode.m_indexBits);
+			int paletteSize = 1 << mode.m_indexBits;
+			int bestError = INT32_MAX;
+			for (int iteration = 0; iteration < 3; ++iteration)
+			{
+				int q[2][4], p[2], endpoints[2][4], palette[16][4];
+				QuantizeBc7Endpoints(mode, e, q, p);
+				ExpandBc7Endpoint(mode, q[0], p[0], endpoints[0]);
+				ExpandBc7Endpoint(mode, q[1], p[1], endpoints[1]);
+				for (int i = 0; i < paletteSize; ++i)
+					for (int c = 0; c < 4; ++c)
+						palette[i][c] = ((64 - weights[i]) * endpoints[0][c] + weights[i] * endpoints[1][c] + 32) >> 6;
+
+				int chosen[16], error = 0;
+				float fitted[16];
+				for (int i = 0; i < count; ++i)
+				{
+					int best = 0, bestDistance = INT32_MAX;
+					for (int j = 0; j < paletteSize; ++j)
+					{
+						int distance = ColorError(pixels[members[i]], palette[j], 4);
+						if (distance < bestDistance)
+						{
+							bestDistance = distance;
+							best = j;
+						}
+					}
+					chosen[i] = best;
+					error += bestDistance;
+					fitted[i] = weights[best] / 64.0f;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					memcpy(quantized, q, sizeof(q));
+					memcpy(pBits, p, sizeof(p));
+					for (int i = 0; i < count; ++i)
+						indices[members[i]] = chosen[i];
+				}
+				if (error == 0 || !RefineEndpoints(points, fitted, count, channels, e[0], e[1]))
+					break;
+			}
+			return bestError;
+		}
+		// Encodes the block in one mode and partition, returning the squared error of the result.
+		static int EncodeBc7Mode(int modeIndex, int partition, const int pixels[16][4], uint8_t* output)
+		{
+			const Bc7Mode& mode = Bc7Modes[modeIndex];
+			int quantized[3][2][4], pBits[3][2], indices[16];
+			int error = 0;
+			for (int s = 0; s < mode.m_subsets; ++s)
+			{
+				int members[16], count = 0;
+				for (int i = 0; i < 16; ++i)
+				{
+					if (Bc7Subset(mode.m_subsets, partition, i) == s)
+						members[count++] = i;
+				}
+				error += EncodeBc7Subset(mode, pixels, members, count, quantized[s], pBits[s], indices);
+
+				// The anchor's index is stored without its top bit, so it has to be in the lower half. Swapping the endpoints mirrors them.
+				int highest = (1 << mode.m_indexBits) - 1;
+				if (indices[Bc7Anchor(mode.m_subsets, partition, s)] > highest / 2)
+				{
+					for (int c = 0; c < 4; ++c)
+					{
+						int t = quantized[s][0][c];
+						quantized[s][0][c] = quantized[s][1][c];
+						quantized[s][1][c] = t;
+					}
+					int t = pBits[s][0];
+					pBits[s][0] = pBits[s][1];
+					pBits[s][1] = t;
+					for (int i = 0; i < count; ++i)
+						indices[members[i]] = highest - indices[members[i]];
+				}
+			}
+
+			BitWriter writer;
+			writer.Write(1 << modeIndex, modeIndex + 1);
+			writer.Write(partition, mode.m_partitionBits);
+			for (int c = 0; c < 4; ++c)
+			{
+				int bits = (c < 3) ? mode.m_colorBits : mode.m_alphaBits;
+				for (int s = 0; s < mode.m_subsets; ++s)
+				{
+					writer.Write(quantized[s][0][c], bits);
+					writer.Write(quantized[s][1][c], bits);
+				}
+			}
+			for (int s = 0; s < mode.m_subsets; ++s)
+			{
+				if (mode.m_endpointPBits)
+				{
+					writer.Write(pBits[s][0], 1);
+					writer.Write(pBits[s][1], 1);
+				}
+				else if (mode.m_sharedPBits)
+					writer.Write(pBits[s][0], 1);
+			}
+			for (int i = 0; i < 16; ++i)
+			{
+				bool anchor = i == Bc7Anchor(mode.m_subsets, partition, Bc7Subset(mode.m_subsets, partition, i));
+				writer.Write(indices[i], mode.m_indexBits - (anchor ? 1 : 0));
+			}
+			memcpy(output, writer.m_bits, 16);
+			return error;
+		}
+		// Squared distance of the pixels from the best line through each subset, ranks partitions before any is encoded. The
+		// variance off the principal axis, from the covariance alone.
+		static float EstimateBc7Partition(const float points[16][4], int channels, int partition)
+		{
+			float total = 0.0f;
+			for (int s = 0; s < 2; ++s)
+			{
+				float sum[4] = {}, products[4][4] = {};
+				int count = 0;
+				for (int i = 0; i < 16; ++i)
+				{
+					if (Bc7Subset(2, partition, i) != s)
+						continue;
+					count++;
+					for (int a = 0; a < channels; ++a)
+					{
+						sum[a] += points[i][a];
+						for (int b = a; b < channels; ++b)
+							products[a][b] += points[i][a] * points[i][b];
+					}
+				}
+				float covariance[4][4], trace = 0.0f;
+				for (int a = 0; a < channels; ++a)
+				{
+					for (int b = a; b < channels; ++b)
+						covariance[a][b] = covariance[b][a] = products[a][b] - sum[a] * sum[b] / count;
+					trace += covariance[a][a];
+				}
+				// A few power iterations are plenty for ranking.
+				float v[4] = { 1.0f, 1.0f, 1.0f, 1.0f }, r[4], largest = 0.0f;
+				for (int iteration = 0; iteration < 3; ++iteration)
+				{
+					float length = 0.0f, dot = 0.0f;
+					for (int a = 0; a < channels; ++a)
+					{
+						r[a] = 0.0f;
+						for (int b = 0; b < channels; ++b)
+							r[a] += covariance[a][b] * v[b];
+						dot += r[a] * v[a];
+						length += v[a] * v[a];
+					}
+					largest = (length > 0.0f) ? dot / length : 0.0f;
+					float scale = 0.0f;
+					for (int a = 0; a < channels; ++a)
+						scale = fmaxf(scale, fabsf(r[a]));
+					if (scale < 1e-6f)
+						break;
+					for (int a = 0; a < channels; ++a)
+						v[a] = r[a] / scale;
+				}
+				total += trace - largest;
+			}
+			return total;
+		}
+		static void EncodeBc7Block(const uint8_t block[64], uint8_t* output)
+		{
+			int pixels[16][4];
+			float points[16][4];
+			bool opaque = true;
+			for (int i = 0; i < 16; ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					pixels[i][c] = block[i * 4 + c];
+					points[i][c] = block[i * 4 + c];
+				}
+				opaque = opaque && block[i * 4 + 3] == 255;
+			}
+			// Within a step or two per channel, as close as any mode gets.
+			int bestError = EncodeBc7Mode(6, 0, pixels, output);
+			if (bestError <= 16 * 4 * 2)
+				return;
+
+			// Partitions // The few whose subsets lie closest to a line each, encoded in full.
+			const int candidates = 2;
+			int ranked[candidates];
+			float rankedError[candidates];
+			for (int i = 0; i < candidates; ++i)
+			{
+				ranked[i] = -1;
+				rankedError[i] = 1e30f;
+			}
+			int channels = opaque ? 3 : 4;
+			for (int partition = 0; partition < 64; ++partition)
+			{
+				float estimate = EstimateBc7Partition(points, channels, partition);
+				for (int i = 0; i < candidates; ++i)
+				{
+					if (estimate < rankedError[i])
+					{
+						for (int j = candidates - 1; j > i; --j)
+						{
+							ranked[j] = ranked[j - 1];
+							rankedError[j] = rankedError[j - 1];
+						}
+						ranked[i] = partition;
+						rankedError[i] = estimate;
+						break;
+					}
+				}
+			}
+			static const int OpaqueModes[2] = { 3, 1 }, AlphaModes[1] = { 7 };
+			const int* modes = opaque ? OpaqueModes : AlphaModes;
+			int modeCount = opaque ? 2 : 1;
+			uint8_t encoded[16];
+			// A partition whose estimate already exceeds the error in hand cannot win, the estimate leaves out quantization. Mode 1 is
+			// rarely better than mode 3 and is only tried on the closest partition.
+			for (int i = 0; i < candidates && rankedError[i] < bestError; ++i)
+			{
+				for (int m = 0; m < (i ? 1 : modeCount); ++m)
+				{
+					int error = EncodeBc7Mode(modes[m], ranked[i], pixels, encoded);
+					if (error < bestError)
+					{
+						bestError = error;
+						memcpy(output, encoded, 16);
+					}
+				}
+			}
+		}
+		static void DecodeBc7Block(const uint8_t* input, uint8_t block[64])
+		{
+			// The mode is the number of zero bits before the first set one.
+			BitReader reader = { input };
+			int modeIndex = 0;
+			while (modeIndex < 8 && reader.Read(1) == 0)
+				modeIndex++;
+			if (modeIndex == 8)
+			{
+				memset(block, 0, 64); // Reserved, decodes to transparent black.
+				return;
+			}
+			const Bc7Mode& mode = Bc7Modes[modeIndex];
+			int partition = reader.Read(mode.m_partitionBits);
+			int rotation = reader.Read(mode.m_rotationBits);
+			int indexSelection = reader.Read(mode.m_indexSelectionBits);
+
+			int endpointCount = mode.m_subsets * 2;
+			int quantized[6][4] = {}, pBits[6] = {};
+			for (int c = 0; c < 4; ++c)
+			{
+				int bits = (c < 3) ? mode.m_colorBits : mode.m_alphaBits;
+				for (int e = 0; e < endpointCount; ++e)
+					quantized[e][c] = reader.Read(bits);
+			}
+			for (int e = 0; e < endpointCount && mode.m_endpointPBits; ++e)
+				pBits[e] = reader.Read(1);
+			for (int s = 0; s < mode.m_subsets && mode.m_sharedPBits; ++s)
+				pBits[s * 2] = pBits[s * 2 + 1] = reader.Read(1);
+			int endpoints[6][4];
+			for (int e = 0; e < endpointCount; ++e)
+				ExpandBc7Endpoint(mode, quantized[e], pBits[e], endpoints[e]);
+
+			int indices[16], secondary[16] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				bool anchor = i == Bc7Anchor(mode.m_subsets, partition, Bc7Subset(mode.m_subsets, partition, i));
+				indices[i] = reader.Read(mode.m_indexBits - (anchor ? 1 : 0));
+			}
+			for (int i = 0; i < 16 && mode.m_secondaryIndexBits; ++i)
+				secondary[i] = reader.Read(mode.m_secondaryIndexBits - (i == 0 ? 1 : 0));
+
+			for (int i = 0; i < 16; ++i)
+			{
+				int s = Bc7Subset(mode.m_subsets, partition, i);
+				const int* e0 = endpoints[s * 2];
+				const int* e1 = endpoints[s * 2 + 1];
+				int colorWeight = Bc7Weights(mode.m_indexBits)[indices[i]], alphaWeight = colorWeight;
+				if (mode.m_secondaryIndexBits)
+				{
+					// The selection bit swaps which index set interpolates colour.
+					int other = Bc7Weights(mode.m_secondaryIndexBits)[secondary[i]];
+					if (indexSelection)
+						colorWeight = other;
+					else
+						alphaWeight = other;
+				}
+				uint8_t* pixel = block + i * 4;
+				for (int c = 0; c < 3; ++c)
+					pixel[c] = (uint8_t)(((64 - colorWeight) * e0[c] + colorWeight * e1[c] + 32) >> 6);
+				pixel[3] = (uint8_t)(((64 - alphaWeight) * e0[3] + alphaWeight * e1[3] + 32) >> 6);
+				// Rotation swaps alpha with one of the colour channels.
+				if (rotation)
+				{
+					uint8_t t = pixel[3];
+					pixel[3] = pixel[rotation - 1];
+					pixel[rotation - 1] = t;
+				}
+			}
+		}
+
+		void CompressImage(const TextureImage& image, CookedTextureFormat format, std::vector<uint8_t>& output)
+		{
+			if (format == COOKED_RGBA8)
+			{
+				output = image.m_pixels;
+				return;
+			}
+			int blocksX = (image.m_width + 3) / 4, blocksY = (image.m_height + 3) / 4;
+			uint32_t blockSize = BlockSizes[format];
+			output.resize((size_t)blocksX * blocksY * blockSize);
+			uint8_t block[64];
+			for (int by = 0; by < blocksY; ++by)
+			{
+				for (int bx = 0; bx < blocksX; ++bx)
+				{
+					// Gather, repeating the edge past the image.
+					for (int i = 0; i < 16; ++i)
+					{
+						int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+						x = (x < image.m_width) ? x : image.m_width - 1;
+						y = (y < image.m_height) ? y : image.m_height - 1;
+						memcpy(block + i * 4, &image.m_pixels[((size_t)y * image.m_width + x) * 4], 4);
+					}
+					uint8_t* out = &output[((size_t)by * blocksX + bx) * blockSize];
+					switch (format)
+					{
+					case COOKED_BC1:
+						EncodeColorBlock(block, out);
+						break;
+					case COOKED_BC3:
+						EncodeSingleBlock(block, 3, out);
+						EncodeColorBlock(block, out + 8);
+						break;
+					case COOKED_BC5:
+						EncodeSingleBlock(block, 0, out);
+						EncodeSingleBlock(block, 1, out + 8);
+						break;
+					case COOKED_BC7:
+						EncodeBc7Block(block, out);
+						break;
+					default:
+						break;
+					}
+				}
+			}
+		}
+		void DecompressImage(const uint8_t* data, CookedTextureFormat format, int width, int height, TextureImage& image)
+		{
+			image.m_width = width;
+			image.m_height = height;
+			image.m_pixels.assign((size_t)width * height * 4, 0);
+			if (format == COOKED_RGBA8)
+			{
+				memcpy(image.m_pixels.data(), data, image.m_pixels.size());
+				return;
+			}
+			int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+			uint32_t blockSize = BlockSizes[format];
+			uint8_t block[64];
+			for (int by = 0; by < blocksY; ++by)
+			{
+				for (int bx = 0; bx < blocksX; ++bx)
+				{
+					const uint8_t* in = data + ((size_t)by * blocksX + bx) * blockSize;
+					memset(block, 255, sizeof(block));
+					switch (format)
+					{
+					case COOKED_BC1:
+						DecodeColorBlock(in, true, block);
+						break;
+					case COOKED_BC3:
+						DecodeColorBlock(in + 8, false, block);
+						DecodeSingleBlock(in, 3, block);
+						break;
+					case COOKED_BC5:
+						DecodeSingleBlock(in, 0, block);
+						DecodeSingleBlock(in + 8, 1, block);
+						for (int i = 0; i < 16; ++i)
+							block[i * 4 + 2] = 0;
+						break;
+					case COOKED_BC7:
+						DecodeBc7Block(in, block);
+						break;
+					default:
+						break;
+					}
+					for (int i = 0; i < 16; ++i)
+					{
+						int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+						if (x < width && y < height)
+							memcpy(&image.m_pixels[((size_t)y * width + x) * 4], block + i * 4, 4);
+					}
+				}
+			}
+		}
+		double ComputePSNR(const TextureImage& a, const TextureImage& b, CookedTextureFormat format)
+		{
+			// Only the channels the format stores.
+			int channels = (format == COOKED_BC1) ? 3 : (format == COOKED_BC5 ? 2 : 4);
+			double squared = 0.0;
+			size_t count = (size_t)a.m_width * a.m_height;
+			for (size_t i = 0; i < count; ++i)
+			{
+				for (int c = 0; c < channels; ++c)
+				{
+					double d = (double)a.m_pixels[i * 4 + c] - b.m_pixels[i * 4 + c];
+					squared += d * d;
+				}
+			}
+			double mse = squared / ((double)count * channels);
+			if (mse == 0.0)
+				return std::numeric_limits<double>::infinity();
+			return 10.0 * log10(255.0 * 255.0 / mse);
+		}
+
+		bool CookTexture(const char* srcPath, const char* dstPath, CookedTextureFormat format, MipFilter filter, CookTextureReport* report)
+		{
+			int width, height, channels;
+			unsigned char* pixels = stbi_load(srcPath, &width, &height, &channels, 4);
+			if (!pixels)
+			{
+				printf("Texture cook error: %s\n", stbi_failure_reason());
+				return false;
+			}
+			TextureImage source;
+			source.m_width = width;
+			source.m_height = height;
+			source.m_pixels.assign(pixels, pixels + (size_t)width * height * 4);
+			stbi_image_free(pixels);
+			return CookTexture(source, dstPath, format, filter, report);
+		}
+		bool CookTexture(const TextureImage& source, const char* dstPath, CookedTextureFormat format, MipFilter filter, CookTextureReport* report)
+		{
+			// D3D11 needs the top level of a block compressed texture to be whole blocks.
+			if (format != COOKED_RGBA8 && ((source.m_width & 3) || (source.m_height & 3)))
+			{
+				printf("Texture cook warning: %dx%d is not a multiple of 4, storing RGBA8.\n", source.m_width, source.m_height);
+				format = COOKED_RGBA8;
+			}
+
+			// Two channel data is not colour, keep it linear.
+			std::vector<TextureImage> mips;
+			GenerateMips(source.m_pixels.data(), source.m_width, source.m_height, filter, format != COOKED_BC5, mips);
+
+			std::vector<std::vector<uint8_t>> levels(mips.size());
+			size_t sourceBytes = 0, cookedBytes = 0, texels = 0;
+			auto encodeStart = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < mips.size(); ++i)
+			{
+				CompressImage(mips[i], format, levels[i]);
+				sourceBytes += mips[i].m_pixels.size();
+				cookedBytes += levels[i].size();
+				texels += (size_t)mips[i].m_width * mips[i].m_height;
+			}
+			double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - encodeStart).count();
+
+			// Header
+			CookedTextureHeader header = {};
+			header.m_magic = CookedTextureMagic;
+			header.m_size = 124;
+			header.m_flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | ((format == COOKED_RGBA8) ? 0x8 : 0x80000); // CAPS, HEIGHT, WIDTH, PIXELFORMAT, MIPMAPCOUNT, PITCH or LINEARSIZE
+			header.m_height = source.m_height;
+			header.m_width = source.m_width;
+			header.m_pitchOrLinearSize = (format == COOKED_RGBA8) ? GetRowPitch(format, source.m_width) : (uint32_t)levels[0].size();
+			header.m_depth = 1;
+			header.m_mipCount = (uint32_t)mips.size();
+			header.m_pixelFormatSize = 32;
+			header.m_pixelFormatFlags = 0x4; // FOURCC
+			header.m_fourCC = CookedTextureDX10;
+			header.m_caps[0] = 0x1000 | ((mips.size() > 1) ? (0x8 | 0x400000) : 0); // TEXTURE, COMPLEX, MIPMAP
+			header.m_dxgiFormat = DxgiFormats[format];
+			header.m_resourceDimension = 3; // TEXTURE2D
+			header.m_arraySize = 1;
+
+			FILE* file = fopen(dstPath, "wb");
+			if (!file)
+				return false;
+			bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+			for (auto& level : levels)
+				written = written && fwrite(level.data(), 1, level.size(), file) == level.size();
+			fclose(file);
+
+			if (report)
+			{
+				TextureImage decoded;
+				DecompressImage(levels[0].data(), format, source.m_width, source.m_height, decoded);
+				report->m_format = format;
+				report->m_width = source.m_width;
+				report->m_height = source.m_height;
+				report->m_mipCount = (int)mips.size();
+				report->m_sourceBytes = sourceBytes;
+				report->m_cookedBytes = cookedBytes;
+				report->m_psnr = ComputePSNR(mips[0], decoded, format);
+				report->m_encodeMs = encodeMs;
+				report->m_megapixelsPerSecond = (encodeMs > 0.0) ? texels / (encodeMs * 1000.0) : 0.0;
+			}
+			return written;
+		}
+
+		const CookedTextureHeader* ReadCookedTexture(const void* data, size_t size, std::vector<CookedMip>& mips)
+		{
+			mips.clear();
+			if (!data || size < sizeof(CookedTextureHeader))
+				return nullptr;
+			const CookedTextureHeader* header = (const CookedTextureHeader*)data;
+			if (header->m_magic != CookedTextureMagic || header->m_size != 124 || header->m_fourCC != CookedTextureDX10)
+				return nullptr;
+			if (header->m_resourceDimension != 3 || header->m_arraySize != 1 || header->m_width == 0 || header->m_height == 0)
+				return nullptr;
+			int format = -1;
+			for (int i = 0; i < COOKED_FORMAT_MAX; ++i)
+			{
+				if (DxgiFormats[i] == header->m_dxgiFormat)
+					format = i;
+			}
+			if (format < 0)
+				return nullptr;
+
+			uint32_t mipCount = header->m_mipCount ? header->m_mipCount : 1;
+			uint32_t width = header->m_width, height = header->m_height;
+			size_t offset = sizeof(CookedTextureHeader);
+			for (uint32_t i = 0; i < mipCount; ++i)
+			{
+				CookedMip mip;
+				mip.m_width = width;
+				mip.m_height = height;
+				mip.m_rowPitch = GetRowPitch((CookedTextureFormat)format, width);
+				mip.m_size = GetMipSize((CookedTextureFormat)format, width, height);
+				if (offset + mip.m_size > size)
+				{
+					mips.clear();
+					return nullptr;
+				}
+				mip.m_data = (const uint8_t*)data + offset;
+				mips.push_back(mip);
+				offset += mip.m_size;
+				width = (width > 1) ? width / 2 : 1;
+				height = (height > 1) ? height / 2 : 1;
+			}
+			return header;
+		}
+	}
+}
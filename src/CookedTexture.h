@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define COOKED_TEXTURE_EXTENSION ".dds"
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// Cooked Texture Format // A plain DDS file with the DX10 extension header, every mip level tightly packed after it.
+		// Kept free of platform headers so the cooker and its encoders build and run anywhere.
+		const uint32_t CookedTextureMagic = 0x20534444; // "DDS "
+		const uint32_t CookedTextureDX10 = 0x30315844; // "DX10"
+
+		enum CookedTextureFormat
+		{
+			COOKED_RGBA8,
+			COOKED_BC1, // RGB, 4 bpp.
+			COOKED_BC3, // RGBA, 8 bpp.
+			COOKED_BC5, // Two channel, 8 bpp. Normal maps.
+			COOKED_BC7, // RGBA, 8 bpp, highest quality.
+			COOKED_FORMAT_MAX,
+		};
+		enum MipFilter
+		{
+			MIP_FILTER_BOX,
+			MIP_FILTER_KAISER,
+		};
+
+		struct CookedTextureHeader
+		{
+			uint32_t m_magic;
+			// DDS_HEADER
+			uint32_t m_size;
+			uint32_t m_flags;
+			uint32_t m_height;
+			uint32_t m_width;
+			uint32_t m_pitchOrLinearSize;
+			uint32_t m_depth;
+			uint32_t m_mipCount;
+			uint32_t m_reserved1[11];
+			uint32_t m_pixelFormatSize;
+			uint32_t m_pixelFormatFlags;
+			uint32_t m_fourCC;
+			uint32_t m_rgbBitCount;
+			uint32_t m_bitMasks[4];
+			uint32_t m_caps[4];
+			uint32_t m_reserved2;
+			// DDS_HEADER_DXT10
+			uint32_t m_dxgiFormat;
+			uint32_t m_resourceDimension;
+			uint32_t m_miscFlag;
+			uint32_t m_arraySize;
+			uint32_t m_miscFlags2;
+		};
+
+		// RGBA8 image, one per mip level.
+		struct TextureImage
+		{
+			int m_width = 0;
+			int m_height = 0;
+			std::vector<uint8_t> m_pixels;
+		};
+		// Location of one mip level inside a cooked file.
+		struct CookedMip
+		{
+			const uint8_t* m_data;
+			uint32_t m_width;
+			uint32_t m_height;
+			uint32_t m_rowPitch;
+			uint32_t m_size;
+		};
+		struct CookTextureReport
+		{
+			CookedTextureFormat m_format = COOKED_RGBA8;
+			int m_width = 0;
+			int m_height = 0;
+			int m_mipCount = 0;
+			size_t m_sourceBytes = 0; // Uncompressed RGBA8 chain.
+			size_t m_cookedBytes = 0;
+			double m_psnr = 0.0; // Top mip against the source, dB.
+			double m_encodeMs = 0.0;
+			double m_megapixelsPerSecond = 0.0;
+		};
+
+		// Mips // Full chain down to 1x1, filtered in linear space when sRGB is set.
+		void GenerateMips(const uint8_t* rgba, int width, int height, MipFilter filter, bool srgb, std::vector<TextureImage>& mips);
+
+		// Block Compression // Images are padded to whole 4x4 blocks by repeating the edge.
+		uint32_t GetBlockSize(CookedTextureFormat format); // Bytes per 4x4 block, 0 for RGBA8.
+		uint32_t GetDxgiFormat(CookedTextureFormat format);
+		uint32_t GetRowPitch(CookedTextureFormat format, uint32_t width);
+		uint32_t GetMipSize(CookedTextureFormat format, uint32_t width, uint32_t height);
+		void CompressImage(const TextureImage& image, CookedTextureFormat format, std::vector<uint8_t>& output);
+		void DecompressImage(const uint8_t* data, CookedTextureFormat format, int width, int height, TextureImage& image);
+		double ComputePSNR(const TextureImage& a, const TextureImage& b, CookedTextureFormat format);
+
+		// Converts any stb_image supported file into the cooked format.
+		bool CookTexture(const char* srcPath, const char* dstPath, CookedTextureFormat format, MipFilter filter, CookTextureReport* report = nullptr);
+		bool CookTexture(const TextureImage& source, const char* dstPath, CookedTextureFormat format, MipFilter filter, CookTextureReport* report = nullptr);
+
+		// Validates a cooked file in memory, returning the header and filling mips, or nullptr.
+		const CookedTextureHeader* ReadCookedTexture(const void* data, size_t size, std::vector<CookedMip>& mips);
+	}
+}
@@ -0,0 +1,874 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace Renderer
+{
+	// Frustum
+	void Frustum::Extract(const Math::Matrix4F& viewProj)
+	{
+		// Gribb/Hartmann, clip space is -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+		const float* r0 = viewProj.m[0];
+		const float* r1 = viewProj.m[1];
+		const float* r2 = viewProj.m[2];
+		const float* r3 = viewProj.m[3];
+		m_planes[0] = Math::Vector4F(r3[0] + r0[0], r3[1] + r0[1], r3[2] + r0[2], r3[3] + r0[3]);
+		m_planes[1] = Math::Vector4F(r3[0] - r0[0], r3[1] - r0[1], r3[2] - r0[2], r3[3] - r0[3]);
+		m_planes[2] = Math::Vector4F(r3[0] + r1[0], r3[1] + r1[1], r3[2] + r1[2], r3[3] + r1[3]);
+		m_planes[3] = Math::Vector4F(r3[0] - r1[0], r3[1] - r1[1], r3[2] - r1[2], r3[3] - r1[3]);
+		m_planes[4] = Math::Vector4F(r2[0], r2[1], r2[2], r2[3]);
+		m_planes[5] = Math::Vector4F(r3[0] - r2[0], r3[1] - r2[1], r3[2] - r2[2], r3[3] - r2[3]);
+		for (int i = 0; i < 8; ++i)
+		{
+			if (i >= 6)
+			{
+				m_x[i] = m_y[i] = m_z[i] = 0.0f;
+				m_w[i] = 1.0f;
+				continue;
+			}
+			Math::Vector4F& p = m_planes[i];
+			float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+			if (length > 0.0f)
+				p = p / length;
+			m_x[i] = p.x;
+			m_y[i] = p.y;
+			m_z[i] = p.z;
+			m_w[i] = p.w;
+		}
+	}
+
+	CullResult Frustum::TestScalar(const Math::BoundingBox& box) const
+	{
+		// Distance of the box centre against its projected radius, per plane.
+		Math::Vector3F c = box.GetCenter(), e = box.GetExtents();
+		CullResult result = CULL_INSIDE;
+		for (int i = 0; i < 6; ++i)
+		{
+			const Math::Vector4F& p = m_planes[i];
+			float distance = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+			float radius = fabsf(p.x) * e.x + fabsf(p.y) * e.y + fabsf(p.z) * e.z;
+			if (distance + radius < 0.0f)
+				return CULL_OUTSIDE;
+			if (distance - radius < 0.0f)
+				result = CULL_INTERSECT;
+		}
+		return result;
+	}
+	bool Frustum::Test(const Math::BoundingSphere& sphere) const
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			const Math::Vector4F& p = m_planes[i];
+			if (p.x * sphere.center.x + p.y * sphere.center.y + p.z * sphere.center.z + p.w < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+#if defined(MATH_SIMD_SSE)
+	// SSE Path // The arithmetic matches TestScalar operation for operation, so both agree exactly.
+	static inline __m128 Abs(__m128 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+	CullResult Frustum::Test(const Math::BoundingBox& box) const
+	{
+		// One box against four planes per iteration.
+		Math::Vector3F c = box.GetCenter(), e = box.GetExtents();
+		__m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+		__m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+		__m128 zero = _mm_setzero_ps();
+		int intersect = 0;
+		for (int i = 0; i < 8; i += 4)
+		{
+			__m128 px = _mm_load_ps(m_x + i), py = _mm_load_ps(m_y + i), pz = _mm_load_ps(m_z + i), pw = _mm_load_ps(m_w + i);
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_mul_ps(pz, cz)), pw);
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Abs(px), ex), _mm_mul_ps(Abs(py), ey)), _mm_mul_ps(Abs(pz), ez));
+			if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)))
+				return CULL_OUTSIDE;
+			intersect |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+		}
+		return intersect ? CULL_INTERSECT : CULL_INSIDE;
+	}
+	void Frustum::Test(const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, int& outside, int& intersect) const
+	{
+		__m128 cx = _mm_load_ps(centerX), cy = _mm_load_ps(centerY), cz = _mm_load_ps(centerZ);
+		__m128 ex = _mm_load_ps(extentX), ey = _mm_load_ps(extentY), ez = _mm_load_ps(extentZ);
+		__m128 zero = _mm_setzero_ps(), out = zero, cross = zero;
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 px = _mm_set1_ps(m_x[p]), py = _mm_set1_ps(m_y[p]), pz = _mm_set1_ps(m_z[p]), pw = _mm_set1_ps(m_w[p]);
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_mul_ps(pz, cz)), pw);
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Abs(px), ex), _mm_mul_ps(Abs(py), ey)), _mm_mul_ps(Abs(pz), ez));
+			out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			cross = _mm_or_ps(cross, _mm_cmplt_ps(_mm_sub_ps(distance, radius), zero));
+		}
+		outside = _mm_movemask_ps(out);
+		intersect = _mm_movemask_ps(cross);
+	}
+	void Frustum::Cull(const Math::BoundingBox* boxes, size_t count, uint8_t* visible) const
+	{
+		// Four boxes against one plane per iteration.
+		size_t i = 0;
+		__m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			alignas(16) float c[3][4], e[3][4];
+			for (int b = 0; b < 4; ++b)
+			{
+				Math::Vector3F center = boxes[i + b].GetCenter(), extents = boxes[i + b].GetExtents();
+				for (int k = 0; k < 3; ++k)
+				{
+					c[k][b] = center.v[k];
+					e[k][b] = extents.v[k];
+				}
+			}
+			__m128 cx = _mm_load_ps(c[0]), cy = _mm_load_ps(c[1]), cz = _mm_load_ps(c[2]);
+			__m128 ex = _mm_load_ps(e[0]), ey = _mm_load_ps(e[1]), ez = _mm_load_ps(e[2]);
+			__m128 outside = zero;
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 px = _mm_set1_ps(m_x[p]), py = _mm_set1_ps(m_y[p]), pz = _mm_set1_ps(m_z[p]), pw = _mm_set1_ps(m_w[p]);
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)), _mm_mul_ps(pz, cz)), pw);
+				__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(Abs(px), ex), _mm_mul_ps(Abs(py), ey)), _mm_mul_ps(Abs(pz), ez));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			}
+			int mask = _mm_movemask_ps(outside);
+			for (int b = 0; b < 4; ++b)
+				visible[i + b] = (mask & (1 << b)) ? 0 : 1;
+		}
+		for (; i < count; ++i)
+			visible[i] = TestScalar(boxes[i]) != CULL_OUTSIDE;
+	}
+#else
+	CullResult Frustum::Test(const Math::BoundingBox& box) const
+	{
+		return TestScalar(box);
+	}
+	void Frustum::Test(const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, int& outside, int& intersect) const
+	{
+		outside = 0;
+		intersect = 0;
+		for (int b = 0; b < 4; ++b)
+		{
+			for (int i = 0; i < 6; ++i)
+			{
+				const Math::Vector4F& p = m_planes[i];
+				float distance = p.x * centerX[b] + p.y * centerY[b] + p.z * centerZ[b] + p.w;
+				float radius = fabsf(p.x) * extentX[b] + fabsf(p.y) * extentY[b] + fabsf(p.z) * extentZ[b];
+				if (distance + radius < 0.0f)
+					outside |= 1 << b;
+				if (distance - radius < 0.0f)
+					intersect |= 1 << b;
+			}
+		}
+	}
+	void Frustum::Cull(const Math::BoundingBox* boxes, size_t count, uint8_t* visible) const
+	{
+		for (size_t i = 0; i < count; ++i)
+			visible[i] = TestScalar(boxes[i]) != CULL_OUTSIDE;
+	}
+#endif
+
+	// Bounding Volume Hierarchy
+	int BoundingVolumeHierarchy::AllocateNode()
+	{
+		if (!m_freeNodes.empty())
+		{
+			int node = m_freeNodes.back();
+			m_freeNodes.pop_back();
+			return node;
+		}
+		m_nodes.emplace_back();
+		return (int)m_nodes.size() - 1;
+	}
+	void BoundingVolumeHierarchy::FreeNode(int node)
+	{
+		m_nodes[node] = Node();
+		m_freeNodes.push_back(node);
+	}
+
+	BvhProxy BoundingVolumeHierarchy::Insert(const Math::BoundingBox& box, int userData)
+	{
+		int leaf = AllocateNode();
+		m_nodes[leaf].m_bounds = box;
+		m_nodes[leaf].m_userData = userData;
+		m_nodes[leaf].m_inserted = true;
+		m_inserted.push_back(leaf);
+		m_stats.m_leaves++;
+		m_changed = true;
+		return leaf;
+	}
+	void BoundingVolumeHierarchy::Remove(BvhProxy proxy)
+	{
+		m_collapse = true;
+		if (m_nodes[proxy].m_inserted)
+			m_inserted.erase(std::find(m_inserted.begin(), m_inserted.end(), proxy));
+		else
+			RemoveLeaf(proxy);
+		FreeNode(proxy);
+		m_stats.m_leaves--;
+		m_changed = true;
+	}
+	void BoundingVolumeHierarchy::Move(BvhProxy proxy, const Math::BoundingBox& box)
+	{
+		Node& node = m_nodes[proxy];
+		if (node.m_bounds == box)
+			return;
+		node.m_bounds = box;
+		if (!node.m_moved)
+		{
+			node.m_moved = true;
+			m_moved.push_back(proxy);
+		}
+	}
+
+	void BoundingVolumeHierarchy::InsertLeaf(int leaf)
+	{
+		if (m_root < 0)
+		{
+			m_root = leaf;
+			m_nodes[leaf].m_parent = -1;
+			return;
+		}
+
+		// Descend towards the cheapest sibling by surface area, stopping when pairing with the current node is cheaper.
+		Math::BoundingBox box = m_nodes[leaf].m_bounds;
+		int index = m_root;
+		while (!m_nodes[index].IsLeaf())
+		{
+			const Node& node = m_nodes[index];
+			Math::BoundingBox combined = node.m_bounds;
+			combined.Extend(box);
+			float combinedArea = combined.GetSurfaceArea();
+			float cost = 2.0f * combinedArea;
+			float inheritance = 2.0f * (combinedArea - node.m_bounds.GetSurfaceArea());
+			auto childCost = [&](int child)
+			{
+				Math::BoundingBox b = m_nodes[child].m_bounds;
+				b.Extend(box);
+				float area = b.GetSurfaceArea();
+				if (!m_nodes[child].IsLeaf())
+					area -= m_nodes[child].m_bounds.GetSurfaceArea();
+				return area + inheritance;
+			};
+			float costLeft = childCost(node.m_left);
+			float costRight = childCost(node.m_right);
+			if (cost < costLeft && cost < costRight)
+				break;
+			index = (costLeft < costRight) ? node.m_left : node.m_right;
+		}
+
+		// New parent for the sibling and the leaf.
+		int sibling = index;
+		int oldParent = m_nodes[sibling].m_parent;
+		int parent = AllocateNode();
+		Node& p = m_nodes[parent];
+		p.m_parent = oldParent;
+		p.m_left = sibling;
+		p.m_right = leaf;
+		p.m_bounds = m_nodes[sibling].m_bounds;
+		p.m_bounds.Extend(box);
+		m_nodes[sibling].m_parent = parent;
+		m_nodes[leaf].m_parent = parent;
+		if (oldParent < 0)
+			m_root = parent;
+		else
+		{
+			if (m_nodes[oldParent].m_left == sibling)
+				m_nodes[oldParent].m_left = parent;
+			else
+				m_nodes[oldParent].m_right = parent;
+			RefitUpwards(oldParent);
+		}
+	}
+	void BoundingVolumeHierarchy::RemoveLeaf(int leaf)
+	{
+		if (leaf == m_root)
+		{
+			m_root = -1;
+			return;
+		}
+		// The sibling takes the parent's place.
+		int parent = m_nodes[leaf].m_parent;
+		int grandParent = m_nodes[parent].m_parent;
+		int sibling = (m_nodes[parent].m_left == leaf) ? m_nodes[parent].m_right : m_nodes[parent].m_left;
+		m_nodes[sibling].m_parent = grandParent;
+		if (grandParent < 0)
+			m_root = sibling;
+		else
+		{
+			if (m_nodes[grandParent].m_left == parent)
+				m_nodes[grandParent].m_left = sibling;
+			else
+				m_nodes[grandParent].m_right = sibling;
+		}
+		FreeNode(parent);
+		m_nodes[leaf].m_parent = -1;
+		if (grandParent >= 0)
+			RefitUpwards(grandParent);
+	}
+
+	void BoundingVolumeHierarchy::RefitUpwards(int node)
+	{
+		// Stops at the first ancestor whose bounds do not change, everything above it is already correct.
+		while (node >= 0)
+		{
+			Node& n = m_nodes[node];
+			Math::BoundingBox bounds = m_nodes[n.m_left].m_bounds;
+			bounds.Extend(m_nodes[n.m_right].m_bounds);
+			if (bounds == n.m_bounds)
+				return;
+			n.m_bounds = bounds;
+			RefitCullSlot(node);
+			node = n.m_parent;
+		}
+	}
+	void BoundingVolumeHierarchy::RefitAll()
+	{
+		// Pre-order walk, then children before parents in reverse.
+		if (m_root < 0)
+			return;
+		m_stack.clear();
+		std::vector<int> order;
+		m_stack.push_back(m_root);
+		while (!m_stack.empty())
+		{
+			int node = m_stack.back();
+			m_stack.pop_back();
+			if (m_nodes[node].IsLeaf())
+				continue;
+			order.push_back(node);
+			m_stack.push_back(m_nodes[node].m_left);
+			m_stack.push_back(m_nodes[node].m_right);
+		}
+		for (auto it = order.rbegin(); it != order.rend(); ++it)
+		{
+			Node& n = m_nodes[*it];
+			n.m_bounds = m_nodes[n.m_left].m_bounds;
+			n.m_bounds.Extend(m_nodes[n.m_right].m_bounds);
+			RefitCullSlot(*it);
+		}
+	}
+
+	void BoundingVolumeHierarchy::Update()
+	{
+		if (m_moved.empty() && !m_changed)
+			return;
+		// Inserted leaves go in one at a time, unless they are at least half the tree, then it is built around them.
+		if (!m_inserted.empty() && m_inserted.size() * 2 >= m_stats.m_leaves)
+		{
+			for (int leaf : m_moved)
+				m_nodes[leaf].m_moved = false;
+			m_moved.clear();
+			m_changed = false;
+			Rebuild();
+			return;
+		}
+		for (int leaf : m_inserted)
+		{
+			m_nodes[leaf].m_inserted = false;
+			InsertLeaf(leaf);
+		}
+		if (!m_inserted.empty())
+			m_collapse = true;
+		m_inserted.clear();
+
+		// Many moved leaves touch most of the tree anyway, one bottom-up pass is cheaper than walking from each.
+		if (m_moved.size() * 4 > m_stats.m_leaves)
+			RefitAll();
+		else
+		{
+			for (int leaf : m_moved)
+			{
+				if (m_nodes[leaf].m_moved)
+					RefitUpwards(m_nodes[leaf].m_parent);
+			}
+		}
+		for (int leaf : m_moved)
+		{
+			if (m_nodes[leaf].m_moved)
+				RefitCullSlot(leaf);
+			m_nodes[leaf].m_moved = false;
+		}
+		m_stats.m_refits += (unsigned int)m_moved.size();
+		m_moved.clear();
+		m_changed = false;
+
+		m_stats.m_cost = ComputeCost();
+		if (m_stats.m_cost > m_buildCost * BVH_REBUILD_RATIO)
+			Rebuild();
+		else
+			UpdateCullNodes();
+	}
+
+	void BoundingVolumeHierarchy::Rebuild()
+	{
+		// Keep the leaves, they are the proxies handed out, and rebuild every internal node.
+		std::vector<BuildLeaf> leaves;
+		std::vector<int> internal;
+		leaves.reserve(m_stats.m_leaves);
+		if (m_root >= 0)
+			m_stack.assign(1, m_root);
+		else
+			m_stack.clear();
+		while (!m_stack.empty())
+		{
+			int node = m_stack.back();
+			m_stack.pop_back();
+			if (m_nodes[node].IsLeaf())
+			{
+				const Math::BoundingBox& bounds = m_nodes[node].m_bounds;
+				leaves.push_back({ bounds, bounds.GetCenter(), node });
+				continue;
+			}
+			internal.push_back(node);
+			m_stack.push_back(m_nodes[node].m_left);
+			m_stack.push_back(m_nodes[node].m_right);
+		}
+		for (int node : internal)
+			FreeNode(node);
+		for (int leaf : m_inserted)
+		{
+			m_nodes[leaf].m_inserted = false;
+			leaves.push_back({ m_nodes[leaf].m_bounds, m_nodes[leaf].m_bounds.GetCenter(), leaf });
+		}
+		m_inserted.clear();
+
+		m_root = leaves.empty() ? -1 : Build(leaves.data(), (int)leaves.size());
+		if (m_root >= 0)
+			m_nodes[m_root].m_parent = -1;
+		m_buildCost = ComputeCost();
+		m_stats.m_cost = m_buildCost;
+		m_stats.m_rebuilds++;
+		m_stats.m_refits = 0;
+		m_collapse = true;
+		UpdateCullNodes();
+	}
+	int BoundingVolumeHierarchy::Build(BuildLeaf* leaves, int count)
+	{
+		// The leaves' bounds are copied next to their centres, every pass below reads them in order.
+		if (count == 1)
+			return leaves[0].m_leaf;
+
+		// Split on the longest axis of the leaf centres.
+		Math::BoundingBox bounds, centers;
+		for (int i = 0; i < count; ++i)
+		{
+			bounds.Extend(leaves[i].m_bounds);
+			centers.Extend(leaves[i].m_center);
+		}
+		Math::Vector3F size = centers.maximum - centers.minimum;
+		int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+		float minimum = centers.minimum.v[axis];
+		float extent = size.v[axis];
+
+		int mid = count / 2;
+		if (extent > 0.0f)
+		{
+			// Binned SAH // Cost of each split between bins is left area * left count + right area * right count.
+			struct Bin
+			{
+				Math::BoundingBox m_bounds;
+				int m_count = 0;
+			};
+			Bin bins[BVH_BUILD_BINS];
+			float scale = BVH_BUILD_BINS / extent;
+			auto binOf = [&](const BuildLeaf& leaf)
+			{
+				int b = (int)((leaf.m_center.v[axis] - minimum) * scale);
+				return (b < BVH_BUILD_BINS) ? b : BVH_BUILD_BINS - 1;
+			};
+			for (int i = 0; i < count; ++i)
+			{
+				Bin& bin = bins[binOf(leaves[i])];
+				bin.m_bounds.Extend(leaves[i].m_bounds);
+				bin.m_count++;
+			}
+			float rightCost[BVH_BUILD_BINS];
+			Math::BoundingBox right;
+			int rightCount = 0;
+			for (int b = BVH_BUILD_BINS - 1; b > 0; --b)
+			{
+				right.Extend(bins[b].m_bounds);
+				rightCount += bins[b].m_count;
+				rightCost[b] = right.GetSurfaceArea() * rightCount;
+			}
+			Math::BoundingBox left;
+			int leftCount = 0, split = -1;
+			float best = FLT_MAX;
+			for (int b = 1; b < BVH_BUILD_BINS; ++b)
+			{
+				left.Extend(bins[b - 1].m_bounds);
+				leftCount += bins[b - 1].m_count;
+				float cost = left.GetSurfaceArea() * leftCount + rightCost[b];
+				if (leftCount > 0 && leftCount < count && cost < best)
+				{
+					best = cost;
+					split = b;
+				}
+			}
+			if (split > 0)
+				mid = (int)(std::partition(leaves, leaves + count, [&](const BuildLeaf& leaf) { return binOf(leaf) < split; }) - leaves);
+		}
+		if (mid <= 0 || mid >= count)
+		{
+			// Every centre in one bin, fall back to a median split.
+			mid = count / 2;
+			std::nth_element(leaves, leaves + mid, leaves + count, [&](const BuildLeaf& a, const BuildLeaf& b) { return a.m_center.v[axis] < b.m_center.v[axis]; });
+		}
+
+		int node = AllocateNode();
+		int left = Build(leaves, mid);
+		int right = Build(leaves + mid, count - mid);
+		Node& n = m_nodes[node];
+		n.m_left = left;
+		n.m_right = right;
+		n.m_bounds = bounds;
+		m_nodes[left].m_parent = node;
+		m_nodes[right].m_parent = node;
+		return node;
+	}
+	void BoundingVolumeHierarchy::Clear()
+	{
+		m_nodes.clear();
+		m_freeNodes.clear();
+		m_moved.clear();
+		m_inserted.clear();
+		m_stack.clear();
+		m_cullNodes.clear();
+		m_cullLeaves.clear();
+		m_root = -1;
+		m_buildCost = 0.0f;
+		m_changed = false;
+		m_collapse = false;
+		m_stats = BvhStats();
+	}
+
+	int BoundingVolumeHierarchy::Collapse(int node)
+	{
+		// Open the largest internal child until there are four, the leaves are numbered as the children are reached.
+		int children[4] = { node };
+		int count = 1;
+		while (count < 4)
+		{
+			int open = -1;
+			float area = -1.0f;
+			for (int i = 0; i < count; ++i)
+			{
+				const Node& n = m_nodes[children[i]];
+				if (!n.IsLeaf() && n.m_bounds.GetSurfaceArea() > area)
+				{
+					open = i;
+					area = n.m_bounds.GetSurfaceArea();
+				}
+			}
+			if (open < 0)
+				break;
+			int opened = children[open];
+			m_nodes[opened].m_cullSlot = -1;
+			children[open] = m_nodes[opened].m_left;
+			children[count++] = m_nodes[opened].m_right;
+		}
+
+		int index = (int)m_cullNodes.size();
+		m_cullNodes.emplace_back();
+		m_cullNodes[index].m_children = count;
+		for (int i = 0; i < count; ++i)
+		{
+			int first = (int)m_cullLeaves.size();
+			int child = -1;
+			if (m_nodes[children[i]].IsLeaf())
+				m_cullLeaves.push_back(m_nodes[children[i]].m_userData);
+			else
+				child = Collapse(children[i]);
+			CullNode& c = m_cullNodes[index];
+			c.m_child[i] = child;
+			c.m_first[i] = first;
+			c.m_count[i] = (int)m_cullLeaves.size() - first;
+			m_nodes[children[i]].m_cullSlot = index * 4 + i;
+			RefitCullSlot(children[i]);
+		}
+		return index;
+	}
+	void BoundingVolumeHierarchy::RefitCullSlot(int node)
+	{
+		int slot = m_nodes[node].m_cullSlot;
+		if (slot < 0 || m_collapse)
+			return;
+		CullNode& c = m_cullNodes[slot >> 2];
+		int i = slot & 3;
+		const Math::BoundingBox& bounds = m_nodes[node].m_bounds;
+		Math::Vector3F center = bounds.GetCenter(), extents = bounds.GetExtents();
+		c.m_centerX[i] = center.x;
+		c.m_centerY[i] = center.y;
+		c.m_centerZ[i] = center.z;
+		c.m_extentX[i] = extents.x;
+		c.m_extentY[i] = extents.y;
+		c.m_extentZ[i] = extents.z;
+	}
+	void BoundingVolumeHierarchy::UpdateCullNodes()
+	{
+		if (!m_collapse)
+			return;
+		m_cullNodes.clear();
+		m_cullLeaves.clear();
+		m_collapse = false;
+		if (m_root >= 0)
+			Collapse(m_root);
+	}
+
+	void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<int>& visible)
+	{
+		// Four children per test, those entirely inside the frustum append their leaves without being walked.
+		UpdateCullNodes(); // Only has work when leaves were removed since the last Update.
+		m_stats.m_nodesTested = 0;
+		for (int leaf : m_inserted)
+		{
+			if (frustum.Test(m_nodes[leaf].m_bounds) != CULL_OUTSIDE)
+				visible.push_back(m_nodes[leaf].m_userData);
+		}
+		if (m_cullNodes.empty())
+			return;
+		m_stack.assign(1, 0);
+		while (!m_stack.empty())
+		{
+			const CullNode& node = m_cullNodes[m_stack.back()];
+			m_stack.pop_back();
+			int outside, intersect;
+			frustum.Test(node.m_centerX, node.m_centerY, node.m_centerZ, node.m_extentX, node.m_extentY, node.m_extentZ, outside, intersect);
+			m_stats.m_nodesTested += node.m_children;
+			for (int i = 0; i < node.m_children; ++i)
+			{
+				if (outside & (1 << i))
+					continue;
+				if (node.m_child[i] < 0 || !(intersect & (1 << i)))
+					visible.insert(visible.end(), m_cullLeaves.begin() + node.m_first[i], m_cullLeaves.begin() + node.m_first[i] + node.m_count[i]);
+				else
+					m_stack.push_back(node.m_child[i]);
+			}
+		}
+	}
+
+	float BoundingVolumeHierarchy::ComputeCost() const
+	{
+		if (m_root < 0 || m_nodes[m_root].IsLeaf())
+			return 0.0f;
+		float rootArea = m_nodes[m_root].m_bounds.GetSurfaceArea();
+		if (rootArea <= 0.0f)
+			return 0.0f;
+		float area = 0.0f;
+		for (const Node& n : m_nodes)
+		{
+			if (!n.IsLeaf())
+				area += n.m_bounds.GetSurfaceArea();
+		}
+		return area / rootArea;
+	}
+	bool BoundingVolumeHierarchy::Validate() const
+	{
+		if (m_root < 0)
+			return m_stats.m_leaves == m_inserted.size();
+		if (m_nodes[m_root].m_parent != -1)
+			return false;
+		std::vector<int> stack(1, m_root);
+		unsigned int leaves = 0;
+		while (!stack.empty())
+		{
+			int node = stack.back();
+			stack.pop_back();
+			const Node& n = m_nodes[node];
+			if (n.IsLeaf())
+			{
+				leaves++;
+				continue;
+			}
+			for (int child : { n.m_left, n.m_right })
+			{
+				if (m_nodes[child].m_parent != node || !n.m_bounds.Contains(m_nodes[child].m_bounds))
+					return false;
+				stack.push_back(child);
+			}
+		}
+		return leaves + m_inserted.size() == m_stats.m_leaves;
+	}
+
+	// Culling System
+	void CullingSystem::Create()
+	{
+		m_bvh.Clear();
+	}
+	void CullingSystem::Destroy()
+	{
+		m_bvh.Clear();
+		m_proxies.clear();
+		m_visible.clear();
+		m_visibleList.clear();
+		m_stats = CullingStats();
+	}
+
+	void CullingSystem::Register(Objects::TransformHandle transform, const Math::BoundingBox& localBounds)
+	{
+		if (transform < 0)
+			return;
+		if (transform >= (int)m_proxies.size())
+		{
+			m_proxies.resize(transform + 1, InvalidProxy);
+			m_visible.resize(transform + 1, 1);
+		}
+		Unregister(transform);
+		Transforms.SetBounds(transform, localBounds);
+		m_proxies[transform] = m_bvh.Insert(Transforms.GetWorldBounds(transform), transform);
+		m_visible[transform] = 1; // Drawn until the next cull has seen it.
+	}
+	void CullingSystem::Unregister(Objects::TransformHandle transform)
+	{
+		if (!IsRegistered(transform))
+			return;
+		m_bvh.Remove(m_proxies[transform]);
+		m_proxies[transform] = InvalidProxy;
+		m_visible[transform] = 1;
+		Transforms.SetBounds(transform, Math::BoundingBox());
+	}
+
+	void CullingSystem::Update()
+	{
+		for (Objects::TransformHandle h : Transforms.GetMovedBounds())
+		{
+			if (IsRegistered(h))
+				m_bvh.Move(m_proxies[h], Transforms.GetWorldBounds(h));
+		}
+		m_bvh.Update();
+	}
+	void CullingSystem::Cull(const Frustum& frustum)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_visibleList.clear();
+		m_bvh.Cull(frustum, m_visibleList);
+		std::fill(m_visible.begin(), m_visible.end(), (uint8_t)0);
+		for (int transform : m_visibleList)
+			m_visible[transform] = 1;
+		m_stats.m_visible = (unsigned int)m_visibleList.size();
+		m_stats.m_cullMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	const CullingStats& CullingSystem::GetStats()
+	{
+		m_stats.m_bvh = m_bvh.GetStats();
+		m_stats.m_objects = m_stats.m_bvh.m_leaves;
+		return m_stats;
+	}
+
+	// Meshlets
+	void CullMeshlets(const Frustum& frustum, const Meshes::Meshlet* meshlets, size_t count, std::vector<IndexRange>& ranges)
+	{
+		ranges.clear();
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Meshes::Meshlet& meshlet = meshlets[i];
+			Math::BoundingBox box(Math::Vector3F(meshlet.m_min[0], meshlet.m_min[1], meshlet.m_min[2]), Math::Vector3F(meshlet.m_max[0], meshlet.m_max[1], meshlet.m_max[2]));
+			if (frustum.Test(box) == CULL_OUTSIDE)
+				continue;
+			if (!ranges.empty() && ranges.back().m_firstIndex + ranges.back().m_indexCount == meshlet.m_firstIndex)
+				ranges.back().m_indexCount += meshlet.m_indexCount;
+			else
+				ranges.push_back({ meshlet.m_firstIndex, meshlet.m_indexCount });
+		}
+	}
+
+	// Benchmark
+	CullingBenchmarkReport RunCullingBenchmark(int objects, int frames, unsigned int seed)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		auto elapsed = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+		CullingBenchmarkReport report;
+		report.m_objects = objects;
+		report.m_frames = frames;
+		report.m_valid = true;
+
+		// Random boxes through a 1km cube around the origin.
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+		std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+		std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+		auto randomBox = [&](Math::Vector3F center)
+		{
+			Math::Vector3F e(size(rng), size(rng), size(rng));
+			return Math::BoundingBox(center - e, center + e);
+		};
+		std::vector<Math::BoundingBox> boxes(objects);
+		for (auto& b : boxes)
+			b = randomBox(Math::Vector3F(position(rng), position(rng), position(rng)));
+
+		BoundingVolumeHierarchy bvh;
+		std::vector<BvhProxy> proxies(objects);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < objects; ++i)
+			proxies[i] = bvh.Insert(boxes[i], i);
+		bvh.Rebuild();
+		report.m_buildMs = elapsed(start);
+
+		std::vector<uint8_t> reference(objects), simd(objects), tree(objects);
+		std::vector<int> visible;
+		Math::Matrix4F projection(1.0f);
+		projection.Perspective(16.0f / 9.0f, Math::DegreesToRadians(75.0f), 0.1f, 400.0f);
+		for (int f = 0; f < frames; ++f)
+		{
+			// Camera somewhere inside the volume, facing a random direction.
+			Math::Matrix4F view(1.0f), pitch(1.0f);
+			view.SetRotateY(angle(rng));
+			pitch.SetRotateX(angle(rng) * 0.25f);
+			view = view * pitch;
+			view.SetTranslation(position(rng) * 0.5f, position(rng) * 0.5f, position(rng) * 0.5f);
+			Frustum frustum(view * projection);
+
+			start = Clock::now();
+			for (int i = 0; i < objects; ++i)
+				reference[i] = frustum.TestScalar(boxes[i]) != CULL_OUTSIDE;
+			report.m_scalarMs += elapsed(start);
+
+			start = Clock::now();
+			frustum.Cull(boxes.data(), boxes.size(), simd.data());
+			report.m_simdMs += elapsed(start);
+
+			start = Clock::now();
+			visible.clear();
+			bvh.Cull(frustum, visible);
+			report.m_bvhMs += elapsed(start);
+
+			std::fill(tree.begin(), tree.end(), (uint8_t)0);
+			for (int v : visible)
+				tree[v] = 1;
+			for (int i = 0; i < objects; ++i)
+			{
+				if (simd[i] != reference[i] || tree[i] != reference[i])
+					report.m_mismatches++;
+				report.m_visible += reference[i];
+			}
+
+			// Move a tenth of the objects and refit, rebuilding when the tree has degraded.
+			start = Clock::now();
+			for (int i = 0; i < objects / 10; ++i)
+			{
+				int o = (int)(rng() % objects);
+				Math::Vector3F center = boxes[o].GetCenter() + Math::Vector3F(step(rng), step(rng), step(rng)) * 4.0f;
+				boxes[o] = randomBox(center);
+				bvh.Move(proxies[o], boxes[o]);
+			}
+			bvh.Update();
+			report.m_updateMs += elapsed(start);
+			report.m_valid = report.m_valid && bvh.Validate();
+		}
+		if (frames > 0)
+		{
+			report.m_visible /= frames;
+			report.m_scalarMs /= frames;
+			report.m_simdMs /= frames;
+			report.m_bvhMs /= frames;
+			report.m_updateMs /= frames;
+		}
+		report.m_bvh = bvh.GetStats();
+		return report;
+	}
+}
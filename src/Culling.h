@@ -0,0 +1,223 @@
+#pragma once
+
+#include "Math.h"
+#include "Transform.h"
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <stdint.h>
+
+#define Culling (Renderer::CullingSystem::Instance())
+
+#define BVH_REBUILD_RATIO 1.5f // Rebuild once refitting has grown the tree's cost past this multiple of a fresh build.
+#define BVH_BUILD_BINS 16
+
+namespace Renderer
+{
+	enum CullResult
+	{
+		CULL_OUTSIDE,
+		CULL_INTERSECT,
+		CULL_INSIDE,
+	};
+
+	// View Frustum // Planes face inwards, a point is inside when dot(normal, p) + w >= 0 for all six.
+	struct Frustum
+	{
+		Math::Vector4F m_planes[6]; // Left, right, bottom, top, near, far.
+		// SIMD Layout // The same planes as structure of arrays, padded to 8 with planes that never reject.
+		alignas(16) float m_x[8];
+		alignas(16) float m_y[8];
+		alignas(16) float m_z[8];
+		alignas(16) float m_w[8];
+
+		Frustum() { }
+		explicit Frustum(const Math::Matrix4F& viewProj) { Extract(viewProj); }
+
+		// Planes of the clip volume 0 <= z <= w, rows of viewProj are the clip space components.
+		void Extract(const Math::Matrix4F& viewProj);
+
+		CullResult Test(const Math::BoundingBox& box) const;
+		CullResult TestScalar(const Math::BoundingBox& box) const; // Reference for the SIMD path.
+		bool Test(const Math::BoundingSphere& sphere) const;
+		// Four boxes as centres and extents in 16 byte aligned structure of arrays, bit i of each mask is set for box i.
+		void Test(const float* centerX, const float* centerY, const float* centerZ, const float* extentX, const float* extentY, const float* extentZ, int& outside, int& intersect) const;
+		// Brute Force // Four boxes per iteration, visible[i] is 0 only when boxes[i] is entirely outside.
+		void Cull(const Math::BoundingBox* boxes, size_t count, uint8_t* visible) const;
+	};
+
+	// Meshlet Culling // Index ranges of the meshlets not outside the frustum, tested in the meshlets' own space. Neighbouring
+	// visible meshlets merge into one range, a mesh in full view is a single range.
+	struct IndexRange
+	{
+		uint32_t m_firstIndex;
+		uint32_t m_indexCount;
+	};
+	void CullMeshlets(const Frustum& frustum, const Meshes::Meshlet* meshlets, size_t count, std::vector<IndexRange>& ranges);
+
+	typedef int BvhProxy;
+	const BvhProxy InvalidProxy = -1;
+
+	struct BvhStats
+	{
+		unsigned int m_leaves = 0;
+		unsigned int m_nodes = 0;
+		unsigned int m_refits = 0; // Leaves refitted since the last rebuild.
+		unsigned int m_rebuilds = 0;
+		unsigned int m_nodesTested = 0; // Last cull, children of the collapsed tree.
+		float m_cost = 0.0f; // Surface area heuristic, internal node area over root area.
+	};
+
+	// Dynamic Bounding Volume Hierarchy // Leaves are inserted incrementally, moved leaves are refitted in Update
+	// and the whole tree is rebuilt with a binned SAH split once refitting has degraded it. Culling walks a copy of the
+	// tree collapsed to four children per node, see CullNode.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		BvhProxy Insert(const Math::BoundingBox& box, int userData); // Placed in the tree by the next Update or Rebuild.
+		void Remove(BvhProxy proxy);
+		void Move(BvhProxy proxy, const Math::BoundingBox& box);
+		void Update();
+		void Rebuild();
+		void Clear();
+
+		// Appends the user data of every leaf not outside the frustum.
+		void Cull(const Frustum& frustum, std::vector<int>& visible);
+
+		const Math::BoundingBox& GetBounds(BvhProxy proxy) const { return m_nodes[proxy].m_bounds; }
+		int GetUserData(BvhProxy proxy) const { return m_nodes[proxy].m_userData; }
+		float ComputeCost() const;
+		bool Validate() const; // Parent links and containment, for tests.
+		const BvhStats& GetStats() { m_stats.m_nodes = (unsigned int)(m_nodes.size() - m_freeNodes.size()); return m_stats; }
+
+	private:
+		struct Node
+		{
+			Math::BoundingBox m_bounds;
+			int m_parent = -1;
+			int m_left = -1; // Leaves have no children.
+			int m_right = -1;
+			int m_userData = -1;
+			bool m_moved = false;
+			bool m_inserted = false; // Waiting for Update.
+			int m_cullSlot = -1; // Cull node * 4 + child mirroring this node, -1 when collapsed into its parent.
+
+			bool IsLeaf() const { return m_left < 0; }
+		};
+		struct BuildLeaf
+		{
+			Math::BoundingBox m_bounds;
+			Math::Vector3F m_center;
+			int m_leaf;
+		};
+		// Cull Layout // Four children per node with their centres and extents as structure of arrays, so one SIMD test
+		// covers all of them. Leaves are numbered in tree order and every child keeps the range of leaves under it, a child
+		// entirely inside the frustum appends that range without being walked.
+		struct CullNode
+		{
+			alignas(16) float m_centerX[4] = { };
+			alignas(16) float m_centerY[4] = { };
+			alignas(16) float m_centerZ[4] = { };
+			alignas(16) float m_extentX[4] = { };
+			alignas(16) float m_extentY[4] = { };
+			alignas(16) float m_extentZ[4] = { };
+			int m_child[4]; // Cull node, -1 for leaves.
+			int m_first[4]; // Leaf range.
+			int m_count[4];
+			int m_children = 0;
+		};
+
+		int AllocateNode();
+		void FreeNode(int node);
+		void InsertLeaf(int leaf);
+		void RemoveLeaf(int leaf);
+		void RefitUpwards(int node);
+		void RefitAll();
+		int Build(BuildLeaf* leaves, int count);
+		int Collapse(int node);
+		void RefitCullSlot(int node);
+		void UpdateCullNodes();
+
+	private:
+		std::vector<Node> m_nodes;
+		std::vector<int> m_freeNodes;
+		std::vector<int> m_moved;
+		std::vector<int> m_inserted;
+		std::vector<int> m_stack;
+		std::vector<CullNode> m_cullNodes;
+		std::vector<int> m_cullLeaves; // User data in tree order.
+		int m_root = -1;
+		float m_buildCost = 0.0f;
+		bool m_changed = false; // Leaves inserted or removed since the last Update.
+		bool m_collapse = false; // Cull nodes out of date with the tree's structure, bounds are kept up to date as they change.
+		BvhStats m_stats;
+
+	};
+
+	struct CullingStats
+	{
+		unsigned int m_objects = 0;
+		unsigned int m_visible = 0;
+		double m_cullMs = 0.0;
+		BvhStats m_bvh;
+	};
+
+	// Scene Culling // One BVH leaf per registered transform, world bounds come from the transform system.
+	class CullingSystem
+	{
+	public:
+		void Create();
+		void Destroy();
+
+		void Register(Objects::TransformHandle transform, const Math::BoundingBox& localBounds);
+		void Unregister(Objects::TransformHandle transform);
+		bool IsRegistered(Objects::TransformHandle transform) { return transform >= 0 && transform < (int)m_proxies.size() && m_proxies[transform] != InvalidProxy; }
+		// Unregistered transforms are always visible.
+		bool IsVisible(Objects::TransformHandle transform) { return !IsRegistered(transform) || m_visible[transform]; }
+
+		// After TransformSystem::Update, moves the leaves of every transform whose world bounds changed.
+		void Update();
+		void Cull(const Frustum& frustum);
+
+		const CullingStats& GetStats();
+
+	private:
+		BoundingVolumeHierarchy m_bvh;
+		std::vector<BvhProxy> m_proxies; // Indexed by transform handle.
+		std::vector<uint8_t> m_visible;
+		std::vector<int> m_visibleList;
+		CullingStats m_stats;
+
+	private:
+		CullingSystem() { }
+
+	public:
+		// Singleton Design Pattern
+		static CullingSystem& Instance()
+		{
+			static CullingSystem instance;
+			return instance;
+		}
+
+		CullingSystem(CullingSystem const&) = delete;
+		void operator=(CullingSystem const&) = delete;
+
+	};
+
+	// Benchmark // Random boxes culled by brute force (scalar and SIMD) and through the BVH, with results compared.
+	struct CullingBenchmarkReport
+	{
+		int m_objects = 0;
+		int m_frames = 0;
+		double m_visible = 0.0; // Average per frame.
+		double m_buildMs = 0.0;
+		double m_scalarMs = 0.0; // Averages per frame.
+		double m_simdMs = 0.0;
+		double m_bvhMs = 0.0;
+		double m_updateMs = 0.0;
+		int m_mismatches = 0; // Objects where the SIMD or BVH result differs from the scalar reference.
+		bool m_valid = false; // Tree structure checked after every update.
+		BvhStats m_bvh;
+	};
+	CullingBenchmarkReport RunCullingBenchmark(int objects, int frames, unsigned int seed = 1);
+}
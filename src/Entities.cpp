@@ -0,0 +1,374 @@
+#include "Entities.h"
+#include "Jobs.h"
+#include "Profiler.h"
+
+#include <assert.h>
+#include <string.h>
+#include <mutex>
+
+namespace Entities
+{
+	// Component Registry // Ids are handed out on first use, from any thread.
+	static std::mutex s_componentLock;
+	static ComponentInfo s_components[ENTITY_MAX_COMPONENTS];
+	static ComponentId s_componentCount = 0;
+
+	ComponentId RegisterComponent(size_t size, size_t alignment)
+	{
+		std::lock_guard<std::mutex> lock(s_componentLock);
+		assert(s_componentCount < ENTITY_MAX_COMPONENTS);
+		s_components[s_componentCount] = { size, alignment };
+		return s_componentCount++;
+	}
+	const ComponentInfo& GetComponentInfo(ComponentId id)
+	{
+		return s_components[id];
+	}
+
+	static size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// World
+	void World::Create()
+	{
+		Destroy();
+		m_chunkPool = std::make_unique<Memory::PoolAllocator>(ENTITY_CHUNK_SIZE, 64, 16);
+	}
+	void World::Destroy()
+	{
+		assert(m_iterating == 0);
+		m_records.clear();
+		m_freeRecords.clear();
+		m_archetypes.clear();
+		m_archetypeMap.clear();
+		m_chunkPool.reset(); // Takes every chunk with it.
+		m_stats = WorldStats();
+	}
+
+	Entity World::CreateEntity(ComponentMask mask)
+	{
+		assert(m_iterating == 0);
+		Entity entity;
+		if (!m_freeRecords.empty())
+		{
+			entity.m_index = m_freeRecords.back();
+			m_freeRecords.pop_back();
+		}
+		else
+		{
+			entity.m_index = (uint32_t)m_records.size();
+			m_records.push_back({ nullptr, 0, 0 });
+		}
+		EntityRecord& record = m_records[entity.m_index];
+		entity.m_generation = record.m_generation;
+		record.m_archetype = FindArchetype(mask);
+		record.m_row = AddRow(record.m_archetype, entity);
+		return entity;
+	}
+	void World::DestroyEntity(Entity entity)
+	{
+		assert(m_iterating == 0);
+		if (!IsAlive(entity))
+			return;
+		EntityRecord& record = m_records[entity.m_index];
+		RemoveRow(record.m_archetype, record.m_row);
+		record.m_archetype = nullptr;
+		record.m_generation++; // Stale copies of the id stop resolving.
+		m_freeRecords.push_back(entity.m_index);
+	}
+
+	void* World::AddComponent(Entity entity, ComponentId id)
+	{
+		assert(m_iterating == 0);
+		if (!IsAlive(entity))
+			return nullptr;
+		Archetype* archetype = m_records[entity.m_index].m_archetype;
+		if (archetype->m_columns[id] < 0)
+		{
+			if (!archetype->m_add[id])
+			{
+				archetype->m_add[id] = FindArchetype(archetype->m_mask | (ComponentMask(1) << id));
+				archetype->m_add[id]->m_remove[id] = archetype;
+			}
+			MoveEntity(entity, archetype->m_add[id]);
+		}
+		const EntityRecord& record = m_records[entity.m_index];
+		return record.m_archetype->GetComponent(record.m_row, id);
+	}
+	void World::RemoveComponent(Entity entity, ComponentId id)
+	{
+		assert(m_iterating == 0);
+		if (!IsAlive(entity))
+			return;
+		Archetype* archetype = m_records[entity.m_index].m_archetype;
+		if (archetype->m_columns[id] < 0)
+			return;
+		if (!archetype->m_remove[id])
+		{
+			archetype->m_remove[id] = FindArchetype(archetype->m_mask & ~(ComponentMask(1) << id));
+			archetype->m_remove[id]->m_add[id] = archetype;
+		}
+		MoveEntity(entity, archetype->m_remove[id]);
+	}
+	void* World::GetComponent(Entity entity, ComponentId id)
+	{
+		if (!IsAlive(entity))
+			return nullptr;
+		const EntityRecord& record = m_records[entity.m_index];
+		if (record.m_archetype->m_columns[id] < 0)
+			return nullptr;
+		return record.m_archetype->GetComponent(record.m_row, id);
+	}
+
+	Archetype* World::FindArchetype(ComponentMask mask)
+	{
+		auto found = m_archetypeMap.find(mask);
+		if (found != m_archetypeMap.end())
+			return found->second;
+
+		std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>();
+		archetype->m_mask = mask;
+		memset(archetype->m_columns, -1, sizeof(archetype->m_columns));
+		memset(archetype->m_add, 0, sizeof(archetype->m_add));
+		memset(archetype->m_remove, 0, sizeof(archetype->m_remove));
+		size_t rowBytes = sizeof(Entity);
+		for (ComponentId id = 0; id < ENTITY_MAX_COMPONENTS; ++id)
+		{
+			if (!(mask & (ComponentMask(1) << id)))
+				continue;
+			archetype->m_columns[id] = (int8_t)archetype->m_components.size();
+			archetype->m_components.push_back(id);
+			rowBytes += GetComponentInfo(id).m_size;
+		}
+
+		// Layout // As many rows as fit once every column is padded to a cache line.
+		uint32_t capacity = (uint32_t)(ENTITY_CHUNK_SIZE / rowBytes);
+		for (; capacity > 1; --capacity)
+		{
+			size_t offset = AlignUp(sizeof(Entity) * capacity, 64);
+			for (ComponentId id : archetype->m_components)
+				offset = AlignUp(offset + GetComponentInfo(id).m_size * capacity, 64);
+			if (offset <= ENTITY_CHUNK_SIZE)
+				break;
+		}
+		archetype->m_capacity = capacity;
+		size_t offset = AlignUp(sizeof(Entity) * capacity, 64);
+		for (ComponentId id : archetype->m_components)
+		{
+			assert(GetComponentInfo(id).m_alignment <= 64);
+			archetype->m_offsets.push_back((uint32_t)offset);
+			offset = AlignUp(offset + GetComponentInfo(id).m_size * capacity, 64);
+		}
+		assert(offset <= ENTITY_CHUNK_SIZE); // A single row of this archetype is larger than a chunk.
+
+		Archetype* result = archetype.get();
+		m_archetypeMap[mask] = result;
+		m_archetypes.push_back(std::move(archetype));
+		return result;
+	}
+
+	uint32_t World::AddRow(Archetype* archetype, Entity entity)
+	{
+		uint32_t row = archetype->m_count++;
+		uint32_t chunk = row / archetype->m_capacity;
+		if (chunk == archetype->m_chunks.size())
+			archetype->m_chunks.push_back((uint8_t*)m_chunkPool->Allocate());
+		uint32_t slot = row % archetype->m_capacity;
+		archetype->GetEntities(chunk)[slot] = entity;
+		for (ComponentId id : archetype->m_components)
+		{
+			size_t size = GetComponentInfo(id).m_size;
+			memset((uint8_t*)archetype->GetColumn(chunk, id) + slot * size, 0, size);
+		}
+		return row;
+	}
+	void World::RemoveRow(Archetype* archetype, uint32_t row)
+	{
+		// The last row fills the hole, keeping every chunk but the last one full.
+		uint32_t last = archetype->m_count - 1;
+		if (row != last)
+		{
+			uint32_t chunk = row / archetype->m_capacity, slot = row % archetype->m_capacity;
+			uint32_t lastChunk = last / archetype->m_capacity, lastSlot = last % archetype->m_capacity;
+			Entity moved = archetype->GetEntities(lastChunk)[lastSlot];
+			archetype->GetEntities(chunk)[slot] = moved;
+			for (ComponentId id : archetype->m_components)
+			{
+				size_t size = GetComponentInfo(id).m_size;
+				memcpy((uint8_t*)archetype->GetColumn(chunk, id) + slot * size, (uint8_t*)archetype->GetColumn(lastChunk, id) + lastSlot * size, size);
+			}
+			m_records[moved.m_index].m_row = row;
+		}
+		archetype->m_count--;
+		if (archetype->m_count <= (archetype->m_chunks.size() - 1) * archetype->m_capacity)
+		{
+			m_chunkPool->Free(archetype->m_chunks.back());
+			archetype->m_chunks.pop_back();
+		}
+	}
+	void World::MoveEntity(Entity entity, Archetype* destination)
+	{
+		// Components both archetypes share are copied, added ones stay zeroed, removed ones are dropped.
+		EntityRecord& record = m_records[entity.m_index];
+		Archetype* source = record.m_archetype;
+		uint32_t row = AddRow(destination, entity);
+		for (ComponentId id : source->m_components)
+		{
+			if (destination->m_columns[id] >= 0)
+				memcpy(destination->GetComponent(row, id), source->GetComponent(record.m_row, id), GetComponentInfo(id).m_size);
+		}
+		RemoveRow(source, record.m_row);
+		record.m_archetype = destination;
+		record.m_row = row;
+		m_stats.m_moves++;
+	}
+
+	void World::UpdateQuery(Query& query)
+	{
+		for (; query.m_archetypesChecked < m_archetypes.size(); ++query.m_archetypesChecked)
+		{
+			Archetype* archetype = m_archetypes[query.m_archetypesChecked].get();
+			if (query.Matches(archetype->m_mask))
+				query.m_archetypes.push_back(archetype);
+		}
+	}
+	void World::ForEachChunk(Query& query, const std::function<void(const ChunkView&)>& function)
+	{
+		UpdateQuery(query);
+		m_iterating++;
+		for (Archetype* archetype : query.m_archetypes)
+		{
+			for (uint32_t chunk = 0; chunk < archetype->m_chunks.size(); ++chunk)
+				function(ChunkView(archetype, chunk));
+		}
+		m_iterating--;
+	}
+	void World::ForEachChunkParallel(Query& query, const std::function<void(const ChunkView&)>& function)
+	{
+		UpdateQuery(query);
+		query.m_chunks.clear();
+		for (Archetype* archetype : query.m_archetypes)
+		{
+			for (uint32_t chunk = 0; chunk < archetype->m_chunks.size(); ++chunk)
+				query.m_chunks.push_back(ChunkView(archetype, chunk));
+		}
+		m_iterating++;
+		int workers = JobSystem.GetWorkerCount();
+		if (workers <= 1 || query.m_chunks.size() <= 1)
+		{
+			for (const ChunkView& chunk : query.m_chunks)
+				function(chunk);
+		}
+		else
+		{
+			// A few groups per worker, chunks are equal in size so the split stays even.
+			const ChunkView* chunks = query.m_chunks.data();
+			int count = (int)query.m_chunks.size();
+			int groupSize = (count + workers * 4 - 1) / (workers * 4);
+			Jobs::Counter counter = 0;
+			JobSystem.Dispatch(count, groupSize, [chunks, &function](int start, int end)
+				{
+					for (int i = start; i < end; ++i)
+						function(chunks[i]);
+				}, &counter);
+			JobSystem.Wait(&counter);
+		}
+		m_iterating--;
+	}
+	size_t World::Count(Query& query)
+	{
+		UpdateQuery(query);
+		size_t count = 0;
+		for (Archetype* archetype : query.m_archetypes)
+			count += archetype->m_count;
+		return count;
+	}
+
+	const WorldStats& World::GetStats()
+	{
+		m_stats.m_entities = (uint32_t)(m_records.size() - m_freeRecords.size());
+		m_stats.m_archetypes = (uint32_t)m_archetypes.size();
+		m_stats.m_chunks = 0;
+		for (auto& archetype : m_archetypes)
+			m_stats.m_chunks += (uint32_t)archetype->m_chunks.size();
+		return m_stats;
+	}
+
+	// System Scheduler
+	void SystemScheduler::Add(const char* name, const SystemAccess& access, std::function<void(World&)> function)
+	{
+		m_systems.push_back({ name, access, std::move(function), 0 });
+		m_built = false;
+	}
+	void SystemScheduler::Clear()
+	{
+		m_systems.clear();
+		m_stages.clear();
+		m_built = false;
+	}
+
+	void SystemScheduler::Build()
+	{
+		if (m_built)
+			return;
+		m_stages.clear();
+		for (size_t i = 0; i < m_systems.size(); ++i)
+		{
+			int stage = 0;
+			for (size_t j = 0; j < i; ++j)
+			{
+				if (m_systems[i].m_access.Conflicts(m_systems[j].m_access) && m_systems[j].m_stage + 1 > stage)
+					stage = m_systems[j].m_stage + 1;
+			}
+			m_systems[i].m_stage = stage;
+			if (stage == (int)m_stages.size())
+				m_stages.emplace_back();
+			m_stages[stage].push_back((int)i);
+		}
+		m_built = true;
+	}
+	int SystemScheduler::GetStage(const char* name)
+	{
+		Build();
+		for (const System& system : m_systems)
+		{
+			if (system.m_name == name)
+				return system.m_stage;
+		}
+		return -1;
+	}
+
+	void SystemScheduler::Run(World& world)
+	{
+		Build();
+		bool parallel = JobSystem.GetWorkerCount() > 1;
+		for (const std::vector<int>& stage : m_stages)
+		{
+			// Exclusive systems always have a stage of their own.
+			if (!parallel || stage.size() == 1)
+			{
+				for (int i : stage)
+				{
+					System& system = m_systems[i];
+					PROFILE_SCOPE(system.m_name.c_str());
+					system.m_function(world);
+				}
+				continue;
+			}
+			Jobs::Counter counter = 0;
+			for (int i : stage)
+			{
+				System* system = &m_systems[i];
+				World* target = &world;
+				JobSystem.Run([system, target]()
+					{
+						PROFILE_SCOPE(system->m_name.c_str());
+						system->m_function(*target);
+					}, &counter);
+			}
+			JobSystem.Wait(&counter);
+		}
+	}
+}
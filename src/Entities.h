@@ -0,0 +1,275 @@
+#pragma once
+
+#include "Common.h"
+#include "Memory.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace Entities
+{
+	// Entity // Index into the world's entity table, the generation tells a recycled index from the entity that was destroyed.
+	struct Entity
+	{
+		uint32_t m_index = UINT32_MAX;
+		uint32_t m_generation = 0;
+
+		bool operator==(const Entity& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+		bool operator!=(const Entity& other) const { return !(*this == other); }
+	};
+	const Entity InvalidEntity = Entity();
+
+	// Components // Plain data, moved between chunks with memcpy. Ids are handed out on the first use of each type.
+	typedef uint32_t ComponentId;
+	typedef uint64_t ComponentMask; // One bit per component id, ENTITY_MAX_COMPONENTS at most.
+
+	struct ComponentInfo
+	{
+		size_t m_size;
+		size_t m_alignment;
+	};
+	ComponentId RegisterComponent(size_t size, size_t alignment);
+	const ComponentInfo& GetComponentInfo(ComponentId id);
+
+	template<typename T>
+	ComponentId GetComponentId()
+	{
+		if constexpr (std::is_const<T>::value)
+			return GetComponentId<std::remove_const_t<T>>(); // Read-only access, same component.
+		else
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Components are moved between chunks with memcpy");
+			static const ComponentId id = RegisterComponent(sizeof(T), alignof(T));
+			return id;
+		}
+	}
+	template<typename... Ts>
+	ComponentMask MakeMask() { return (ComponentMask(0) | ... | (ComponentMask(1) << GetComponentId<Ts>())); }
+
+	// Archetype // Every entity with the same set of components, stored in fixed-size chunks.
+	// A chunk holds the entity ids then one array per component (SoA), each column starting on a cache line.
+	// Rows are dense, removing one moves the last row into the hole.
+	struct Archetype
+	{
+		ComponentMask m_mask = 0;
+		std::vector<ComponentId> m_components;
+		std::vector<uint32_t> m_offsets; // Column start in a chunk, per entry of m_components.
+		int8_t m_columns[ENTITY_MAX_COMPONENTS]; // Index into m_components per component id, -1 when absent.
+		uint32_t m_capacity = 0; // Rows per chunk.
+		uint32_t m_count = 0;
+		std::vector<uint8_t*> m_chunks;
+		// Transitions // Archetype reached by adding or removing one component, filled as they are first taken.
+		Archetype* m_add[ENTITY_MAX_COMPONENTS];
+		Archetype* m_remove[ENTITY_MAX_COMPONENTS];
+
+		uint32_t GetChunkCount(uint32_t chunk) const { return (chunk + 1) * m_capacity <= m_count ? m_capacity : m_count - chunk * m_capacity; }
+		Entity* GetEntities(uint32_t chunk) const { return (Entity*)m_chunks[chunk]; }
+		void* GetColumn(uint32_t chunk, ComponentId id) const { return m_columns[id] < 0 ? nullptr : m_chunks[chunk] + m_offsets[m_columns[id]]; }
+		void* GetComponent(uint32_t row, ComponentId id) const
+		{
+			return (uint8_t*)GetColumn(row / m_capacity, id) + (row % m_capacity) * GetComponentInfo(id).m_size;
+		}
+	};
+
+	// Chunk View // One chunk of a query result, component arrays are indexed by row.
+	class ChunkView
+	{
+	public:
+		ChunkView(const Archetype* archetype, uint32_t chunk)
+			: m_archetype(archetype)
+			, m_chunk(chunk)
+			, m_count(archetype->GetChunkCount(chunk))
+		{ }
+
+		uint32_t GetCount() const { return m_count; }
+		const Entity* GetEntities() const { return m_archetype->GetEntities(m_chunk); }
+		// nullptr when the archetype lacks T, only for components the query did not require.
+		template<typename T>
+		T* Get() const { return (T*)m_archetype->GetColumn(m_chunk, GetComponentId<T>()); }
+		template<typename T>
+		bool Has() const { return (m_archetype->m_mask & MakeMask<T>()) != 0; }
+
+	private:
+		const Archetype* m_archetype;
+		uint32_t m_chunk;
+		uint32_t m_count;
+	};
+
+	// Query // Archetypes holding every All component and no None component. Matches are cached and topped up
+	// when the world creates archetypes, so a query kept between frames costs nothing to resolve.
+	class Query
+	{
+	public:
+		template<typename... Ts>
+		Query& All() { m_all |= MakeMask<Ts...>(); return *this; }
+		template<typename... Ts>
+		Query& None() { m_none |= MakeMask<Ts...>(); return *this; }
+
+		bool Matches(ComponentMask mask) const { return (mask & m_all) == m_all && (mask & m_none) == 0; }
+
+	private:
+		friend class World;
+
+		ComponentMask m_all = 0;
+		ComponentMask m_none = 0;
+		std::vector<Archetype*> m_archetypes;
+		size_t m_archetypesChecked = 0;
+		std::vector<ChunkView> m_chunks; // Flattened for parallel dispatch.
+	};
+
+	struct WorldStats
+	{
+		uint32_t m_entities = 0;
+		uint32_t m_archetypes = 0;
+		uint32_t m_chunks = 0;
+		uint32_t m_moves = 0; // Rows moved between archetypes by adding or removing components.
+	};
+
+	// World // Owns the entities, the archetypes and the chunk memory. Structural changes (creating, destroying, adding and
+	// removing components) move rows and invalidate chunk views, so they happen between queries, on one thread.
+	class World
+	{
+	public:
+		World() { }
+		~World() { Destroy(); }
+
+		void Create();
+		void Destroy();
+
+		Entity CreateEntity() { return CreateEntity(0); }
+		template<typename... Ts>
+		Entity CreateEntity(const Ts&... components)
+		{
+			Entity entity = CreateEntity(MakeMask<Ts...>());
+			(SetComponent(entity, components), ...);
+			return entity;
+		}
+		void DestroyEntity(Entity entity);
+		bool IsAlive(Entity entity) const { return entity.m_index < m_records.size() && m_records[entity.m_index].m_generation == entity.m_generation && m_records[entity.m_index].m_archetype; }
+
+		// Untyped, new components are zeroed.
+		void* AddComponent(Entity entity, ComponentId id);
+		void RemoveComponent(Entity entity, ComponentId id);
+		void* GetComponent(Entity entity, ComponentId id);
+
+		template<typename T>
+		T& AddComponent(Entity entity, const T& value = T()) { T* component = (T*)AddComponent(entity, GetComponentId<T>()); *component = value; return *component; }
+		template<typename T>
+		void RemoveComponent(Entity entity) { RemoveComponent(entity, GetComponentId<T>()); }
+		template<typename T>
+		T* GetComponent(Entity entity) { return (T*)GetComponent(entity, GetComponentId<T>()); }
+		template<typename T>
+		bool HasComponent(Entity entity) { return GetComponent(entity, GetComponentId<T>()) != nullptr; }
+		template<typename T>
+		void SetComponent(Entity entity, const T& value) { *GetComponent<T>(entity) = value; }
+
+		// Iteration // Chunk by chunk, on the calling thread or split across the job system.
+		void ForEachChunk(Query& query, const std::function<void(const ChunkView&)>& function);
+		void ForEachChunkParallel(Query& query, const std::function<void(const ChunkView&)>& function);
+		// Row by row, function takes a reference per component in Ts. Const components are only read.
+		template<typename... Ts, typename F>
+		void Each(Query& query, F&& function)
+		{
+			ForEachChunk(query, [&](const ChunkView& chunk) { EachRow(chunk.GetCount(), function, chunk.Get<Ts>()...); });
+		}
+		template<typename... Ts, typename F>
+		void EachParallel(Query& query, F&& function)
+		{
+			ForEachChunkParallel(query, [&](const ChunkView& chunk) { EachRow(chunk.GetCount(), function, chunk.Get<Ts>()...); });
+		}
+		size_t Count(Query& query);
+
+		const WorldStats& GetStats();
+
+		World(World const&) = delete;
+		void operator=(World const&) = delete;
+
+	private:
+		struct EntityRecord
+		{
+			Archetype* m_archetype;
+			uint32_t m_row;
+			uint32_t m_generation;
+		};
+
+		template<typename F, typename... Ps>
+		static void EachRow(uint32_t count, F& function, Ps*... columns)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				function(columns[i]...);
+		}
+
+		Entity CreateEntity(ComponentMask mask);
+		Archetype* FindArchetype(ComponentMask mask);
+		uint32_t AddRow(Archetype* archetype, Entity entity);
+		void RemoveRow(Archetype* archetype, uint32_t row);
+		void MoveEntity(Entity entity, Archetype* destination);
+		void UpdateQuery(Query& query);
+
+	private:
+		std::vector<EntityRecord> m_records;
+		std::vector<uint32_t> m_freeRecords;
+		std::vector<std::unique_ptr<Archetype>> m_archetypes; // Creation order, queries top up from where they left off.
+		std::unordered_map<ComponentMask, Archetype*> m_archetypeMap;
+		std::unique_ptr<Memory::PoolAllocator> m_chunkPool;
+		std::atomic<int> m_iterating = 0; // Queries running, structural changes are not allowed meanwhile.
+		WorldStats m_stats;
+
+	};
+
+	// System Access // Components a system reads and writes, used to find the systems that can run side by side.
+	struct SystemAccess
+	{
+		ComponentMask m_reads = 0;
+		ComponentMask m_writes = 0;
+		bool m_exclusive = false; // Touches state outside the world, runs alone on the calling thread.
+
+		template<typename... Ts>
+		SystemAccess& Read() { m_reads |= MakeMask<Ts...>(); return *this; }
+		template<typename... Ts>
+		SystemAccess& Write() { m_writes |= MakeMask<Ts...>(); return *this; }
+		SystemAccess& Exclusive() { m_exclusive = true; return *this; }
+
+		// Write after read, read after write and write after write.
+		bool Conflicts(const SystemAccess& other) const
+		{
+			return m_exclusive || other.m_exclusive || (m_writes & (other.m_reads | other.m_writes)) != 0 || (m_reads & other.m_writes) != 0;
+		}
+	};
+
+	// System Scheduler // Systems run in stages, a system lands one stage after the last earlier system it conflicts with.
+	// Systems sharing a stage run in parallel through the job system, registration order holds wherever access overlaps.
+	class SystemScheduler
+	{
+	public:
+		void Add(const char* name, const SystemAccess& access, std::function<void(World&)> function);
+		void Clear();
+
+		void Run(World& world);
+
+		int GetStageCount() { Build(); return (int)m_stages.size(); }
+		int GetStage(const char* name);
+
+	private:
+		struct System
+		{
+			std::string m_name;
+			SystemAccess m_access;
+			std::function<void(World&)> m_function;
+			int m_stage;
+		};
+		void Build();
+
+	private:
+		std::vector<System> m_systems;
+		std::vector<std::vector<int>> m_stages;
+		bool m_built = false;
+
+	};
+}
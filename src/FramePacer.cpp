@@ -0,0 +1,203 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <math.h>
+
+void MockClock::Sleep(uint64_t ns)
+{
+	// Rounded up to the timer resolution, then woken late.
+	uint64_t slices = (ns + m_sleepGranularity - 1) / m_sleepGranularity;
+	m_now += slices * m_sleepGranularity + m_sleepOvershoot;
+}
+
+double FramePacerStats::GetJitter() const
+{
+	if (m_frames == 0)
+		return 0.0;
+	double average = m_frameSeconds / m_frames;
+	return sqrt(std::max(m_frameSquares / m_frames - average * average, 0.0));
+}
+
+void FramePacer::Create(PacerClock& clock, const FramePacerSettings& settings)
+{
+	m_clock = &clock;
+	m_settings = settings;
+	m_settings.smoothing = std::clamp(m_settings.smoothing, 1, (int)(sizeof(m_history) / sizeof(m_history[0])));
+	m_stats = FramePacerStats();
+	m_started = false;
+	m_accumulator = 0.0;
+	m_alpha = 0.0;
+	m_simulationTime = 0.0;
+	// Smoothing starts from a history of perfect frames so early deltas are not skewed.
+	for (int i = 0; i < m_settings.smoothing; ++i)
+		m_history[i] = m_settings.fixedStep;
+	m_historyIndex = 0;
+	m_delta = m_settings.fixedStep;
+}
+void FramePacer::Destroy()
+{
+	m_clock = nullptr;
+}
+
+int FramePacer::BeginFrame()
+{
+	uint64_t now = m_clock->Now();
+	double delta = m_settings.fixedStep; // The first frame runs one step.
+	if (!m_started)
+	{
+		m_started = true;
+		m_deadline = now;
+	}
+	else
+	{
+		delta = (now - m_lastFrame) * 1e-9;
+		m_stats.m_frames++;
+		m_stats.m_frameSeconds += delta;
+		m_stats.m_frameSquares += delta * delta;
+		m_stats.m_worstFrame = std::max(m_stats.m_worstFrame, delta);
+	}
+	m_lastFrame = now;
+
+	// Spike Clamp
+	if (delta > m_settings.maxDelta)
+	{
+		m_stats.m_spikes++;
+		m_stats.m_clampedSeconds += delta - m_settings.maxDelta;
+		delta = m_settings.maxDelta;
+	}
+	// Smoothing // Averaged over the last few frames, scheduler noise does not turn into uneven steps.
+	m_history[m_historyIndex] = delta;
+	m_historyIndex = (m_historyIndex + 1) % m_settings.smoothing;
+	double sum = 0.0;
+	for (int i = 0; i < m_settings.smoothing; ++i)
+		sum += m_history[i];
+	m_delta = sum / m_settings.smoothing;
+
+	// Fixed Steps
+	m_accumulator += m_delta;
+	int steps = 0;
+	while (m_accumulator >= m_settings.fixedStep)
+	{
+		if (steps == m_settings.maxSteps)
+		{
+			// Too far behind to catch up, drop whole steps and keep the remainder.
+			double dropped = floor(m_accumulator / m_settings.fixedStep);
+			m_stats.m_droppedSteps += (uint64_t)dropped;
+			m_accumulator -= dropped * m_settings.fixedStep;
+			break;
+		}
+		m_accumulator -= m_settings.fixedStep;
+		steps++;
+	}
+	m_simulationTime += steps * m_settings.fixedStep;
+	m_stats.m_steps += steps;
+	m_alpha = std::clamp(m_accumulator / m_settings.fixedStep, 0.0, 1.0 - 1e-9);
+	return steps;
+}
+void FramePacer::EndFrame()
+{
+	if (m_settings.targetFps <= 0.0)
+		return;
+
+	// Deadlines advance by whole periods so rounding never accumulates into drift.
+	uint64_t period = (uint64_t)(1e9 / m_settings.targetFps);
+	m_deadline += period;
+	uint64_t now = m_clock->Now();
+	if (now >= m_deadline)
+	{
+		// Late by more than a frame, start over rather than bursting to catch up.
+		m_stats.m_lateFrames++;
+		if (now - m_deadline > period)
+			m_deadline = now;
+		return;
+	}
+
+	// Sleep while it is safe to, then spin the rest.
+	uint64_t spinThreshold = (uint64_t)(m_settings.spinThreshold * 1e9);
+	while (now < m_deadline)
+	{
+		uint64_t remaining = m_deadline - now;
+		if (remaining > spinThreshold)
+			m_clock->Sleep(remaining - spinThreshold);
+		else
+			m_clock->Spin();
+		uint64_t woke = m_clock->Now();
+		((remaining > spinThreshold) ? m_stats.m_sleepSeconds : m_stats.m_spinSeconds) += (woke - now) * 1e-9;
+		now = woke;
+	}
+}
+
+static void Simulate(MockClock& clock, FramePacer& pacer, int frames, double workMs, unsigned int seed, FramePacerSimulationReport& report)
+{
+	// Deterministic noise, work varies by +-25% and every 500th frame stalls for 400 ms.
+	// Frame intervals are measured here too, leaving out the stalls so jitter reflects pacing alone.
+	unsigned int state = seed ? seed : 1;
+	uint64_t steps = 0;
+	uint64_t last = clock.Now();
+	double sum = 0.0, squares = 0.0, worst = 0.0;
+	int intervals = 0;
+	bool stalled = true;
+	for (int f = 0; f < frames; ++f)
+	{
+		double interval = (clock.Now() - last) * 1e-6;
+		last = clock.Now();
+		if (!stalled)
+		{
+			sum += interval;
+			squares += interval * interval;
+			worst = std::max(worst, interval);
+			intervals++;
+		}
+		steps += pacer.BeginFrame();
+		if (pacer.GetAlpha() < 0.0 || pacer.GetAlpha() >= 1.0)
+			report.m_alphaInRange = false;
+		state = state * 1664525u + 1013904223u;
+		double noise = (state >> 8) / (double)(1u << 24);
+		double ms = workMs * (0.75 + 0.5 * noise);
+		stalled = f % 500 == 499;
+		if (stalled)
+			ms += 400.0;
+		clock.Advance((uint64_t)(ms * 1000000.0));
+		pacer.EndFrame();
+	}
+	const FramePacerStats& stats = pacer.GetStats();
+	if (intervals > 0)
+	{
+		report.m_averageMs = sum / intervals;
+		report.m_jitterMs = sqrt(std::max(squares / intervals - report.m_averageMs * report.m_averageMs, 0.0));
+		report.m_worstMs = worst;
+	}
+	report.m_stepsPerFrame = (double)steps / frames;
+	report.m_driftMs = (stats.m_frameSeconds + pacer.GetFixedStep() - stats.m_clampedSeconds - stats.m_droppedSteps * pacer.GetFixedStep()
+		- pacer.GetSimulationTime() - pacer.GetAlpha() * pacer.GetFixedStep()) * 1000.0;
+}
+FramePacerSimulationReport RunFramePacerSimulation(int frames, double workMs, unsigned int seed)
+{
+	FramePacerSimulationReport report;
+	report.m_frames = frames;
+	if (frames <= 0)
+		return report;
+	FramePacerSettings settings;
+	report.m_targetMs = 1000.0 / settings.targetFps;
+
+	// Spin-only reference, the same frames without sleeping.
+	{
+		MockClock clock;
+		FramePacer pacer;
+		FramePacerSettings spinOnly = settings;
+		spinOnly.spinThreshold = 1e9;
+		pacer.Create(clock, spinOnly);
+		FramePacerSimulationReport unused;
+		Simulate(clock, pacer, frames, workMs, seed, unused);
+		report.m_spinOnlyCpuUsage = pacer.GetStats().GetCpuUsage();
+	}
+
+	MockClock clock;
+	FramePacer pacer;
+	pacer.Create(clock, settings);
+	Simulate(clock, pacer, frames, workMs, seed, report);
+	const FramePacerStats& stats = pacer.GetStats();
+	report.m_cpuUsage = stats.GetCpuUsage();
+	report.m_spikes = stats.m_spikes;
+	return report;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Common.h"
+
+#include <stdint.h>
+
+// Pacer Clock // Nanosecond time source and waits, real in Timing and mocked for the pacing simulation.
+class PacerClock
+{
+public:
+	virtual ~PacerClock() { }
+
+	virtual uint64_t Now() = 0;
+	virtual void Sleep(uint64_t ns) = 0; // May return late, never early.
+	virtual void Spin() = 0; // One iteration of a busy wait.
+};
+
+// Mock Clock // Time only moves when told to. Sleeps round up to a granularity and overshoot by a fixed amount, like the OS scheduler.
+class MockClock : public PacerClock
+{
+public:
+	uint64_t Now() override { return m_now; }
+	void Sleep(uint64_t ns) override;
+	void Spin() override { m_now += m_spinCost; }
+
+	void Advance(uint64_t ns) { m_now += ns; }
+
+	uint64_t m_now = 0;
+	uint64_t m_sleepGranularity = 1000000; // 1 ms timer resolution.
+	uint64_t m_sleepOvershoot = 200000;
+	uint64_t m_spinCost = 1000;
+};
+
+struct FramePacerSettings
+{
+	double targetFps = WINDOW_FPS; // 0 Uncapped.
+	double fixedStep = 1.0 / WINDOW_FPS; // Seconds per simulation step.
+	int maxSteps = 5; // Per frame, time beyond this is dropped instead of spiralling.
+	double maxDelta = 0.25; // Spike clamp, a breakpoint or window drag does not become 15 steps.
+	int smoothing = 4; // Frames averaged into the delta, 1 disables.
+	double spinThreshold = 0.002; // The tail of a frame is spun, sleeps are not precise enough.
+};
+
+struct FramePacerStats
+{
+	uint64_t m_frames = 0;
+	uint64_t m_steps = 0;
+	uint64_t m_spikes = 0; // Deltas clamped to maxDelta.
+	uint64_t m_droppedSteps = 0;
+	uint64_t m_lateFrames = 0; // Missed the deadline, nothing to wait for.
+	double m_frameSeconds = 0.0; // Sum of measured frame intervals.
+	double m_frameSquares = 0.0;
+	double m_clampedSeconds = 0.0; // Time removed by the spike clamp.
+	double m_sleepSeconds = 0.0;
+	double m_spinSeconds = 0.0;
+	double m_worstFrame = 0.0;
+
+	double GetAverageFrame() const { return m_frames ? m_frameSeconds / m_frames : 0.0; }
+	double GetJitter() const; // Standard deviation of the frame interval.
+	double GetCpuUsage() const { return m_frameSeconds > 0.0 ? 1.0 - m_sleepSeconds / m_frameSeconds : 0.0; } // Fraction of the time not asleep.
+};
+
+// Frame Pacer // Turns measured frame times into a smoothed delta and a number of fixed simulation steps,
+// leaving an interpolation factor for rendering between the last two steps, then waits out the frame budget.
+class FramePacer
+{
+public:
+	void Create(PacerClock& clock, const FramePacerSettings& settings = FramePacerSettings());
+	void Destroy();
+
+	// Start of frame, returns the number of fixed steps to simulate.
+	int BeginFrame();
+	// End of frame, sleeps then spins until the next frame is due.
+	void EndFrame();
+
+	double GetDelta() { return m_delta; } // Smoothed and clamped, seconds.
+	double GetFixedStep() { return m_settings.fixedStep; }
+	double GetAlpha() { return m_alpha; } // [0, 1) between the previous and the latest step.
+	double GetSimulationTime() { return m_simulationTime; }
+
+	void SetTargetFps(double fps) { m_settings.targetFps = fps; }
+	const FramePacerSettings& GetSettings() { return m_settings; }
+	const FramePacerStats& GetStats() { return m_stats; }
+	void ResetStats() { m_stats = FramePacerStats(); }
+
+private:
+	PacerClock* m_clock = nullptr;
+	FramePacerSettings m_settings;
+	FramePacerStats m_stats;
+
+	bool m_started = false;
+	uint64_t m_lastFrame = 0;
+	uint64_t m_deadline = 0;
+	double m_history[16] = { };
+	int m_historyCount = 0;
+	int m_historyIndex = 0;
+	double m_delta = 0.0;
+	double m_accumulator = 0.0;
+	double m_alpha = 0.0;
+	double m_simulationTime = 0.0;
+
+};
+
+// Simulation // Drives a pacer with the mock clock through a deterministic workload of noisy frames and occasional spikes.
+struct FramePacerSimulationReport
+{
+	int m_frames = 0;
+	double m_targetMs = 0.0;
+	double m_averageMs = 0.0; // Frame intervals, stalls left out.
+	double m_jitterMs = 0.0;
+	double m_worstMs = 0.0;
+	double m_cpuUsage = 0.0; // Spinning counts as busy.
+	double m_spinOnlyCpuUsage = 0.0; // The same workload with every wait spun.
+	double m_stepsPerFrame = 0.0;
+	double m_driftMs = 0.0; // Real time not yet simulated, bounded by the smoothing window.
+	uint64_t m_spikes = 0;
+	bool m_alphaInRange = true;
+};
+FramePacerSimulationReport RunFramePacerSimulation(int frames, double workMs, unsigned int seed = 1);
@@ -2,14 +2,44 @@
 
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <stdio.h>
 
-void Game::Create()
+void Game::Create(const GameOptions& options)
 {
+	m_options = options;
+	Profiler.Create(); // First, the calling thread is registered as Main.
+	FrameMemory.Create();
 	KeyboardInput.Create();
 	MouseInput.Create();
-	m_window.Create();
-	m_renderer.Create(m_window);
-	m_audioEngine.Create();
+	if (m_options.headless)
+	{
+		if (m_options.software)
+			m_renderer.CreateSoftware();
+		else
+			m_renderer.CreateNull();
+		m_audioEngine.CreateNull();
+	}
+	else
+	{
+		m_window.Create();
+		m_renderer.Create(m_window);
+		m_audioEngine.Create();
+	}
+	Transforms.Create();
+	Culling.Create();
+	JobSystem.Create();
+	AssetLoader.Create();
+	Textures.Create(m_renderer);
+	Shaders.Create(m_renderer);
+	Materials.Create(m_renderer);
+	if (m_options.loadTest)
+	{
+		RunLoadTest();
+		return;
+	}
 	{
 		// Create here..
 		m_sceneRoot.Create();
@@ -24,19 +54,47 @@ void Game::Create()
 		m_sceneRoot.AddChild(m_cameraObject);
 		m_sceneRoot.AddChild(m_playerObject);
 
+		// Crowd // Every copy shares the player's model, loaded once.
+		int columns = (int)ceilf(sqrtf((float)m_options.instances));
+		for (int i = 0; i < m_options.instances; ++i)
+		{
+			std::unique_ptr<Objects::ModelObject> crowd = std::make_unique<Objects::ModelObject>();
+			crowd->Create(m_renderer, "./res/models/heavy.obj");
+			crowd->SetCamera(&m_cameraObject);
+			crowd->SetPosition({ (float)(i % columns - columns / 2) * 2.0f, 0.0f, (float)(i / columns + 1) * 2.0f });
+			m_sceneRoot.AddChild(*crowd);
+			m_crowdObjects.push_back(std::move(crowd));
+		}
+
 		m_audioEngine.PlayAudio("./res/sounds/test.ogg", 0.1f);
 		//m_audioEngine.PlayMusic("./res/sounds/music/streamed/rivaldealer.ogg", 0.5f);
 	}
-	m_window.MessageLoop();
+	if (m_options.headless)
+	{
+		AssetLoader.WaitAll(); // Measure frames, not streaming.
+		Renderer::ShaderLibraryStats shaders = Shaders.GetStats();
+		char report[256];
+		snprintf(report, sizeof(report), "Startup: shaders %u compiled (%.2f ms), %u from disk (%.2f ms), %u memory hits, %u objects shared\n",
+			shaders.m_compiles, shaders.m_compileMs, shaders.m_diskHits, shaders.m_diskMs, shaders.m_memoryHits, shaders.m_programHits);
+		OutputDebugString(report);
+		printf("%s", report);
+		RunHeadless(m_options.headlessFrames);
+	}
+	else
+		m_window.MessageLoop();
 }
 void Game::Destroy()
 {
+	AssetLoader.Destroy(); // Drop in-flight loads before their owners go away.
 	m_window.Destroy();
 	m_renderer.Destroy();
 	MouseInput.Destroy();
 	KeyboardInput.Destroy();
 	{
 		// Destroy here..
+		for (auto& o : m_crowdObjects)
+			o->Destroy();
+		m_crowdObjects.clear();
 		m_playerObject.Destroy();
 		m_cameraObject.Destroy();
 		m_sceneRoot.Destroy();
@@ -44,12 +102,243 @@ void Game::Destroy()
 		m_audioEngine.UnloadAudio("./res/sounds/test.ogg");
 		m_audioEngine.UnloadAudio("./res/sounds/music/streamed/rivaldealer.ogg");
 	}
+	Materials.Destroy();
+	Textures.Destroy();
+	Shaders.Destroy();
+	JobSystem.Destroy();
+	Culling.Destroy();
+	Transforms.Destroy();
 	m_audioEngine.Destroy();
+	FrameMemory.Destroy();
+	Profiler.Destroy();
+}
+
+void Game::RunHeadless(int frames)
+{
+	// Platform-agnostic fixed-step loop, no message pump or presentation.
+	if (frames <= 0)
+		return;
+	GameTime.Create();
+	GameTime.SetFixedStep(m_options.fixedStep);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	double total = 0.0, worst = 0.0, best = 1e9;
+	size_t draws = 0, instances = 0;
+	uint64_t steadyAllocations = 0, peakAllocations = 0;
+	int mismatches = 0;
+	char mismatch[128] = {};
+	for (int i = 0; i < frames; ++i)
+	{
+		Clock::time_point start = Clock::now();
+		Profiler.BeginFrame();
+		GameTime.CalculateTimings();
+		Update();
+		Draw();
+		Profiler.EndFrame();
+		FrameMemory.EndFrame();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		total += ms;
+		worst = (ms > worst) ? ms : worst;
+		best = (ms < best) ? ms : best;
+		draws += m_renderer.GetDrawRecords().size();
+		for (const auto& d : m_renderer.GetDrawRecords())
+			instances += d.m_instanceCount;
+		unsigned int expectedInstances, minDraws, maxDraws;
+		if (!CheckInstancing(expectedInstances, minDraws, maxDraws) && mismatches++ == 0)
+		{
+			const Renderer::RenderQueueStats& stats = m_renderer.GetRenderQueue().GetStats();
+			snprintf(mismatch, sizeof(mismatch), "frame %d drew %u instances in %u draws, expected %u in %u to %u", i, stats.m_instances, stats.m_instancedDraws,
+				expectedInstances, minDraws, maxDraws);
+		}
+		// Steady state is the second half, once loads have landed and arenas have grown.
+		uint64_t allocations = FrameMemory.GetStats().m_heapAllocations;
+		if (i >= frames / 2)
+			steadyAllocations += allocations;
+		peakAllocations = (allocations > peakAllocations) ? allocations : peakAllocations;
+	}
+
+	// Report
+	char report[256];
+	snprintf(report, sizeof(report), "Headless: %d frames, avg %.4f ms, min %.4f ms, max %.4f ms, %.1f fps, %.1f draws/frame, %.1f instances/frame, %zu models\n",
+		frames, total / frames, best, worst, frames / (total / 1000.0), (double)draws / frames, (double)instances / frames, Renderer::Meshes::MeshRenderer::GetSharedModelCount());
+	OutputDebugString(report);
+	printf("%s", report);
+	const Memory::FrameMemoryStats& memory = FrameMemory.GetStats();
+	snprintf(report, sizeof(report), "Memory: %.2f heap allocations/frame steady, %llu peak, frame arena %zu / %zu bytes, %u overflows%s\n",
+		(double)steadyAllocations / (frames - frames / 2), (unsigned long long)peakAllocations, memory.m_arenaUsed, memory.m_arenaCapacity, memory.m_arenaOverflows,
+		MEMORY_TRACKING ? "" : " (tracking off)");
+	OutputDebugString(report);
+	printf("%s", report);
+	if (Renderer::RHI::RecordingDevice* device = m_renderer.GetRecordingDevice())
+	{
+		// Every frame went through the recording device, any error is a command the D3D11 device would have misused.
+		const Renderer::RHI::RecordingStats& recording = device->GetRecordingStats();
+		const Renderer::RHI::DeviceStats& stats = device->GetStats();
+		snprintf(report, sizeof(report), "RHI: %llu commands in %llu submits, %llu draws, %llu update bytes, %u buffers, %u pipelines, %llu errors%s%s\n",
+			(unsigned long long)stats.m_commands, (unsigned long long)stats.m_submits, (unsigned long long)recording.m_draws, (unsigned long long)recording.m_updateBytes,
+			stats.m_buffers, stats.m_pipelines, (unsigned long long)recording.m_errors, device->GetErrors().empty() ? "" : ", first: ", device->GetErrors().empty() ? "" : device->GetErrors()[0].c_str());
+		OutputDebugString(report);
+		printf("%s", report);
+	}
+	snprintf(report, sizeof(report), "Instancing: %d of %d frames mismatched%s%s\n", mismatches, frames, mismatches ? ", first: " : "", mismatch);
+	OutputDebugString(report);
+	printf("%s", report);
+	if (mismatches)
+		m_exitCode = 1;
+	if (m_options.trace)
+		printf("Trace: %s %s\n", Profiler.ExportChromeTrace(PROFILER_TRACE_PATH) ? "wrote" : "failed to write", PROFILER_TRACE_PATH);
+	if (m_options.software)
+	{
+		const Renderer::RasterStats& raster = m_renderer.GetSoftwareRasterizer().GetStats();
+		snprintf(report, sizeof(report), "Software: %u triangles, %u binned, %u culled, %u clipped, %llu pixels shaded, vertices %.2f ms, binning %.2f ms, tiles %.2f ms\n",
+			raster.m_triangles, raster.m_trianglesBinned, raster.m_trianglesCulled, raster.m_trianglesClipped, (unsigned long long)raster.m_pixelsShaded,
+			raster.m_vertexMs, raster.m_binMs, raster.m_rasterMs);
+		OutputDebugString(report);
+		printf("%s", report);
+		printf("Screenshot: %s %s\n", m_renderer.GetSoftwareRasterizer().WriteImage(RASTER_SCREENSHOT_PATH) ? "wrote" : "failed to write", RASTER_SCREENSHOT_PATH);
+	}
+}
+
+bool Game::CheckInstancing(unsigned int& expectedInstances, unsigned int& minDraws, unsigned int& maxDraws)
+{
+	// Expected // Every drawn copy of an instanced model is one instance of each of its meshes. Copies of a mesh at the same level
+	// share a draw, split every INSTANCE_BUFFER_CAPACITY, and a command list boundary can split a run once more.
+	std::map<std::pair<size_t, int>, unsigned int> batches;
+	expectedInstances = 0;
+	auto count = [&batches, &expectedInstances](Objects::ModelObject& object)
+	{
+		Renderer::Meshes::MeshRenderer& meshRenderer = object.GetMeshRenderer();
+		if (!object.WasDrawn() || !meshRenderer.IsInstanced())
+			return;
+		for (size_t m = 0; m < meshRenderer.GetMeshCount(); ++m)
+		{
+			batches[{ m, meshRenderer.GetMeshLod(m) }]++;
+			expectedInstances++;
+		}
+	};
+	count(m_playerObject);
+	for (auto& o : m_crowdObjects)
+		count(*o);
+	minDraws = 0;
+	for (const auto& batch : batches)
+		minDraws += (batch.second + INSTANCE_BUFFER_CAPACITY - 1) / INSTANCE_BUFFER_CAPACITY;
+	const Renderer::RenderQueueStats& stats = m_renderer.GetRenderQueue().GetStats();
+	maxDraws = minDraws + (stats.m_commandLists > 1 ? stats.m_commandLists - 1 : 0);
+	return stats.m_instances == expectedInstances && stats.m_instancedDraws >= minDraws && stats.m_instancedDraws <= maxDraws;
+}
+
+void Game::RunLoadTest()
+{
+	// Gather res/
+	std::vector<std::string> models, textures;
+	std::vector<std::wstring> shaders;
+	std::error_code error;
+	for (auto& entry : std::filesystem::recursive_directory_iterator("./res", error))
+	{
+		if (!entry.is_regular_file())
+			continue;
+		std::string ext = entry.path().extension().string();
+		if (ext == ".obj" || ext == ".dae" || ext == ".fbx")
+			models.push_back(entry.path().string());
+		else if (ext == ".png" || ext == ".jpg" || ext == ".tga" || ext == ".bmp")
+			textures.push_back(entry.path().string());
+		else if (ext == ".hlsl")
+			shaders.push_back(entry.path().wstring());
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+	// Serial // The old path, everything on the calling thread. Shaders compile from source in both runs.
+	Shaders.SetDiskCache(false);
+	Shaders.ClearMemoryCache();
+	Clock::time_point start = Clock::now();
+	for (auto& path : models)
+	{
+		Renderer::Meshes::ModelData data;
+		Renderer::Meshes::MeshRenderer::Import(path.c_str(), nullptr, data);
+	}
+	for (auto& path : textures)
+	{
+		Renderer::Meshes::TextureData data;
+		Renderer::Meshes::Texture::Decode(path.c_str(), data);
+	}
+	for (auto& path : shaders)
+	{
+		Renderer::Meshes::ShaderBlobs blobs;
+		Renderer::Meshes::Shader::Compile(path.c_str(), blobs);
+		blobs.Release();
+	}
+	double serialMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	// Parallel // Same work through the streaming threads.
+	Shaders.ClearMemoryCache();
+	start = Clock::now();
+	for (auto& path : models)
+	{
+		std::shared_ptr<Renderer::Meshes::ModelData> data = std::make_shared<Renderer::Meshes::ModelData>();
+		AssetLoader.Request(path.c_str(), [data, path]() { return Renderer::Meshes::MeshRenderer::Import(path.c_str(), nullptr, *data); });
+	}
+	for (auto& path : textures)
+	{
+		AssetLoader.Request(path.c_str(), [path]()
+		{
+			Renderer::Meshes::TextureData data;
+			return Renderer::Meshes::Texture::Decode(path.c_str(), data);
+		});
+	}
+	for (auto& path : shaders)
+	{
+		AssetLoader.Request("shader", [path]()
+		{
+			Renderer::Meshes::ShaderBlobs blobs;
+			bool result = Renderer::Meshes::Shader::Compile(path.c_str(), blobs);
+			blobs.Release();
+			return result;
+		});
+	}
+	AssetLoader.WaitAll();
+	double parallelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	// Shader Cache // Startup cost of every shader from source, from the disk cache and from memory.
+	auto compileShaders = [&shaders]()
+	{
+		Clock::time_point start = Clock::now();
+		for (auto& path : shaders)
+		{
+			Renderer::Meshes::ShaderBlobs blobs;
+			Renderer::Meshes::Shader::Compile(path.c_str(), blobs);
+			blobs.Release();
+		}
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+	Shaders.ClearMemoryCache();
+	double sourceMs = compileShaders();
+	Shaders.SetDiskCache(true);
+	Shaders.ClearMemoryCache();
+	Shaders.Precompile("./res/shaders");
+	Shaders.ClearMemoryCache();
+	Shaders.ResetStats();
+	double diskMs = compileShaders();
+	double memoryMs = compileShaders();
+	Renderer::ShaderLibraryStats shaderStats = Shaders.GetStats();
+
+	// Report
+	char report[256];
+	snprintf(report, sizeof(report), "Shader Cache: source %.2f ms, disk %.2f ms (%u hits), memory %.2f ms (%u hits)\n",
+		sourceMs, diskMs, shaderStats.m_diskHits, memoryMs, shaderStats.m_memoryHits);
+	OutputDebugString(report);
+	printf("%s", report);
+	snprintf(report, sizeof(report), "Load Test: %zu models, %zu textures, %zu shaders, serial %.2f ms, parallel %.2f ms (%d threads), %.2fx\n",
+		models.size(), textures.size(), shaders.size(), serialMs, parallelMs, AssetLoader.GetWorkerCount(), serialMs / (parallelMs > 0.0 ? parallelMs : 1.0));
+	OutputDebugString(report);
+	printf("%s", report);
 }
 
 std::stringstream r;
 void Game::Update()
 {
+	PROFILE_FUNCTION();
+	Transforms.BeginStep(); // Keep the last step for interpolation
 	KeyboardInput.Update();
 	{
 		// Update here..
@@ -58,14 +347,31 @@ void Game::Update()
 			Destroy(); // Quit Game
 
 		//m_playerObject.Rotate(GameTime.GetDelta(), {0,1,0});
-		m_sceneRoot.Update(); // Update Scene
+		{
+			PROFILE_SCOPE("Scene Update");
+			if (SCENE_PARALLEL_UPDATE)
+				m_sceneRoot.UpdateParallel(); // Update Scene across all workers
+			else
+				m_sceneRoot.Update(); // Update Scene
+		}
+		{
+			PROFILE_SCOPE("Transforms");
+			Transforms.Update(); // Resolve Dirty Transforms
+			Culling.Update(); // Refit Moved Bounds
+		}
+	}
+	{
+		PROFILE_SCOPE("Asset Upload");
+		AssetLoader.Update(); // Upload Streamed Assets
 	}
 	m_audioEngine.Update();
 }
 
 bool showImGui = true;
+bool showProfiler = true;
 void Game::Draw()
 {
+	PROFILE_FUNCTION();
 	m_renderer.BeginFrame();
 	{
 		ImGui::Begin("Camera", &showImGui);
@@ -80,9 +386,52 @@ void Game::Draw()
 				Math::RadiansToDegrees(m_cameraObject.GetRotation().z));
 		}
 		ImGui::End();
+		ImGui::Begin("Renderer", &showImGui);
+		{ // ImGui // Stats from the previous frame's render queue.
+			const Renderer::RenderQueueStats& stats = m_renderer.GetRenderQueue().GetStats();
+			ImGui::Text("Draws: %u (%u instanced, %u instances)", stats.m_draws, stats.m_instancedDraws, stats.m_instances);
+			ImGui::Text("Models: %zu shared", Renderer::Meshes::MeshRenderer::GetSharedModelCount());
+			ImGui::Text("Binds: Shader %u, Texture %u, Constants %u, Mesh %u, Material %u", stats.m_shaderBinds, stats.m_textureBinds, stats.m_constantBinds, stats.m_meshBinds, stats.m_materialBinds);
+			ImGui::Text("State Changes Saved: %u", stats.m_stateChangesSaved);
+			ImGui::Text("Command Lists: %u, Record %.3f ms, Submit %.3f ms", stats.m_commandLists, stats.m_recordMs, stats.m_submitMs);
+			const Renderer::TextureCacheStats& textures = Textures.GetStats();
+			ImGui::Text("Textures: %u (%u referenced), %u samplers", textures.m_entries, textures.m_referenced, textures.m_samplers);
+			ImGui::Text("Texture Memory: %.2f / %.2f MB", textures.m_residentBytes / (1024.0 * 1024.0), textures.m_budgetBytes / (1024.0 * 1024.0));
+			ImGui::Text("Texture Loads: %u (%u decodes), Hits %u, Evictions %u", textures.m_loads, textures.m_decodes, textures.m_hits, textures.m_evictions);
+			const Renderer::MaterialLibraryStats& materials = Materials.GetStats();
+			ImGui::Text("Materials: %u (%u shared acquires), %u uploads", materials.m_materials, materials.m_shared, materials.m_uploads);
+			Renderer::ShaderLibraryStats shaders = Shaders.GetStats();
+			ImGui::Text("Shaders: %u compiled (%.2f ms), %u from disk (%.2f ms), %u memory hits", shaders.m_compiles, shaders.m_compileMs, shaders.m_diskHits, shaders.m_diskMs, shaders.m_memoryHits);
+			ImGui::Text("Shader Objects: %u created, %u shared", shaders.m_programs, shaders.m_programHits);
+			const Renderer::CullingStats& culling = Culling.GetStats();
+			ImGui::Text("Culling: %u / %u visible (%.3f ms), %u nodes tested", culling.m_visible, culling.m_objects, culling.m_cullMs, culling.m_bvh.m_nodesTested);
+			ImGui::Text("BVH: %u nodes, cost %.2f, %u refits, %u rebuilds", culling.m_bvh.m_nodes, culling.m_bvh.m_cost, culling.m_bvh.m_refits, culling.m_bvh.m_rebuilds);
+			const FramePacerStats& pacing = GameTime.GetPacer().GetStats();
+			ImGui::Text("Frame: %.2f ms, jitter %.2f ms, worst %.2f ms", pacing.GetAverageFrame() * 1000.0, pacing.GetJitter() * 1000.0, pacing.m_worstFrame * 1000.0);
+			ImGui::Text("Pacing: %.1f%% awake, %.2f steps/frame, %llu late, %llu spikes", pacing.GetCpuUsage() * 100.0, pacing.m_frames ? (double)pacing.m_steps / pacing.m_frames : 0.0,
+				(unsigned long long)pacing.m_lateFrames, (unsigned long long)pacing.m_spikes);
+			const Memory::FrameMemoryStats& memory = FrameMemory.GetStats();
+			ImGui::Text("Heap: %llu allocations (%.1f KB) last frame", (unsigned long long)memory.m_heapAllocations, memory.m_heapBytes / 1024.0);
+			ImGui::Text("Frame Arena: %.1f / %.1f KB, %u overflows", memory.m_arenaUsed / 1024.0, memory.m_arenaCapacity / 1024.0, memory.m_arenaOverflows);
+			Memory::RingAllocator& constants = m_renderer.GetConstantAllocator();
+			ImGui::Text("Constant Ring: %.1f / %.1f KB, %zu frames in flight, %u wraps, %u full", constants.GetUsed() / 1024.0, constants.GetCapacity() / 1024.0,
+				constants.GetFramesInFlight(), constants.GetWraps(), constants.GetFailures());
+		}
+		ImGui::End();
+		Profiler.DrawImGui(&showProfiler);
 		// Draw here..
 		//
-		m_sceneRoot.Draw(); // Draw Scene
+		if (SCENE_CULLING)
+		{
+			PROFILE_SCOPE("Culling");
+			m_cameraObject.UpdateView(); // This frame's view, the scene draw comes after.
+			Renderer::Camera& camera = m_cameraObject.GetCameraRenderer();
+			Culling.Cull(Renderer::Frustum(camera.GetViewMatrix() * camera.GetProjectionMatrix())); // Cull Scene
+		}
+		{
+			PROFILE_SCOPE("Scene Draw");
+			m_sceneRoot.Draw(); // Draw Scene
+		}
 	}
 	m_renderer.EndFrame();
 }
@@ -9,21 +9,53 @@
 #include "Window.h"
 #include "Renderer.h"
 #include "Audio.h"
+#include "Assets.h"
+#include "TextureCache.h"
+#include "ShaderLibrary.h"
+#include "Material.h"
+#include "Profiler.h"
+#include "Memory.h"
 
 #include "GameObject.h"
 
+struct GameOptions
+{
+	// Headless // No window, null renderer and stubbed audio, driven by a fixed-step loop. Checks each frame's instanced draws
+	// against the scene and exits non-zero on a mismatch.
+	bool headless = false;
+	int headlessFrames = 1000;
+	float fixedStep = 1.0f / WINDOW_FPS;
+	// Load Test // Loads res/ serially then through the asset streaming threads and reports both times.
+	bool loadTest = false;
+	// Crowd // Extra copies of the player model in a grid, sharing one model and drawn instanced.
+	int instances = 0;
+	// Trace // Writes the profiler history as Chrome trace JSON once the headless run ends.
+	bool trace = false;
+	// Software // Headless run drawn by the software rasterizer, the last frame is written to RASTER_SCREENSHOT_PATH.
+	bool software = false;
+};
+
 class Game
 {
 public:
-	void Create();
+	void Create(const GameOptions& options = GameOptions());
 	void Destroy();
 
 	void Update();
 	void Draw();
 
+	int GetExitCode() { return m_exitCode; } // Non-zero when a headless run failed one of its checks.
+
 private:
 	Game() { }
 
+	void RunHeadless(int frames);
+	void RunLoadTest();
+	bool CheckInstancing(unsigned int& expectedInstances, unsigned int& minDraws, unsigned int& maxDraws);
+
+	GameOptions m_options;
+	int m_exitCode = 0;
+
 	Window m_window;
 	Renderer::Renderer m_renderer;
 	AudioEngine::AudioEngine m_audioEngine;
@@ -31,6 +63,7 @@ private:
 	Objects::GameObject m_sceneRoot;
 	Objects::CameraObject m_cameraObject;
 	Objects::ModelObject m_playerObject;
+	std::vector<std::unique_ptr<Objects::ModelObject>> m_crowdObjects;
 
 public:
 	// Singleton Design Pattern
@@ -1,4 +1,10 @@
 #include "GameObject.h"
+#include "Memory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
 
 namespace Objects
 {
@@ -15,25 +21,34 @@ namespace Objects
 	GameObject::GameObject()
 		: m_parent(nullptr)
 		, m_children()
+		, m_skipChildUpdate(false)
+		, m_transform(InvalidTransform)
 	{ }
 	GameObject::~GameObject()
 	{ }
 
 	void GameObject::Create()
 	{
-		m_localTransform = Math::Matrix4F(1.0f);
-		m_globalTransform = Math::Matrix4F(1.0f);
+		m_transform = Transforms.Allocate();
 	}
 	void GameObject::Destroy()
 	{
 		if (m_parent != nullptr)
 			m_parent->RemoveChild(*this);
 		for (auto o : m_children)
+		{
 			o->m_parent = nullptr;
+			Transforms.SetParent(o->m_transform, InvalidTransform);
+		}
+		m_children.clear();
+		Transforms.Free(m_transform);
+		m_transform = InvalidTransform;
 	}
 
 	void GameObject::Update()
 	{
+		if (m_skipChildUpdate)
+			return;
 		for (auto o : m_children)
 			o->Update();
 	}
@@ -43,63 +58,84 @@ namespace Objects
 			o->Draw();
 	}
 
-	void GameObject::UpdateTranform()
+	void GameObject::UpdateParallel()
 	{
-		if (m_parent != nullptr)
-			m_globalTransform = m_parent->GetGlobalTransform() * m_localTransform;
-		else
-			m_globalTransform = m_localTransform;
+		// Partition into independent subtrees, splitting the top of the tree until every worker has work.
+		// Split nodes are updated here first, without their children, so parents still update before children.
+		// Nodes with a single child are kept whole, splitting them adds no work and would walk a chain down on this thread.
+		Memory::FrameVector<GameObject*> subtrees(1, this, FrameMemory.GetAllocator());
+		size_t target = (size_t)JobSystem.GetWorkerCount() * 4;
+		size_t next = 0;
+		while (subtrees.size() < target && next < subtrees.size())
+		{
+			GameObject* o = subtrees[next];
+			if (o->m_children.size() < 2)
+			{
+				next++;
+				continue;
+			}
+			o->m_skipChildUpdate = true;
+			o->Update();
+			o->m_skipChildUpdate = false;
+			subtrees.erase(subtrees.begin() + next);
+			subtrees.insert(subtrees.end(), o->m_children.begin(), o->m_children.end());
+		}
 
-		for (auto o : m_children)
-			o->UpdateTranform();
+		Jobs::Counter counter = 0;
+		for (auto o : subtrees)
+			JobSystem.Run([o]() { o->Update(); }, &counter);
+		JobSystem.Wait(&counter);
+	}
+	void GameObject::UpdateTranform()
+	{
+		// Children inherit the dirty flag during the transform pass.
+		Transforms.MarkDirty(m_transform);
 	}
 
 	void GameObject::SetPosition(float x, float y, float z)
 	{
-		m_localTransform.SetTranslation(x, y, z);
-		UpdateTranform();
+		Transforms.ModifyLocal(m_transform).SetTranslation(x, y, z);
 	}
 	void GameObject::SetScale(float width, float height, float depth)
 	{
-		m_localTransform.SetScaled(width, height, depth);
-		UpdateTranform();
+		Transforms.ModifyLocal(m_transform).SetScaled(width, height, depth);
 	}
 	void GameObject::SetRotate(float radians, float axisX, float axisY, float axisZ)
 	{
-		m_localTransform.SetRotateX(radians * axisX);
-		m_localTransform.SetRotateY(radians * axisY);
-		m_localTransform.SetRotateZ(radians * axisZ);
-		UpdateTranform();
+		Math::Matrix4F& local = Transforms.ModifyLocal(m_transform);
+		local.SetRotateX(radians * axisX);
+		local.SetRotateY(radians * axisY);
+		local.SetRotateZ(radians * axisZ);
 	}
 
 	void GameObject::Translate(float x, float y, float z)
 	{
-		m_localTransform.Translate(x, y, z);
-		UpdateTranform();
+		Transforms.ModifyLocal(m_transform).Translate(x, y, z);
 	}
 	void GameObject::Scale(float width, float height, float depth)
 	{
-		m_localTransform.Scale(width, height, depth);
-		UpdateTranform();
+		Transforms.ModifyLocal(m_transform).Scale(width, height, depth);
 	}
 	void GameObject::Rotate(float radians, float axisX, float axisY, float axisZ)
 	{
-		m_localTransform.RotateX(radians * axisX);
-		m_localTransform.RotateY(radians * axisY);
-		m_localTransform.RotateZ(radians * axisZ);
-		UpdateTranform();
+		Math::Matrix4F& local = Transforms.ModifyLocal(m_transform);
+		local.RotateX(radians * axisX);
+		local.RotateY(radians * axisY);
+		local.RotateZ(radians * axisZ);
 	}
 
 	void GameObject::AddChild(GameObject& child)
 	{
 		child.m_parent = this;
 		m_children.push_back(&child);
+		Transforms.SetParent(child.m_transform, m_transform);
 	}
 	void GameObject::RemoveChild(GameObject& child)
 	{
 		if (RemoveElement(m_children, child))
 		{
 			child.m_parent = nullptr;
+			Transforms.SetParent(child.m_transform, InvalidTransform);
 		}
 	}
 	// Camera Object
@@ -155,7 +191,7 @@ namespace Objects
 	}
 	void CameraObject::Draw()
 	{
-		m_camera.Draw(m_globalTransform);
+		UpdateView();
 		GameObject::Draw();
 	}
 	// Model Object
@@ -169,10 +205,11 @@ namespace Objects
 	{
 		GameObject::Create();
 		m_meshRenderer.Create(renderer);
-		m_meshRenderer.LoadModel(modelPath);
+		m_meshRenderer.LoadModelAsync(modelPath);
 	}
 	void ModelObject::Destroy()
 	{
+		Culling.Unregister(m_transform);
 		GameObject::Destroy();
 		m_meshRenderer.Destroy();
 	}
@@ -183,8 +220,258 @@ namespace Objects
 	}
 	void ModelObject::Draw()
 	{
+		// Culling // Registered once the model's bounds are known, drawn unculled until then.
+		if (!Culling.IsRegistered(m_transform) && m_meshRenderer.IsLoaded())
+			Culling.Register(m_transform, m_meshRenderer.GetBounds());
+		else if (!Culling.IsVisible(m_transform))
+		{
+			m_drawn = false;
+			GameObject::Draw();
+			return;
+		}
+		m_drawn = m_meshRenderer.IsLoaded();
 		Renderer::Camera* c = &m_camera->GetCameraRenderer();
-		m_meshRenderer.Draw(m_globalTransform, *c);
+		Math::Matrix4F model = GetInterpolatedTransform();
+		m_meshRenderer.Draw(model, *c);
 		GameObject::Draw();
 	}
+	// Object Systems
+	ObjectSystems::ObjectSystems()
+	{
+		m_cameras.All<CameraController, LocalTransform, WorldTransform>();
+		m_spin.All<Spin, LocalTransform>();
+		m_roots.All<LocalTransform, WorldTransform>().None<Parent>();
+		m_children.All<LocalTransform, WorldTransform, Parent>();
+		m_models.All<ModelDrawer, WorldTransform>();
+	}
+
+	void ObjectSystems::Register(Entities::SystemScheduler& scheduler)
+	{
+		scheduler.Add("Camera Control", Entities::SystemAccess().Write<CameraController, LocalTransform>().Exclusive(),
+			[this](Entities::World& world) { UpdateCameras(world); });
+		scheduler.Add("Spin", Entities::SystemAccess().Read<Spin>().Write<LocalTransform>(),
+			[this](Entities::World& world) { UpdateSpin(world, GameTime.GetDelta(), true); });
+		scheduler.Add("World Transforms", Entities::SystemAccess().Read<LocalTransform, Parent>().Write<WorldTransform>(),
+			[this](Entities::World& world) { UpdateWorldTransforms(world, true); });
+	}
+
+	void ObjectSystems::UpdateCameras(Entities::World& world)
+	{
+		world.Each<CameraController, LocalTransform>(m_cameras, [](CameraController& controller, LocalTransform& local)
+			{
+				// Looking
+				float yaw = (MouseInput.x - controller.m_lastMouseX) * controller.m_turnSpeed;
+				float pitch = (MouseInput.y - controller.m_lastMouseY) * controller.m_turnSpeed;
+				controller.m_lastMouseX = MouseInput.x; controller.m_lastMouseY = MouseInput.y;
+				// Constrain Camera Pitch
+				if (pitch >= Math::DegreesToRadians(89.0f))
+					pitch = Math::DegreesToRadians(89.0f);
+				if (pitch <= Math::DegreesToRadians(-89.0f))
+					pitch = Math::DegreesToRadians(-89.0f);
+				if (KeyboardInput.IsKeyDown('R'))
+				{
+					// Reset View Rotation
+					yaw = 0.0f; pitch = 0.0f;
+				}
+				// Walking
+				Renderer::Camera& camera = *controller.m_camera;
+				int moveX = KeyboardInput.IsKeyPressed('A') - KeyboardInput.IsKeyPressed('D');
+				int moveY = KeyboardInput.IsKeyPressed(VK_SPACE) - KeyboardInput.IsKeyPressed(VK_CONTROL);
+				int moveZ = KeyboardInput.IsKeyPressed('W') - KeyboardInput.IsKeyPressed('S');
+				Math::Vector3F move = camera.GetRight() * (float)moveX + camera.GetForward() * (float)moveZ;
+				move.y = (float)moveY;
+				// Move
+				local.m_matrix.RotateY(-yaw);
+				local.m_matrix.RotateX(-pitch);
+				local.m_matrix.Translate(-move.Normalise() * controller.m_moveSpeed * GameTime.GetDelta());
+				// Update
+				camera.Update();
+			});
+	}
+	void ObjectSystems::UpdateSpin(Entities::World& world, float delta, bool parallel)
+	{
+		auto rotate = [delta](const Spin& spin, LocalTransform& local)
+			{
+				float radians = spin.m_radiansPerSecond * delta;
+				local.m_matrix.RotateX(radians * spin.m_axis.x);
+				local.m_matrix.RotateY(radians * spin.m_axis.y);
+				local.m_matrix.RotateZ(radians * spin.m_axis.z);
+			};
+		if (parallel)
+			world.EachParallel<const Spin, LocalTransform>(m_spin, rotate);
+		else
+			world.Each<const Spin, LocalTransform>(m_spin, rotate);
+	}
+	void ObjectSystems::UpdateWorldTransforms(Entities::World& world, bool parallel)
+	{
+		auto roots = [](const LocalTransform& local, WorldTransform& global) { global.m_matrix = local.m_matrix; };
+		if (parallel)
+			world.EachParallel<const LocalTransform, WorldTransform>(m_roots, roots);
+		else
+			world.Each<const LocalTransform, WorldTransform>(m_roots, roots);
+
+		// Children // One pass per depth, so parents are always resolved before their children.
+		uint32_t maxDepth = 0;
+		world.Each<const Parent>(m_children, [&maxDepth](const Parent& parent) { maxDepth = (parent.m_depth > maxDepth) ? parent.m_depth : maxDepth; });
+		for (uint32_t depth = 1; depth <= maxDepth; ++depth)
+		{
+			auto children = [&world, depth](const Entities::ChunkView& chunk)
+				{
+					const LocalTransform* local = chunk.Get<const LocalTransform>();
+					const Parent* parent = chunk.Get<const Parent>();
+					WorldTransform* global = chunk.Get<WorldTransform>();
+					// Siblings are usually created together, the parent lookup is reused while it repeats.
+					Entities::Entity last = Entities::InvalidEntity;
+					const WorldTransform* parentGlobal = nullptr;
+					for (uint32_t i = 0; i < chunk.GetCount(); ++i)
+					{
+						if (parent[i].m_depth != depth)
+							continue;
+						if (parent[i].m_entity != last)
+						{
+							last = parent[i].m_entity;
+							parentGlobal = world.GetComponent<WorldTransform>(last);
+						}
+						global[i].m_matrix = parentGlobal ? parentGlobal->m_matrix * local[i].m_matrix : local[i].m_matrix;
+					}
+				};
+			if (parallel)
+				world.ForEachChunkParallel(m_children, children);
+			else
+				world.ForEachChunk(m_children, children);
+		}
+	}
+	void ObjectSystems::Draw(Entities::World& world)
+	{
+		world.Each<CameraController, const WorldTransform>(m_cameras, [](CameraController& controller, const WorldTransform& global)
+			{
+				controller.m_camera->Draw(global.m_matrix);
+			});
+		world.Each<ModelDrawer, const WorldTransform>(m_models, [](ModelDrawer& drawer, const WorldTransform& global)
+			{
+				Math::Matrix4F model = global.m_matrix;
+				drawer.m_meshRenderer->Draw(model, *drawer.m_camera);
+			});
+	}
+
+	// Benchmark
+	class SpinObject : public GameObject
+	{
+	public:
+		void Update() override
+		{
+			Rotate(m_spin.m_radiansPerSecond * m_delta, m_spin.m_axis);
+			GameObject::Update();
+		}
+
+		TransformHandle GetTransformHandle() { return m_transform; }
+
+		Spin m_spin;
+		float m_delta;
+	};
+
+	EntityBenchmarkReport RunEntityBenchmark(int entities, int frames)
+	{
+		EntityBenchmarkReport report;
+		report.m_entities = entities;
+		report.m_frames = frames;
+		if (entities <= 0 || frames <= 0)
+			return report;
+
+		typedef std::chrono::high_resolution_clock Clock;
+		const float delta = 1.0f / WINDOW_FPS;
+		bool parallel = JobSystem.GetWorkerCount() > 1;
+		std::vector<Spin> spins(entities);
+		srand(1);
+		for (Spin& spin : spins)
+		{
+			spin.m_radiansPerSecond = 0.5f + (rand() % 100) * 0.01f;
+			spin.m_axis = Math::Vector3F((float)(rand() % 2), 1.0f, (float)(rand() % 2));
+		}
+
+		// Game Object Tree // Heap allocated children under one root, as the scene creates them.
+		Transforms.Create();
+		GameObject root;
+		root.Create();
+		std::vector<std::unique_ptr<SpinObject>> objects;
+		for (int i = 0; i < entities; ++i)
+		{
+			std::unique_ptr<SpinObject> object = std::make_unique<SpinObject>();
+			object->Create();
+			object->SetPosition((float)(i % 100), 0.0f, (float)(i / 100));
+			object->m_spin = spins[i];
+			object->m_delta = delta;
+			root.AddChild(*object);
+			objects.push_back(std::move(object));
+		}
+		Transforms.Update();
+		auto start = Clock::now();
+		for (int f = 0; f < frames; ++f)
+		{
+			root.Update();
+			Transforms.Update();
+		}
+		report.m_treeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+		if (parallel)
+		{
+			start = Clock::now();
+			for (int f = 0; f < frames; ++f)
+			{
+				root.UpdateParallel();
+				Transforms.Update();
+				FrameMemory.EndFrame();
+			}
+			report.m_treeParallelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+		}
+
+		// Entities // The same hierarchy, every child one depth below the root.
+		Entities::World world;
+		world.Create();
+		ObjectSystems systems;
+		Entities::Entity rootEntity = world.CreateEntity(LocalTransform{ Math::Matrix4F(1.0f) }, WorldTransform{ Math::Matrix4F(1.0f) });
+		std::vector<Entities::Entity> children(entities);
+		for (int i = 0; i < entities; ++i)
+		{
+			LocalTransform local = { Math::Matrix4F(1.0f) };
+			local.m_matrix.SetTranslation((float)(i % 100), 0.0f, (float)(i / 100));
+			children[i] = world.CreateEntity(local, WorldTransform{ Math::Matrix4F(1.0f) }, Parent{ rootEntity, 1 }, spins[i]);
+		}
+		report.m_chunks = world.GetStats().m_chunks;
+		systems.UpdateWorldTransforms(world, false);
+		start = Clock::now();
+		for (int f = 0; f < frames; ++f)
+		{
+			systems.UpdateSpin(world, delta, false);
+			systems.UpdateWorldTransforms(world, false);
+		}
+		report.m_entityMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+		if (parallel)
+		{
+			Entities::SystemScheduler scheduler;
+			scheduler.Add("Spin", Entities::SystemAccess().Read<Spin>().Write<LocalTransform>(),
+				[&systems, delta](Entities::World& target) { systems.UpdateSpin(target, delta, true); });
+			scheduler.Add("World Transforms", Entities::SystemAccess().Read<LocalTransform, Parent>().Write<WorldTransform>(),
+				[&systems](Entities::World& target) { systems.UpdateWorldTransforms(target, true); });
+			start = Clock::now();
+			for (int f = 0; f < frames; ++f)
+				scheduler.Run(world);
+			report.m_entityParallelMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+		}
+
+		// Both took the same steps, the results should agree to rounding.
+		for (int i = 0; i < entities; ++i)
+		{
+			const Math::Matrix4F& a = Transforms.GetGlobal(objects[i]->GetTransformHandle());
+			const Math::Matrix4F& b = world.GetComponent<WorldTransform>(children[i])->m_matrix;
+			for (int e = 0; e < 16; ++e)
+				report.m_maxDifference = std::max(report.m_maxDifference, fabsf(a.m[e / 4][e % 4] - b.m[e / 4][e % 4]));
+		}
+
+		world.Destroy();
+		for (auto& object : objects)
+			object->Destroy();
+		root.Destroy();
+		Transforms.Destroy();
+		return report;
+	}
 }
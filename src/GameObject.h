@@ -9,6 +9,10 @@
 #include "Renderer.h"
 #include "Camera.h"
 #include "Meshes.h"
+#include "Transform.h"
+#include "Jobs.h"
+#include "Culling.h"
+#include "Entities.h"
 
 #include <vector>
 
@@ -26,6 +30,7 @@ namespace Objects
 		virtual void Update();
 		virtual void Draw();
 
+		void UpdateParallel();
 		void UpdateTranform();
 
 		void SetPosition(float x, float y, float z);
@@ -49,34 +54,39 @@ namespace Objects
 		GameObject* GetChild(int index) { return m_children[index]; }
 		int GetChildCount() { return m_children.size(); }
 
-		Math::Matrix4F GetLocalTransform() { return m_localTransform; }
-		Math::Matrix4F GetGlobalTransform() { return m_globalTransform; }
+		// Global transforms are resolved once per frame by TransformSystem::Update.
+		Math::Matrix4F GetLocalTransform() { return Transforms.GetLocal(m_transform); }
+		Math::Matrix4F GetGlobalTransform() { return Transforms.GetGlobal(m_transform); }
+		Math::Matrix4F GetInterpolatedTransform() { return Transforms.GetInterpolated(m_transform, GameTime.GetAlpha()); } // For drawing between fixed steps.
 
 		Math::Vector3F GetTranslation() 
 		{ 
-			return Math::Vector3F(m_globalTransform.m03, m_globalTransform.m13, m_globalTransform.m23); 
+			const Math::Matrix4F& global = Transforms.GetGlobal(m_transform);
+			return Math::Vector3F(global.m03, global.m13, global.m23); 
 		}
 		Math::Vector3F GetScale() 
 		{ 
-			float xAxis = Math::Vector3F(m_globalTransform.m00, m_globalTransform.m01, m_globalTransform.m02).Magnitude();
-			float yAxis = Math::Vector3F(m_globalTransform.m10, m_globalTransform.m11, m_globalTransform.m12).Magnitude();
-			float zAxis = Math::Vector3F(m_globalTransform.m20, m_globalTransform.m21, m_globalTransform.m22).Magnitude();
+			const Math::Matrix4F& global = Transforms.GetGlobal(m_transform);
+			float xAxis = Math::Vector3F(global.m00, global.m01, global.m02).Magnitude();
+			float yAxis = Math::Vector3F(global.m10, global.m11, global.m12).Magnitude();
+			float zAxis = Math::Vector3F(global.m20, global.m21, global.m22).Magnitude();
 			return Math::Vector3F(xAxis, yAxis, zAxis);
 		}
 		Math::Vector3F GetRotation() 
 		{ 
-			float xAxis = atan2f(m_globalTransform.m12, m_globalTransform.m11);
-			float yAxis = atan2f(m_globalTransform.m20, m_globalTransform.m00);
-			float zAxis = atan2f(m_globalTransform.m01, m_globalTransform.m00);
+			const Math::Matrix4F& global = Transforms.GetGlobal(m_transform);
+			float xAxis = atan2f(global.m12, global.m11);
+			float yAxis = atan2f(global.m20, global.m00);
+			float zAxis = atan2f(global.m01, global.m00);
 			return Math::Vector3F(xAxis, yAxis, zAxis); 
 		}
 
 	protected:
 		GameObject* m_parent;
 		std::vector<GameObject*> m_children;
+		bool m_skipChildUpdate;
 
-		Math::Matrix4F m_localTransform;
-		Math::Matrix4F m_globalTransform;
+		TransformHandle m_transform;
 
 	};
 	class CameraObject : public GameObject
@@ -92,6 +102,8 @@ namespace Objects
 		void Draw() override;
 
 		Renderer::Camera& GetCameraRenderer() { return m_camera; }
+		// The view from this frame's interpolated transform, before anything culls or draws against it.
+		void UpdateView() { m_camera.Draw(GetInterpolatedTransform()); }
 
 	public:
 		float turnSpeed = 0.0012f;
@@ -117,10 +129,89 @@ namespace Objects
 		void Draw() override;
 
 		void SetCamera(CameraObject* camera) { m_camera = camera; }
+		Renderer::Meshes::MeshRenderer& GetMeshRenderer() { return m_meshRenderer; }
+		bool WasDrawn() { return m_drawn; } // Last Draw submitted the model, it was loaded and not culled.
 
 	private:
 		Renderer::Meshes::MeshRenderer m_meshRenderer;
 		CameraObject* m_camera;
+		bool m_drawn = false;
 
 	};
+
+	// Entity Behaviours // The objects above as components and systems, for scenes too large to walk as a tree.
+	// Transforms live in the chunks next to the other components instead of the TransformSystem.
+	struct LocalTransform
+	{
+		Math::Matrix4F m_matrix;
+	};
+	struct WorldTransform
+	{
+		Math::Matrix4F m_matrix;
+	};
+	// Depth is one for children of roots, world transforms are resolved one depth at a time.
+	struct Parent
+	{
+		Entities::Entity m_entity;
+		uint32_t m_depth;
+	};
+	// Constant rotation, per axis like GameObject::Rotate.
+	struct Spin
+	{
+		float m_radiansPerSecond;
+		Math::Vector3F m_axis;
+	};
+	// CameraObject::Update, the camera itself stays outside the world.
+	struct CameraController
+	{
+		Renderer::Camera* m_camera;
+		float m_turnSpeed;
+		float m_moveSpeed;
+		float m_lastMouseX;
+		float m_lastMouseY;
+	};
+	// ModelObject::Draw, drawn unculled.
+	struct ModelDrawer
+	{
+		Renderer::Meshes::MeshRenderer* m_meshRenderer;
+		Renderer::Camera* m_camera;
+	};
+
+	// Object Systems // Keeps the queries between frames, one instance per world.
+	class ObjectSystems
+	{
+	public:
+		ObjectSystems();
+
+		// Camera Control, Spin and World Transforms with the fixed step delta, in that order where they overlap.
+		void Register(Entities::SystemScheduler& scheduler);
+
+		void UpdateCameras(Entities::World& world);
+		void UpdateSpin(Entities::World& world, float delta, bool parallel);
+		void UpdateWorldTransforms(Entities::World& world, bool parallel);
+		// Cameras then models, main thread.
+		void Draw(Entities::World& world);
+
+	private:
+		Entities::Query m_cameras;
+		Entities::Query m_spin;
+		Entities::Query m_roots;
+		Entities::Query m_children;
+		Entities::Query m_models;
+
+	};
+
+	// Benchmark // The same spinning children under one root, updated as a GameObject tree and as entities.
+	struct EntityBenchmarkReport
+	{
+		int m_entities = 0;
+		int m_frames = 0;
+		double m_treeMs = 0.0; // Per frame, Update then TransformSystem::Update.
+		double m_treeParallelMs = 0.0; // UpdateParallel.
+		double m_entityMs = 0.0; // Systems on the calling thread.
+		double m_entityParallelMs = 0.0; // Scheduled, chunks split across workers.
+		float m_maxDifference = 0.0f; // Largest world matrix element difference between the two at the end.
+		uint32_t m_chunks = 0;
+	};
+	EntityBenchmarkReport RunEntityBenchmark(int entities, int frames);
 }
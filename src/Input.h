@@ -2,7 +2,7 @@
 
 #include "Common.h"
 
-#include <queue>
+#include "Memory.h"
 
 #define KeyboardInput (Input::Keyboard::Instance())
 #define MouseInput (Input::Mouse::Instance())
@@ -58,8 +58,8 @@ namespace Input
 		void OnChar(const unsigned char key);
 
 		bool m_keyStates[256];
-		std::queue<unsigned char> m_charBuffer;
-		std::queue<KeyboardEvent> m_keyBuffer;
+		Memory::RingBuffer<unsigned char, KEYBOARD_BUFFER_SIZE> m_charBuffer;
+		Memory::RingBuffer<KeyboardEvent, KEYBOARD_BUFFER_SIZE> m_keyBuffer;
 		KeyboardEvent m_keyEvent;
 
 	private:
@@ -0,0 +1,213 @@
+#include "Jobs.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <string>
+
+namespace Jobs
+{
+	// Valid only while t_generation matches the scheduler's.
+	static thread_local int t_workerIndex = -1;
+	static thread_local int t_queueIndex = -1;
+	static thread_local uint32_t t_generation = 0;
+
+	void Scheduler::Create(int workerCount)
+	{
+		if (workerCount <= 0)
+			workerCount = (int)std::thread::hardware_concurrency();
+		if (workerCount <= 0)
+			workerCount = 1;
+
+		m_workerCount = workerCount;
+		for (int i = 0; i < workerCount + JOB_EXTERNAL_QUEUES; ++i)
+			m_queues.push_back(std::make_unique<WorkQueue>());
+		m_externalQueues = 0;
+
+		// Worker 0 is the calling thread.
+		t_generation = ++m_generation;
+		t_workerIndex = 0;
+		t_queueIndex = 0;
+		m_running = true;
+		for (int i = 1; i < workerCount; ++i)
+			m_threads.emplace_back(&Scheduler::WorkerMain, this, i);
+	}
+	void Scheduler::Destroy()
+	{
+		if (!m_running)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(m_sleepLock);
+			m_running = false;
+		}
+		m_wake.notify_all();
+		for (auto& t : m_threads)
+			t.join();
+		m_threads.clear();
+		m_queues.clear();
+		m_workerCount = 0;
+		m_generation++;
+		m_continuations.clear();
+		m_waitingJobs = 0;
+	}
+
+	void Scheduler::Run(std::function<void()> function, Counter* counter)
+	{
+		if (counter)
+			counter->fetch_add(1);
+		Push({ std::move(function), counter });
+	}
+	void Scheduler::Run(std::function<void()> function, Counter* counter, Counter* dependency)
+	{
+		if (dependency == nullptr)
+			return Run(std::move(function), counter);
+
+		// Counted as waiting before the dependency is read, so a job completing it meanwhile is sure to look for continuations.
+		if (counter)
+			counter->fetch_add(1);
+		m_waitingJobs.fetch_add(1);
+		{
+			std::lock_guard<std::mutex> lock(m_continuationLock);
+			if (dependency->load() > 0)
+			{
+				m_continuations[dependency].push_back({ std::move(function), counter });
+				return;
+			}
+		}
+		m_waitingJobs.fetch_sub(1);
+		Push({ std::move(function), counter });
+	}
+	void Scheduler::Dispatch(int count, int groupSize, std::function<void(int, int)> function, Counter* counter)
+	{
+		if (groupSize <= 0)
+			groupSize = 1;
+		for (int start = 0; start < count; start += groupSize)
+		{
+			int end = (start + groupSize < count) ? start + groupSize : count;
+			Run([function, start, end]() { function(start, end); }, counter);
+		}
+	}
+
+	void Scheduler::Wait(Counter* counter)
+	{
+		// Participate instead of blocking.
+		int queue = m_queues.empty() ? 0 : GetQueueIndex();
+		while (counter->load() > 0)
+		{
+			if (m_queues.empty() || !Execute(queue))
+				std::this_thread::yield();
+		}
+	}
+
+	int Scheduler::GetWorkerIndex()
+	{
+		return t_generation == Instance().m_generation.load() ? t_workerIndex : -1;
+	}
+	int Scheduler::GetQueueIndex()
+	{
+		uint32_t generation = m_generation.load();
+		if (t_generation != generation)
+		{
+			// First push or wait from a thread outside the scheduler.
+			int external = m_externalQueues.fetch_add(1);
+			t_workerIndex = -1;
+			t_queueIndex = m_workerCount + std::min(external, JOB_EXTERNAL_QUEUES - 1);
+			t_generation = generation;
+		}
+		return t_queueIndex;
+	}
+
+	void Scheduler::Push(Job job)
+	{
+		if (m_queues.empty())
+		{
+			// Not created, run inline.
+			job.m_function();
+			Complete(job.m_counter);
+			return;
+		}
+		WorkQueue& queue = *m_queues[GetQueueIndex()];
+		{
+			std::lock_guard<std::mutex> lock(queue.m_lock);
+			queue.m_jobs.push_back(std::move(job));
+		}
+		m_pending.fetch_add(1);
+		{
+			// Serialise with sleeping workers so the wake-up is not lost.
+			std::lock_guard<std::mutex> lock(m_sleepLock);
+		}
+		m_wake.notify_one();
+	}
+	bool Scheduler::Pop(int queueIndex, Job& job)
+	{
+		WorkQueue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.m_lock);
+		if (queue.m_jobs.empty())
+			return false;
+		job = std::move(queue.m_jobs.back());
+		queue.m_jobs.pop_back();
+		return true;
+	}
+	bool Scheduler::Steal(int queueIndex, Job& job)
+	{
+		// Workers and the external queues claimed so far.
+		int count = m_workerCount + std::min(m_externalQueues.load(), JOB_EXTERNAL_QUEUES);
+		for (int i = 1; i < count; ++i)
+		{
+			WorkQueue& queue = *m_queues[(queueIndex + i) % count];
+			std::unique_lock<std::mutex> lock(queue.m_lock, std::try_to_lock);
+			if (!lock.owns_lock() || queue.m_jobs.empty())
+				continue;
+			job = std::move(queue.m_jobs.front());
+			queue.m_jobs.pop_front();
+			return true;
+		}
+		return false;
+	}
+	bool Scheduler::Execute(int queueIndex)
+	{
+		Job job;
+		if (!Pop(queueIndex, job) && !Steal(queueIndex, job))
+			return false;
+		m_pending.fetch_sub(1);
+		{
+			PROFILE_SCOPE("Job");
+			job.m_function();
+		}
+		Complete(job.m_counter);
+		return true;
+	}
+	void Scheduler::Complete(Counter* counter)
+	{
+		if (!counter || counter->fetch_sub(1) != 1 || m_waitingJobs.load() == 0)
+			return;
+
+		// Reached zero with continuations waiting somewhere, release those on this counter.
+		std::vector<Job> ready;
+		{
+			std::lock_guard<std::mutex> lock(m_continuationLock);
+			auto it = m_continuations.find(counter);
+			if (it == m_continuations.end() || counter->load() > 0)
+				return;
+			ready.swap(it->second);
+			m_continuations.erase(it);
+			m_waitingJobs.fetch_sub((int)ready.size());
+		}
+		for (Job& job : ready)
+			Push(std::move(job));
+	}
+
+	void Scheduler::WorkerMain(int worker)
+	{
+		t_generation = m_generation.load();
+		t_workerIndex = worker;
+		t_queueIndex = worker;
+		Profiler.SetThreadName(("Job Worker " + std::to_string(worker)).c_str());
+		while (m_running)
+		{
+			if (Execute(worker))
+				continue;
+			std::unique_lock<std::mutex> lock(m_sleepLock);
+			m_wake.wait(lock, [this]() { return !m_running || m_pending.load() > 0; });
+		}
+	}
+}
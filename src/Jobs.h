@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define JobSystem (Jobs::Scheduler::Instance())
+
+namespace Jobs
+{
+	// Counts outstanding jobs, Wait() returns once it reaches zero.
+	typedef std::atomic<int> Counter;
+
+	struct Job
+	{
+		std::function<void()> m_function;
+		Counter* m_counter;
+	};
+
+	// Work-stealing scheduler // Each worker owns a deque, pops from the back and steals from the front of others.
+	// The calling thread is worker 0 and runs jobs while it waits. Other threads claim a queue of their own on their first push.
+	class Scheduler
+	{
+	public:
+		void Create(int workerCount = JOB_WORKER_COUNT);
+		void Destroy();
+
+		void Run(std::function<void()> function, Counter* counter = nullptr);
+		// Continuation // Held aside until the dependency reaches zero, then pushed by the job that brought it there.
+		// The dependency must stay alive until this job has been released.
+		void Run(std::function<void()> function, Counter* counter, Counter* dependency);
+		void Dispatch(int count, int groupSize, std::function<void(int, int)> function, Counter* counter);
+
+		void Wait(Counter* counter);
+
+		int GetWorkerCount() { return m_workerCount; }
+		static int GetWorkerIndex(); // -1 on threads outside the scheduler.
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex m_lock;
+			std::deque<Job> m_jobs;
+		};
+
+		int GetQueueIndex();
+		void Push(Job job);
+		bool Pop(int queue, Job& job);
+		bool Steal(int queue, Job& job);
+		bool Execute(int queue);
+		void Complete(Counter* counter);
+
+		void WorkerMain(int worker);
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_queues; // Workers first, then JOB_EXTERNAL_QUEUES.
+		std::vector<std::thread> m_threads;
+		int m_workerCount = 0;
+		std::atomic<int> m_externalQueues = 0; // Claimed so far.
+		std::atomic<uint32_t> m_generation = 0; // Bumped by Create and Destroy, so queue indices cached by threads from an earlier run are dropped.
+
+		std::mutex m_continuationLock;
+		std::unordered_map<Counter*, std::vector<Job>> m_continuations; // Keyed by dependency.
+		std::atomic<int> m_waitingJobs = 0;
+
+		std::mutex m_sleepLock;
+		std::condition_variable m_wake;
+		std::atomic<int> m_pending = 0;
+		std::atomic<bool> m_running = false;
+
+	private:
+		Scheduler() { }
+
+	public:
+		// Singleton Design Pattern
+		static Scheduler& Instance()
+		{
+			static Scheduler instance;
+			return instance;
+		}
+
+		Scheduler(Scheduler const&) = delete;
+		void operator=(Scheduler const&) = delete;
+
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common.h"
+#include <Windows.h>
+
+// Read-only memory-mapped file.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* filePath);
+	void Close();
+
+	const void* GetData() { return m_data; }
+	size_t GetSize() { return m_size; }
+	bool IsOpen() { return m_data != nullptr; }
+
+	MappedFile(MappedFile const&) = delete;
+	void operator=(MappedFile const&) = delete;
+
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const void* m_data;
+	size_t m_size;
+
+};
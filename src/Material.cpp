@@ -0,0 +1,109 @@
+#include "Material.h"
+
+#include <string.h>
+
+namespace Renderer
+{
+	// Hashed and compared as bytes, padding would make equal descriptions differ.
+	static_assert(sizeof(MaterialDesc) == sizeof(uint32_t) * (1 + 3 * MATERIAL_TEXTURE_COUNT + 10), "MaterialDesc must stay free of padding.");
+	static_assert(sizeof(MaterialConstants) % 16 == 0, "Structured buffer elements stay 16 byte aligned.");
+
+	MaterialLibrary::MaterialLibrary()
+	{
+		// Default Material // Never released, draws without a material of their own use it.
+		m_materials.emplace_back();
+		m_materials[0].m_hash = Hash(m_materials[0].m_desc);
+		m_materials[0].m_refCount = 1;
+		m_lookup.insert({ m_materials[0].m_hash, 0 });
+	}
+
+	uint64_t MaterialLibrary::Hash(const MaterialDesc& desc)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		const uint8_t* bytes = (const uint8_t*)&desc;
+		for (size_t i = 0; i < sizeof(MaterialDesc); ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	uint32_t MaterialLibrary::Acquire(const MaterialDesc& desc)
+	{
+		m_stats.m_acquires++;
+		uint64_t hash = Hash(desc);
+		auto range = m_lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			Entry& e = m_materials[it->second];
+			if (memcmp(&e.m_desc, &desc, sizeof(MaterialDesc)) != 0)
+				continue;
+			e.m_refCount++;
+			m_stats.m_shared++;
+			return it->second;
+		}
+		uint32_t material;
+		if (!m_freeMaterials.empty())
+		{
+			material = m_freeMaterials.back();
+			m_freeMaterials.pop_back();
+		}
+		else
+		{
+			material = (uint32_t)m_materials.size();
+			m_materials.emplace_back();
+		}
+		Entry& e = m_materials[material];
+		e.m_desc = desc;
+		e.m_hash = hash;
+		e.m_refCount = 1;
+		m_lookup.insert({ hash, material });
+		m_dirty = true;
+		return material;
+	}
+	void MaterialLibrary::Release(uint32_t material)
+	{
+		// The default material and anything released after Destroy are left alone.
+		if (material == 0 || material >= m_materials.size() || m_materials[material].m_refCount <= 0)
+			return;
+		Entry& e = m_materials[material];
+		if (--e.m_refCount > 0)
+			return;
+		auto range = m_lookup.equal_range(e.m_hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second == material)
+			{
+				m_lookup.erase(it);
+				break;
+			}
+		}
+		e = Entry();
+		m_freeMaterials.push_back(material);
+		m_dirty = true;
+	}
+
+	MaterialConstants MaterialLibrary::Pack(const MaterialDesc& desc)
+	{
+		MaterialConstants constants;
+		memcpy(constants.m_baseColor, desc.m_baseColor, sizeof(constants.m_baseColor));
+		memcpy(constants.m_uvTransform, desc.m_uvTransform, sizeof(constants.m_uvTransform));
+		constants.m_diffuseLayer = desc.m_layers[MATERIAL_TEXTURE_DIFFUSE];
+		constants.m_flags = desc.m_textures[MATERIAL_TEXTURE_DIFFUSE].IsValid() ? MATERIAL_FLAG_DIFFUSE : 0;
+		constants.m_roughness = desc.m_roughness;
+		constants.m_metallic = desc.m_metallic;
+		return constants;
+	}
+	void MaterialLibrary::PackAll(std::vector<MaterialConstants>& constants)
+	{
+		constants.resize(m_materials.size());
+		for (size_t i = 0; i < m_materials.size(); ++i)
+			constants[i] = Pack(m_materials[i].m_desc);
+	}
+
+	const MaterialLibraryStats& MaterialLibrary::GetStats()
+	{
+		m_stats.m_materials = (unsigned int)(m_materials.size() - m_freeMaterials.size());
+		m_stats.m_capacity = m_capacity;
+		return m_stats;
+	}
+}
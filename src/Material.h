@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Common.h"
+#include "RHI.h"
+
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#define Materials (::Renderer::MaterialLibrary::Instance()) // Qualified, it is used inside namespace Renderer where Renderer names the class.
+
+namespace Renderer
+{
+	class Renderer;
+
+	enum MaterialTexture
+	{
+		MATERIAL_TEXTURE_DIFFUSE,
+		MATERIAL_TEXTURE_COUNT,
+	};
+	enum MaterialFlags
+	{
+		MATERIAL_FLAG_DIFFUSE = 1 << 0, // Diffuse texture bound, its layer is sampled.
+	};
+
+	// Material Description // Plain data, compared and hashed as bytes, so equal descriptions share one material.
+	struct MaterialDesc
+	{
+		uint32_t m_shader = 0; // Shader permutation id, Shader::m_id.
+		RHI::TextureHandle m_textures[MATERIAL_TEXTURE_COUNT];
+		uint32_t m_layers[MATERIAL_TEXTURE_COUNT] = { }; // Slice of each texture, every texture is read as an array.
+		float m_baseColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float m_uvTransform[4] = { 1.0f, 1.0f, 0.0f, 0.0f }; // Scale xy, offset zw, applied before sampling.
+		float m_roughness = 1.0f;
+		float m_metallic = 0.0f;
+	};
+	// GPU layout of one material, an element of the material buffer. Matches Material in the model shader.
+	struct MaterialConstants
+	{
+		float m_baseColor[4];
+		float m_uvTransform[4];
+		uint32_t m_diffuseLayer;
+		uint32_t m_flags; // MaterialFlags.
+		float m_roughness;
+		float m_metallic;
+	};
+
+	struct MaterialLibraryStats
+	{
+		unsigned int m_materials = 0; // Live, the default material included.
+		unsigned int m_acquires = 0;
+		unsigned int m_shared = 0; // Acquires answered with an existing material.
+		unsigned int m_capacity = 0; // Materials the GPU buffers hold.
+		unsigned int m_uploads = 0; // Times the material buffer was rewritten.
+		size_t m_uploadBytes = 0;
+	};
+
+	// Material Library // Materials are deduplicated and reference counted, their id indexes one structured buffer holding every
+	// material's constants. Draws bind a material by offset into a small table of ids, so changing material never rebinds a texture
+	// when the textures share an array. Id 0 is the default material, white and untextured. Main thread only.
+	// The GPU buffers live in MaterialBuffers.cpp, the rest needs no device.
+	class MaterialLibrary
+	{
+	public:
+		void Create(Renderer& renderer);
+		void Destroy();
+
+		uint32_t Acquire(const MaterialDesc& desc);
+		void Release(uint32_t material);
+		const MaterialDesc& GetDesc(uint32_t material) { return m_materials[material].m_desc; }
+
+		// Packing // Every material in id order, released slots as the default material.
+		static MaterialConstants Pack(const MaterialDesc& desc);
+		void PackAll(std::vector<MaterialConstants>& constants);
+		static uint64_t Hash(const MaterialDesc& desc);
+
+		// Rewrites the material buffer when a material changed since the last call, growing both buffers first if needed.
+		void Update();
+		RHI::BufferHandle GetBuffer() { return m_buffer; } // StructuredBuffer<Material>, bound to t1.
+		RHI::BufferHandle GetIdTable() { return m_idTable; } // One ConstantAlignment block per material, bound to b1.
+
+		const MaterialLibraryStats& GetStats();
+
+	private:
+		struct Entry
+		{
+			MaterialDesc m_desc;
+			uint64_t m_hash = 0;
+			int m_refCount = 0;
+		};
+
+		void Grow(uint32_t capacity);
+
+	private:
+		Renderer* m_renderer = nullptr;
+
+		std::vector<Entry> m_materials; // Indexed by id.
+		std::vector<uint32_t> m_freeMaterials;
+		std::unordered_multimap<uint64_t, uint32_t> m_lookup;
+		bool m_dirty = true;
+
+		RHI::BufferHandle m_buffer;
+		RHI::BufferHandle m_idTable;
+		uint32_t m_capacity = 0;
+		MaterialLibraryStats m_stats;
+
+	private:
+		MaterialLibrary();
+
+	public:
+		// Singleton Design Pattern
+		static MaterialLibrary& Instance()
+		{
+			static MaterialLibrary instance;
+			return instance;
+		}
+
+		MaterialLibrary(MaterialLibrary const&) = delete;
+		void operator=(MaterialLibrary const&) = delete;
+
+	};
+}
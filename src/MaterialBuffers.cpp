@@ -0,0 +1,80 @@
+#include "Material.h"
+#include "Renderer.h"
+
+#include <vector>
+
+namespace Renderer
+{
+	void MaterialLibrary::Create(Renderer& renderer)
+	{
+		m_renderer = &renderer;
+		m_dirty = true;
+	}
+	void MaterialLibrary::Destroy()
+	{
+		if (m_renderer && m_renderer->GetRHI())
+		{
+			m_renderer->GetRHI()->Destroy(m_buffer);
+			m_renderer->GetRHI()->Destroy(m_idTable);
+		}
+		m_buffer = RHI::BufferHandle();
+		m_idTable = RHI::BufferHandle();
+		m_capacity = 0;
+		m_materials.resize(1);
+		m_freeMaterials.clear();
+		m_lookup.clear();
+		m_lookup.insert({ m_materials[0].m_hash, 0 });
+		m_stats = MaterialLibraryStats();
+		m_dirty = true;
+		m_renderer = nullptr;
+	}
+
+	void MaterialLibrary::Grow(uint32_t capacity)
+	{
+		RHI::Device* device = m_renderer->GetRHI();
+		device->Destroy(m_buffer);
+		device->Destroy(m_idTable);
+		m_capacity = capacity;
+
+		RHI::BufferDesc bufferDesc;
+		bufferDesc.m_size = capacity * sizeof(MaterialConstants);
+		bufferDesc.m_usage = RHI::BUFFER_SHADER_RESOURCE;
+		bufferDesc.m_stride = sizeof(MaterialConstants);
+		bufferDesc.m_dynamic = true;
+		bufferDesc.m_name = "Materials";
+		m_buffer = device->CreateBuffer(bufferDesc);
+
+		// Id Table // Block i holds i, binding a material is an offset change like the constant ring.
+		std::vector<uint32_t> ids((size_t)capacity * RHI::ConstantAlignment / sizeof(uint32_t), 0);
+		for (uint32_t i = 0; i < capacity; ++i)
+			ids[(size_t)i * RHI::ConstantAlignment / sizeof(uint32_t)] = i;
+		RHI::BufferDesc tableDesc;
+		tableDesc.m_size = capacity * RHI::ConstantAlignment;
+		tableDesc.m_usage = RHI::BUFFER_CONSTANT;
+		tableDesc.m_name = "Material Ids";
+		m_idTable = device->CreateBuffer(tableDesc, ids.data());
+		m_dirty = true;
+	}
+	void MaterialLibrary::Update()
+	{
+		if (!m_renderer || !m_renderer->GetRHI())
+			return;
+		uint32_t capacity = m_capacity ? m_capacity : MATERIAL_BUFFER_CAPACITY;
+		while (capacity < m_materials.size())
+			capacity *= 2;
+		if (capacity != m_capacity)
+			Grow(capacity);
+		if (!m_dirty)
+			return;
+		// Discarded whole, frames still in flight keep reading the old contents.
+		MaterialConstants* mapped = (MaterialConstants*)m_renderer->GetRHI()->Map(m_buffer, RHI::MAP_WRITE_DISCARD);
+		if (!mapped)
+			return;
+		for (size_t i = 0; i < m_materials.size(); ++i)
+			mapped[i] = Pack(m_materials[i].m_desc);
+		m_renderer->GetRHI()->Unmap(m_buffer);
+		m_dirty = false;
+		m_stats.m_uploads++;
+		m_stats.m_uploadBytes += m_materials.size() * sizeof(MaterialConstants);
+	}
+}
@@ -2,9 +2,39 @@
 
 #define _USE_MATH_DEFINES 
 #include <math.h>
+#include <float.h>
+#include <stddef.h>
+
+// SIMD Backend // Selected at compile time, define MATH_FORCE_SCALAR to always use the scalar reference path.
+#if !defined(MATH_FORCE_SCALAR)
+	#if defined(__AVX__)
+		#define MATH_SIMD_AVX
+	#endif
+	#if defined(MATH_SIMD_AVX) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define MATH_SIMD_SSE
+	#endif
+#endif
+
+#if defined(MATH_SIMD_AVX)
+	#include <immintrin.h>
+#elif defined(MATH_SIMD_SSE)
+	#include <emmintrin.h>
+#endif
 
 namespace Math
 {
+	struct Vector3F;
+	struct Vector4F;
+	struct Matrix4F;
+
+	// Matrix Operations // Dispatch to the SIMD backend when available, otherwise the scalar reference path.
+	inline Matrix4F Multiply(const Matrix4F& a, const Matrix4F& b);
+	inline Vector4F Transform(const Matrix4F& a, const Vector4F& b);
+	inline Matrix4F Transpose(const Matrix4F& a);
+	inline Matrix4F Inverse(const Matrix4F& a);
+	inline void TransformArray(const Matrix4F& a, const Vector3F* in, Vector3F* out, size_t count);
+	inline void TransformArray(const Matrix4F& a, const Vector4F* in, Vector4F* out, size_t count);
+
 	inline float DegreesToRadians(float d)
 	{
 		return d * ((float)M_PI / 180.0f);
@@ -134,7 +164,7 @@ namespace Math
 	};
 
 	// Matrices
-	struct Matrix4F
+	struct alignas(16) Matrix4F
 	{
 		// Anonymous Struct // Allows interchangable usage of array or individual variables (Shares Memory).
 		union {
@@ -321,8 +351,90 @@ namespace Math
 			);
 		}
 
+		Matrix4F Transpose() const { return Math::Transpose(*this); }
+		Matrix4F Inverse() const { return Math::Inverse(*this); }
+
+		// Operator Overloads
+		friend Matrix4F operator*(const Matrix4F& a, const Matrix4F& b) { return Multiply(a, b); }
+		friend Vector4F operator*(const Matrix4F& a, const Vector4F& b) { return Transform(a, b); }
+
+	};
+
+	// Bounds
+	struct BoundingBox
+	{
+		Vector3F minimum;
+		Vector3F maximum;
+
+		// Constructors
+		BoundingBox() // Empty, extending it with any point makes it valid.
+			: minimum(FLT_MAX, FLT_MAX, FLT_MAX), maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+		{ }
+		BoundingBox(Vector3F minimum, Vector3F maximum)
+			: minimum(minimum), maximum(maximum)
+		{ }
+
+		// Methods
+		bool IsEmpty() const { return minimum.x > maximum.x || minimum.y > maximum.y || minimum.z > maximum.z; }
+		Vector3F GetCenter() const { return (minimum + maximum) * 0.5f; }
+		Vector3F GetExtents() const { return (maximum - minimum) * 0.5f; }
+		float GetSurfaceArea() const
+		{
+			if (IsEmpty())
+				return 0.0f;
+			Vector3F d = maximum - minimum;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+		bool Contains(const BoundingBox& b) const
+		{
+			return b.minimum.x >= minimum.x && b.minimum.y >= minimum.y && b.minimum.z >= minimum.z
+				&& b.maximum.x <= maximum.x && b.maximum.y <= maximum.y && b.maximum.z <= maximum.z;
+		}
+		// Compares rather than fminf/fmaxf, which are library calls without fast math. A NaN argument is still ignored.
+		void Extend(const Vector3F& p)
+		{
+			minimum = Vector3F(p.x < minimum.x ? p.x : minimum.x, p.y < minimum.y ? p.y : minimum.y, p.z < minimum.z ? p.z : minimum.z);
+			maximum = Vector3F(p.x > maximum.x ? p.x : maximum.x, p.y > maximum.y ? p.y : maximum.y, p.z > maximum.z ? p.z : maximum.z);
+		}
+		void Extend(const BoundingBox& b)
+		{
+			minimum = Vector3F(b.minimum.x < minimum.x ? b.minimum.x : minimum.x, b.minimum.y < minimum.y ? b.minimum.y : minimum.y, b.minimum.z < minimum.z ? b.minimum.z : minimum.z);
+			maximum = Vector3F(b.maximum.x > maximum.x ? b.maximum.x : maximum.x, b.maximum.y > maximum.y ? b.maximum.y : maximum.y, b.maximum.z > maximum.z ? b.maximum.z : maximum.z);
+		}
+		// Encloses the box after transforming it, points are multiplied the way the shaders do, row i of a giving component i.
+		BoundingBox Transform(const Matrix4F& a) const
+		{
+			if (IsEmpty())
+				return *this;
+			Vector3F c = GetCenter(), e = GetExtents();
+			Vector3F center, extents;
+			for (int i = 0; i < 3; ++i)
+			{
+				center.v[i] = a.m[i][0] * c.x + a.m[i][1] * c.y + a.m[i][2] * c.z + a.m[i][3];
+				extents.v[i] = fabsf(a.m[i][0]) * e.x + fabsf(a.m[i][1]) * e.y + fabsf(a.m[i][2]) * e.z;
+			}
+			return BoundingBox(center - extents, center + extents);
+		}
+
 		// Operator Overloads
-		friend Matrix4F operator*(const Matrix4F& a, const Matrix4F& b)
+		friend bool operator==(const BoundingBox& a, const BoundingBox& b)
+		{
+			return a.minimum.x == b.minimum.x && a.minimum.y == b.minimum.y && a.minimum.z == b.minimum.z
+				&& a.maximum.x == b.maximum.x && a.maximum.y == b.maximum.y && a.maximum.z == b.maximum.z;
+		}
+		friend bool operator!=(const BoundingBox& a, const BoundingBox& b) { return !(a == b); }
+
+	};
+	struct BoundingSphere
+	{
+		Vector3F center;
+		float radius = 0.0f;
+	};
+
+	// Scalar Reference Path // Kept as the ground truth for the SIMD backend.
+	namespace Scalar
+	{
+		inline Matrix4F Multiply(const Matrix4F& a, const Matrix4F& b)
 		{
 			return Matrix4F(
 				// First Row
@@ -347,13 +459,233 @@ namespace Math
 				a.m03*b.m30 + a.m13*b.m31 + a.m23*b.m32 + a.m33*b.m33  // m33
 			);
 		}
-		friend Vector4F operator*(const Matrix4F& a, const Vector4F& b)
+		inline Vector4F Transform(const Matrix4F& a, const Vector4F& b)
 		{
 			return Vector4F(b.x*a.m00 + b.y*a.m10 + b.z*a.m20 + b.w*a.m30,
 							b.x*a.m01 + b.y*a.m11 + b.z*a.m21 + b.w*a.m31,
 							b.x*a.m02 + b.y*a.m12 + b.z*a.m22 + b.w*a.m32,
 							b.x*a.m03 + b.y*a.m13 + b.z*a.m23 + b.w*a.m33);
 		}
+		inline Matrix4F Transpose(const Matrix4F& a)
+		{
+			return Matrix4F(
+				a.m00, a.m10, a.m20, a.m30,
+				a.m01, a.m11, a.m21, a.m31,
+				a.m02, a.m12, a.m22, a.m32,
+				a.m03, a.m13, a.m23, a.m33
+			);
+		}
+		inline Matrix4F Inverse(const Matrix4F& a)
+		{
+			// Cofactor expansion, returns identity for singular matrices.
+			const float* m = &a.m[0][0];
+			Matrix4F r;
+			float* inv = &r.m[0][0];
+			inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+			inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+			inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+			inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+			inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+			inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+			inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+			inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+			inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+			inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+			inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+			inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+			inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+			inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+			inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+			inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+			float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+			if (det == 0.0f)
+				return Matrix4F(1.0f);
+			float invDet = 1.0f / det;
+			for (int i = 0; i < 16; ++i)
+				inv[i] *= invDet;
+			return r;
+		}
+		inline void TransformArray(const Matrix4F& a, const Vector3F* in, Vector3F* out, size_t count)
+		{
+			// Points // w is implicitly 1.
+			for (size_t i = 0; i < count; ++i)
+			{
+				Vector3F p = in[i];
+				out[i] = Vector3F(p.x*a.m00 + p.y*a.m10 + p.z*a.m20 + a.m30,
+								  p.x*a.m01 + p.y*a.m11 + p.z*a.m21 + a.m31,
+								  p.x*a.m02 + p.y*a.m12 + p.z*a.m22 + a.m32);
+			}
+		}
+		inline void TransformArray(const Matrix4F& a, const Vector4F* in, Vector4F* out, size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+				out[i] = Scalar::Transform(a, in[i]);
+		}
+	}
 
-	};
+#if defined(MATH_SIMD_SSE)
+	// SSE/AVX Path // Rows of the matrix map directly onto __m128 registers.
+	namespace SIMD
+	{
+		inline __m128 LoadRow(const Matrix4F& a, int row) { return _mm_loadu_ps(a.m[row]); }
+		inline __m128 Splat(__m128 v, int i)
+		{
+			switch (i)
+			{
+			case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+			case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+			case 2: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+			default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+		}
+		// Linear combination of the rows of a, weighted by the components of v.
+		inline __m128 Combine(__m128 v, __m128 r0, __m128 r1, __m128 r2, __m128 r3)
+		{
+			__m128 x = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+			__m128 y = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), r1);
+			__m128 z = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), r2);
+			__m128 w = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), r3);
+			return _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w));
+		}
+
+		inline Matrix4F Multiply(const Matrix4F& a, const Matrix4F& b)
+		{
+			Matrix4F r;
+#if defined(MATH_SIMD_AVX)
+			// Two result rows per iteration, each 128-bit lane holds one row.
+			__m256 a0 = _mm256_broadcast_ps((const __m128*)a.m[0]);
+			__m256 a1 = _mm256_broadcast_ps((const __m128*)a.m[1]);
+			__m256 a2 = _mm256_broadcast_ps((const __m128*)a.m[2]);
+			__m256 a3 = _mm256_broadcast_ps((const __m128*)a.m[3]);
+			for (int i = 0; i < 4; i += 2)
+			{
+				__m256 rows = _mm256_loadu_ps(b.m[i]);
+				__m256 x = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+				__m256 y = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), a1);
+				__m256 z = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), a2);
+				__m256 w = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), a3);
+				_mm256_storeu_ps(r.m[i], _mm256_add_ps(_mm256_add_ps(x, y), _mm256_add_ps(z, w)));
+			}
+#else
+			__m128 a0 = LoadRow(a, 0), a1 = LoadRow(a, 1), a2 = LoadRow(a, 2), a3 = LoadRow(a, 3);
+			for (int i = 0; i < 4; ++i)
+				_mm_storeu_ps(r.m[i], Combine(LoadRow(b, i), a0, a1, a2, a3));
+#endif
+			return r;
+		}
+		inline Vector4F Transform(const Matrix4F& a, const Vector4F& b)
+		{
+			Vector4F r;
+			_mm_storeu_ps(r.v, Combine(_mm_loadu_ps(b.v), LoadRow(a, 0), LoadRow(a, 1), LoadRow(a, 2), LoadRow(a, 3)));
+			return r;
+		}
+		inline Matrix4F Transpose(const Matrix4F& a)
+		{
+			__m128 r0 = LoadRow(a, 0), r1 = LoadRow(a, 1), r2 = LoadRow(a, 2), r3 = LoadRow(a, 3);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			Matrix4F r;
+			_mm_storeu_ps(r.m[0], r0);
+			_mm_storeu_ps(r.m[1], r1);
+			_mm_storeu_ps(r.m[2], r2);
+			_mm_storeu_ps(r.m[3], r3);
+			return r;
+		}
+
+		// 2x2 Sub-Matrix Helpers // A __m128 holds a row major 2x2 matrix as (A0, A1, A2, A3).
+		inline __m128 Mat2Mul(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+							  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		}
+		inline __m128 Mat2AdjMul(__m128 a, __m128 b) // adj(A) * B
+		{
+			return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+							  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+		inline __m128 Mat2MulAdj(__m128 a, __m128 b) // A * adj(B)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+							  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		}
+		inline Matrix4F Inverse(const Matrix4F& a)
+		{
+			// Block matrix inverse, returns identity for singular matrices.
+			__m128 r0 = LoadRow(a, 0), r1 = LoadRow(a, 1), r2 = LoadRow(a, 2), r3 = LoadRow(a, 3);
+			__m128 A = _mm_movelh_ps(r0, r1);
+			__m128 B = _mm_movehl_ps(r1, r0);
+			__m128 C = _mm_movelh_ps(r2, r3);
+			__m128 D = _mm_movehl_ps(r3, r2);
+
+			// Sub-matrix determinants as (|A|, |B|, |C|, |D|)
+			__m128 detSub = _mm_sub_ps(
+				_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+				_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0)))
+			);
+			__m128 detA = Splat(detSub, 0);
+			__m128 detB = Splat(detSub, 1);
+			__m128 detC = Splat(detSub, 2);
+			__m128 detD = Splat(detSub, 3);
+
+			__m128 D_C = Mat2AdjMul(D, C);
+			__m128 A_B = Mat2AdjMul(A, B);
+			__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+			__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+			__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+			__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+			// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+			__m128 tr = _mm_mul_ps(A_B, _mm_shuffle_ps(D_C, D_C, _MM_SHUFFLE(3, 1, 2, 0)));
+			tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+			tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 1, 1, 1)));
+			tr = Splat(tr, 0);
+			__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+			if (_mm_cvtss_f32(detM) == 0.0f)
+				return Matrix4F(1.0f);
+
+			__m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+			X_ = _mm_mul_ps(X_, rDetM);
+			Y_ = _mm_mul_ps(Y_, rDetM);
+			Z_ = _mm_mul_ps(Z_, rDetM);
+			W_ = _mm_mul_ps(W_, rDetM);
+
+			Matrix4F r;
+			_mm_storeu_ps(r.m[0], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(1, 3, 1, 3)));
+			_mm_storeu_ps(r.m[1], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(0, 2, 0, 2)));
+			_mm_storeu_ps(r.m[2], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(1, 3, 1, 3)));
+			_mm_storeu_ps(r.m[3], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(0, 2, 0, 2)));
+			return r;
+		}
+		inline void TransformArray(const Matrix4F& a, const Vector3F* in, Vector3F* out, size_t count)
+		{
+			__m128 a0 = LoadRow(a, 0), a1 = LoadRow(a, 1), a2 = LoadRow(a, 2), a3 = LoadRow(a, 3);
+			for (size_t i = 0; i < count; ++i)
+			{
+				// Points // w is implicitly 1.
+				__m128 r = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(in[i].x), a0), _mm_mul_ps(_mm_set1_ps(in[i].y), a1)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(in[i].z), a2), a3));
+				alignas(16) float f[4];
+				_mm_store_ps(f, r);
+				out[i] = Vector3F(f[0], f[1], f[2]);
+			}
+		}
+		inline void TransformArray(const Matrix4F& a, const Vector4F* in, Vector4F* out, size_t count)
+		{
+			__m128 a0 = LoadRow(a, 0), a1 = LoadRow(a, 1), a2 = LoadRow(a, 2), a3 = LoadRow(a, 3);
+			for (size_t i = 0; i < count; ++i)
+				_mm_storeu_ps(out[i].v, Combine(_mm_loadu_ps(in[i].v), a0, a1, a2, a3));
+		}
+	}
+	namespace Backend = SIMD;
+#else
+	namespace Backend = Scalar;
+#endif
+
+	inline Matrix4F Multiply(const Matrix4F& a, const Matrix4F& b) { return Backend::Multiply(a, b); }
+	inline Vector4F Transform(const Matrix4F& a, const Vector4F& b) { return Backend::Transform(a, b); }
+	inline Matrix4F Transpose(const Matrix4F& a) { return Backend::Transpose(a); }
+	inline Matrix4F Inverse(const Matrix4F& a) { return Backend::Inverse(a); }
+	inline void TransformArray(const Matrix4F& a, const Vector3F* in, Vector3F* out, size_t count) { Backend::TransformArray(a, in, out, count); }
+	inline void TransformArray(const Matrix4F& a, const Vector4F* in, Vector4F* out, size_t count) { Backend::TransformArray(a, in, out, count); }
 };
@@ -0,0 +1,334 @@
+#include "Memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdlib.h>
+
+// Heap Tracking
+static std::atomic<uint64_t> s_heapAllocations = 0;
+static std::atomic<uint64_t> s_heapFrees = 0;
+static std::atomic<uint64_t> s_heapBytes = 0;
+
+#if MEMORY_TRACKING
+static void* TrackedAllocate(size_t size)
+{
+	s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	s_heapBytes.fetch_add(size, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+static void TrackedFree(void* p)
+{
+	if (!p)
+		return;
+	s_heapFrees.fetch_add(1, std::memory_order_relaxed);
+	free(p);
+}
+
+void* operator new(size_t size)
+{
+	void* p = TrackedAllocate(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new[](size_t size)
+{
+	void* p = TrackedAllocate(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAllocate(size); }
+void operator delete(void* p) noexcept { TrackedFree(p); }
+void operator delete[](void* p) noexcept { TrackedFree(p); }
+void operator delete(void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+#endif
+
+namespace Memory
+{
+	HeapStats GetHeapStats()
+	{
+		HeapStats stats;
+		stats.m_allocations = s_heapAllocations.load(std::memory_order_relaxed);
+		stats.m_frees = s_heapFrees.load(std::memory_order_relaxed);
+		stats.m_bytes = s_heapBytes.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	static size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Linear Allocator
+	void LinearAllocator::Create(size_t capacity)
+	{
+		Destroy();
+		m_capacity = AlignUp(std::max<size_t>(capacity, 64), 64);
+		m_base = (uint8_t*)::operator new(m_capacity, std::align_val_t(64));
+		m_offset = 0;
+		m_highWater = 0;
+		m_overflows = 0;
+	}
+	void LinearAllocator::Destroy()
+	{
+		Reset();
+		if (m_base)
+			::operator delete(m_base, std::align_val_t(64));
+		m_base = nullptr;
+		m_capacity = 0;
+	}
+
+	void* LinearAllocator::Allocate(size_t size, size_t alignment)
+	{
+		size_t offset = AlignUp(m_offset, alignment);
+		if (m_base && offset + size <= m_capacity)
+		{
+			m_offset = offset + size;
+			return m_base + offset;
+		}
+		// Overflow // Served from the heap for now, Reset makes room for it next time.
+		void* block = ::operator new(size + alignment);
+		m_overflow.push_back(block);
+		m_overflowBytes += size + alignment;
+		return (void*)AlignUp((size_t)block, alignment);
+	}
+	void LinearAllocator::Reset()
+	{
+		m_highWater = std::max(m_highWater, GetUsed());
+		if (!m_overflow.empty())
+		{
+			for (void* block : m_overflow)
+				::operator delete(block);
+			m_overflow.clear();
+			m_overflowBytes = 0;
+			m_overflows++;
+			if (m_base)
+			{
+				// Grown once, with headroom, the steady state then stays inside the main block.
+				size_t capacity = m_highWater + m_highWater / 2;
+				::operator delete(m_base, std::align_val_t(64));
+				m_capacity = AlignUp(capacity, 64);
+				m_base = (uint8_t*)::operator new(m_capacity, std::align_val_t(64));
+			}
+		}
+		m_offset = 0;
+	}
+
+	// Pool Allocator
+	void PoolAllocator::Create(size_t blockSize, size_t alignment, size_t blocksPerChunk)
+	{
+		Destroy();
+		m_alignment = std::max(alignment, alignof(FreeBlock));
+		m_blockSize = AlignUp(std::max(blockSize, sizeof(FreeBlock)), m_alignment);
+		m_blocksPerChunk = std::max<size_t>(blocksPerChunk, 1);
+	}
+	void PoolAllocator::Destroy()
+	{
+		for (void* chunk : m_chunks)
+			::operator delete(chunk, std::align_val_t(m_alignment));
+		m_chunks.clear();
+		m_free = nullptr;
+		m_live = 0;
+	}
+
+	void* PoolAllocator::Allocate()
+	{
+		if (!m_free)
+			Grow();
+		FreeBlock* block = m_free;
+		m_free = block->m_next;
+		m_live++;
+		return block;
+	}
+	void PoolAllocator::Free(void* block)
+	{
+		if (!block)
+			return;
+		FreeBlock* b = (FreeBlock*)block;
+		b->m_next = m_free;
+		m_free = b;
+		m_live--;
+	}
+	void PoolAllocator::Grow()
+	{
+		uint8_t* chunk = (uint8_t*)::operator new(m_blockSize * m_blocksPerChunk, std::align_val_t(m_alignment));
+		m_chunks.push_back(chunk);
+		// Threaded back to front so blocks are handed out in address order.
+		for (size_t i = m_blocksPerChunk; i-- > 0;)
+		{
+			FreeBlock* b = (FreeBlock*)(chunk + i * m_blockSize);
+			b->m_next = m_free;
+			m_free = b;
+		}
+	}
+
+	// Ring Allocator
+	void RingAllocator::Create(size_t capacity)
+	{
+		m_capacity = capacity;
+		m_head = 0;
+		m_used = 0;
+		m_frameBytes = 0;
+		m_frames.clear();
+		m_wraps = 0;
+		m_failures = 0;
+	}
+	void RingAllocator::Destroy()
+	{
+		Create(0);
+	}
+
+	size_t RingAllocator::Allocate(size_t size, size_t alignment)
+	{
+		// Live bytes run from the tail up to the head, the new block has to fit between the head and the tail.
+		size_t offset = AlignUp(m_head, alignment);
+		bool wrap = offset + size > m_capacity;
+		if (wrap)
+			offset = 0;
+		size_t padding = wrap ? m_capacity - m_head : offset - m_head;
+		if (size > m_capacity || m_used + padding + size > m_capacity)
+		{
+			m_failures++;
+			return InvalidOffset;
+		}
+		m_wraps += wrap;
+		m_head = offset + size;
+		m_used += padding + size;
+		m_frameBytes += padding + size;
+		return offset;
+	}
+	void RingAllocator::EndFrame()
+	{
+		if (m_frames.size() == 16)
+			RetireFrame(); // Callers retire long before this, kept from overwriting the history.
+		m_frames.push(m_frameBytes);
+		m_frameBytes = 0;
+	}
+	void RingAllocator::RetireFrame()
+	{
+		if (m_frames.empty())
+			return;
+		m_used -= m_frames.front();
+		m_frames.pop();
+		// Empty, restarting at the front keeps the next frames contiguous.
+		if (m_used == 0 && m_frameBytes == 0)
+			m_head = 0;
+	}
+
+	// Frame Arena
+	void FrameArena::Create(size_t capacity)
+	{
+		m_arena.Create(capacity);
+		m_stats = FrameMemoryStats();
+		m_lastHeap = GetHeapStats();
+	}
+	void FrameArena::Destroy()
+	{
+		m_arena.Destroy();
+	}
+	void FrameArena::EndFrame()
+	{
+		HeapStats heap = GetHeapStats();
+		m_stats.m_frames++;
+		m_stats.m_heapAllocations = heap.m_allocations - m_lastHeap.m_allocations;
+		m_stats.m_heapBytes = heap.m_bytes - m_lastHeap.m_bytes;
+		m_stats.m_arenaUsed = m_arena.GetUsed();
+		m_arena.Reset();
+		m_stats.m_arenaCapacity = m_arena.GetCapacity();
+		m_stats.m_arenaOverflows = m_arena.GetOverflows();
+		// Taken after the reset so a grown arena counts against the frame that outgrew it.
+		m_lastHeap = GetHeapStats();
+	}
+
+	// Benchmark
+	AllocatorBenchmarkReport RunAllocatorBenchmark(int frames, int itemsPerFrame)
+	{
+		AllocatorBenchmarkReport report;
+		report.m_frames = frames;
+		report.m_itemsPerFrame = itemsPerFrame;
+		if (frames <= 1 || itemsPerFrame <= 0)
+			return report;
+
+		typedef std::chrono::high_resolution_clock Clock;
+		LinearAllocator arena;
+		arena.Create(1024);
+		volatile size_t sink = 0;
+		uint64_t allocations[4] = { };
+		double ms[4] = { };
+		for (int f = 0; f < frames; ++f)
+		{
+			// The first frame warms up the arena and the pools and is not counted.
+			uint64_t before[4];
+			Clock::time_point start;
+
+			// Vector built and dropped every frame, like a list of stopped channels.
+			before[0] = GetHeapStats().m_allocations;
+			start = Clock::now();
+			{
+				std::vector<int> items;
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items.push_back(i);
+				sink = sink + items.size();
+			}
+			ms[0] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			before[1] = GetHeapStats().m_allocations;
+			start = Clock::now();
+			{
+				FrameVector<int> items(arena);
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items.push_back(i);
+				sink = sink + items.size();
+			}
+			arena.Reset();
+			ms[1] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+			// Map churn, like channels starting and stopping.
+			before[2] = GetHeapStats().m_allocations;
+			start = Clock::now();
+			{
+				std::map<int, void*> items;
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items[i] = nullptr;
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items.erase(i);
+				sink = sink + items.size();
+			}
+			ms[2] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			before[3] = GetHeapStats().m_allocations;
+			start = Clock::now();
+			{
+				std::map<int, void*, std::less<int>, PoolAdapter<std::pair<const int, void*>>> items;
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items[i] = nullptr;
+				for (int i = 0; i < itemsPerFrame; ++i)
+					items.erase(i);
+				sink = sink + items.size();
+			}
+			ms[3] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			uint64_t after = GetHeapStats().m_allocations;
+
+			if (f > 0)
+			{
+				allocations[0] += before[1] - before[0];
+				allocations[1] += before[2] - before[1];
+				allocations[2] += before[3] - before[2];
+				allocations[3] += after - before[3];
+			}
+		}
+		report.m_heapVectorMs = ms[0] / frames;
+		report.m_arenaVectorMs = ms[1] / frames;
+		report.m_heapMapMs = ms[2] / frames;
+		report.m_poolMapMs = ms[3] / frames;
+		report.m_heapAllocationsPerFrame = (double)(allocations[0] + allocations[2]) / (frames - 1);
+		report.m_arenaAllocationsPerFrame = (double)allocations[1] / (frames - 1);
+		report.m_poolAllocationsPerFrame = (double)allocations[3] / (frames - 1);
+		return report;
+	}
+}
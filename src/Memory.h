@@ -0,0 +1,289 @@
+#pragma once
+
+#include "Common.h"
+
+#include <memory>
+#include <new>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FrameMemory (Memory::FrameArena::Instance())
+
+namespace Memory
+{
+	// Heap Tracking // Every global operator new is counted while MEMORY_TRACKING is on.
+	struct HeapStats
+	{
+		uint64_t m_allocations = 0;
+		uint64_t m_frees = 0;
+		uint64_t m_bytes = 0; // Requested, not freed.
+	};
+	HeapStats GetHeapStats();
+
+	// Linear Allocator // Bump pointer over one block, everything is freed at once by Reset.
+	// Overflow chains extra heap blocks, Reset then grows the main block to the high-water mark so the next round fits.
+	class LinearAllocator
+	{
+	public:
+		LinearAllocator() { }
+		~LinearAllocator() { Destroy(); }
+
+		void Create(size_t capacity);
+		void Destroy();
+
+		void* Allocate(size_t size, size_t alignment = alignof(max_align_t));
+		template<typename T>
+		T* Allocate(size_t count) { return (T*)Allocate(sizeof(T) * count, alignof(T)); }
+		void Reset();
+
+		size_t GetUsed() { return m_offset + m_overflowBytes; }
+		size_t GetCapacity() { return m_capacity; }
+		size_t GetHighWater() { return m_highWater; }
+		uint32_t GetOverflows() { return m_overflows; }
+
+		LinearAllocator(LinearAllocator const&) = delete;
+		void operator=(LinearAllocator const&) = delete;
+
+	private:
+		uint8_t* m_base = nullptr;
+		size_t m_capacity = 0;
+		size_t m_offset = 0;
+		std::vector<void*> m_overflow;
+		size_t m_overflowBytes = 0;
+		size_t m_highWater = 0;
+		uint32_t m_overflows = 0;
+
+	};
+
+	// Pool Allocator // Fixed-size blocks carved from chunks, free blocks form an intrusive list.
+	// Allocate and Free are O(1), chunks are only returned by Destroy. Not thread-safe.
+	class PoolAllocator
+	{
+	public:
+		PoolAllocator() { }
+		PoolAllocator(size_t blockSize, size_t alignment, size_t blocksPerChunk = 64) { Create(blockSize, alignment, blocksPerChunk); }
+		~PoolAllocator() { Destroy(); }
+
+		void Create(size_t blockSize, size_t alignment, size_t blocksPerChunk = 64);
+		void Destroy();
+
+		void* Allocate();
+		void Free(void* block);
+
+		size_t GetLive() { return m_live; }
+		size_t GetCapacity() { return m_chunks.size() * m_blocksPerChunk; }
+
+		PoolAllocator(PoolAllocator const&) = delete;
+		void operator=(PoolAllocator const&) = delete;
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* m_next;
+		};
+		void Grow();
+
+	private:
+		size_t m_blockSize = 0;
+		size_t m_alignment = 0;
+		size_t m_blocksPerChunk = 0;
+		FreeBlock* m_free = nullptr;
+		std::vector<void*> m_chunks;
+		size_t m_live = 0;
+
+	};
+
+	// One pool per block size, shared by every PoolAdapter of that size.
+	// Never destroyed, containers in other singletons may outlive static destruction.
+	template<size_t Size, size_t Alignment>
+	PoolAllocator& GetSizedPool()
+	{
+		static PoolAllocator* pool = new PoolAllocator(Size < sizeof(void*) ? sizeof(void*) : Size, Alignment);
+		return *pool;
+	}
+
+	// Arena Adapter // STL allocator over a LinearAllocator, deallocate does nothing.
+	// Containers using it must be gone before the arena is reset.
+	template<typename T>
+	class ArenaAdapter
+	{
+	public:
+		typedef T value_type;
+
+		ArenaAdapter(LinearAllocator& arena) noexcept : m_arena(&arena) { }
+		template<typename U>
+		ArenaAdapter(const ArenaAdapter<U>& other) noexcept : m_arena(other.m_arena) { }
+
+		T* allocate(size_t n) { return (T*)m_arena->Allocate(n * sizeof(T), alignof(T)); }
+		void deallocate(T*, size_t) noexcept { }
+
+		template<typename U>
+		bool operator==(const ArenaAdapter<U>& other) const noexcept { return m_arena == other.m_arena; }
+		template<typename U>
+		bool operator!=(const ArenaAdapter<U>& other) const noexcept { return m_arena != other.m_arena; }
+
+		LinearAllocator* m_arena;
+	};
+
+	// Pool Adapter // STL allocator for node containers (map, list, set), single nodes come from the pool of their size.
+	template<typename T>
+	class PoolAdapter
+	{
+	public:
+		typedef T value_type;
+
+		PoolAdapter() noexcept { }
+		template<typename U>
+		PoolAdapter(const PoolAdapter<U>&) noexcept { }
+
+		T* allocate(size_t n)
+		{
+			if (n == 1)
+				return (T*)GetSizedPool<sizeof(T), alignof(T)>().Allocate();
+			return std::allocator<T>().allocate(n);
+		}
+		void deallocate(T* p, size_t n) noexcept
+		{
+			if (n == 1)
+				GetSizedPool<sizeof(T), alignof(T)>().Free(p);
+			else
+				std::allocator<T>().deallocate(p, n);
+		}
+
+		template<typename U>
+		bool operator==(const PoolAdapter<U>&) const noexcept { return true; }
+		template<typename U>
+		bool operator!=(const PoolAdapter<U>&) const noexcept { return false; }
+	};
+
+	// Ring Buffer // Fixed capacity FIFO that never allocates, pushing when full drops the oldest item.
+	template<typename T, size_t Capacity>
+	class RingBuffer
+	{
+	public:
+		void push(const T& item)
+		{
+			if (m_count == Capacity)
+				pop();
+			m_items[(m_head + m_count) % Capacity] = item;
+			m_count++;
+		}
+		void pop()
+		{
+			m_head = (m_head + 1) % Capacity;
+			m_count--;
+		}
+		T& front() { return m_items[m_head]; }
+		bool empty() const { return m_count == 0; }
+		size_t size() const { return m_count; }
+		void clear() { m_head = m_count = 0; }
+
+	private:
+		T m_items[Capacity] = { };
+		size_t m_head = 0;
+		size_t m_count = 0;
+	};
+
+	// Ring Allocator // Offsets into a buffer owned by the caller, any backend. Allocations are linear and wrap to the start,
+	// space is only reused once the frame that took it is retired, which the caller does when the consumer is done with it.
+	class RingAllocator
+	{
+	public:
+		static const size_t InvalidOffset = SIZE_MAX;
+
+		void Create(size_t capacity);
+		void Destroy();
+
+		// Offset of size bytes aligned to alignment (a power of two), or InvalidOffset when the frames in flight leave no room.
+		size_t Allocate(size_t size, size_t alignment);
+		// Closes the current frame, its allocations stay live until retired.
+		void EndFrame();
+		// Frees the oldest closed frame.
+		void RetireFrame();
+
+		size_t GetCapacity() { return m_capacity; }
+		size_t GetUsed() { return m_used; } // Live bytes, alignment and wrap padding included.
+		size_t GetFrameBytes() { return m_frameBytes; } // Current frame so far.
+		size_t GetFramesInFlight() { return m_frames.size(); }
+		uint32_t GetWraps() { return m_wraps; }
+		uint32_t GetFailures() { return m_failures; }
+
+	private:
+		size_t m_capacity = 0;
+		size_t m_head = 0; // Next free byte.
+		size_t m_used = 0;
+		size_t m_frameBytes = 0;
+		RingBuffer<size_t, 16> m_frames; // Bytes per closed frame, oldest first.
+		uint32_t m_wraps = 0;
+		uint32_t m_failures = 0;
+	};
+
+	struct FrameMemoryStats
+	{
+		uint64_t m_frames = 0;
+		uint64_t m_heapAllocations = 0; // During the last frame, from any thread.
+		uint64_t m_heapBytes = 0;
+		size_t m_arenaUsed = 0; // Last frame.
+		size_t m_arenaCapacity = 0;
+		uint32_t m_arenaOverflows = 0; // Frames that outgrew the arena.
+	};
+
+	// Frame Arena // Main thread scratch memory, valid until the end of the frame it was allocated in.
+	class FrameArena
+	{
+	public:
+		void Create(size_t capacity = FRAME_ARENA_SIZE);
+		void Destroy();
+
+		void* Allocate(size_t size, size_t alignment = alignof(max_align_t)) { return m_arena.Allocate(size, alignment); }
+		template<typename T>
+		T* Allocate(size_t count) { return m_arena.Allocate<T>(count); }
+		LinearAllocator& GetAllocator() { return m_arena; }
+
+		// Frame boundary, resets the arena and records the heap allocations made since the last one.
+		void EndFrame();
+
+		const FrameMemoryStats& GetStats() { return m_stats; }
+
+	private:
+		LinearAllocator m_arena;
+		HeapStats m_lastHeap;
+		FrameMemoryStats m_stats;
+
+	private:
+		FrameArena() { }
+
+	public:
+		// Singleton Design Pattern
+		static FrameArena& Instance()
+		{
+			static FrameArena instance;
+			return instance;
+		}
+
+		FrameArena(FrameArena const&) = delete;
+		void operator=(FrameArena const&) = delete;
+
+	};
+
+	// Scratch vector for the current frame.
+	template<typename T>
+	using FrameVector = std::vector<T, ArenaAdapter<T>>;
+
+	// Benchmark // Per-frame container churn through the heap, the frame arena and pools, with heap allocations counted.
+	struct AllocatorBenchmarkReport
+	{
+		int m_frames = 0;
+		int m_itemsPerFrame = 0;
+		double m_heapVectorMs = 0.0; // Per frame.
+		double m_arenaVectorMs = 0.0;
+		double m_heapMapMs = 0.0;
+		double m_poolMapMs = 0.0;
+		double m_heapAllocationsPerFrame = 0.0; // Steady state, after the first frame.
+		double m_arenaAllocationsPerFrame = 0.0;
+		double m_poolAllocationsPerFrame = 0.0;
+		bool m_tracking = MEMORY_TRACKING;
+	};
+	AllocatorBenchmarkReport RunAllocatorBenchmark(int frames, int itemsPerFrame);
+}
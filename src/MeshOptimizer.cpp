@@ -0,0 +1,763 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <math.h>
+#include <string.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		static const float* Position(const void* vertices, size_t stride, uint32_t index)
+		{
+			return (const float*)((const uint8_t*)vertices + index * stride);
+		}
+
+		// Triangles using each vertex, one flat array indexed by per-vertex offsets.
+		struct TriangleAdjacency
+		{
+			std::vector<uint32_t> m_counts;
+			std::vector<uint32_t> m_offsets;
+			std::vector<uint32_t> m_triangles;
+
+			void Build(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+			{
+				m_counts.assign(vertexCount, 0);
+				m_offsets.resize(vertexCount);
+				m_triangles.resize(indexCount);
+				for (size_t i = 0; i < indexCount; ++i)
+					m_counts[indices[i]]++;
+				uint32_t offset = 0;
+				for (size_t v = 0; v < vertexCount; ++v)
+				{
+					m_offsets[v] = offset;
+					offset += m_counts[v];
+					m_counts[v] = 0;
+				}
+				for (size_t i = 0; i < indexCount; ++i)
+				{
+					uint32_t v = indices[i];
+					m_triangles[m_offsets[v] + m_counts[v]++] = (uint32_t)(i / 3);
+				}
+			}
+		};
+
+		// Welding
+		static uint32_t HashBytes(const uint8_t* data, size_t size)
+		{
+			// FNV-1a
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < size; ++i)
+				hash = (hash ^ data[i]) * 16777619u;
+			return hash;
+		}
+		size_t WeldVertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount)
+		{
+			uint8_t* bytes = (uint8_t*)vertices;
+			size_t tableSize = 16;
+			while (tableSize < vertexCount * 2)
+				tableSize *= 2;
+			std::vector<uint32_t> table(tableSize, UINT32_MAX); // Open addressing, holds the first vertex of every group.
+			std::vector<uint32_t> remap(vertexCount);
+			std::vector<uint8_t> canonical(vertexCount, 0);
+			uint32_t unique = 0;
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				const uint8_t* vertex = bytes + v * stride;
+				size_t slot = HashBytes(vertex, stride) & (tableSize - 1);
+				while (table[slot] != UINT32_MAX && memcmp(bytes + table[slot] * stride, vertex, stride) != 0)
+					slot = (slot + 1) & (tableSize - 1);
+				if (table[slot] == UINT32_MAX)
+				{
+					table[slot] = (uint32_t)v;
+					remap[v] = unique++;
+					canonical[v] = 1;
+				}
+				else
+					remap[v] = remap[table[slot]];
+			}
+			// Compacted after hashing, the comparisons above read the original slots.
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				if (canonical[v] && remap[v] != v)
+					memcpy(bytes + remap[v] * stride, bytes + v * stride, stride);
+			}
+			for (size_t i = 0; i < indexCount; ++i)
+				indices[i] = remap[indices[i]];
+			return unique;
+		}
+		size_t RemoveDegenerateTriangles(uint32_t* indices, size_t indexCount)
+		{
+			size_t write = 0;
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+			{
+				uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				if (a == b || b == c || c == a)
+					continue;
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			return write;
+		}
+
+		// Forsyth
+		static float ForsythVertexScore(int cachePosition, uint32_t valence, int cacheSize)
+		{
+			if (valence == 0)
+				return -1.0f; // Nothing left to draw, never picked.
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices score a little lower, avoiding long strips that leave the cache cold.
+				if (cachePosition < 3)
+					score = 0.75f;
+				else
+					score = powf(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), 1.5f);
+			}
+			// Vertices with few triangles left are finished first, so they stop occupying the cache.
+			return score + 2.0f / sqrtf((float)valence);
+		}
+		void OptimizeVertexCacheForsyth(uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+		{
+			size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0)
+				return;
+			cacheSize = std::clamp(cacheSize, 4, 64);
+
+			TriangleAdjacency adjacency;
+			adjacency.Build(indices, triangleCount * 3, vertexCount);
+			std::vector<int> cachePosition(vertexCount, -1);
+			std::vector<float> vertexScore(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+				vertexScore[v] = ForsythVertexScore(-1, adjacency.m_counts[v], cacheSize);
+			int best = 0;
+			float bestScore = -1.0f;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = (int)t;
+				}
+			}
+
+			std::vector<uint8_t> emitted(triangleCount, 0);
+			std::vector<uint32_t> output(triangleCount * 3);
+			uint32_t cache[64 + 3], next[64 + 3];
+			int cacheCount = 0;
+			size_t cursor = 0;
+			for (size_t o = 0; o < triangleCount; ++o)
+			{
+				if (best < 0)
+				{
+					// Dead end, nothing in the cache has triangles left. Resume from the first undrawn triangle.
+					while (emitted[cursor])
+						cursor++;
+					best = (int)cursor;
+				}
+				uint32_t t = (uint32_t)best;
+				const uint32_t* tri = indices + t * 3;
+				emitted[t] = 1;
+				output[o * 3] = tri[0];
+				output[o * 3 + 1] = tri[1];
+				output[o * 3 + 2] = tri[2];
+
+				// Drawn triangles leave their vertices' lists.
+				int count = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = tri[k];
+					uint32_t* list = &adjacency.m_triangles[adjacency.m_offsets[v]];
+					uint32_t& live = adjacency.m_counts[v];
+					for (uint32_t j = 0; j < live; ++j)
+					{
+						if (list[j] == t)
+						{
+							list[j] = list[--live];
+							break;
+						}
+					}
+					if (std::find(next, next + count, v) == next + count)
+						next[count++] = v;
+				}
+				// LRU // The triangle moves to the front, vertices pushed past the end are rescored as evicted.
+				for (int i = 0; i < cacheCount; ++i)
+				{
+					uint32_t v = cache[i];
+					if (v != tri[0] && v != tri[1] && v != tri[2])
+						next[count++] = v;
+				}
+				for (int i = 0; i < count; ++i)
+				{
+					uint32_t v = next[i];
+					cachePosition[v] = (i < cacheSize) ? i : -1;
+					vertexScore[v] = ForsythVertexScore(cachePosition[v], adjacency.m_counts[v], cacheSize);
+				}
+				cacheCount = std::min(count, cacheSize);
+				memcpy(cache, next, cacheCount * sizeof(uint32_t));
+
+				// Only triangles touching a rescored vertex changed, the next one is the best among them.
+				best = -1;
+				bestScore = -1.0f;
+				for (int i = 0; i < count; ++i)
+				{
+					uint32_t v = next[i];
+					const uint32_t* list = &adjacency.m_triangles[adjacency.m_offsets[v]];
+					for (uint32_t j = 0; j < adjacency.m_counts[v]; ++j)
+					{
+						uint32_t n = list[j];
+						float score = vertexScore[indices[n * 3]] + vertexScore[indices[n * 3 + 1]] + vertexScore[indices[n * 3 + 2]];
+						if (score > bestScore)
+						{
+							bestScore = score;
+							best = (int)n;
+						}
+					}
+				}
+			}
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		// Tipsify
+		void OptimizeVertexCacheTipsify(uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+		{
+			size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0)
+				return;
+
+			TriangleAdjacency adjacency;
+			adjacency.Build(indices, triangleCount * 3, vertexCount);
+			std::vector<uint32_t> live = adjacency.m_counts;
+			std::vector<uint32_t> timestamps(vertexCount, 0);
+			std::vector<uint8_t> emitted(triangleCount, 0);
+			std::vector<uint32_t> deadEnds;
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> output;
+			deadEnds.reserve(triangleCount * 3);
+			output.reserve(triangleCount * 3);
+
+			uint32_t time = cacheSize + 1;
+			size_t cursor = 0;
+			int fan = -1;
+			while (cursor < vertexCount && live[cursor] == 0)
+				cursor++;
+			if (cursor < vertexCount)
+				fan = (int)cursor;
+			while (fan >= 0)
+			{
+				// Every remaining triangle around the fan vertex.
+				candidates.clear();
+				const uint32_t* list = &adjacency.m_triangles[adjacency.m_offsets[fan]];
+				for (uint32_t j = 0; j < adjacency.m_counts[fan]; ++j)
+				{
+					uint32_t t = list[j];
+					if (emitted[t])
+						continue;
+					emitted[t] = 1;
+					for (int k = 0; k < 3; ++k)
+					{
+						uint32_t v = indices[t * 3 + k];
+						output.push_back(v);
+						deadEnds.push_back(v);
+						candidates.push_back(v);
+						live[v]--;
+						if (time - timestamps[v] > (uint32_t)cacheSize)
+							timestamps[v] = time++;
+					}
+				}
+
+				// Next Fan // The oldest neighbour that will still be cached after its own fan is drawn.
+				int next = -1;
+				int bestPriority = -1;
+				for (uint32_t v : candidates)
+				{
+					if (live[v] == 0)
+						continue;
+					int priority = 0;
+					if (time - timestamps[v] + 2 * live[v] <= (uint32_t)cacheSize)
+						priority = (int)(time - timestamps[v]);
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						next = (int)v;
+					}
+				}
+				if (next < 0)
+				{
+					// Dead end, back to the most recently used vertex with work left, else the next in input order.
+					while (!deadEnds.empty() && next < 0)
+					{
+						uint32_t v = deadEnds.back();
+						deadEnds.pop_back();
+						if (live[v] > 0)
+							next = (int)v;
+					}
+					while (next < 0 && cursor < vertexCount)
+					{
+						if (live[cursor] > 0)
+							next = (int)cursor;
+						else
+							cursor++;
+					}
+				}
+				fan = next;
+			}
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		// Overdraw
+		struct TriangleCluster
+		{
+			uint32_t m_begin;
+			uint32_t m_end;
+			float m_sort;
+		};
+		void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride, float threshold)
+		{
+			size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0)
+				return;
+			const uint32_t cacheSize = 16;
+
+			// Hard Boundaries // All three vertices missed, the cache had already restarted there.
+			std::vector<uint32_t> timestamps(vertexCount, 0);
+			std::vector<uint8_t> misses(triangleCount);
+			std::vector<uint32_t> hard;
+			uint32_t time = cacheSize + 1;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				uint8_t m = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = indices[t * 3 + k];
+					if (time - timestamps[v] > cacheSize)
+					{
+						timestamps[v] = time++;
+						m++;
+					}
+				}
+				if (t == 0 || m == 3)
+					hard.push_back((uint32_t)t);
+				misses[t] = m;
+			}
+			hard.push_back((uint32_t)triangleCount);
+
+			// Soft Boundaries // Split as soon as the run since the last split is within threshold of the whole cluster's ACMR.
+			std::vector<TriangleCluster> clusters;
+			for (size_t c = 0; c + 1 < hard.size(); ++c)
+			{
+				uint32_t begin = hard[c], end = hard[c + 1];
+				uint32_t clusterMisses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+					clusterMisses += misses[t];
+				float limit = threshold * clusterMisses / (end - begin);
+
+				time += cacheSize + 1; // Every vertex counts as evicted.
+				uint32_t start = begin, runMisses = 0;
+				for (uint32_t t = begin; t < end; ++t)
+				{
+					for (int k = 0; k < 3; ++k)
+					{
+						uint32_t v = indices[t * 3 + k];
+						if (time - timestamps[v] > cacheSize)
+						{
+							timestamps[v] = time++;
+							runMisses++;
+						}
+					}
+					if (t + 1 < end && runMisses <= limit * (t + 1 - start))
+					{
+						clusters.push_back({ start, t + 1, 0.0f });
+						start = t + 1;
+						runMisses = 0;
+						time += cacheSize + 1;
+					}
+				}
+				clusters.push_back({ start, end, 0.0f });
+			}
+
+			// Sort Key // How far a cluster faces away from the mesh centre, outward clusters occlude the rest.
+			double meshCenter[3] = { }, meshArea = 0.0;
+			std::vector<float> clusterData(clusters.size() * 6);
+			for (size_t c = 0; c < clusters.size(); ++c)
+			{
+				double center[3] = { }, normal[3] = { }, area = 0.0;
+				for (uint32_t t = clusters[c].m_begin; t < clusters[c].m_end; ++t)
+				{
+					const float* a = Position(vertices, stride, indices[t * 3]);
+					const float* b = Position(vertices, stride, indices[t * 3 + 1]);
+					const float* p = Position(vertices, stride, indices[t * 3 + 2]);
+					double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					double e1[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+					double n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+					double w = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (int i = 0; i < 3; ++i)
+					{
+						center[i] += (a[i] + b[i] + p[i]) / 3.0 * w;
+						normal[i] += n[i];
+					}
+					area += w;
+				}
+				for (int i = 0; i < 3; ++i)
+				{
+					meshCenter[i] += center[i];
+					clusterData[c * 6 + i] = (float)(area > 0.0 ? center[i] / area : 0.0);
+					clusterData[c * 6 + 3 + i] = (float)normal[i];
+				}
+				meshArea += area;
+			}
+			for (int i = 0; i < 3; ++i)
+				meshCenter[i] = meshArea > 0.0 ? meshCenter[i] / meshArea : 0.0;
+			for (size_t c = 0; c < clusters.size(); ++c)
+			{
+				const float* center = &clusterData[c * 6];
+				const float* normal = &clusterData[c * 6 + 3];
+				float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				float dot = 0.0f;
+				for (int i = 0; i < 3; ++i)
+					dot += (center[i] - (float)meshCenter[i]) * normal[i];
+				clusters[c].m_sort = length > 0.0f ? dot / length : 0.0f;
+			}
+			std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& a, const TriangleCluster& b) { return a.m_sort > b.m_sort; });
+
+			std::vector<uint32_t> output;
+			output.reserve(triangleCount * 3);
+			for (const TriangleCluster& c : clusters)
+				output.insert(output.end(), indices + c.m_begin * 3, indices + c.m_end * 3);
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		// Vertex Fetch
+		size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount)
+		{
+			std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+			uint32_t next = 0;
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				uint32_t& r = remap[indices[i]];
+				if (r == UINT32_MAX)
+					r = next++;
+				indices[i] = r;
+			}
+			uint8_t* bytes = (uint8_t*)vertices;
+			std::vector<uint8_t> source(bytes, bytes + vertexCount * stride);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				if (remap[v] != UINT32_MAX)
+					memcpy(bytes + remap[v] * stride, &source[v * stride], stride);
+			}
+			return next;
+		}
+
+		// Index Width
+		void PackIndices(void* destination, const uint32_t* indices, size_t indexCount, uint32_t indexSize)
+		{
+			if (indexSize == 4)
+			{
+				memcpy(destination, indices, indexCount * sizeof(uint32_t));
+				return;
+			}
+			uint16_t* output = (uint16_t*)destination;
+			for (size_t i = 0; i < indexCount; ++i)
+				output[i] = (uint16_t)indices[i];
+		}
+		void UnpackIndices(uint32_t* destination, const void* indices, size_t indexCount, uint32_t indexSize)
+		{
+			if (indexSize == 4)
+			{
+				memcpy(destination, indices, indexCount * sizeof(uint32_t));
+				return;
+			}
+			const uint16_t* input = (const uint16_t*)indices;
+			for (size_t i = 0; i < indexCount; ++i)
+				destination[i] = input[i];
+		}
+
+		// Meshlets
+		static void FinishMeshlet(Meshlet& meshlet, const uint32_t* indices, const void* vertices, size_t stride)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				meshlet.m_min[k] = 1e30f;
+				meshlet.m_max[k] = -1e30f;
+			}
+			const uint32_t* begin = indices + meshlet.m_firstIndex;
+			const uint32_t* end = begin + meshlet.m_indexCount;
+			for (const uint32_t* i = begin; i != end; ++i)
+			{
+				const float* p = Position(vertices, stride, *i);
+				for (int k = 0; k < 3; ++k)
+				{
+					meshlet.m_min[k] = std::min(meshlet.m_min[k], p[k]);
+					meshlet.m_max[k] = std::max(meshlet.m_max[k], p[k]);
+				}
+			}
+			// Sphere around the box centre, as for whole meshes.
+			float radiusSqr = 0.0f;
+			for (int k = 0; k < 3; ++k)
+				meshlet.m_center[k] = (meshlet.m_min[k] + meshlet.m_max[k]) * 0.5f;
+			for (const uint32_t* i = begin; i != end; ++i)
+			{
+				const float* p = Position(vertices, stride, *i);
+				float dx = p[0] - meshlet.m_center[0], dy = p[1] - meshlet.m_center[1], dz = p[2] - meshlet.m_center[2];
+				radiusSqr = std::max(radiusSqr, dx * dx + dy * dy + dz * dz);
+			}
+			meshlet.m_radius = sqrtf(radiusSqr);
+		}
+		void BuildMeshlets(std::vector<Meshlet>& meshlets, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+			uint32_t maxVertices, uint32_t maxTriangles)
+		{
+			meshlets.clear();
+			maxVertices = std::max(maxVertices, 3u);
+			maxTriangles = std::max(maxTriangles, 1u);
+			// Vertices of the open meshlet are tagged with its number, nothing to clear between meshlets.
+			std::vector<uint32_t> owner(vertexCount, UINT32_MAX);
+			Meshlet meshlet = { };
+			uint32_t id = 0;
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+			{
+				uint32_t added = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = indices[i + k];
+					bool repeated = (k > 0 && v == indices[i]) || (k > 1 && v == indices[i + 1]);
+					added += (owner[v] != id && !repeated) ? 1 : 0;
+				}
+				if (meshlet.m_indexCount > 0 && (meshlet.m_vertexCount + added > maxVertices || meshlet.m_indexCount / 3 == maxTriangles))
+				{
+					FinishMeshlet(meshlet, indices, vertices, stride);
+					meshlets.push_back(meshlet);
+					meshlet = { };
+					meshlet.m_firstIndex = (uint32_t)i;
+					id++;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = indices[i + k];
+					if (owner[v] != id)
+					{
+						owner[v] = id;
+						meshlet.m_vertexCount++;
+					}
+				}
+				meshlet.m_indexCount += 3;
+			}
+			if (meshlet.m_indexCount > 0)
+			{
+				FinishMeshlet(meshlet, indices, vertices, stride);
+				meshlets.push_back(meshlet);
+			}
+		}
+
+		// Metrics
+		void AnalyzeVertexCache(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+		{
+			std::vector<uint32_t> timestamps(vertexCount, 0);
+			std::vector<uint8_t> referenced(vertexCount, 0);
+			uint32_t time = cacheSize + 1;
+			size_t misses = 0, unique = 0;
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				uint32_t v = indices[i];
+				if (time - timestamps[v] > (uint32_t)cacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+				if (!referenced[v])
+				{
+					referenced[v] = 1;
+					unique++;
+				}
+			}
+			stats.m_acmr = indexCount >= 3 ? (float)misses / (indexCount / 3) : 0.0f;
+			stats.m_atvr = unique ? (float)misses / unique : 0.0f;
+		}
+		void AnalyzeVertexFetch(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t stride)
+		{
+			// Post-transform misses fetch their vertex through a small FIFO of 64 byte lines.
+			const uint32_t cacheSize = 16, lineSize = 64, lineCache = 64;
+			std::vector<uint32_t> timestamps(vertexCount, 0);
+			std::vector<uint32_t> lineTimestamps((vertexCount * stride + lineSize - 1) / lineSize + 1, 0);
+			std::vector<uint8_t> referenced(vertexCount, 0);
+			uint32_t time = cacheSize + 1, lineTime = lineCache + 1;
+			size_t lines = 0, unique = 0;
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				uint32_t v = indices[i];
+				if (!referenced[v])
+				{
+					referenced[v] = 1;
+					unique++;
+				}
+				if (time - timestamps[v] <= cacheSize)
+					continue;
+				timestamps[v] = time++;
+				for (size_t line = v * stride / lineSize; line <= ((v + 1) * stride - 1) / lineSize; ++line)
+				{
+					if (lineTime - lineTimestamps[line] > lineCache)
+					{
+						lineTimestamps[line] = lineTime++;
+						lines++;
+					}
+				}
+			}
+			stats.m_overfetch = unique ? (float)(lines * lineSize) / (unique * stride) : 0.0f;
+		}
+
+		static const int OverdrawResolution = 256;
+		static void RasterizeOverdraw(std::vector<float>& depth, uint64_t& shaded, const float* a, const float* b, const float* c)
+		{
+			// Counter-clockwise is front facing, the mirrored pass of each axis sees the other side.
+			float area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+			if (area <= 0.0f)
+				return;
+			int minX = std::max((int)floorf(std::min({ a[0], b[0], c[0] })), 0);
+			int minY = std::max((int)floorf(std::min({ a[1], b[1], c[1] })), 0);
+			int maxX = std::min((int)ceilf(std::max({ a[0], b[0], c[0] })), OverdrawResolution - 1);
+			int maxY = std::min((int)ceilf(std::max({ a[1], b[1], c[1] })), OverdrawResolution - 1);
+			for (int y = minY; y <= maxY; ++y)
+			{
+				float py = y + 0.5f;
+				for (int x = minX; x <= maxX; ++x)
+				{
+					float px = x + 0.5f;
+					float w0 = (c[0] - b[0]) * (py - b[1]) - (c[1] - b[1]) * (px - b[0]);
+					float w1 = (a[0] - c[0]) * (py - c[1]) - (a[1] - c[1]) * (px - c[0]);
+					float w2 = (b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0]);
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+					float z = (w0 * a[2] + w1 * b[2] + w2 * c[2]) / area;
+					float& d = depth[y * OverdrawResolution + x];
+					if (z < d)
+					{
+						d = z;
+						shaded++;
+					}
+				}
+			}
+		}
+		void AnalyzeOverdraw(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride)
+		{
+			// Triangles referencing a vertex past the end are skipped rather than read.
+			auto valid = [indices, vertexCount](size_t i) { return indices[i] < vertexCount && indices[i + 1] < vertexCount && indices[i + 2] < vertexCount; };
+			float minimum[3] = { 1e30f, 1e30f, 1e30f }, maximum[3] = { -1e30f, -1e30f, -1e30f };
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				if (indices[i] >= vertexCount)
+					continue;
+				const float* p = Position(vertices, stride, indices[i]);
+				for (int k = 0; k < 3; ++k)
+				{
+					minimum[k] = std::min(minimum[k], p[k]);
+					maximum[k] = std::max(maximum[k], p[k]);
+				}
+			}
+			float extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2], 1e-20f });
+			float scale = (OverdrawResolution - 1) / extent;
+
+			std::vector<float> depth(OverdrawResolution * OverdrawResolution);
+			uint64_t shaded = 0, covered = 0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (int side = 0; side < 2; ++side)
+				{
+					std::fill(depth.begin(), depth.end(), 1e30f);
+					for (size_t i = 0; i + 2 < indexCount; i += 3)
+					{
+						if (!valid(i))
+							continue;
+						float projected[3][3];
+						for (int k = 0; k < 3; ++k)
+						{
+							const float* p = Position(vertices, stride, indices[i + k]);
+							float x = (p[(axis + 1) % 3] - minimum[(axis + 1) % 3]) * scale;
+							float y = (p[(axis + 2) % 3] - minimum[(axis + 2) % 3]) * scale;
+							float z = p[axis] - minimum[axis];
+							// Viewed from the far side, mirrored so winding still tells front from back.
+							projected[k][0] = side ? (OverdrawResolution - 1) - x : x;
+							projected[k][1] = y;
+							projected[k][2] = side ? -z : z;
+						}
+						// Looking along the axis, faces wound counter-clockwise by the right hand rule appear clockwise.
+						RasterizeOverdraw(depth, shaded, projected[0], projected[2], projected[1]);
+					}
+					for (float d : depth)
+						covered += d < 1e30f;
+				}
+			}
+			stats.m_overdraw = covered ? (float)shaded / covered : 0.0f;
+		}
+
+		static void Analyze(MeshStatistics& stats, const void* vertices, size_t vertexCount, size_t stride, const std::vector<uint32_t>& indices, bool overdraw)
+		{
+			AnalyzeVertexCache(stats, indices.data(), indices.size(), vertexCount);
+			AnalyzeVertexFetch(stats, indices.data(), indices.size(), vertexCount, stride);
+			if (overdraw)
+				AnalyzeOverdraw(stats, indices.data(), indices.size(), vertices, vertexCount, stride);
+		}
+		MeshOptimizationReport OptimizeMesh(void* vertices, size_t& vertexCount, size_t stride, std::vector<uint32_t>& indices, const MeshOptimizationSettings& settings)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			MeshOptimizationReport report;
+			report.m_verticesBefore = vertexCount;
+			report.m_trianglesBefore = indices.size() / 3;
+			Analyze(report.m_before, vertices, vertexCount, stride, indices, settings.analyzeOverdraw);
+			// Points and lines left by triangulation would shift every triangle after them, left as they are.
+			if (indices.size() % 3 == 0 && stride >= sizeof(float) * 3)
+			{
+				if (settings.weld)
+				{
+					vertexCount = WeldVertices(vertices, vertexCount, stride, indices.data(), indices.size());
+					indices.resize(RemoveDegenerateTriangles(indices.data(), indices.size()));
+				}
+				if (settings.cache == VertexCacheMethod::Forsyth)
+					OptimizeVertexCacheForsyth(indices.data(), indices.size(), vertexCount);
+				else if (settings.cache == VertexCacheMethod::Tipsify)
+					OptimizeVertexCacheTipsify(indices.data(), indices.size(), vertexCount);
+				// Clusters come from cache restarts, input order has none worth keeping.
+				if (settings.overdraw && settings.cache != VertexCacheMethod::None)
+					OptimizeOverdraw(indices.data(), indices.size(), vertices, vertexCount, stride, settings.overdrawThreshold);
+				if (settings.fetch)
+					vertexCount = OptimizeVertexFetch(vertices, vertexCount, stride, indices.data(), indices.size());
+			}
+			report.m_verticesAfter = vertexCount;
+			report.m_trianglesAfter = indices.size() / 3;
+			Analyze(report.m_after, vertices, vertexCount, stride, indices, settings.analyzeOverdraw);
+			report.m_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			return report;
+		}
+
+		// Verification
+		static void CanonicalTriangles(std::vector<std::string>& triangles, const void* vertices, const uint32_t* indices, size_t indexCount, size_t stride)
+		{
+			const char* bytes = (const char*)vertices;
+			triangles.clear();
+			for (size_t i = 0; i + 2 < indexCount; i += 3)
+			{
+				std::string v[3];
+				for (int k = 0; k < 3; ++k)
+					v[k].assign(bytes + indices[i + k] * stride, stride);
+				// Degenerate by contents, welding drops them.
+				if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+					continue;
+				// Rotated to start at the smallest vertex, winding is kept.
+				int first = (v[1] < v[0]) ? ((v[2] < v[1]) ? 2 : 1) : ((v[2] < v[0]) ? 2 : 0);
+				triangles.push_back(v[first] + v[(first + 1) % 3] + v[(first + 2) % 3]);
+			}
+			std::sort(triangles.begin(), triangles.end());
+		}
+		bool CompareTriangles(const void* verticesA, const uint32_t* indicesA, size_t indexCountA,
+			const void* verticesB, const uint32_t* indicesB, size_t indexCountB, size_t stride)
+		{
+			std::vector<std::string> a, b;
+			CanonicalTriangles(a, verticesA, indicesA, indexCountA, stride);
+			CanonicalTriangles(b, verticesB, indicesB, indexCountB, stride);
+			return a == b;
+		}
+	}
+}
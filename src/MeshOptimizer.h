@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Common.h"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// Mesh Optimizer // CPU only, works on any vertex layout whose first three floats are the position.
+		// Triangle lists with 32-bit indices, callers with narrower indices go through OptimizeMesh.
+
+		// Merges byte-identical vertices, indices are rewritten. Returns the new vertex count.
+		size_t WeldVertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount);
+		// Drops triangles with a repeated index. Returns the new index count.
+		size_t RemoveDegenerateTriangles(uint32_t* indices, size_t indexCount);
+
+		// Post-transform cache ordering.
+		// Forsyth // Greedy, scores vertices by LRU cache position and remaining valence.
+		void OptimizeVertexCacheForsyth(uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize = 32);
+		// Tipsify // Fans around one vertex at a time, stepping to the best cached neighbour. Faster, close in quality.
+		void OptimizeVertexCacheTipsify(uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+
+		// Overdraw ordering // Splits the cache-ordered list into clusters where the cache restarts, or where splitting
+		// costs less than threshold in ACMR, then draws outward-facing clusters first.
+		void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride, float threshold = 1.05f);
+
+		// Vertex Fetch // Vertices renumbered in first-use order, unreferenced ones dropped. Returns the new vertex count.
+		size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount);
+
+		// Index Width // 16-bit whenever every vertex is addressable, halving index memory and bandwidth.
+		inline uint32_t SelectIndexSize(size_t vertexCount) { return vertexCount <= 0x10000 ? 2 : 4; }
+		// Narrows or copies to indexSize bytes per index.
+		void PackIndices(void* destination, const uint32_t* indices, size_t indexCount, uint32_t indexSize);
+		// Widens indexSize byte indices back to 32-bit.
+		void UnpackIndices(uint32_t* destination, const void* indices, size_t indexCount, uint32_t indexSize);
+
+		// Meshlets // Consecutive triangles grouped while they fit the vertex and triangle limits. The index order is kept,
+		// so the optimized order survives and every meshlet is a contiguous index range that can be culled on its own.
+		struct Meshlet
+		{
+			uint32_t m_firstIndex;
+			uint32_t m_indexCount;
+			uint32_t m_vertexCount; // Unique vertices referenced.
+			float m_radius;
+			float m_center[3];
+			float m_min[3];
+			float m_max[3];
+		};
+		void BuildMeshlets(std::vector<Meshlet>& meshlets, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+			uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+		// Metrics
+		struct MeshStatistics
+		{
+			float m_acmr = 0.0f; // Vertex shader runs per triangle, 0.5 at best, 3 at worst.
+			float m_atvr = 0.0f; // Vertex shader runs per vertex, 1 at best.
+			float m_overfetch = 0.0f; // Vertex bytes read through 64 byte lines over bytes referenced, 1 at best.
+			float m_overdraw = 0.0f; // Pixels shaded over pixels covered, 1 at best. Only when requested.
+		};
+		// FIFO post-transform cache, the size matches common hardware.
+		void AnalyzeVertexCache(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize = 16);
+		void AnalyzeVertexFetch(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t stride);
+		// Rasterized from the six axis directions at a fixed resolution, with back faces culled. Triangles indexing past vertexCount are skipped.
+		void AnalyzeOverdraw(MeshStatistics& stats, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride);
+
+		enum class VertexCacheMethod
+		{
+			None,
+			Forsyth,
+			Tipsify,
+		};
+		struct MeshOptimizationSettings
+		{
+			bool weld = true;
+			VertexCacheMethod cache = VertexCacheMethod::Forsyth;
+			bool overdraw = true;
+			float overdrawThreshold = 1.05f;
+			bool fetch = true;
+			bool analyzeOverdraw = false; // Rasterizes the mesh, too slow for every load.
+		};
+		struct MeshOptimizationReport
+		{
+			size_t m_verticesBefore = 0;
+			size_t m_verticesAfter = 0;
+			size_t m_trianglesBefore = 0;
+			size_t m_trianglesAfter = 0;
+			MeshStatistics m_before;
+			MeshStatistics m_after;
+			double m_ms = 0.0;
+		};
+
+		// Full Pipeline // Weld, cache order, overdraw order, fetch order, in place. vertexCount shrinks when vertices merge.
+		MeshOptimizationReport OptimizeMesh(void* vertices, size_t& vertexCount, size_t stride, std::vector<uint32_t>& indices, const MeshOptimizationSettings& settings = MeshOptimizationSettings());
+
+		template<typename Vertex, typename Index>
+		MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices, std::vector<Index>& indices, const MeshOptimizationSettings& settings = MeshOptimizationSettings())
+		{
+			std::vector<uint32_t> indices32(indices.begin(), indices.end());
+			size_t vertexCount = vertices.size();
+			MeshOptimizationReport report = OptimizeMesh(vertices.data(), vertexCount, sizeof(Vertex), indices32, settings);
+			vertices.resize(vertexCount);
+			indices.assign(indices32.begin(), indices32.end());
+			return report;
+		}
+
+		// Verification // True when both lists draw the same triangles, compared by vertex contents and winding.
+		bool CompareTriangles(const void* verticesA, const uint32_t* indicesA, size_t indexCountA,
+			const void* verticesB, const uint32_t* indicesB, size_t indexCountB, size_t stride);
+	}
+}
@@ -0,0 +1,549 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		static const float* Position(const void* vertices, size_t stride, uint32_t index)
+		{
+			return (const float*)((const uint8_t*)vertices + index * stride);
+		}
+		static void Cross(float* out, const float* a, const float* b)
+		{
+			out[0] = a[1] * b[2] - a[2] * b[1];
+			out[1] = a[2] * b[0] - a[0] * b[2];
+			out[2] = a[0] * b[1] - a[1] * b[0];
+		}
+		static float Dot(const float* a, const float* b)
+		{
+			return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+		}
+		static void TriangleNormal(float* out, const float* p0, const float* p1, const float* p2)
+		{
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			Cross(out, e1, e2);
+		}
+
+		// Quadric // Area weighted squared distances to planes as p'Ap + 2b'p + c. Doubles, c cancels against the rest.
+		struct Quadric
+		{
+			double m_a00 = 0, m_a11 = 0, m_a22 = 0, m_a01 = 0, m_a02 = 0, m_a12 = 0;
+			double m_b0 = 0, m_b1 = 0, m_b2 = 0;
+			double m_c = 0;
+			double m_weight = 0; // Face area only, border planes constrain without diluting the error.
+
+			void AddPlane(const float* n, float d, float weight, bool face)
+			{
+				m_a00 += weight * n[0] * n[0];
+				m_a11 += weight * n[1] * n[1];
+				m_a22 += weight * n[2] * n[2];
+				m_a01 += weight * n[0] * n[1];
+				m_a02 += weight * n[0] * n[2];
+				m_a12 += weight * n[1] * n[2];
+				m_b0 += weight * n[0] * d;
+				m_b1 += weight * n[1] * d;
+				m_b2 += weight * n[2] * d;
+				m_c += weight * d * d;
+				if (face)
+					m_weight += weight;
+			}
+			void Add(const Quadric& q)
+			{
+				m_a00 += q.m_a00; m_a11 += q.m_a11; m_a22 += q.m_a22;
+				m_a01 += q.m_a01; m_a02 += q.m_a02; m_a12 += q.m_a12;
+				m_b0 += q.m_b0; m_b1 += q.m_b1; m_b2 += q.m_b2;
+				m_c += q.m_c;
+				m_weight += q.m_weight;
+			}
+			// Mean squared distance of p to the planes.
+			float Error(const float* p) const
+			{
+				double x = p[0], y = p[1], z = p[2];
+				double r = m_a00 * x * x + m_a11 * y * y + m_a22 * z * z + 2.0 * (m_a01 * x * y + m_a02 * x * z + m_a12 * y * z)
+					+ 2.0 * (m_b0 * x + m_b1 * y + m_b2 * z) + m_c;
+				return r > 0.0 ? (float)(r / std::max(m_weight, 1e-12)) : 0.0f;
+			}
+		};
+
+		// Vertices at the same position, each maps to the first of its group.
+		static void BuildPositionRemap(std::vector<uint32_t>& remap, const void* vertices, size_t vertexCount, size_t stride)
+		{
+			size_t tableSize = 16;
+			while (tableSize < vertexCount * 2)
+				tableSize *= 2;
+			std::vector<uint32_t> table(tableSize, UINT32_MAX);
+			remap.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v)
+			{
+				const float* p = Position(vertices, stride, (uint32_t)v);
+				// FNV-1a over the position bytes.
+				uint32_t hash = 2166136261u;
+				for (size_t i = 0; i < sizeof(float) * 3; ++i)
+					hash = (hash ^ ((const uint8_t*)p)[i]) * 16777619u;
+				size_t slot = hash & (tableSize - 1);
+				while (table[slot] != UINT32_MAX && memcmp(Position(vertices, stride, table[slot]), p, sizeof(float) * 3) != 0)
+					slot = (slot + 1) & (tableSize - 1);
+				if (table[slot] == UINT32_MAX)
+					table[slot] = (uint32_t)v;
+				remap[v] = table[slot];
+			}
+		}
+
+		enum VertexKind : uint8_t
+		{
+			VERTEX_MANIFOLD,
+			VERTEX_BORDER, // One open edge in, one out. Slides along them.
+			VERTEX_LOCKED, // Seams, corners and non-manifold fans.
+		};
+
+		// Directed position edges, sorted, for border and non-manifold lookups.
+		struct EdgeSet
+		{
+			std::vector<uint64_t> m_edges;
+
+			void Build(const uint32_t* positions, size_t indexCount)
+			{
+				m_edges.resize(indexCount);
+				for (size_t i = 0; i < indexCount; i += 3)
+				{
+					for (int e = 0; e < 3; ++e)
+						m_edges[i + e] = ((uint64_t)positions[i + e] << 32) | positions[i + (e + 1) % 3];
+				}
+				std::sort(m_edges.begin(), m_edges.end());
+			}
+			size_t Count(uint32_t a, uint32_t b) const
+			{
+				uint64_t key = ((uint64_t)a << 32) | b;
+				auto range = std::equal_range(m_edges.begin(), m_edges.end(), key);
+				return range.second - range.first;
+			}
+		};
+
+		// Ericson, Real-Time Collision Detection 5.1.5.
+		static float PointTriangleDistance(const float* p, const float* a, const float* b, const float* c)
+		{
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+			float closest[3];
+			float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+			float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+			float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+			float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+			float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+			float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+			float s = 0.0f, t = 0.0f;
+			if (d1 <= 0.0f && d2 <= 0.0f)
+				s = t = 0.0f;
+			else if (d3 >= 0.0f && d4 <= d3)
+				s = 1.0f, t = 0.0f;
+			else if (d6 >= 0.0f && d5 <= d6)
+				s = 0.0f, t = 1.0f;
+			else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+				s = d1 / (d1 - d3), t = 0.0f;
+			else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+				s = 0.0f, t = d2 / (d2 - d6);
+			else if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+			{
+				float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+				s = 1.0f - w, t = w;
+			}
+			else
+			{
+				float denominator = 1.0f / (va + vb + vc);
+				s = vb * denominator, t = vc * denominator;
+			}
+			for (int k = 0; k < 3; ++k)
+				closest[k] = a[k] + ab[k] * s + ac[k] * t - p[k];
+			return sqrtf(Dot(closest, closest));
+		}
+		size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+			size_t targetIndexCount, float targetError, float* resultError)
+		{
+			std::vector<uint32_t> result(indices, indices + indexCount);
+			float error = 0.0f;
+			if (indexCount % 3 == 0 && vertexCount > 0)
+			{
+				std::vector<uint32_t> remap;
+				BuildPositionRemap(remap, vertices, vertexCount, stride);
+
+				// Seams // A position used by more than one vertex splits attributes, moving it would tear the mesh.
+				std::vector<uint8_t> referenced(vertexCount, 0);
+				std::vector<uint32_t> wedges(vertexCount, 0);
+				for (uint32_t index : result)
+					referenced[index] = 1;
+				for (size_t v = 0; v < vertexCount; ++v)
+					wedges[remap[v]] += referenced[v];
+
+				// Quadrics // Per position, every incident face plane plus stiff planes through open edges.
+				std::vector<uint32_t> positions(indexCount);
+				for (size_t i = 0; i < indexCount; ++i)
+					positions[i] = remap[result[i]];
+				EdgeSet edges;
+				edges.Build(positions.data(), indexCount);
+				std::vector<Quadric> quadrics(vertexCount);
+				// Bounds // Every source position is a member of one position, in a list per position, and each position holds
+				// the largest distance from its members to a triangle around it. The nearest triangle of the whole mesh is no
+				// further, so the largest of these bounds the distance of every source vertex to the simplified surface.
+				std::vector<uint32_t> firstMember(vertexCount, UINT32_MAX), lastMember(vertexCount, UINT32_MAX), nextMember(vertexCount, UINT32_MAX);
+				std::vector<float> bounds(vertexCount, 0.0f);
+				for (uint32_t position : positions)
+					firstMember[position] = lastMember[position] = position;
+				for (size_t i = 0; i < indexCount; i += 3)
+				{
+					const float* p[3] = { Position(vertices, stride, result[i]), Position(vertices, stride, result[i + 1]), Position(vertices, stride, result[i + 2]) };
+					float n[3];
+					TriangleNormal(n, p[0], p[1], p[2]);
+					float length = sqrtf(Dot(n, n));
+					if (length <= 0.0f)
+						continue;
+					n[0] /= length; n[1] /= length; n[2] /= length;
+					for (int k = 0; k < 3; ++k)
+						quadrics[positions[i + k]].AddPlane(n, -Dot(n, p[0]), length * 0.5f, true);
+					for (int e = 0; e < 3; ++e)
+					{
+						uint32_t a = positions[i + e], b = positions[i + (e + 1) % 3];
+						if (edges.Count(b, a) > 0)
+							continue;
+						float edge[3] = { p[(e + 1) % 3][0] - p[e][0], p[(e + 1) % 3][1] - p[e][1], p[(e + 1) % 3][2] - p[e][2] };
+						float m[3];
+						Cross(m, edge, n);
+						float mLength = sqrtf(Dot(m, m));
+						if (mLength <= 0.0f)
+							continue;
+						m[0] /= mLength; m[1] /= mLength; m[2] /= mLength;
+						float weight = Dot(edge, edge) * 10.0f;
+						quadrics[a].AddPlane(m, -Dot(m, p[e]), weight, false);
+						quadrics[b].AddPlane(m, -Dot(m, p[e]), weight, false);
+					}
+				}
+
+				struct Collapse
+				{
+					uint32_t m_from;
+					uint32_t m_to;
+					float m_cost;
+				};
+				std::vector<Collapse> candidates;
+				std::vector<VertexKind> kinds(vertexCount);
+				std::vector<uint8_t> borderIn(vertexCount), borderOut(vertexCount), touched(vertexCount);
+				std::vector<uint32_t> collapse(vertexCount);
+				std::vector<uint32_t> counts(vertexCount), offsets(vertexCount), adjacency;
+				struct RegionFace
+				{
+					const float* m_points[3];
+					uint32_t m_owner;
+				};
+				struct RegionMember
+				{
+					uint32_t m_member;
+					uint32_t m_owner;
+					float m_distance;
+				};
+				std::vector<uint32_t> ring;
+				std::vector<RegionFace> regionFaces;
+				std::vector<RegionMember> regionMembers;
+				size_t count = indexCount;
+				while (count > targetIndexCount)
+				{
+					// Topology // Rebuilt every pass, collapses move the borders.
+					for (size_t i = 0; i < count; ++i)
+						positions[i] = remap[result[i]];
+					positions.resize(count);
+					edges.Build(positions.data(), count);
+					for (size_t v = 0; v < vertexCount; ++v)
+						kinds[v] = wedges[v] > 1 ? VERTEX_LOCKED : VERTEX_MANIFOLD;
+					std::fill(borderIn.begin(), borderIn.end(), 0);
+					std::fill(borderOut.begin(), borderOut.end(), 0);
+					for (size_t i = 0; i < edges.m_edges.size(); ++i)
+					{
+						uint64_t key = edges.m_edges[i];
+						uint32_t a = (uint32_t)(key >> 32), b = (uint32_t)key;
+						size_t opposite = edges.Count(b, a);
+						if ((i > 0 && edges.m_edges[i - 1] == key) || opposite > 1)
+							kinds[a] = kinds[b] = VERTEX_LOCKED; // Edge shared by more than two faces.
+						if (opposite == 0)
+						{
+							borderOut[a]++;
+							borderIn[b]++;
+						}
+					}
+					for (size_t v = 0; v < vertexCount; ++v)
+					{
+						if (kinds[v] != VERTEX_LOCKED && (borderIn[v] || borderOut[v]))
+							kinds[v] = (borderIn[v] == 1 && borderOut[v] == 1) ? VERTEX_BORDER : VERTEX_LOCKED;
+					}
+					// Faces around every position.
+					std::fill(counts.begin(), counts.end(), 0);
+					for (size_t i = 0; i < count; ++i)
+						counts[positions[i]]++;
+					uint32_t offset = 0;
+					for (size_t v = 0; v < vertexCount; ++v)
+					{
+						offsets[v] = offset;
+						offset += counts[v];
+						counts[v] = 0;
+					}
+					adjacency.resize(count);
+					for (size_t i = 0; i < count; ++i)
+						adjacency[offsets[positions[i]] + counts[positions[i]]++] = (uint32_t)(i / 3);
+
+					// Candidates // Both directions of every edge, cheapest first.
+					candidates.clear();
+					for (size_t i = 0; i < count; i += 3)
+					{
+						for (int e = 0; e < 3; ++e)
+						{
+							uint32_t va = result[i + e], vb = result[i + (e + 1) % 3];
+							uint32_t ends[2][2] = { { va, vb }, { vb, va } };
+							for (auto& end : ends)
+							{
+								uint32_t from = remap[end[0]], to = remap[end[1]];
+								if (from == to || kinds[from] == VERTEX_LOCKED)
+									continue;
+								if (kinds[from] == VERTEX_BORDER && edges.Count(from, to) + edges.Count(to, from) != 1)
+									continue; // Borders only collapse along themselves.
+								Quadric q = quadrics[from];
+								q.Add(quadrics[to]);
+								candidates.push_back({ end[0], end[1], q.Error(Position(vertices, stride, end[1])) });
+							}
+						}
+					}
+					std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.m_cost < b.m_cost; });
+
+					// Collapses // Independent ones only, a collapse locks the ring around the moving vertex for the pass and needs
+					// it untouched, so no triangle is changed by two collapses and the adjacency stays exact for the bounds.
+					// The pass stops at the cheapest quarter of the candidates, costlier ones often get cheaper once their
+					// neighbours have gone.
+					for (size_t v = 0; v < vertexCount; ++v)
+						collapse[v] = (uint32_t)v;
+					std::fill(touched.begin(), touched.end(), 0);
+					size_t goal = (count - targetIndexCount) / 3;
+					size_t removed = 0;
+					size_t applied = 0;
+					float passLimit = candidates.empty() ? 0.0f : candidates[candidates.size() / 4].m_cost;
+					for (const Collapse& c : candidates)
+					{
+						if (removed >= goal || c.m_cost > passLimit)
+							break;
+						uint32_t from = remap[c.m_from], to = remap[c.m_to];
+						bool blocked = touched[from] || touched[to];
+						for (uint32_t k = 0; k < counts[from] && !blocked; ++k)
+						{
+							uint32_t t = adjacency[offsets[from] + k] * 3;
+							blocked = touched[positions[t]] || touched[positions[t + 1]] || touched[positions[t + 2]];
+						}
+						if (blocked)
+							continue;
+						// Flips // Every face kept around the moving vertex must face the same way afterwards.
+						bool flips = false;
+						const float* target = Position(vertices, stride, c.m_to);
+						for (uint32_t k = 0; k < counts[from] && !flips; ++k)
+						{
+							uint32_t t = adjacency[offsets[from] + k] * 3;
+							if (positions[t] == to || positions[t + 1] == to || positions[t + 2] == to)
+								continue; // Collapses away.
+							const float* p[3];
+							const float* q[3];
+							for (int j = 0; j < 3; ++j)
+							{
+								p[j] = Position(vertices, stride, result[t + j]);
+								q[j] = positions[t + j] == from ? target : p[j];
+							}
+							float before[3], after[3];
+							TriangleNormal(before, p[0], p[1], p[2]);
+							TriangleNormal(after, q[0], q[1], q[2]);
+							flips = Dot(before, after) <= 0.0f;
+						}
+						if (flips)
+							continue;
+
+						// Bounds // The triangles around the moving vertex's ring as they would be, the collapsed ones gone. Members of
+						// the ring and of the moving vertex join whichever ring position owns their nearest triangle there.
+						ring.clear();
+						for (uint32_t k = 0; k < counts[from]; ++k)
+						{
+							uint32_t t = adjacency[offsets[from] + k] * 3;
+							for (int j = 0; j < 3; ++j)
+							{
+								if (positions[t + j] != from && std::find(ring.begin(), ring.end(), positions[t + j]) == ring.end())
+									ring.push_back(positions[t + j]);
+							}
+						}
+						regionFaces.clear();
+						for (uint32_t n : ring)
+						{
+							// The target also takes over the moving vertex's surviving triangles.
+							for (int list = 0; list < (n == to ? 2 : 1); ++list)
+							{
+								uint32_t around = list ? from : n;
+								for (uint32_t f = 0; f < counts[around]; ++f)
+								{
+									uint32_t u = adjacency[offsets[around] + f] * 3;
+									bool hasFrom = positions[u] == from || positions[u + 1] == from || positions[u + 2] == from;
+									bool hasTo = positions[u] == to || positions[u + 1] == to || positions[u + 2] == to;
+									if ((hasFrom && hasTo) || (list && hasTo))
+										continue; // Collapses away, or already listed around the target.
+									RegionFace face;
+									for (int w = 0; w < 3; ++w)
+										face.m_points[w] = positions[u + w] == from ? target : Position(vertices, stride, result[u + w]);
+									face.m_owner = n;
+									regionFaces.push_back(face);
+								}
+							}
+						}
+						regionMembers.clear();
+						bool exceeds = regionFaces.empty();
+						for (size_t r = 0; r <= ring.size() && !exceeds; ++r)
+						{
+							for (uint32_t m = firstMember[r < ring.size() ? ring[r] : from]; m != UINT32_MAX && !exceeds; m = nextMember[m])
+							{
+								const float* p = Position(vertices, stride, m);
+								RegionMember member = { m, UINT32_MAX, FLT_MAX };
+								for (const RegionFace& face : regionFaces)
+								{
+									float distance = PointTriangleDistance(p, face.m_points[0], face.m_points[1], face.m_points[2]);
+									if (distance < member.m_distance)
+									{
+										member.m_distance = distance;
+										member.m_owner = face.m_owner;
+									}
+									if (distance == 0.0f)
+										break;
+								}
+								exceeds = member.m_distance > targetError;
+								regionMembers.push_back(member);
+							}
+						}
+						if (exceeds)
+							continue;
+
+						firstMember[from] = lastMember[from] = UINT32_MAX;
+						for (uint32_t n : ring)
+						{
+							firstMember[n] = lastMember[n] = UINT32_MAX;
+							bounds[n] = 0.0f;
+						}
+						for (const RegionMember& member : regionMembers)
+						{
+							nextMember[member.m_member] = UINT32_MAX;
+							if (lastMember[member.m_owner] == UINT32_MAX)
+								firstMember[member.m_owner] = member.m_member;
+							else
+								nextMember[lastMember[member.m_owner]] = member.m_member;
+							lastMember[member.m_owner] = member.m_member;
+							bounds[member.m_owner] = std::max(bounds[member.m_owner], member.m_distance);
+						}
+
+						collapse[c.m_from] = c.m_to;
+						touched[from] = touched[to] = 1;
+						for (uint32_t k = 0; k < counts[from]; ++k)
+						{
+							uint32_t t = adjacency[offsets[from] + k] * 3;
+							touched[positions[t]] = touched[positions[t + 1]] = touched[positions[t + 2]] = 1;
+						}
+						quadrics[to].Add(quadrics[from]);
+						removed += kinds[from] == VERTEX_BORDER ? 1 : 2;
+						applied++;
+					}
+					if (applied == 0)
+						break;
+
+					// Faces collapsed to a line are dropped.
+					size_t write = 0;
+					for (size_t i = 0; i < count; i += 3)
+					{
+						uint32_t a = collapse[result[i]], b = collapse[result[i + 1]], c = collapse[result[i + 2]];
+						if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+							continue;
+						result[write++] = a;
+						result[write++] = b;
+						result[write++] = c;
+					}
+					count = write;
+				}
+				result.resize(count);
+				for (size_t v = 0; v < vertexCount; ++v)
+				{
+					if (firstMember[v] != UINT32_MAX)
+						error = std::max(error, bounds[v]);
+				}
+			}
+			memcpy(destination, result.data(), result.size() * sizeof(uint32_t));
+			if (resultError)
+				*resultError = error;
+			return result.size();
+		}
+
+		float MeasureSimplifyError(const uint32_t* source, size_t sourceCount, const uint32_t* simplified, size_t simplifiedCount, const void* vertices, size_t stride)
+		{
+			std::vector<uint32_t> unique(source, source + sourceCount);
+			std::sort(unique.begin(), unique.end());
+			unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+			float worst = 0.0f;
+			for (uint32_t v : unique)
+			{
+				const float* p = Position(vertices, stride, v);
+				float nearest = FLT_MAX;
+				for (size_t i = 0; i + 2 < simplifiedCount && nearest > worst; i += 3)
+					nearest = std::min(nearest, PointTriangleDistance(p, Position(vertices, stride, simplified[i]), Position(vertices, stride, simplified[i + 1]), Position(vertices, stride, simplified[i + 2])));
+				worst = std::max(worst, nearest);
+			}
+			return worst;
+		}
+
+		void GenerateLods(std::vector<MeshLod>& lods, std::vector<uint32_t>& indices, const void* vertices, size_t vertexCount, size_t stride, int levelCount, float ratio)
+		{
+			lods.clear();
+			size_t fullCount = indices.size();
+			if (fullCount % 3 != 0)
+				return;
+			std::vector<uint32_t> level(fullCount);
+			size_t previous = fullCount;
+			for (int i = 0; i < levelCount; ++i)
+			{
+				size_t target = (size_t)(previous / 3 * ratio) * 3;
+				if (target < 3)
+					break;
+				float error = 0.0f;
+				size_t count = SimplifyMesh(level.data(), indices.data(), fullCount, vertices, vertexCount, stride, target, FLT_MAX, &error);
+				if (count == 0 || count > previous - previous / 10)
+					break; // Held up by seams and borders, not worth a level.
+				OptimizeVertexCacheForsyth(level.data(), count, vertexCount);
+				lods.push_back({ (uint32_t)indices.size(), (uint32_t)count, error, 0 });
+				indices.insert(indices.end(), level.begin(), level.begin() + count);
+				previous = count;
+			}
+		}
+
+		float ProjectedPixelsPerUnit(const Math::Matrix4F& modelViewProj, const Math::Vector3F& center, float viewportWidth, float viewportHeight)
+		{
+			const float* r0 = modelViewProj.m[0];
+			const float* r1 = modelViewProj.m[1];
+			const float* r3 = modelViewProj.m[3];
+			float w = r3[0] * center.x + r3[1] * center.y + r3[2] * center.z + r3[3];
+			if (w <= 1e-6f)
+				return FLT_MAX; // At or behind the eye, full detail.
+			float x = sqrtf(r0[0] * r0[0] + r0[1] * r0[1] + r0[2] * r0[2]) * 0.5f * viewportWidth;
+			float y = sqrtf(r1[0] * r1[0] + r1[1] * r1[1] + r1[2] * r1[2]) * 0.5f * viewportHeight;
+			return std::max(x, y) / w;
+		}
+		int SelectLod(const float* errors, int levelCount, float pixelsPerUnit, int current, float maxPixels, float hysteresis)
+		{
+			for (int level = levelCount - 1; level > 0; --level)
+			{
+				float limit = level > current ? maxPixels * (1.0f - hysteresis) : maxPixels;
+				if (errors[level] * pixelsPerUnit <= limit)
+					return level;
+			}
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.h"
+#include "Math.h"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// Mesh Simplifier // Quadric error metric edge collapses onto existing vertices, ordered by the quadric and limited by a tracked
+		// distance bound, CPU only, position = first three floats.
+		// Only indices change, so every level of detail shares the vertex buffer of the full mesh.
+
+		// Collapses edges until at most targetIndexCount indices are left, or no collapse keeps every source vertex within
+		// targetError of the surface, in object space units. Vertices on UV seams and non-manifold edges stay put, open borders
+		// only slide along themselves. destination may be indices. Returns the new index count. resultError bounds the distance
+		// from any source vertex to the simplified surface, MeasureSimplifyError never finds more.
+		size_t SimplifyMesh(uint32_t* destination, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+			size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+		// Verification // Largest distance from a source vertex to the closest simplified triangle. Brute force.
+		float MeasureSimplifyError(const uint32_t* source, size_t sourceCount, const uint32_t* simplified, size_t simplifiedCount, const void* vertices, size_t stride);
+
+		// Level of Detail // Index range after the full detail indices of a mesh.
+		struct MeshLod
+		{
+			uint32_t m_firstIndex;
+			uint32_t m_indexCount;
+			float m_error; // Object space bound, reported by SimplifyMesh.
+			uint32_t m_padding;
+		};
+		// Appends up to levelCount coarser index lists to indices, each about ratio the triangles of the one before.
+		// Every level is simplified from the full mesh and cache ordered. Levels that barely shrink are dropped.
+		void GenerateLods(std::vector<MeshLod>& lods, std::vector<uint32_t>& indices, const void* vertices, size_t vertexCount, size_t stride,
+			int levelCount = MESH_LOD_LEVELS, float ratio = 0.5f);
+
+		// LOD Selection
+		// Screen pixels covered by one object space unit at center, from the clip space rows of modelViewProj.
+		// Perspective and orthographic alike, w is 1 for the latter.
+		float ProjectedPixelsPerUnit(const Math::Matrix4F& modelViewProj, const Math::Vector3F& center, float viewportWidth, float viewportHeight);
+		// Coarsest level whose error covers at most maxPixels, errors[0] being the full mesh. A coarser level than current is only
+		// taken with the hysteresis fraction to spare, so an object resting on a threshold does not pop back and forth.
+		int SelectLod(const float* errors, int levelCount, float pixelsPerUnit, int current, float maxPixels = LOD_PIXEL_ERROR, float hysteresis = LOD_HYSTERESIS);
+	}
+}
@@ -1,9 +1,19 @@
 #include "Meshes.h"
+#include "TextureCache.h"
+#include "ShaderLibrary.h"
+#include "CookedMesh.h"
+#include "MappedFile.h"
+#include "Culling.h"
+#include "Material.h"
 
+#include <algorithm>
 #include <string>
 #include <math.h>
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "external/stb_image.h"
 
 struct Constants
@@ -15,33 +25,141 @@ namespace Renderer
 {
 	namespace Meshes
 	{
+		// Shared Models // Main thread only, keyed by model and shader path.
+		static std::unordered_map<std::string, std::weak_ptr<Model>> sharedModels;
+		// Cooked texture formats in RHI terms, same order as CookedTextureFormat.
+		static const RHI::Format cookedFormats[COOKED_FORMAT_MAX] = { RHI::FORMAT_RGBA8, RHI::FORMAT_BC1, RHI::FORMAT_BC3, RHI::FORMAT_BC5, RHI::FORMAT_BC7 };
+
+		Model::~Model()
+		{
+			for (auto& m : m_meshes)
+			{
+				if (m_renderer)
+					m.Destroy(*m_renderer);
+			}
+			for (auto& t : m_textures)
+				Textures.Release(t);
+			for (uint32_t material : m_materials)
+				Materials.Release(material);
+			// Atlas // Every page is the same array texture, destroyed once.
+			if (!m_atlasTextures.empty() && m_renderer && m_renderer->GetRHI())
+				m_renderer->GetRHI()->Destroy(m_atlasTextures[0].m_texture);
+			for (auto& t : m_atlasTextures)
+				delete t.m_softwareTexture;
+		}
+
+		// Material of one mesh, shared with every other mesh using the same shader, texture and slice.
+		static uint32_t AcquireMaterial(const Mesh& mesh, const Texture& texture, uint32_t layer = 0)
+		{
+			MaterialDesc desc;
+			desc.m_shader = mesh.m_shader.m_id;
+			desc.m_textures[MATERIAL_TEXTURE_DIFFUSE] = texture.m_texture;
+			desc.m_layers[MATERIAL_TEXTURE_DIFFUSE] = layer;
+			return Materials.Acquire(desc);
+		}
+		// Texture Atlas // The pages become slices of one array texture, every atlased mesh on any page shares its bind and sort id.
+		// The software backend gets a texture per page, each with the same id.
+		static void UploadAtlas(Renderer& renderer, Model& model, ModelData& data)
+		{
+			model.m_atlasPages = std::move(data.m_atlasPages);
+			model.m_atlasPages.resize(model.m_meshes.size(), -1);
+			const TextureAtlas& atlas = data.m_atlas;
+			if (atlas.m_pages.empty())
+				return;
+			TextureData pages;
+			pages.m_width = atlas.m_pageSize;
+			pages.m_height = atlas.m_pageSize;
+			pages.m_arraySize = (uint32_t)atlas.m_pages.size();
+			for (const auto& page : atlas.m_pages)
+			{
+				for (const TextureImage& image : page)
+				{
+					pages.m_mips.push_back({ image.m_pixels.data(), (uint32_t)image.m_width * 4 });
+					pages.m_bytes += image.m_pixels.size();
+				}
+			}
+			Texture texture = Texture().Upload(renderer, "Texture Atlas", pages, Textures.GetSampler(Texture::DefaultSampler()));
+			model.m_atlasTextures.assign(atlas.m_pages.size(), texture);
+			for (size_t page = 1; page < atlas.m_pages.size() && renderer.IsSoftware(); ++page)
+			{
+				SoftwareTexture* software = new SoftwareTexture();
+				for (const TextureImage& image : atlas.m_pages[page])
+				{
+					software->m_levels.emplace_back();
+					SoftwareTexture::Level& l = software->m_levels.back();
+					l.m_width = image.m_width;
+					l.m_height = image.m_height;
+					l.m_texels.resize((size_t)image.m_width * image.m_height);
+					memcpy(l.m_texels.data(), image.m_pixels.data(), l.m_texels.size() * sizeof(uint32_t));
+				}
+				model.m_atlasTextures[page].m_softwareTexture = software;
+			}
+			for (size_t i = 0; i < model.m_meshes.size(); ++i)
+			{
+				int page = model.m_atlasPages[i];
+				if (page < 0)
+					continue;
+				Materials.Release(model.m_materials[i]);
+				model.m_materials[i] = AcquireMaterial(model.m_meshes[i], model.m_atlasTextures[page], (uint32_t)page);
+			}
+			data.m_atlas = TextureAtlas();
+		}
+
 		MeshRenderer::MeshRenderer()
-			: m_constantBuffer(nullptr)
+			: m_renderer(nullptr)
 		{ }
 		MeshRenderer::~MeshRenderer()
 		{ }
 
 		void MeshRenderer::Create(Renderer& renderer)
 		{
-			m_renderer = renderer;
+			m_renderer = &renderer;
 		}
 		void MeshRenderer::Destroy()
 		{
-			for (auto m : m_meshes)
-				m.Destroy();
-			m_constantBuffer->Release();
+			m_model.reset(); // The last renderer using the model frees it.
 		}
 
-		Mesh MeshRenderer::ProcessMesh(aiMesh* mesh, const aiScene* scene)
+		std::shared_ptr<Model> MeshRenderer::FindModel(const char* filePath, const wchar_t* shaderPath, bool& created)
+		{
+			std::string key = TextureCache::Canonicalize(filePath);
+			if (shaderPath)
+				key += "|" + std::filesystem::path(shaderPath).generic_string();
+			std::shared_ptr<Model> model = sharedModels[key].lock();
+			created = !model;
+			if (created)
+			{
+				model = std::make_shared<Model>();
+				sharedModels[key] = model;
+			}
+			return model;
+		}
+		size_t MeshRenderer::GetSharedModelCount()
+		{
+			size_t count = 0;
+			for (auto it = sharedModels.begin(); it != sharedModels.end();)
+			{
+				if (it->second.expired())
+					it = sharedModels.erase(it);
+				else
+				{
+					count++;
+					++it;
+				}
+			}
+			return count;
+		}
+
+		Mesh MeshRenderer::ProcessMesh(aiMesh* mesh, const aiScene* scene, ModelData& data)
 		{
-			std::vector<TexVertex3D> meshData;
-			std::vector<uint16_t> indiceData;
 			Mesh m;
 			// Vertices
 			{
+				std::vector<TexVertex3D>& meshData = m.m_vertices;
+				meshData.resize(mesh->mNumVertices);
 				for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
 				{
-					TexVertex3D vertex;
+					TexVertex3D& vertex = meshData[i];
 					vertex.x = mesh->mVertices[i].x;
 					vertex.y = mesh->mVertices[i].y;
 					vertex.z = mesh->mVertices[i].z;
@@ -55,345 +173,673 @@ namespace Renderer
 						vertex.u = 0.0f;
 						vertex.v = 0.0f;
 					}
-					meshData.push_back(vertex);
 				}
-				m.m_vertices = meshData;
-				m.m_vertexCount = meshData.size();
 			}
 			// Indices
 			{
+				// Sized exactly up front, points and lines survive triangulation with fewer than 3.
+				std::vector<uint32_t>& indiceData = m.m_indices;
+				size_t indexCount = 0;
+				for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+					indexCount += mesh->mFaces[i].mNumIndices;
+				indiceData.resize(indexCount);
+				uint32_t* index = indiceData.data();
 				for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
 				{
-					aiFace face = mesh->mFaces[i];
+					const aiFace& face = mesh->mFaces[i];
 					for (unsigned int j = 0; j < face.mNumIndices; ++j)
 					{
-						indiceData.push_back(face.mIndices[j]);
+						*index++ = face.mIndices[j];
 					}
 				}
-				m.m_indices = indiceData;
-				m.m_indexCount = indiceData.size();
 			}
-			// Textures
+			// Optimize // Welded, then reordered for the post-transform cache, overdraw and vertex fetch.
+			if (data.m_optimize)
+			{
+				MeshOptimizationReport report = OptimizeMesh(m.m_vertices, m.m_indices);
+				char message[256];
+				snprintf(message, sizeof(message), "Optimized mesh: %zu -> %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms)\n",
+					report.m_verticesBefore, report.m_verticesAfter, report.m_before.m_acmr, report.m_after.m_acmr, report.m_before.m_atvr, report.m_after.m_atvr, report.m_ms);
+				OutputDebugString(message);
+				data.m_optimization.push_back(report);
+			}
+			m.m_vertexCount = m.m_vertices.size();
+			m.m_indexCount = m.m_indices.size();
+			// Index Width // Picked after welding, which often brings a mesh back under 16-bit.
+			m.m_indexSize = SelectIndexSize(m.m_vertexCount);
+			if (MESH_MESHLETS && m.m_indexCount % 3 == 0 && m.m_indexCount / 3 > MESHLET_MAX_TRIANGLES)
+				BuildMeshlets(m.m_meshlets, m.m_indices.data(), m.m_indices.size(), m.m_vertices.data(), m.m_vertices.size(), sizeof(TexVertex3D));
+			// Levels of Detail // Appended after the full detail indices, sharing its vertices.
+			if (data.m_optimize && MESH_LOD_LEVELS > 0)
+				GenerateLods(m.m_lods, m.m_indices, m.m_vertices.data(), m.m_vertices.size(), sizeof(TexVertex3D));
+			// Textures // Only the first diffuse texture is used, one per mesh.
 			{
+				std::string texPath;
 				if (mesh->mMaterialIndex >= 0)
 				{
 					aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-					auto type = aiTextureType_DIFFUSE;
-					auto tc = material->GetTextureCount(type);
-					if (tc > 0)
+					if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
 					{
-						for (unsigned int i = 0; i < tc; i++)
-						{
-							aiString str;
-							material->GetTexture(type, i, &str);
-							Texture tex = tex.LoadTexture(m_renderer, str.C_Str());
-							tex.m_id = m_textureCount;
-							tex.m_type = "texture_diffuse";
-							tex.m_texFilePath = str.C_Str();
-							m_textures.push_back(tex);
-							m_textureCount++;
-						}
+						aiString str;
+						material->GetTexture(aiTextureType_DIFFUSE, 0, &str);
+						texPath = str.C_Str();
 					}
 				}
+				data.m_texturePaths.push_back(texPath);
 			}
 			m.m_stride = sizeof(TexVertex3D);
 			m.m_offset = 0;
-			m.m_mesh = mesh;
-			m_meshCount++;
+			m.m_mesh = nullptr; // The importer does not outlive Import.
+			m.ComputeBounds();
 
 			return m;
 		}
-		void MeshRenderer::ProcessNode(aiNode* node, const aiScene* scene)
+		void MeshRenderer::ProcessNode(aiNode* node, const aiScene* scene, ModelData& data)
 		{
 			for (unsigned int i = 0; i < node->mNumMeshes; ++i)
 			{
 				aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-				m_meshes.push_back(ProcessMesh(mesh, scene));
+				data.m_meshes.push_back(ProcessMesh(mesh, scene, data));
 			}
 			for (unsigned int i = 0; i < node->mNumChildren; ++i)
 			{
-				ProcessNode(node->mChildren[i], scene);
+				ProcessNode(node->mChildren[i], scene, data);
 			}
 		}
 
-		void MeshRenderer::LoadModel(const char* filePath, const wchar_t* shaderPath)
+		bool MeshRenderer::ImportCooked(const char* filePath, ModelData& data)
 		{
-			m_modelFilePath = filePath;
+			std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+			if (!file->Open(filePath))
+				return false;
+			const CookedMeshHeader* header = ReadCookedMesh(file->GetData(), file->GetSize());
+			if (!header)
+				return false;
+
+			// Meshes are uploaded straight from the mapping, nothing is copied on the CPU.
+			const uint8_t* base = (const uint8_t*)file->GetData();
+			const CookedSubmesh* submeshes = (const CookedSubmesh*)(base + header->m_submeshOffset);
+			const CookedMaterial* materials = (const CookedMaterial*)(base + header->m_materialOffset);
+			data.m_meshes.resize(header->m_submeshCount);
+			data.m_texturePaths.resize(header->m_submeshCount);
+			for (uint32_t i = 0; i < header->m_submeshCount; ++i)
+			{
+				const CookedSubmesh& sub = submeshes[i];
+				Mesh& m = data.m_meshes[i];
+				m.m_vertexData = base + header->m_vertexOffset + (uint64_t)sub.m_firstVertex * sub.m_vertexStride;
+				m.m_indexData = base + header->m_indexOffset + sub.m_indexOffset;
+				m.m_vertexCount = sub.m_vertexCount;
+				m.m_indexCount = sub.m_indexCount;
+				m.m_indexSize = sub.m_indexSize;
+				// Meshlets are kept after the mapping is dropped, copied out.
+				if (sub.m_meshletCount > 0)
+				{
+					const Meshlet* meshlets = (const Meshlet*)(base + header->m_meshletOffset) + sub.m_firstMeshlet;
+					m.m_meshlets.assign(meshlets, meshlets + sub.m_meshletCount);
+				}
+				if (sub.m_lodCount > 0)
+				{
+					const MeshLod* lods = (const MeshLod*)(base + header->m_lodOffset) + sub.m_firstLod;
+					m.m_lods.assign(lods, lods + sub.m_lodCount);
+				}
+				m.m_stride = sub.m_vertexStride;
+				m.m_offset = 0;
+				m.m_mesh = nullptr;
+				m.ComputeBounds();
+
+				// Textures
+				if (sub.m_material >= 0 && (uint32_t)sub.m_material < header->m_materialCount)
+					data.m_texturePaths[i] = materials[sub.m_material].m_diffusePath;
+			}
+			data.m_file = std::move(file);
+			data.m_cooked = true;
+			return true;
+		}
+
+		void MeshRenderer::PackTextures(const char* filePath, ModelData& data)
+		{
+			// Candidates // Small source images, cooked textures stay on their own. Every mesh sampling one must keep its UVs inside
+			// the texture, wrapping would read its neighbours once the UVs are moved into the page.
+			const float uvEpsilon = 1.0f / 4096.0f;
+			AtlasSettings settings;
+			std::map<std::string, std::vector<uint32_t>> users;
+			for (uint32_t i = 0; i < data.m_texturePaths.size(); ++i)
+			{
+				if (!data.m_texturePaths[i].empty())
+					users[data.m_texturePaths[i]].push_back(i);
+			}
+			std::vector<std::string> paths;
+			for (const auto& u : users)
+			{
+				int width, height;
+				if (std::filesystem::exists(u.first + COOKED_TEXTURE_EXTENSION) || !ReadAtlasSourceSize(u.first.c_str(), width, height)
+					|| width > settings.m_maxSize || height > settings.m_maxSize)
+					continue;
+				bool inside = true;
+				for (uint32_t i : u.second)
+				{
+					const Mesh& m = data.m_meshes[i];
+					const uint8_t* vertices = m.m_vertexData ? (const uint8_t*)m.m_vertexData : (const uint8_t*)m.m_vertices.data();
+					if (m.m_stride != sizeof(TexVertex3D))
+						inside = false;
+					for (UINT v = 0; v < m.m_vertexCount && inside; ++v)
+					{
+						const TexVertex3D& vertex = *(const TexVertex3D*)(vertices + (size_t)v * m.m_stride);
+						inside = vertex.u >= -uvEpsilon && vertex.u <= 1.0f + uvEpsilon && vertex.v >= -uvEpsilon && vertex.v <= 1.0f + uvEpsilon;
+					}
+				}
+				if (inside)
+					paths.push_back(u.first);
+			}
+			if (paths.size() < 2)
+				return; // Nothing to share a bind with.
+
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<TextureImage> images(paths.size());
+			std::vector<const TextureImage*> sources;
+			std::vector<std::string> packed;
+			for (size_t t = 0; t < paths.size(); ++t)
+			{
+				if (!ReadAtlasSource(paths[t].c_str(), images[t]))
+					continue;
+				sources.push_back(&images[t]);
+				packed.push_back(paths[t]);
+			}
+			BuildTextureAtlas(sources.data(), sources.size(), settings, data.m_atlas);
+			if (data.m_atlas.m_stats.m_packed == 0)
+			{
+				data.m_atlas = TextureAtlas();
+				return;
+			}
+
+			// Rewrite UVs // Into the packed rectangle. Cooked vertices are copied out of the read-only mapping first.
+			data.m_atlasPages.assign(data.m_meshes.size(), -1);
+			for (size_t t = 0; t < packed.size(); ++t)
+			{
+				const AtlasPlacement& p = data.m_atlas.m_placements[t];
+				if (p.m_page < 0)
+					continue;
+				for (uint32_t i : users[packed[t]])
+				{
+					Mesh& m = data.m_meshes[i];
+					if (m.m_vertexData)
+					{
+						const TexVertex3D* vertices = (const TexVertex3D*)m.m_vertexData;
+						m.m_vertices.assign(vertices, vertices + m.m_vertexCount);
+						m.m_vertexData = nullptr;
+					}
+					for (TexVertex3D& vertex : m.m_vertices)
+					{
+						vertex.u = std::min(std::max(vertex.u, 0.0f), 1.0f) * p.m_uvScale[0] + p.m_uvOffset[0];
+						vertex.v = std::min(std::max(vertex.v, 0.0f), 1.0f) * p.m_uvScale[1] + p.m_uvOffset[1];
+					}
+					data.m_texturePaths[i].clear();
+					data.m_atlasPages[i] = p.m_page;
+				}
+			}
+			{
+				const AtlasStats& stats = data.m_atlas.m_stats;
+				char message[512];
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				snprintf(message, sizeof(message), "Packed %d of %d textures of %s into %d atlas pages, %.1f%% occupied, in %.2f ms\n",
+					stats.m_packed, stats.m_inputs, filePath, stats.m_pages, stats.m_occupancy * 100.0f, ms);
+				OutputDebugString(message);
+			}
+		}
+
+		bool MeshRenderer::Import(const char* filePath, const wchar_t* shaderPath, ModelData& data)
+		{
+			// Thread-safe // File I/O, parsing and shader compilation only, no device access.
+			auto loadStart = std::chrono::high_resolution_clock::now();
+			// Cooked Model // Used when a <model>.dxmesh sits next to the source, see CookMesh.
+			std::string cookedPath = filePath;
+			if (cookedPath.find(COOKED_MESH_EXTENSION) == std::string::npos)
+				cookedPath += COOKED_MESH_EXTENSION;
 			// Load Model
+			if (!ImportCooked(cookedPath.c_str(), data))
 			{
 				Assimp::Importer importer;
 				const aiScene* scene = importer.ReadFile(filePath, aiProcess_Triangulate | aiProcess_FlipUVs);
-				ProcessNode(scene->mRootNode, scene);
-
-				for (unsigned int i = 0; i < m_meshes.size(); i++)
+				if (!scene || !scene->mRootNode)
+				{
+					OutputDebugString("Assimp error: ");
+					OutputDebugString(importer.GetErrorString());
+					OutputDebugString("\n");
+					return false;
+				}
+				// Every mesh is usually referenced once, no regrowth while the tree is walked.
+				data.m_meshes.reserve(scene->mNumMeshes);
+				data.m_texturePaths.reserve(scene->mNumMeshes);
+				ProcessNode(scene->mRootNode, scene, data);
+			}
+			if (data.m_packTextures)
+				PackTextures(filePath, data);
+			// Compile Shader // Once per model, every mesh shares the bytecode and the shader objects.
+			if (shaderPath && !Shader::Compile(shaderPath, data.m_shaderBlobs, MESH_INSTANCING))
+				return false;
+			{
+				char message[512];
+				double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+				snprintf(message, sizeof(message), "Loaded %s (%s) in %.2f ms\n", filePath, data.m_cooked ? "cooked" : "assimp", ms);
+				OutputDebugString(message);
+			}
+			return true;
+		}
+		void MeshRenderer::Upload(Renderer& renderer, const std::shared_ptr<Model>& model, ModelData& data, bool streamTextures)
+		{
+			// Main thread only.
+			model->m_renderer = &renderer;
+			model->m_meshes = std::move(data.m_meshes);
+			model->m_bounds = Math::BoundingBox();
+			for (auto& m : model->m_meshes)
+				model->m_bounds.Extend(m.m_bounds);
+			model->m_sphere.center = model->m_bounds.GetCenter();
+			model->m_sphere.radius = 0.0f;
+			for (auto& m : model->m_meshes)
+				if (!m.m_bounds.IsEmpty())
+					model->m_sphere.radius = fmaxf(model->m_sphere.radius, model->m_sphere.center.Distance(m.m_sphere.center) + m.m_sphere.radius);
+			// Model wide levels, meshes with fewer stay on their coarsest.
+			model->m_lodErrors.clear();
+			for (auto& m : model->m_meshes)
+			{
+				if (m.m_lods.size() + 1 > model->m_lodErrors.size())
+					model->m_lodErrors.resize(m.m_lods.size() + 1, 0.0f);
+			}
+			for (auto& m : model->m_meshes)
+			{
+				for (size_t level = 1; level < model->m_lodErrors.size(); ++level)
 				{
-					auto& m = m_meshes[i];
-					m.Setup(m_renderer, shaderPath);
+					float error = m.m_lods.empty() ? 0.0f : m.m_lods[std::min(level, m.m_lods.size()) - 1].m_error;
+					model->m_lodErrors[level] = fmaxf(model->m_lodErrors[level], error);
 				}
 			}
-			// Create Constant Buffer
+			if (model->m_lodErrors.size() < 2)
+				model->m_lodErrors.clear();
+			for (auto& m : model->m_meshes)
 			{
-				D3D11_BUFFER_DESC constantBufferDesc;
-				ZeroMemory(&constantBufferDesc, sizeof(D3D11_BUFFER_DESC));
-				constantBufferDesc.ByteWidth = sizeof(Constants) + 0xf & 0xfffffff0;
-				constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-				constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-				constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-				HRESULT result = m_renderer.GetDevice()->CreateBuffer(&constantBufferDesc, nullptr, &m_constantBuffer);
-				assert(SUCCEEDED(result));
+				m.Setup(renderer, data.m_shaderBlobs);
+				// The software backend draws from the CPU copies, keep the cooked data before the mapping goes. Atlased vertices were copied at import.
+				if (renderer.IsSoftware() && m.m_vertexData)
+				{
+					const TexVertex3D* vertices = (const TexVertex3D*)m.m_vertexData;
+					m.m_vertices.assign(vertices, vertices + m.m_vertexCount);
+				}
+				if (renderer.IsSoftware() && m.m_indexData)
+				{
+					m.m_indices.resize(m.GetBufferIndexCount());
+					UnpackIndices(m.m_indices.data(), m.m_indexData, m.m_indices.size(), m.m_indexSize);
+				}
+				m.m_vertexData = nullptr;
+				m.m_indexData = nullptr;
 			}
+			data.m_file.reset(); // Buffers are immutable copies now, drop the mapping.
+
+			// Textures
+			model->m_texturePaths = std::move(data.m_texturePaths);
+			model->m_textures.assign(model->m_meshes.size(), Texture());
+			model->m_materials.resize(model->m_meshes.size());
+			for (unsigned int i = 0; i < model->m_meshes.size(); i++)
+				model->m_materials[i] = AcquireMaterial(model->m_meshes[i], model->m_textures[i]);
+			UploadAtlas(renderer, *model, data);
+			for (unsigned int i = 0; i < model->m_texturePaths.size(); i++)
+			{
+				if (model->m_texturePaths[i].empty())
+					continue;
+				const char* texPath = model->m_texturePaths[i].c_str();
+				if (!streamTextures)
+				{
+					model->m_textures[i] = Textures.Acquire(texPath);
+					model->m_textures[i].m_id = i;
+					Materials.Release(model->m_materials[i]);
+					model->m_materials[i] = AcquireMaterial(model->m_meshes[i], model->m_textures[i]);
+					continue;
+				}
+				// Decoded on a streaming thread by the cache. The mesh draws untextured until then.
+				std::weak_ptr<Model> weakModel = model;
+				Textures.AcquireAsync(texPath, [weakModel, i](const Texture& tex)
+				{
+					Texture texture = tex;
+					std::shared_ptr<Model> model = weakModel.lock();
+					if (!model)
+					{
+						Textures.Release(texture); // Every user went away while it streamed.
+						return;
+					}
+					model->m_textures[i] = texture;
+					model->m_textures[i].m_id = i;
+					Materials.Release(model->m_materials[i]);
+					model->m_materials[i] = AcquireMaterial(model->m_meshes[i], texture);
+				});
+			}
+			model->m_instanced = MESH_INSTANCING;
+			model->m_loaded = true;
 		}
 
+		void MeshRenderer::LoadModel(const char* filePath, const wchar_t* shaderPath)
+		{
+			m_modelFilePath = filePath;
+			bool created;
+			m_model = FindModel(filePath, shaderPath, created);
+			if (m_model->m_loaded)
+				return;
+			// Also completes an in-flight streamed load of the same model early.
+			ModelData data;
+			data.m_packTextures = TEXTURE_ATLAS && (!m_renderer->IsNull() || m_renderer->IsSoftware()); // Nothing samples them on the null backend.
+			if (Import(filePath, m_renderer->IsNull() ? nullptr : shaderPath, data))
+				Upload(*m_renderer, m_model, data, false);
+		}
+		Assets::AssetHandle MeshRenderer::LoadModelAsync(const char* filePath, const wchar_t* shaderPath, Assets::AssetPriority priority)
+		{
+			m_modelFilePath = filePath;
+			bool created;
+			m_model = FindModel(filePath, shaderPath, created);
+			if (!created)
+				return m_model->m_handle; // Already loaded or streaming for another renderer.
+
+			std::shared_ptr<ModelData> data = std::make_shared<ModelData>();
+			data->m_packTextures = TEXTURE_ATLAS && (!m_renderer->IsNull() || m_renderer->IsSoftware());
+			std::shared_ptr<Model> model = m_model;
+			Renderer* renderer = m_renderer;
+			std::string path = filePath;
+			std::wstring shader = m_renderer->IsNull() ? L"" : shaderPath;
+			model->m_handle = AssetLoader.Request(filePath,
+				[data, path, shader]() { return Import(path.c_str(), shader.empty() ? nullptr : shader.c_str(), *data); },
+				[renderer, model, data](bool result)
+				{
+					if (result && !model->m_loaded)
+						Upload(*renderer, model, *data, true);
+				},
+				priority);
+			return model->m_handle;
+		}
+
+		int MeshRenderer::GetMeshLod(size_t mesh)
+		{
+			// The level last selected, clamped to the levels the mesh has like Draw does.
+			return std::min(m_lod, (int)m_model->m_meshes[mesh].m_lods.size());
+		}
 		void MeshRenderer::Draw(Math::Matrix4F& modelMat, Camera& camera)
 		{
+			if (!IsLoaded())
+				return; // Still streaming.
+			Model& model = *m_model;
+
 			// Camera
 			Math::Matrix4F m_modelViewProj = modelMat * camera.GetViewMatrix() * camera.GetProjectionMatrix();
 
-			// Update Constant Buffer
+			// Write Constants // Into the frame's constant ring, instanced draws carry their transform in the queue instead. With
+			// MESH_INSTANCING on every model is instanced and nothing here reaches the ring, -rhitest drives it directly.
+			UINT constantOffset = 0;
+			if (!model.m_instanced)
 			{
-				D3D11_MAPPED_SUBRESOURCE mappedSubresource;
-				m_renderer.GetDeviceContext()->Map(m_constantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
-				Constants* constants = (Constants*)(mappedSubresource.pData);
+				Constants* constants = (Constants*)m_renderer->AllocateConstants(sizeof(Constants), constantOffset);
+				if (!constants)
+					return; // Ring full of frames the GPU has not finished.
 				constants->modelViewProj = m_modelViewProj;
-				m_renderer.GetDeviceContext()->Unmap(m_constantBuffer, 0);
 			}
-			// Draw Mesh
-			for (unsigned int i = 0; i < m_meshes.size(); i++)
+			// Submit Meshes // Sorted and drawn by the render queue at the end of the frame.
+			float depth = SortKey::ViewDepth(modelMat, camera.GetViewMatrix());
+			Frustum frustum(m_modelViewProj); // Model space, meshlet bounds are tested as they are.
+
+			// Level of Detail // From the simplification error projected at the model's bounding sphere.
+			if (!model.m_lodErrors.empty())
 			{
-				auto& m = m_meshes[i];
-				m.m_shader.Use(m_renderer);
-				if (m_textureCount > 0)
+				float pixelsPerUnit = ProjectedPixelsPerUnit(m_modelViewProj, model.m_sphere.center, camera.GetViewportWidth(), camera.GetViewportHeight());
+				m_lod = SelectLod(model.m_lodErrors.data(), (int)model.m_lodErrors.size(), pixelsPerUnit, m_lod);
+			}
+			for (unsigned int i = 0; i < model.m_meshes.size(); i++)
+			{
+				auto& m = model.m_meshes[i];
+				Texture* tex = (model.m_textures[i].m_materialId != 0) ? &model.m_textures[i] : nullptr;
+				if (model.m_atlasPages[i] >= 0)
+					tex = &model.m_atlasTextures[model.m_atlasPages[i]];
+				unsigned int material = tex ? tex->m_materialId : 0;
+
+				DrawItem item;
+				item.m_mesh = &m;
+				item.m_shader = &m.m_shader;
+				item.m_texture = tex;
+				item.m_constantBuffer = model.m_instanced ? RHI::BufferHandle() : m_renderer->GetConstantRing();
+				item.m_constantOffset = constantOffset;
+				item.m_constantSize = sizeof(Constants);
+				item.m_modelViewProj = m_modelViewProj;
+				item.m_material = model.m_materials[i];
+				item.m_instanced = model.m_instanced;
+				item.m_firstIndex = 0;
+				item.m_indexCount = m.m_indexCount;
+				int lod = std::min(m_lod, (int)m.m_lods.size());
+				if (lod > 0)
 				{
-					auto& tex = m_textures[i];
-					tex.Use(m_renderer, tex.m_id);
+					item.m_firstIndex = m.m_lods[lod - 1].m_firstIndex;
+					item.m_indexCount = m.m_lods[lod - 1].m_indexCount;
+				}
+				// Instances at different levels batch apart, the level sits above the mesh id.
+				uint64_t key = model.m_instanced ? SortKey::MakeInstanced(PASS_OPAQUE, m.m_shader.m_id, material, m.m_id | ((unsigned int)lod << 24)) : SortKey::Make(PASS_OPAQUE, m.m_shader.m_id, material, depth);
+				// Instanced draws are whole meshes, culled per object only. Per copy ranges would give each partly visible copy
+				// draws of its own and break the batch, so with MESH_INSTANCING on, meshlet culling covers non-instanced models.
+				if (model.m_instanced || m.m_meshlets.empty() || lod > 0)
+				{
+					m_renderer->GetRenderQueue().Submit(key, item);
+					continue;
+				}
+				// Meshlet Culling // Runs of visible meshlets are contiguous index ranges, one draw each.
+				CullMeshlets(frustum, m.m_meshlets.data(), m.m_meshlets.size(), m_meshletRanges);
+				for (const IndexRange& range : m_meshletRanges)
+				{
+					item.m_firstIndex = range.m_firstIndex;
+					item.m_indexCount = range.m_indexCount;
+					m_renderer->GetRenderQueue().Submit(key, item);
 				}
-				m_renderer.GetDeviceContext()->VSSetConstantBuffers(0, 1, &m_constantBuffer);
-				m.Draw(m_renderer);
 			}
 		}
 
+		bool Shader::Compile(LPCWSTR sPath, ShaderBlobs& blobs, bool instanced)
+		{
+			// Thread-safe // Bytecode comes from the shader library, compiled at most once per permutation.
+			return Shaders.Compile(sPath, blobs, instanced);
+		}
+		void Shader::Create(Renderer& renderer, const ShaderBlobs& blobs)
+		{
+			// Shader objects are shared by every mesh using the same bytecode.
+			Shaders.CreateShader(blobs, *this);
+		}
 		void Shader::Setup(Renderer& renderer, LPCWSTR sPath)
 		{
-			// Create Shaders
+			ShaderBlobs blobs;
+			if (!renderer.IsNull())
+				Compile(sPath, blobs);
+			Create(renderer, blobs);
+			blobs.Release();
+		}
+		void ShaderBlobs::Release()
+		{
+			if (m_vertexBlob)
+				m_vertexBlob->Release();
+			if (m_pixelBlob)
+				m_pixelBlob->Release();
+			m_vertexBlob = nullptr;
+			m_pixelBlob = nullptr;
+			m_instanced = false;
+		}
+
+		bool Texture::Decode(const char* filePath, TextureData& data)
+		{
+			// Thread-safe // stbi_load keeps no global state with the default settings used here.
+			// Cooked Texture // Used when a <texture>.dds sits next to the source, see CookTexture.
+			std::string cookedPath = filePath;
+			if (cookedPath.find(COOKED_TEXTURE_EXTENSION) == std::string::npos)
+				cookedPath += COOKED_TEXTURE_EXTENSION;
+			std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+			std::vector<CookedMip> cookedMips;
+			if (file->Open(cookedPath.c_str()))
 			{
-				// Vertex Shader
-				ID3DBlob* vsBlob;
+				if (const CookedTextureHeader* header = ReadCookedTexture(file->GetData(), file->GetSize(), cookedMips))
 				{
-					ID3DBlob* shaderCompileErrors;
-					HRESULT result = D3DCompileFromFile(
-						sPath,
-						nullptr,
-						nullptr,
-						"vs_main",
-						"vs_5_0",
-						0,
-						0,
-						&vsBlob,
-						&shaderCompileErrors
-					);
-					if (FAILED(result))
+					data.m_width = header->m_width;
+					data.m_height = header->m_height;
+					data.m_format = RHI::FORMAT_UNKNOWN;
+					for (int f = 0; f < COOKED_FORMAT_MAX; ++f)
 					{
-						const char* errorString = nullptr;
-						if (result == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
-							errorString = "D3DCompileFromFile error: File not found.";
-						else if (shaderCompileErrors)
-						{
-							errorString = (const char*)shaderCompileErrors->GetBufferPointer();
-							shaderCompileErrors->Release();
-						}
-						MessageBox(0, errorString, "Error", MB_OK);
-						OutputDebugString("D3DCompileFromFile error: ");
-						OutputDebugString(errorString);
-						OutputDebugString("\n");
-						return;
+						if (GetDxgiFormat((CookedTextureFormat)f) == header->m_dxgiFormat)
+							data.m_format = cookedFormats[f];
 					}
-
-					result = renderer.GetDevice()->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, &m_vertexShader);
-					assert(SUCCEEDED(result));
-				}
-				// Pixel Shader
-				ID3DBlob* psBlob;
-				{
-					ID3DBlob* shaderCompileErrors;
-					HRESULT result = D3DCompileFromFile(
-						sPath,
-						nullptr,
-						nullptr,
-						"ps_main",
-						"ps_5_0",
-						0,
-						0,
-						&psBlob,
-						&shaderCompileErrors
-					);
-					if (FAILED(result))
+					for (const auto& mip : cookedMips)
 					{
-						const char* errorString = nullptr;
-						if (result == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
-							errorString = "D3DCompileFromFile error: File not found.";
-						else if (shaderCompileErrors)
-						{
-							errorString = (const char*)shaderCompileErrors->GetBufferPointer();
-							shaderCompileErrors->Release();
-						}
-						MessageBox(0, errorString, "Error", MB_OK);
-						OutputDebugString("D3DCompileFromFile error: ");
-						OutputDebugString(errorString);
-						OutputDebugString("\n");
-						return;
+						data.m_mips.push_back({ mip.m_data, mip.m_rowPitch });
+						data.m_bytes += mip.m_size;
 					}
-
-					result = renderer.GetDevice()->CreatePixelShader(psBlob->GetBufferPointer(), psBlob->GetBufferSize(), nullptr, &m_pixelShader);
-					assert(SUCCEEDED(result));
+					data.m_file = std::move(file);
+					return true;
 				}
-				psBlob->Release();
-				// Create Input Layout
-				{
-					D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
-					{
-						{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-						{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-					};
+			}
 
-					HRESULT result = renderer.GetDevice()->CreateInputLayout(inputElementDesc, ARRAYSIZE(inputElementDesc), vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), &m_inputLayout);
-					assert(SUCCEEDED(result));
-				}
-				vsBlob->Release();
+			// Source Image // Uncompressed, with a box filtered mip chain built here.
+			int texWidth, texHeight, texNumChannels;
+			int texForceNumChannels = 4;
+			unsigned char* textureBytes = stbi_load(filePath, &texWidth, &texHeight, &texNumChannels, texForceNumChannels);
+			if (!textureBytes)
+				return false;
+			GenerateMips(textureBytes, texWidth, texHeight, MIP_FILTER_BOX, true, data.m_images);
+			stbi_image_free(textureBytes); // Free Image
+			data.m_width = texWidth;
+			data.m_height = texHeight;
+			data.m_format = RHI::FORMAT_RGBA8;
+			for (const auto& image : data.m_images)
+			{
+				data.m_mips.push_back({ image.m_pixels.data(), (uint32_t)image.m_width * 4 });
+				data.m_bytes += image.m_pixels.size();
 			}
+			return true;
 		}
-		void Shader::Use(Renderer& renderer)
+		void TextureData::Release()
 		{
-			renderer.GetDeviceContext()->IASetInputLayout(m_inputLayout);
-			renderer.GetDeviceContext()->VSSetShader(m_vertexShader, nullptr, 0);
-			renderer.GetDeviceContext()->PSSetShader(m_pixelShader, nullptr, 0);
+			m_mips.clear();
+			m_images.clear();
+			m_file.reset();
 		}
-		void Shader::Destroy()
+		RHI::SamplerDesc Texture::DefaultSampler()
 		{
-			m_vertexShader->Release();
-			m_pixelShader->Release();
-			m_inputLayout->Release();
+			RHI::SamplerDesc samplerDesc;
+			samplerDesc.m_filter = RHI::FILTER_POINT;
+			samplerDesc.m_address = RHI::ADDRESS_BORDER;
+			samplerDesc.m_maxAnisotropy = 1;
+			for (int i = 0; i < 4; ++i)
+				samplerDesc.m_borderColor[i] = 1.0f;
+			return samplerDesc;
 		}
-
-		Texture Texture::LoadTexture(Renderer& renderer, const char* filePath)
+		Texture Texture::Upload(Renderer& renderer, const char* filePath, TextureData& data, RHI::SamplerHandle sampler)
 		{
+			static unsigned int nextMaterialId = 1;
 			m_texFilePath = filePath;
 			m_type = "texture_diffuse";
-			// Create Sampler State
-			{
-				HRESULT result;
-
-				D3D11_SAMPLER_DESC samplerDesc;
-				ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
-				samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-				samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
-				samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
-				samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
-				samplerDesc.MipLODBias = 0.0f;
-				samplerDesc.MaxAnisotropy = 1;
-				samplerDesc.BorderColor[0] = 1.0f;
-				samplerDesc.BorderColor[1] = 1.0f;
-				samplerDesc.BorderColor[2] = 1.0f;
-				samplerDesc.BorderColor[3] = 1.0f;
-				samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-				samplerDesc.MinLOD = -FLT_MAX;
-				samplerDesc.MaxLOD = FLT_MAX;
-				result = renderer.GetDevice()->CreateSamplerState(&samplerDesc, &m_samplerState);
-				assert(SUCCEEDED(result));
-			}
-			// Load Image and Create Texture
-			{
-				HRESULT result;
-
-				int texWidth, texHeight, texNumChannels;
-				int texForceNumChannels = 4;
-				unsigned char* textureBytes = stbi_load(filePath, &texWidth, &texHeight, &texNumChannels, texForceNumChannels);
-				//assert(textureBytes);
-				int texBytesPerRow = 4 * sizeof(unsigned char) * texWidth;
-
-				// Create Texture
-				D3D11_TEXTURE2D_DESC textureDesc;
-				ZeroMemory(&textureDesc, sizeof(D3D11_TEXTURE2D_DESC));
-				textureDesc.Width = texWidth;
-				textureDesc.Height = texHeight;
-				textureDesc.MipLevels = 1;
-				textureDesc.ArraySize = 1;
-				//textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-				textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				textureDesc.SampleDesc.Count = 1;
-				textureDesc.SampleDesc.Quality = 0;
-				textureDesc.Usage = D3D11_USAGE_DYNAMIC;
-				textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-				textureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-
-				D3D11_SUBRESOURCE_DATA textureSubresource;
-				ZeroMemory(&textureSubresource, sizeof(D3D11_SUBRESOURCE_DATA));
-				textureSubresource.pSysMem = textureBytes;
-				textureSubresource.SysMemPitch = texBytesPerRow;
-				result = renderer.GetDevice()->CreateTexture2D(&textureDesc, &textureSubresource, &m_texture);
-				//assert(SUCCEEDED(result));
-
-				D3D11_SHADER_RESOURCE_VIEW_DESC shaderResource;
-				ZeroMemory(&shaderResource, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
-				shaderResource.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				shaderResource.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-				shaderResource.Texture2D.MipLevels = 1;
-				result = renderer.GetDevice()->CreateShaderResourceView(m_texture, &shaderResource, &m_textureView);
-				//assert(SUCCEEDED(result));
-
-				free(textureBytes); // Free Image
-			}
-			return Texture(m_id, m_type, m_texFilePath, m_samplerState, m_texture, m_textureView);
+			m_materialId = nextMaterialId++;
+			m_sampler = sampler;
+			if (renderer.IsSoftware() && data.IsValid())
+			{
+				// Software Texture // Every mip level expanded to RGBA8, block compressed levels are decoded on the CPU.
+				CookedTextureFormat format = COOKED_RGBA8;
+				for (int f = 0; f < COOKED_FORMAT_MAX; ++f)
+				{
+					if (cookedFormats[f] == data.m_format)
+						format = (CookedTextureFormat)f;
+				}
+				SoftwareTexture* software = new SoftwareTexture();
+				software->m_levels.resize(data.m_mips.size() / data.m_arraySize); // First slice only.
+				TextureImage image;
+				for (size_t level = 0; level < software->m_levels.size(); ++level)
+				{
+					int width = std::max(data.m_width >> level, 1), height = std::max(data.m_height >> level, 1);
+					DecompressImage((const uint8_t*)data.m_mips[level].m_data, format, width, height, image);
+					SoftwareTexture::Level& l = software->m_levels[level];
+					l.m_width = width;
+					l.m_height = height;
+					l.m_texels.resize((size_t)width * height);
+					memcpy(l.m_texels.data(), image.m_pixels.data(), l.m_texels.size() * sizeof(uint32_t));
+				}
+				m_softwareTexture = software;
+			}
+			// Create Texture // Immutable, every mip level is known up front.
+			if (data.IsValid())
+			{
+				RHI::TextureDesc textureDesc;
+				textureDesc.m_width = data.m_width;
+				textureDesc.m_height = data.m_height;
+				textureDesc.m_mipCount = (uint32_t)data.m_mips.size() / data.m_arraySize;
+				textureDesc.m_arraySize = data.m_arraySize;
+				textureDesc.m_format = data.m_format;
+				textureDesc.m_name = filePath;
+				m_texture = renderer.GetRHI()->CreateTexture(textureDesc, data.m_mips.data());
+			}
+			data.Release();
+			Texture texture(m_id, m_type, m_texFilePath, m_sampler, m_texture, m_materialId);
+			texture.m_softwareTexture = m_softwareTexture;
+			return texture;
 		}
-		void Texture::Use(Renderer& renderer, unsigned int id)
+
+		void Mesh::ComputeBounds()
 		{
-			renderer.GetDeviceContext()->PSSetShaderResources(0, 1, &m_textureView);
-			renderer.GetDeviceContext()->PSSetSamplers(0, 1, &m_samplerState);
+			// Positions lead every vertex layout, cooked or imported.
+			const uint8_t* vertices = m_vertexData ? (const uint8_t*)m_vertexData : (const uint8_t*)m_vertices.data();
+			m_bounds = Math::BoundingBox();
+			for (UINT i = 0; i < m_vertexCount; ++i)
+			{
+				const float* p = (const float*)(vertices + (size_t)i * m_stride);
+				m_bounds.Extend(Math::Vector3F(p[0], p[1], p[2]));
+			}
+			// Sphere around the box centre, tighter than the box's own bounding sphere.
+			m_sphere.center = m_bounds.GetCenter();
+			float radiusSqr = 0.0f;
+			for (UINT i = 0; i < m_vertexCount; ++i)
+			{
+				const float* p = (const float*)(vertices + (size_t)i * m_stride);
+				radiusSqr = fmaxf(radiusSqr, (Math::Vector3F(p[0], p[1], p[2]) - m_sphere.center).MagnitudeSqr());
+			}
+			m_sphere.radius = sqrtf(radiusSqr);
 		}
-
-		void Mesh::Setup(Renderer& renderer, LPCWSTR shaderPath)
+		void Mesh::Setup(Renderer& renderer, const ShaderBlobs& shaderBlobs)
 		{
-			m_shader.Setup(renderer, shaderPath);
-			// Mesh Data
+			static unsigned int nextId = 1;
+			m_id = nextId++;
+			m_shader.Create(renderer, shaderBlobs);
+			// Mesh Data // Immutable, on every backend so the recording device sees the same resources.
 			{
-				D3D11_BUFFER_DESC vertexBufferDesc;
-				ZeroMemory(&vertexBufferDesc, sizeof(D3D11_BUFFER_DESC));
-				vertexBufferDesc.ByteWidth = m_vertexCount * sizeof(TexVertex3D);
-				vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-				vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-
-				D3D11_SUBRESOURCE_DATA vertexData;
-				ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
-				vertexData.pSysMem = &m_vertices[0];
-
-				HRESULT result = renderer.GetDevice()->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer);
-				assert(SUCCEEDED(result));
+				RHI::BufferDesc vertexBufferDesc;
+				vertexBufferDesc.m_size = m_vertexCount * sizeof(TexVertex3D);
+				vertexBufferDesc.m_usage = RHI::BUFFER_VERTEX;
+				vertexBufferDesc.m_name = "Mesh Vertices";
+				m_vertexBuffer = renderer.GetRHI()->CreateBuffer(vertexBufferDesc, m_vertexData ? m_vertexData : m_vertices.data());
+				assert(m_vertexBuffer.IsValid());
 
-				D3D11_BUFFER_DESC indexBufferDesc;
-				ZeroMemory(&indexBufferDesc, sizeof(D3D11_BUFFER_DESC));
-				indexBufferDesc.ByteWidth = m_indexCount * sizeof(uint16_t);
-				indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-				indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-
-				D3D11_SUBRESOURCE_DATA indexData;
-				ZeroMemory(&indexData, sizeof(D3D11_SUBRESOURCE_DATA));
-				indexData.pSysMem = &m_indices[0];
+				RHI::BufferDesc indexBufferDesc;
+				indexBufferDesc.m_size = GetBufferIndexCount() * m_indexSize;
+				indexBufferDesc.m_usage = RHI::BUFFER_INDEX;
+				indexBufferDesc.m_name = "Mesh Indices";
+				const void* indexData;
+				std::vector<uint16_t> packed;
+				if (m_indexData)
+					indexData = m_indexData;
+				else if (m_indexSize == sizeof(uint16_t))
+				{
+					packed.resize(m_indices.size());
+					PackIndices(packed.data(), m_indices.data(), m_indices.size(), m_indexSize);
+					indexData = packed.data();
+				}
+				else
+					indexData = m_indices.data();
 
-				result = renderer.GetDevice()->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
-				assert(SUCCEEDED(result));
+				m_indexBuffer = renderer.GetRHI()->CreateBuffer(indexBufferDesc, indexData);
+				assert(m_indexBuffer.IsValid());
 			}
 		}
-		void Mesh::Draw(Renderer& renderer)
-		{
-			renderer.GetDeviceContext()->IASetVertexBuffers(0, 1, &m_vertexBuffer, &m_stride, &m_offset);
-			renderer.GetDeviceContext()->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
-			renderer.GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			renderer.GetDeviceContext()->DrawIndexed(m_indexCount, 0, 0);
-		}
-		void Mesh::Destroy()
+		void Mesh::Destroy(Renderer& renderer)
 		{
-			m_vertexBuffer->Release();
-			m_indexBuffer->Release();
-			m_shader.Destroy();
+			// The device releases them once the frames drawing them are done, or already did when it went first.
+			if (!renderer.GetRHI())
+				return;
+			renderer.GetRHI()->Destroy(m_vertexBuffer);
+			renderer.GetRHI()->Destroy(m_indexBuffer);
+			m_vertexBuffer = RHI::BufferHandle();
+			m_indexBuffer = RHI::BufferHandle();
 		}
 	}
 }
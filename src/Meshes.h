@@ -4,6 +4,13 @@
 #include "Math.h"
 #include "Renderer.h"
 #include "Camera.h"
+#include "Assets.h"
+#include "MappedFile.h"
+#include "CookedTexture.h"
+#include "TextureAtlas.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Culling.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -11,6 +18,8 @@
 
 #include <vector>
 #include <map>
+#include <string>
+#include <unordered_map>
 
 namespace Renderer
 {
@@ -50,48 +59,124 @@ namespace Renderer
 			};
 		};
 
+		// Decoded mip chain, produced off the main thread.
+		struct TextureData
+		{
+			int m_width = 0;
+			int m_height = 0;
+			uint32_t m_arraySize = 1;
+			RHI::Format m_format = RHI::FORMAT_RGBA8;
+			std::vector<RHI::SubresourceData> m_mips; // Point into m_images or m_file, slice by slice.
+			std::vector<TextureImage> m_images; // Mips generated at load time from a source image.
+			std::unique_ptr<MappedFile> m_file; // Cooked textures upload straight from the mapping.
+			size_t m_bytes = 0;
+
+			bool IsValid() { return !m_mips.empty(); }
+			void Release();
+		};
 		struct Texture
 		{
 			unsigned int m_id;
 			const char* m_type;
 			const char* m_texFilePath;
 
-			ID3D11SamplerState* m_samplerState;
-			ID3D11Texture2D* m_texture;
-			ID3D11ShaderResourceView* m_textureView;
+			RHI::SamplerHandle m_sampler; // Shared, owned by the texture cache.
+			RHI::TextureHandle m_texture;
+			unsigned int m_materialId = 0; // Render queue sort id.
+			int m_cacheEntry = -1; // TextureCache entry holding the GPU resources.
+			const SoftwareTexture* m_softwareTexture = nullptr; // Decoded copy for the software backend, owned by the texture cache.
 
-			Texture LoadTexture(Renderer& renderer, const char* filePath);
+			static bool Decode(const char* filePath, TextureData& data);
+			static RHI::SamplerDesc DefaultSampler();
+			Texture Upload(Renderer& renderer, const char* filePath, TextureData& data, RHI::SamplerHandle sampler);
+		};
+		// Compiled bytecode, produced off the main thread.
+		struct ShaderBlobs
+		{
+			ID3DBlob* m_vertexBlob = nullptr;
+			ID3DBlob* m_pixelBlob = nullptr;
+			bool m_instanced = false; // Vertex shader reads its transform from the instance stream.
 
-			void Use(Renderer& renderer, unsigned int id);
+			void Release();
 		};
 		struct Shader
 		{
-			ID3D11VertexShader* m_vertexShader;
-			ID3D11PixelShader* m_pixelShader;
-			ID3D11InputLayout* m_inputLayout;
+			RHI::PipelineHandle m_pipeline; // Shared, owned by the shader library.
+			unsigned int m_id = 0; // Render queue sort id.
+			bool m_instanced = false;
 
+			static bool Compile(LPCWSTR sPath, ShaderBlobs& blobs, bool instanced = false);
+			void Create(Renderer& renderer, const ShaderBlobs& blobs);
 			void Setup(Renderer& renderer, LPCWSTR sPath);
-			void Use(Renderer& renderer);
-			void Destroy();
 		};
 		struct Mesh
 		{
 			std::vector<TexVertex3D> m_vertices;
-			std::vector<uint16_t> m_indices;
+			std::vector<uint32_t> m_indices; // Full width on the CPU, narrowed to m_indexSize at upload.
+			std::vector<Meshlet> m_meshlets; // Empty when the mesh fits in one.
+			std::vector<MeshLod> m_lods; // Coarser levels, their indices follow the full detail ones.
 			Shader m_shader;
 
+			// Upload Source // Points into a cooked file mapping, falls back to m_vertices/m_indices when null.
+			const void* m_vertexData = nullptr;
+			const void* m_indexData = nullptr;
+
 			UINT m_vertexCount;
-			UINT m_indexCount;
+			UINT m_indexCount; // Full detail.
+			UINT m_indexSize = sizeof(uint16_t); // Chosen per mesh from the vertex count.
 			UINT m_stride;
 			UINT m_offset;
 			aiMesh* m_mesh;
 
-			ID3D11Buffer* m_vertexBuffer;
-			ID3D11Buffer* m_indexBuffer;	
+			RHI::BufferHandle m_vertexBuffer;
+			RHI::BufferHandle m_indexBuffer;
+			unsigned int m_id = 0; // Render queue batching id.
 
-			void Setup(Renderer& renderer, LPCWSTR shaderPath);
-			void Draw(Renderer& renderer);
-			void Destroy();
+			// Local space, computed at import.
+			Math::BoundingBox m_bounds;
+			Math::BoundingSphere m_sphere;
+
+			RHI::Format GetIndexFormat() const { return (m_indexSize == sizeof(uint32_t)) ? RHI::FORMAT_R32_UINT : RHI::FORMAT_R16_UINT; }
+			UINT GetBufferIndexCount() const { return m_lods.empty() ? m_indexCount : m_lods.back().m_firstIndex + m_lods.back().m_indexCount; }
+			void ComputeBounds();
+			void Setup(Renderer& renderer, const ShaderBlobs& shaderBlobs);
+			void Destroy(Renderer& renderer);
+		};
+
+		// CPU side of a model // Filled by MeshRenderer::Import on any thread, consumed by MeshRenderer::Upload.
+		struct ModelData
+		{
+			std::vector<Mesh> m_meshes;
+			std::vector<std::string> m_texturePaths; // One per mesh, empty when untextured.
+			std::unique_ptr<MappedFile> m_file; // Cooked meshes upload straight from the mapping.
+			ShaderBlobs m_shaderBlobs;
+			bool m_cooked = false;
+			bool m_optimize = MESH_OPTIMIZE; // Assimp imports only, cooked meshes were optimized when cooked.
+			std::vector<MeshOptimizationReport> m_optimization; // One per optimized mesh.
+			bool m_packTextures = TEXTURE_ATLAS;
+			TextureAtlas m_atlas; // Pages of the textures packed at import, their paths are cleared.
+			std::vector<int> m_atlasPages; // One per mesh, its page or -1. Empty when nothing was packed.
+
+			~ModelData() { m_shaderBlobs.Release(); }
+		};
+		// Shared Model // Loaded once per model and shader, every MeshRenderer drawing it shares the meshes, textures and GPU buffers.
+		struct Model
+		{
+			std::vector<Mesh> m_meshes;
+			std::vector<Texture> m_textures; // One per mesh, filled in as they stream.
+			std::vector<uint32_t> m_materials; // One per mesh, material library ids. Untextured until the texture streams in.
+			std::vector<std::string> m_texturePaths;
+			std::vector<Texture> m_atlasTextures; // One per atlas page, slices of one array texture owned by the model.
+			std::vector<int> m_atlasPages; // One per mesh, its atlas page or -1 when it has a texture of its own.
+			Math::BoundingBox m_bounds; // Every mesh, local space.
+			Math::BoundingSphere m_sphere;
+			std::vector<float> m_lodErrors; // Per level, the largest of its meshes. Empty when no mesh has levels.
+			Assets::AssetHandle m_handle = Assets::InvalidAsset;
+			bool m_loaded = false;
+			bool m_instanced = false; // Drawn through the render queue's instanced path.
+			Renderer* m_renderer = nullptr; // Owns the mesh buffers, set at upload.
+
+			~Model();
 		};
 
 		class MeshRenderer
@@ -104,27 +189,35 @@ namespace Renderer
 			void Destroy();
 
 			void LoadModel(const char* filePath, const wchar_t* shaderPath = L"./res/shaders/modelShader.hlsl");
+			Assets::AssetHandle LoadModelAsync(const char* filePath, const wchar_t* shaderPath = L"./res/shaders/modelShader.hlsl", Assets::AssetPriority priority = Assets::PRIORITY_NORMAL);
+			static bool Import(const char* filePath, const wchar_t* shaderPath, ModelData& data);
 
 			void Draw(Math::Matrix4F& modelMat, Camera& camera);
 
 			const char* GetModelPath() { return m_modelFilePath; }
+			bool IsLoaded() { return m_model && m_model->m_loaded; }
+			const Math::BoundingBox& GetBounds() { return m_model->m_bounds; }
+			bool IsInstanced() { return m_model && m_model->m_instanced; }
+			size_t GetMeshCount() { return m_model ? m_model->m_meshes.size() : 0; }
+			int GetMeshLod(size_t mesh);
+			static size_t GetSharedModelCount();
 
 		private:
-			Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene);
-			void ProcessNode(aiNode* node, const aiScene* scene);
+			static Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene, ModelData& data);
+			static void ProcessNode(aiNode* node, const aiScene* scene, ModelData& data);
+			static void PackTextures(const char* filePath, ModelData& data);
+			static bool ImportCooked(const char* filePath, ModelData& data);
+			static std::shared_ptr<Model> FindModel(const char* filePath, const wchar_t* shaderPath, bool& created);
+			static void Upload(Renderer& renderer, const std::shared_ptr<Model>& model, ModelData& data, bool streamTextures);
 
 		private:
-			Renderer m_renderer;
+			Renderer* m_renderer;
 
-			std::vector<Texture> m_textures;
-			std::vector<Texture> m_loadedTextures;
-			UINT m_textureCount = 0;
-
-			std::vector<Mesh> m_meshes;
-			UINT m_meshCount = 0;
+			std::shared_ptr<Model> m_model;
 			const char* m_modelFilePath;
 
-			ID3D11Buffer* m_constantBuffer;
+			int m_lod = 0; // Per object, kept for the selection hysteresis.
+			std::vector<IndexRange> m_meshletRanges; // Scratch, kept so culling stops allocating once grown.
 		};
 	}
 }
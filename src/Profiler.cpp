@@ -0,0 +1,417 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Profiling
+{
+	thread_local ThreadBuffer* FrameProfiler::s_threadBuffer = nullptr;
+
+	void FrameProfiler::Create()
+	{
+		m_frames.assign(PROFILER_HISTORY, ProfileFrame());
+		m_frameCount = 0;
+		m_epoch = Now();
+		m_frameBegin = m_epoch;
+		SetThreadName("Main");
+	}
+	void FrameProfiler::Destroy()
+	{
+		// Thread buffers stay allocated, live threads still point at theirs.
+		ProfileFrame discard;
+		Collect(discard);
+		m_frames.clear();
+		m_scratch = ProfileFrame();
+		m_frameCount = 0;
+	}
+
+	ThreadBuffer* FrameProfiler::RegisterThread()
+	{
+		std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(m_threadLock);
+		buffer->m_index = (uint32_t)m_threads.size();
+		buffer->m_name = "Thread " + std::to_string(buffer->m_index);
+		s_threadBuffer = buffer.get();
+		m_threads.push_back(std::move(buffer));
+		return s_threadBuffer;
+	}
+	void FrameProfiler::SetThreadName(const char* name)
+	{
+		ThreadBuffer* buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(m_threadLock);
+		buffer->m_name = name;
+	}
+	std::string FrameProfiler::GetThreadName(uint32_t thread)
+	{
+		std::lock_guard<std::mutex> lock(m_threadLock);
+		return (thread < m_threads.size()) ? m_threads[thread]->m_name : std::string("Unknown");
+	}
+
+	void FrameProfiler::BeginFrame()
+	{
+		m_frameBegin = Now();
+	}
+	void FrameProfiler::EndFrame()
+	{
+		if (m_frames.empty())
+			return;
+		// Paused frames are still drained so the rings never fill, just not kept.
+		ProfileFrame& frame = m_paused ? m_scratch : m_frames[m_frameCount % m_frames.size()];
+		frame.m_index = m_frameCount;
+		frame.m_begin = m_frameBegin;
+		frame.m_end = Now();
+		Collect(frame);
+		BuildHierarchy(frame);
+		if (!m_paused)
+			m_frameCount++;
+	}
+	const ProfileFrame* FrameProfiler::GetFrame(int age) const
+	{
+		if (age < 0 || age >= GetFrameCount())
+			return nullptr;
+		return &m_frames[(m_frameCount - 1 - age) % m_frames.size()];
+	}
+
+	void FrameProfiler::Collect(ProfileFrame& frame)
+	{
+		// Vectors are cleared, not freed, a steady frame does not allocate.
+		frame.m_events.clear();
+		frame.m_dropped = 0;
+		std::lock_guard<std::mutex> lock(m_threadLock);
+		for (auto& t : m_threads)
+		{
+			uint64_t head = t->m_head.load(std::memory_order_acquire);
+			uint64_t tail = t->m_tail.load(std::memory_order_relaxed);
+			for (; tail != head; ++tail)
+				frame.m_events.push_back(t->m_events[tail & (PROFILER_EVENT_CAPACITY - 1)]);
+			t->m_tail.store(tail, std::memory_order_release);
+			frame.m_dropped += t->m_dropped.exchange(0, std::memory_order_relaxed);
+		}
+	}
+	void FrameProfiler::BuildHierarchy(ProfileFrame& frame)
+	{
+		// Parents open first, a child sharing its parent's start sorts after it by depth.
+		std::sort(frame.m_events.begin(), frame.m_events.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+		{
+			if (a.m_thread != b.m_thread)
+				return a.m_thread < b.m_thread;
+			if (a.m_begin != b.m_begin)
+				return a.m_begin < b.m_begin;
+			return a.m_depth < b.m_depth;
+		});
+
+		frame.m_nodes.clear();
+		frame.m_roots.clear();
+		std::vector<OpenScope>& stack = m_stack;
+		stack.clear();
+		for (const ProfileEvent& e : frame.m_events)
+		{
+			// Scopes whose parent closes in a later frame become roots.
+			while (!stack.empty() && (stack.back().m_event->m_thread != e.m_thread || stack.back().m_event->m_depth >= e.m_depth || stack.back().m_event->m_end < e.m_end))
+				stack.pop_back();
+			int parent = stack.empty() ? -1 : stack.back().m_node;
+
+			// Merge with a sibling of the same name.
+			int node = -1;
+			if (parent < 0)
+			{
+				for (int s : frame.m_roots)
+				{
+					const ProfileNode& n = frame.m_nodes[s];
+					if (n.m_thread == e.m_thread && (n.m_name == e.m_name || strcmp(n.m_name, e.m_name) == 0))
+					{
+						node = s;
+						break;
+					}
+				}
+			}
+			else
+			{
+				for (int s = frame.m_nodes[parent].m_firstChild; s >= 0; s = frame.m_nodes[s].m_nextSibling)
+				{
+					if (frame.m_nodes[s].m_name == e.m_name || strcmp(frame.m_nodes[s].m_name, e.m_name) == 0)
+					{
+						node = s;
+						break;
+					}
+				}
+			}
+			if (node < 0)
+			{
+				node = (int)frame.m_nodes.size();
+				ProfileNode n;
+				n.m_name = e.m_name;
+				n.m_thread = e.m_thread;
+				n.m_parent = parent;
+				frame.m_nodes.push_back(n);
+				if (parent < 0)
+					frame.m_roots.push_back(node);
+				else
+				{
+					ProfileNode& p = frame.m_nodes[parent];
+					if (p.m_lastChild >= 0)
+						frame.m_nodes[p.m_lastChild].m_nextSibling = node;
+					else
+						p.m_firstChild = node;
+					p.m_lastChild = node;
+				}
+			}
+			frame.m_nodes[node].m_totalNs += e.m_end - e.m_begin;
+			frame.m_nodes[node].m_calls++;
+			stack.push_back({ &e, node });
+		}
+
+		for (ProfileNode& n : frame.m_nodes)
+		{
+			uint64_t children = 0;
+			for (int c = n.m_firstChild; c >= 0; c = frame.m_nodes[c].m_nextSibling)
+				children += frame.m_nodes[c].m_totalNs;
+			n.m_selfNs = (n.m_totalNs > children) ? n.m_totalNs - children : 0;
+		}
+	}
+
+	static void WriteJsonString(FILE* f, const char* s)
+	{
+		fputc('"', f);
+		for (; *s; ++s)
+		{
+			if (*s == '"' || *s == '\\')
+				fputc('\\', f);
+			if ((unsigned char)*s >= 0x20)
+				fputc(*s, f);
+		}
+		fputc('"', f);
+	}
+	bool FrameProfiler::ExportChromeTrace(const char* filePath)
+	{
+		FILE* f = fopen(filePath, "w");
+		if (!f)
+			return false;
+		fprintf(f, "{\"traceEvents\":[\n");
+		bool first = true;
+		{
+			std::lock_guard<std::mutex> lock(m_threadLock);
+			for (const auto& t : m_threads)
+			{
+				fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", t->m_index);
+				WriteJsonString(f, t->m_name.c_str());
+				fprintf(f, "}}");
+				first = false;
+			}
+		}
+		// Oldest frame first, microseconds since Create.
+		for (int age = GetFrameCount() - 1; age >= 0; --age)
+		{
+			const ProfileFrame& frame = *GetFrame(age);
+			fprintf(f, "%s{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":0}", first ? "" : ",\n",
+				(unsigned long long)frame.m_index, (double)(int64_t)(frame.m_begin - m_epoch) / 1000.0, (frame.m_end - frame.m_begin) / 1000.0);
+			first = false;
+			for (const ProfileEvent& e : frame.m_events)
+			{
+				fprintf(f, ",\n{\"name\":");
+				WriteJsonString(f, e.m_name);
+				fprintf(f, ",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+					(double)(int64_t)(e.m_begin - m_epoch) / 1000.0, (e.m_end - e.m_begin) / 1000.0, e.m_thread);
+			}
+		}
+		fprintf(f, "\n]}\n");
+		bool written = !ferror(f);
+		fclose(f);
+		return written;
+	}
+
+	static ImU32 GetScopeColor(const char* name)
+	{
+		// FNV-1a of the name, stable across frames and runs.
+		uint32_t hash = 2166136261u;
+		for (; *name; ++name)
+			hash = (hash ^ (uint8_t)*name) * 16777619u;
+		return ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.75f);
+	}
+
+	void FrameProfiler::DrawImGui(bool* open)
+	{
+		ImGui::SetNextWindowSize(ImVec2(640, 480), ImGuiCond_FirstUseEver);
+		if (!ImGui::Begin("Profiler", open))
+		{
+			ImGui::End();
+			return;
+		}
+		int count = GetFrameCount();
+		if (count == 0)
+		{
+			ImGui::Text("No frames recorded.");
+			ImGui::End();
+			return;
+		}
+		m_selectedAge = std::min(m_selectedAge, count - 1);
+
+		// Frame History // Oldest on the left, click a bar to inspect that frame.
+		float times[PROFILER_HISTORY];
+		for (int i = 0; i < count; ++i)
+			times[i] = (float)GetFrame(count - 1 - i)->GetMs();
+		ImGui::PlotHistogram("##History", times, count, 0, nullptr, 0.0f, FLT_MAX, ImVec2(-1, 60));
+		if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(0))
+		{
+			float t = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x) / ImGui::GetItemRectSize().x;
+			m_selectedAge = count - 1 - std::clamp((int)(t * count), 0, count - 1);
+		}
+		ImGui::Checkbox("Pause", &m_paused);
+		ImGui::SameLine();
+		ImGui::SliderInt("Age", &m_selectedAge, 0, count - 1);
+		ImGui::SameLine();
+		if (ImGui::Button("Export Trace"))
+			m_exportStatus = ExportChromeTrace(PROFILER_TRACE_PATH) ? "Saved " PROFILER_TRACE_PATH : "Failed to write " PROFILER_TRACE_PATH;
+		if (!m_exportStatus.empty())
+			ImGui::Text("%s", m_exportStatus.c_str());
+
+		const ProfileFrame& frame = *GetFrame(m_selectedAge);
+		ImGui::Text("Frame %llu: %.3f ms, %zu scopes, %u dropped", (unsigned long long)frame.m_index, frame.GetMs(), frame.m_events.size(), frame.m_dropped);
+		if (ImGui::CollapsingHeader("Timeline", ImGuiTreeNodeFlags_DefaultOpen))
+			DrawTimeline(frame);
+		if (ImGui::CollapsingHeader("Hierarchy", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			uint32_t thread = UINT32_MAX;
+			bool threadOpen = false;
+			for (int root : frame.m_roots)
+			{
+				const ProfileNode& n = frame.m_nodes[root];
+				if (n.m_thread != thread)
+				{
+					if (threadOpen)
+						ImGui::TreePop();
+					thread = n.m_thread;
+					threadOpen = ImGui::TreeNodeEx((void*)(intptr_t)thread, ImGuiTreeNodeFlags_DefaultOpen, "%s", GetThreadName(thread).c_str());
+				}
+				if (threadOpen)
+					DrawNode(frame, root);
+			}
+			if (threadOpen)
+				ImGui::TreePop();
+		}
+		ImGui::End();
+	}
+	void FrameProfiler::DrawTimeline(const ProfileFrame& frame)
+	{
+		// Flame Graph // One band per thread, one row per depth, scaled to the frame.
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+		float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+		double scale = width / (double)std::max<uint64_t>(frame.m_end - frame.m_begin, 1);
+		ImVec2 mouse = ImGui::GetIO().MousePos;
+		float y = origin.y;
+
+		size_t i = 0;
+		while (i < frame.m_events.size())
+		{
+			uint32_t thread = frame.m_events[i].m_thread;
+			size_t end = i;
+			uint32_t maxDepth = 0;
+			while (end < frame.m_events.size() && frame.m_events[end].m_thread == thread)
+				maxDepth = std::max(maxDepth, frame.m_events[end++].m_depth);
+
+			drawList->AddText(ImVec2(origin.x, y), ImGui::GetColorU32(ImGuiCol_TextDisabled), GetThreadName(thread).c_str());
+			y += rowHeight;
+			drawList->PushClipRect(ImVec2(origin.x, y), ImVec2(origin.x + width, y + (maxDepth + 1) * rowHeight), true);
+			for (; i < end; ++i)
+			{
+				const ProfileEvent& e = frame.m_events[i];
+				float x0 = origin.x + (float)((int64_t)(e.m_begin - frame.m_begin) * scale);
+				float x1 = origin.x + (float)((int64_t)(e.m_end - frame.m_begin) * scale);
+				x0 = std::max(x0, origin.x);
+				x1 = std::max(std::min(x1, origin.x + width), x0 + 1.0f);
+				float y0 = y + e.m_depth * rowHeight;
+				float y1 = y0 + rowHeight - 1.0f;
+				drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), GetScopeColor(e.m_name));
+				if (x1 - x0 > 30.0f)
+				{
+					drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+					drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(0, 0, 0, 255), e.m_name);
+					drawList->PopClipRect();
+				}
+				if (ImGui::IsWindowHovered() && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+					ImGui::SetTooltip("%s\n%.3f ms", e.m_name, (e.m_end - e.m_begin) / 1000000.0);
+			}
+			drawList->PopClipRect();
+			y += (maxDepth + 1) * rowHeight;
+		}
+		ImGui::Dummy(ImVec2(width, y - origin.y));
+	}
+	void FrameProfiler::DrawNode(const ProfileFrame& frame, int node)
+	{
+		const ProfileNode& n = frame.m_nodes[node];
+		double frameNs = (double)std::max<uint64_t>(frame.m_end - frame.m_begin, 1);
+		ImGuiTreeNodeFlags flags = (n.m_firstChild < 0) ? (ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen) : ImGuiTreeNodeFlags_DefaultOpen;
+		bool open = ImGui::TreeNodeEx((void*)(intptr_t)node, flags, "%s: %.3f ms (%.1f%%), self %.3f ms, x%u",
+			n.m_name, n.m_totalNs / 1000000.0, 100.0 * n.m_totalNs / frameNs, n.m_selfNs / 1000000.0, n.m_calls);
+		if (!open || n.m_firstChild < 0)
+			return;
+		for (int c = n.m_firstChild; c >= 0; c = frame.m_nodes[c].m_nextSibling)
+			DrawNode(frame, c);
+		ImGui::TreePop();
+	}
+
+	static volatile uint64_t s_benchmarkSink = 0;
+	template<typename Body>
+	static double TimeMarkers(int iterations, int eventsPerIteration, Body body, double* collectNs = nullptr)
+	{
+		// Batches fit in the ring, collection is timed apart from the markers.
+		int batch = std::max(PROFILER_EVENT_CAPACITY / 2 / eventsPerIteration, 1);
+		uint64_t total = 0;
+		for (int done = 0; done < iterations; done += batch)
+		{
+			int n = std::min(batch, iterations - done);
+			Profiler.BeginFrame();
+			uint64_t start = Now();
+			for (int i = 0; i < n; ++i)
+				body(i);
+			total += Now() - start;
+			start = Now();
+			Profiler.EndFrame();
+			if (collectNs)
+				*collectNs += (double)(Now() - start);
+		}
+		return (double)total / iterations;
+	}
+	ProfilerBenchmarkReport RunProfilerBenchmark(int markers)
+	{
+		ProfilerBenchmarkReport report;
+		report.m_markers = markers;
+		if (markers <= 0)
+			return report;
+		bool enabled = Profiler.IsEnabled();
+		Profiler.SetPaused(true);
+		Profiler.EndFrame(); // Drop anything already recorded.
+
+		report.m_loopNs = TimeMarkers(markers, 1, [](int i) { s_benchmarkSink = s_benchmarkSink + i; });
+		double collectNs = 0.0;
+		Profiler.SetEnabled(true);
+		report.m_markerNs = TimeMarkers(markers, 1, [](int i)
+		{
+			Profiling::ScopedMarker marker("Benchmark");
+			s_benchmarkSink = s_benchmarkSink + i;
+		}, &collectNs) - report.m_loopNs;
+		report.m_collectNs = collectNs / markers;
+		report.m_nestedNs = (TimeMarkers(markers / 4, 4, [](int i)
+		{
+			Profiling::ScopedMarker a("Benchmark A");
+			Profiling::ScopedMarker b("Benchmark B");
+			Profiling::ScopedMarker c("Benchmark C");
+			Profiling::ScopedMarker d("Benchmark D");
+			s_benchmarkSink = s_benchmarkSink + i;
+		}) - report.m_loopNs) / 4.0;
+		Profiler.SetEnabled(false);
+		report.m_disabledNs = TimeMarkers(markers, 1, [](int i)
+		{
+			Profiling::ScopedMarker marker("Benchmark");
+			s_benchmarkSink = s_benchmarkSink + i;
+		}) - report.m_loopNs;
+
+		Profiler.SetEnabled(enabled);
+		Profiler.SetPaused(false);
+		return report;
+	}
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#define Profiler (Profiling::FrameProfiler::Instance())
+
+// Markers // Names must outlive the profiler, string literals or __FUNCTION__.
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+#if PROFILER_ENABLED
+#define PROFILE_SCOPE(name) Profiling::ScopedMarker PROFILE_JOIN(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+
+namespace Profiling
+{
+	static_assert((PROFILER_EVENT_CAPACITY & (PROFILER_EVENT_CAPACITY - 1)) == 0, "PROFILER_EVENT_CAPACITY must be a power of two.");
+
+	// Nanoseconds since an arbitrary epoch.
+	inline uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// One closed scope, written once when the scope ends.
+	struct ProfileEvent
+	{
+		const char* m_name;
+		uint64_t m_begin;
+		uint64_t m_end;
+		uint32_t m_depth;
+		uint32_t m_thread; // Index into the profiler's thread list.
+	};
+
+	// Thread Buffer // Single producer ring, the owning thread writes at the head and the main thread drains from the tail.
+	// Events are dropped rather than blocking when the collector falls behind.
+	struct ThreadBuffer
+	{
+		std::atomic<uint64_t> m_head = 0;
+		std::atomic<uint64_t> m_tail = 0;
+		std::atomic<uint32_t> m_dropped = 0;
+		uint32_t m_depth = 0; // Owner only.
+		uint32_t m_index = 0;
+		std::string m_name;
+		ProfileEvent m_events[PROFILER_EVENT_CAPACITY];
+
+		void Push(const ProfileEvent& e)
+		{
+			uint64_t head = m_head.load(std::memory_order_relaxed);
+			if (head - m_tail.load(std::memory_order_acquire) >= PROFILER_EVENT_CAPACITY)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			m_events[head & (PROFILER_EVENT_CAPACITY - 1)] = e;
+			m_head.store(head + 1, std::memory_order_release);
+		}
+	};
+
+	// Aggregated Hierarchy // Scopes with the same name under the same parent merged into one node.
+	struct ProfileNode
+	{
+		const char* m_name = nullptr;
+		uint64_t m_totalNs = 0;
+		uint64_t m_selfNs = 0; // Total minus children.
+		uint32_t m_calls = 0;
+		uint32_t m_thread = 0;
+		int m_parent = -1;
+		// Children are linked through the node array, rebuilding a frame allocates nothing once it has grown.
+		int m_firstChild = -1;
+		int m_lastChild = -1;
+		int m_nextSibling = -1;
+	};
+
+	struct ProfileFrame
+	{
+		uint64_t m_index = 0;
+		uint64_t m_begin = 0;
+		uint64_t m_end = 0;
+		uint32_t m_dropped = 0;
+		std::vector<ProfileEvent> m_events; // Sorted by thread, then begin.
+		std::vector<ProfileNode> m_nodes;
+		std::vector<int> m_roots; // One list for every thread, in thread order.
+
+		double GetMs() const { return (m_end - m_begin) / 1000000.0; }
+	};
+
+	class FrameProfiler
+	{
+	public:
+		void Create();
+		void Destroy();
+
+		// Main thread // Frame boundaries, EndFrame collects every thread's events and builds the hierarchy.
+		void BeginFrame();
+		void EndFrame();
+
+		void SetThreadName(const char* name);
+		void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+		bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+		void SetPaused(bool paused) { m_paused = paused; }
+
+		// Newest first, 0 is the last completed frame. Null while the history is empty.
+		const ProfileFrame* GetFrame(int age) const;
+		int GetFrameCount() const { return (int)(m_frameCount < m_frames.size() ? m_frameCount : m_frames.size()); }
+		std::string GetThreadName(uint32_t thread);
+
+		// Chrome Trace // chrome://tracing or ui.perfetto.dev, every frame in the history.
+		bool ExportChromeTrace(const char* filePath);
+		void DrawImGui(bool* open);
+
+		static ThreadBuffer* GetThreadBuffer() { return s_threadBuffer ? s_threadBuffer : Instance().RegisterThread(); }
+
+	private:
+		ThreadBuffer* RegisterThread();
+		void Collect(ProfileFrame& frame);
+		void BuildHierarchy(ProfileFrame& frame);
+		void DrawTimeline(const ProfileFrame& frame);
+		void DrawNode(const ProfileFrame& frame, int node);
+
+		struct OpenScope
+		{
+			const ProfileEvent* m_event;
+			int m_node;
+		};
+
+	private:
+		static thread_local ThreadBuffer* s_threadBuffer;
+
+		std::atomic<bool> m_enabled = true;
+		bool m_paused = false;
+
+		std::mutex m_threadLock;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_threads; // Never shrinks, threads may exit with events in flight.
+
+		std::vector<ProfileFrame> m_frames; // History ring.
+		ProfileFrame m_scratch; // Collected into while paused.
+		std::vector<OpenScope> m_stack; // BuildHierarchy, kept for its capacity.
+		uint64_t m_frameCount = 0;
+		uint64_t m_frameBegin = 0;
+		uint64_t m_epoch = 0;
+
+		// Viewer
+		int m_selectedAge = 0;
+		std::string m_exportStatus;
+
+	private:
+		FrameProfiler() { }
+
+	public:
+		// Singleton Design Pattern
+		static FrameProfiler& Instance()
+		{
+			static FrameProfiler instance;
+			return instance;
+		}
+
+		FrameProfiler(FrameProfiler const&) = delete;
+		void operator=(FrameProfiler const&) = delete;
+
+	};
+
+	class ScopedMarker
+	{
+	public:
+		explicit ScopedMarker(const char* name)
+		{
+			if (!Profiler.IsEnabled())
+				return;
+			m_buffer = FrameProfiler::GetThreadBuffer();
+			m_name = name;
+			m_depth = m_buffer->m_depth++;
+			m_begin = Now();
+		}
+		~ScopedMarker()
+		{
+			if (!m_buffer)
+				return;
+			uint64_t end = Now();
+			m_buffer->m_depth--;
+			m_buffer->Push({ m_name, m_begin, end, m_depth, m_buffer->m_index });
+		}
+
+		ScopedMarker(ScopedMarker const&) = delete;
+		void operator=(ScopedMarker const&) = delete;
+
+	private:
+		ThreadBuffer* m_buffer = nullptr;
+		const char* m_name = nullptr;
+		uint64_t m_begin = 0;
+		uint32_t m_depth = 0;
+	};
+
+	// Benchmark // Cost of one marker, enabled and disabled, measured against an empty loop.
+	struct ProfilerBenchmarkReport
+	{
+		int m_markers = 0;
+		double m_loopNs = 0.0; // Per iteration, no marker.
+		double m_markerNs = 0.0; // Per marker, loop subtracted.
+		double m_disabledNs = 0.0;
+		double m_nestedNs = 0.0; // Per marker, four deep.
+		double m_collectNs = 0.0; // Per event drained and aggregated by EndFrame.
+	};
+	ProfilerBenchmarkReport RunProfilerBenchmark(int markers);
+}
@@ -0,0 +1,102 @@
+#include "RHI.h"
+
+#include <string.h>
+
+namespace Renderer
+{
+	namespace RHI
+	{
+		uint32_t GetFormatSize(Format format)
+		{
+			switch (format)
+			{
+			case FORMAT_RGBA8: return 4;
+			case FORMAT_BC1: return 8;
+			case FORMAT_BC3: return 16;
+			case FORMAT_BC5: return 16;
+			case FORMAT_BC7: return 16;
+			case FORMAT_R16_UINT: return 2;
+			case FORMAT_R32_UINT: return 4;
+			case FORMAT_RG32_FLOAT: return 8;
+			case FORMAT_RGB32_FLOAT: return 12;
+			case FORMAT_RGBA32_FLOAT: return 16;
+			default: return 0;
+			}
+		}
+		bool IsBlockCompressed(Format format)
+		{
+			return format == FORMAT_BC1 || format == FORMAT_BC3 || format == FORMAT_BC5 || format == FORMAT_BC7;
+		}
+		const char* GetStateName(ResourceState state)
+		{
+			static const char* names[STATE_COUNT] = { "undefined", "copy dest", "vertex buffer", "index buffer", "constant buffer", "shader resource" };
+			return (state >= 0 && state < STATE_COUNT) ? names[state] : "invalid";
+		}
+
+		// Command List
+		void CommandList::UpdateBuffer(BufferHandle buffer, uint32_t offset, const void* data, uint32_t size)
+		{
+			// Payloads stay 16 byte aligned so the device can copy them as they are.
+			uint32_t payload = (uint32_t)((m_payload.size() + 15) & ~(size_t)15);
+			m_payload.resize(payload + size);
+			memcpy(m_payload.data() + payload, data, size);
+			Add(COMMAND_UPDATE_BUFFER, 0, buffer, offset, size, payload);
+		}
+
+		// Device
+		void Device::QueueRelease(ResourceType type, uint32_t index, uint32_t generation)
+		{
+			if (index == UINT32_MAX)
+				return;
+			// Commands already submitted this frame may still reference it.
+			m_releases.push_back({ type, index, generation, m_frameIndex });
+		}
+		void Device::ProcessReleases()
+		{
+			size_t kept = 0;
+			for (size_t i = 0; i < m_releases.size(); ++i)
+			{
+				const PendingRelease& r = m_releases[i];
+				if (r.m_frame < m_completedFrames)
+				{
+					Release(r.m_type, r.m_index, r.m_generation);
+					m_stats.m_releases++;
+				}
+				else
+					m_releases[kept++] = r;
+			}
+			m_releases.resize(kept);
+		}
+		void Device::EndFrame()
+		{
+			SignalFrame(m_frameIndex);
+			m_frameIndex++;
+			// Never more than RHI_FRAMES_IN_FLIGHT ahead of the GPU, fences are reused after that.
+			if (m_frameIndex - m_completedFrames > RHI_FRAMES_IN_FLIGHT)
+				IsFrameComplete(m_frameIndex - RHI_FRAMES_IN_FLIGHT - 1, true);
+			IsFrameComplete(m_frameIndex - 1);
+			ProcessReleases();
+		}
+		bool Device::IsFrameComplete(uint64_t frame, bool wait)
+		{
+			// Fences complete in order, stop at the first frame still running.
+			while (m_completedFrames <= frame && m_completedFrames < m_frameIndex && PollFrame(m_completedFrames, wait))
+				m_completedFrames++;
+			return m_completedFrames > frame;
+		}
+		void Device::WaitIdle()
+		{
+			// Closes the frame being recorded too, so its commands are covered.
+			EndFrame();
+			IsFrameComplete(m_frameIndex - 1, true);
+			ProcessReleases();
+		}
+
+		const DeviceStats& Device::GetStats()
+		{
+			CountResources(m_stats);
+			m_stats.m_pendingReleases = (uint32_t)m_releases.size();
+			return m_stats;
+		}
+	}
+}
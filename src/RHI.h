@@ -0,0 +1,396 @@
+#pragma once
+
+#include "Common.h"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Renderer
+{
+	// Render Hardware Interface // What the mesh, texture, shader and queue code draws through. Resources are plain
+	// handles into per-device pools, draws are recorded into command lists and executed by the device on submit.
+	// Free of platform headers, the D3D11 device implements it on Windows and the recording device everywhere.
+	namespace RHI
+	{
+		// Handle // Index into a device pool, the generation tells a reused slot from the resource that was destroyed.
+		template<typename Tag>
+		struct Handle
+		{
+			uint32_t m_index = UINT32_MAX;
+			uint32_t m_generation = 0;
+
+			static Handle Make(uint32_t index, uint32_t generation) { Handle handle; handle.m_index = index; handle.m_generation = generation; return handle; }
+			bool IsValid() const { return m_index != UINT32_MAX; }
+			bool operator==(const Handle& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+			bool operator!=(const Handle& other) const { return !(*this == other); }
+			bool operator<(const Handle& other) const { return m_index < other.m_index || (m_index == other.m_index && m_generation < other.m_generation); }
+		};
+		typedef Handle<struct BufferTag> BufferHandle;
+		typedef Handle<struct TextureTag> TextureHandle;
+		typedef Handle<struct SamplerTag> SamplerHandle;
+		typedef Handle<struct PipelineTag> PipelineHandle;
+
+		enum ResourceType
+		{
+			RESOURCE_BUFFER,
+			RESOURCE_TEXTURE,
+			RESOURCE_SAMPLER,
+			RESOURCE_PIPELINE,
+		};
+
+		// Handle Pool // Dense slots reused through a free list. Freeing bumps the slot's generation, so every handle
+		// still pointing at it goes stale instead of reaching whatever is created there next.
+		template<typename T, typename H>
+		class HandlePool
+		{
+		public:
+			H Allocate(const T& value)
+			{
+				uint32_t index;
+				if (!m_free.empty())
+				{
+					index = m_free.back();
+					m_free.pop_back();
+				}
+				else
+				{
+					index = (uint32_t)m_slots.size();
+					m_slots.emplace_back();
+				}
+				Slot& slot = m_slots[index];
+				slot.m_value = value;
+				slot.m_alive = true;
+				m_count++;
+				return H::Make(index, slot.m_generation);
+			}
+			// nullptr when the handle is stale or was never allocated.
+			T* Get(H handle)
+			{
+				if (handle.m_index >= m_slots.size())
+					return nullptr;
+				Slot& slot = m_slots[handle.m_index];
+				return (slot.m_alive && slot.m_generation == handle.m_generation) ? &slot.m_value : nullptr;
+			}
+			bool Free(H handle)
+			{
+				if (!Get(handle))
+					return false;
+				Slot& slot = m_slots[handle.m_index];
+				slot.m_value = T();
+				slot.m_alive = false;
+				slot.m_generation++;
+				m_free.push_back(handle.m_index);
+				m_count--;
+				return true;
+			}
+			template<typename F>
+			void ForEach(F&& function)
+			{
+				for (uint32_t i = 0; i < (uint32_t)m_slots.size(); ++i)
+				{
+					if (!m_slots[i].m_alive)
+						continue;
+					function(H::Make(i, m_slots[i].m_generation), m_slots[i].m_value);
+				}
+			}
+			uint32_t GetCount() { return m_count; }
+
+		private:
+			struct Slot
+			{
+				T m_value = T();
+				uint32_t m_generation = 1; // Never 0, a default handle matches nothing.
+				bool m_alive = false;
+			};
+			std::vector<Slot> m_slots;
+			std::vector<uint32_t> m_free;
+			uint32_t m_count = 0;
+		};
+
+		enum Format
+		{
+			FORMAT_UNKNOWN,
+			FORMAT_RGBA8,
+			FORMAT_BC1,
+			FORMAT_BC3,
+			FORMAT_BC5,
+			FORMAT_BC7,
+			FORMAT_R16_UINT,
+			FORMAT_R32_UINT,
+			FORMAT_RG32_FLOAT,
+			FORMAT_RGB32_FLOAT,
+			FORMAT_RGBA32_FLOAT,
+			FORMAT_COUNT,
+		};
+		// Bytes per texel, or per 4x4 block for block compressed formats.
+		uint32_t GetFormatSize(Format format);
+		bool IsBlockCompressed(Format format);
+
+		// States // Where a resource is in the pipeline. Changing state takes an explicit barrier in the command list.
+		enum ResourceState
+		{
+			STATE_UNDEFINED,
+			STATE_COPY_DEST,
+			STATE_VERTEX_BUFFER,
+			STATE_INDEX_BUFFER,
+			STATE_CONSTANT_BUFFER,
+			STATE_SHADER_RESOURCE,
+			STATE_COUNT,
+		};
+		const char* GetStateName(ResourceState state);
+
+		enum BufferUsage
+		{
+			BUFFER_VERTEX = 1 << 0,
+			BUFFER_INDEX = 1 << 1,
+			BUFFER_CONSTANT = 1 << 2,
+			BUFFER_SHADER_RESOURCE = 1 << 3, // Structured, read by shaders through a texture slot.
+		};
+		struct BufferDesc
+		{
+			uint32_t m_size = 0;
+			uint32_t m_usage = 0; // BufferUsage bits.
+			uint32_t m_stride = 0; // Element size of structured buffers.
+			bool m_dynamic = false; // Written by the CPU every frame through Map or UpdateBuffer, never by a copy.
+			const char* m_name = "";
+		};
+		// Initial contents of one mip level.
+		struct SubresourceData
+		{
+			const void* m_data = nullptr;
+			uint32_t m_rowPitch = 0; // Bytes per row of texels, or per row of blocks.
+		};
+		struct TextureDesc
+		{
+			uint32_t m_width = 0;
+			uint32_t m_height = 0;
+			uint32_t m_mipCount = 1;
+			uint32_t m_arraySize = 1; // Shaders read every texture as a Texture2DArray, a single texture is one slice.
+			Format m_format = FORMAT_RGBA8;
+			const char* m_name = "";
+		};
+
+		enum Filter
+		{
+			FILTER_POINT,
+			FILTER_LINEAR,
+			FILTER_ANISOTROPIC,
+		};
+		enum AddressMode
+		{
+			ADDRESS_WRAP,
+			ADDRESS_CLAMP,
+			ADDRESS_BORDER,
+		};
+		struct SamplerDesc
+		{
+			Filter m_filter = FILTER_POINT;
+			AddressMode m_address = ADDRESS_BORDER; // Every axis.
+			uint32_t m_maxAnisotropy = 1;
+			float m_borderColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		};
+
+		enum CullMode
+		{
+			CULL_NONE,
+			CULL_FRONT,
+			CULL_BACK,
+		};
+		struct VertexElement
+		{
+			const char* m_semantic;
+			uint32_t m_semanticIndex;
+			Format m_format;
+			uint32_t m_slot;
+			uint32_t m_offset; // AppendElement follows the previous element of the slot.
+			bool m_perInstance;
+		};
+		const uint32_t AppendElement = UINT32_MAX;
+		struct PipelineDesc
+		{
+			// Bytecode, empty on backends that do not run shaders.
+			const void* m_vertexCode = nullptr;
+			size_t m_vertexCodeSize = 0;
+			const void* m_pixelCode = nullptr;
+			size_t m_pixelCodeSize = 0;
+			const VertexElement* m_elements = nullptr;
+			uint32_t m_elementCount = 0;
+			// Fixed Function
+			CullMode m_cullMode = CULL_BACK;
+			bool m_frontCounterClockwise = true;
+			bool m_depthTest = true;
+			bool m_depthWrite = true;
+		};
+
+		enum MapMode
+		{
+			MAP_WRITE_DISCARD, // Fresh memory, the previous contents may still be in use by the GPU.
+			MAP_WRITE_NO_OVERWRITE, // Same memory, the caller only writes ranges the GPU is not reading.
+		};
+
+		const uint32_t MaxVertexBuffers = 4;
+		const uint32_t MaxConstantBuffers = 4;
+		const uint32_t MaxTextures = 8;
+		const uint32_t MaxSamplers = 4;
+		const uint32_t ConstantAlignment = 256; // Constant buffer binding offsets.
+
+		// Command List // Commands recorded on any thread, executed in order by Device::Submit on the thread owning the device.
+		// Handles are resolved at submit, so a resource destroyed after recording is caught there rather than here.
+		enum CommandType
+		{
+			COMMAND_SET_PIPELINE,
+			COMMAND_SET_VERTEX_BUFFER,
+			COMMAND_SET_INDEX_BUFFER,
+			COMMAND_SET_CONSTANT_BUFFER,
+			COMMAND_SET_TEXTURE,
+			COMMAND_SET_SHADER_BUFFER,
+			COMMAND_SET_SAMPLER,
+			COMMAND_DRAW_INDEXED,
+			COMMAND_DRAW_INDEXED_INSTANCED,
+			COMMAND_BUFFER_BARRIER,
+			COMMAND_TEXTURE_BARRIER,
+			COMMAND_UPDATE_BUFFER,
+			COMMAND_COUNT,
+		};
+		struct Command
+		{
+			CommandType m_type;
+			uint32_t m_slot;
+			uint32_t m_index; // Handle of the resource the command takes, the pool depends on the type.
+			uint32_t m_generation;
+			uint32_t m_args[5];
+
+			template<typename H>
+			H GetHandle() const { return H::Make(m_index, m_generation); }
+		};
+
+		class CommandList
+		{
+		public:
+			void Reset() { m_commands.clear(); m_payload.clear(); }
+
+			void SetPipeline(PipelineHandle pipeline) { Add(COMMAND_SET_PIPELINE, 0, pipeline); }
+			void SetVertexBuffer(uint32_t slot, BufferHandle buffer, uint32_t stride, uint32_t offset = 0) { Add(COMMAND_SET_VERTEX_BUFFER, slot, buffer, stride, offset); }
+			// format is FORMAT_R16_UINT or FORMAT_R32_UINT.
+			void SetIndexBuffer(BufferHandle buffer, Format format, uint32_t offset = 0) { Add(COMMAND_SET_INDEX_BUFFER, 0, buffer, format, offset); }
+			// Vertex stage, offset and size in bytes, offset a multiple of ConstantAlignment.
+			void SetConstantBuffer(uint32_t slot, BufferHandle buffer, uint32_t offset, uint32_t size) { Add(COMMAND_SET_CONSTANT_BUFFER, slot, buffer, offset, size); }
+			// Pixel stage. A default handle unbinds the slot.
+			void SetTexture(uint32_t slot, TextureHandle texture) { Add(COMMAND_SET_TEXTURE, slot, texture); }
+			void SetShaderBuffer(uint32_t slot, BufferHandle buffer) { Add(COMMAND_SET_SHADER_BUFFER, slot, buffer); }
+			void SetSampler(uint32_t slot, SamplerHandle sampler) { Add(COMMAND_SET_SAMPLER, slot, sampler); }
+
+			void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex = 0) { Add(COMMAND_DRAW_INDEXED, 0, PipelineHandle(), indexCount, firstIndex, (uint32_t)baseVertex); }
+			void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+			{
+				Add(COMMAND_DRAW_INDEXED_INSTANCED, 0, PipelineHandle(), indexCount, firstIndex, (uint32_t)baseVertex, instanceCount, firstInstance);
+			}
+
+			void Barrier(BufferHandle buffer, ResourceState before, ResourceState after) { Add(COMMAND_BUFFER_BARRIER, 0, buffer, before, after); }
+			void Barrier(TextureHandle texture, ResourceState before, ResourceState after) { Add(COMMAND_TEXTURE_BARRIER, 0, texture, before, after); }
+			// The data is copied into the list. Dynamic buffers are appended to, writing at offset 0 discards their old contents,
+			// other buffers must be in STATE_COPY_DEST.
+			void UpdateBuffer(BufferHandle buffer, uint32_t offset, const void* data, uint32_t size);
+
+			const std::vector<Command>& GetCommands() const { return m_commands; }
+			const uint8_t* GetPayload(uint32_t offset) const { return m_payload.data() + offset; }
+			size_t GetCommandCount() const { return m_commands.size(); }
+
+		private:
+			template<typename H>
+			void Add(CommandType type, uint32_t slot, H handle, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0, uint32_t a3 = 0, uint32_t a4 = 0)
+			{
+				m_commands.push_back({ type, slot, handle.m_index, handle.m_generation, { a0, a1, a2, a3, a4 } });
+			}
+
+		private:
+			std::vector<Command> m_commands;
+			std::vector<uint8_t> m_payload; // UpdateBuffer data.
+		};
+
+		struct DeviceCaps
+		{
+			bool m_constantBufferOffsets = true; // SetConstantBuffer may bind at a non-zero offset.
+			bool m_mapNoOverwriteConstants = true; // Constant buffers accept MAP_WRITE_NO_OVERWRITE.
+		};
+
+		struct DeviceStats
+		{
+			uint32_t m_buffers = 0;
+			uint32_t m_textures = 0;
+			uint32_t m_samplers = 0;
+			uint32_t m_pipelines = 0;
+			uint32_t m_pendingReleases = 0; // Destroyed, waiting on the frames that may still use them.
+			uint64_t m_releases = 0;
+			uint64_t m_submits = 0;
+			uint64_t m_commands = 0;
+		};
+
+		// Device // Creates resources and executes command lists. Main thread only, apart from recording command lists.
+		// Destroyed resources are released once every frame submitted before the destroy has finished on the GPU,
+		// so callers can drop a handle right after its last use.
+		class Device
+		{
+		public:
+			virtual ~Device() { }
+
+			virtual const char* GetName() = 0;
+			virtual const DeviceCaps& GetCaps() = 0;
+
+			// Invalid handles on failure.
+			virtual BufferHandle CreateBuffer(const BufferDesc& desc, const void* data = nullptr) = 0;
+			// One entry per mip level, per array slice, slices outermost. nullptr leaves the contents undefined.
+			virtual TextureHandle CreateTexture(const TextureDesc& desc, const SubresourceData* data = nullptr) = 0;
+			virtual SamplerHandle CreateSampler(const SamplerDesc& desc) = 0;
+			virtual PipelineHandle CreatePipeline(const PipelineDesc& desc) = 0;
+
+			// Invalid handles are ignored.
+			void Destroy(BufferHandle buffer) { QueueRelease(RESOURCE_BUFFER, buffer.m_index, buffer.m_generation); }
+			void Destroy(TextureHandle texture) { QueueRelease(RESOURCE_TEXTURE, texture.m_index, texture.m_generation); }
+			void Destroy(SamplerHandle sampler) { QueueRelease(RESOURCE_SAMPLER, sampler.m_index, sampler.m_generation); }
+			void Destroy(PipelineHandle pipeline) { QueueRelease(RESOURCE_PIPELINE, pipeline.m_index, pipeline.m_generation); }
+
+			// Dynamic buffers only, unmapped before any command list using them is submitted.
+			virtual void* Map(BufferHandle buffer, MapMode mode) = 0;
+			virtual void Unmap(BufferHandle buffer) = 0;
+
+			virtual void Submit(const CommandList& commands) = 0;
+
+			// Frames // EndFrame closes the frame and signals its fence. Frames complete in order.
+			void EndFrame();
+			uint64_t GetFrameIndex() { return m_frameIndex; } // Frame being recorded.
+			bool IsFrameComplete(uint64_t frame, bool wait = false);
+			// Waits for the GPU and releases everything destroyed so far, before shutting down.
+			void WaitIdle();
+
+			const DeviceStats& GetStats();
+
+		protected:
+			virtual void SignalFrame(uint64_t frame) = 0;
+			virtual bool PollFrame(uint64_t frame, bool wait) = 0;
+			// Frees the resource now, stale handles are ignored.
+			virtual void Release(ResourceType type, uint32_t index, uint32_t generation) = 0;
+			virtual void CountResources(DeviceStats& stats) = 0;
+
+			DeviceStats m_stats;
+
+		private:
+			void QueueRelease(ResourceType type, uint32_t index, uint32_t generation);
+			void ProcessReleases();
+
+		private:
+			struct PendingRelease
+			{
+				ResourceType m_type;
+				uint32_t m_index;
+				uint32_t m_generation;
+				uint64_t m_frame; // Released once this frame completes.
+			};
+			std::vector<PendingRelease> m_releases;
+			uint64_t m_frameIndex = 0;
+			uint64_t m_completedFrames = 0; // Every frame below this has completed.
+
+		};
+	}
+}
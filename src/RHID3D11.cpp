@@ -0,0 +1,447 @@
+#include "RHID3D11.h"
+
+#include <vector>
+#include <float.h>
+#include <string.h>
+
+namespace Renderer
+{
+	namespace RHI
+	{
+		static DXGI_FORMAT GetDxgiFormat(Format format)
+		{
+			static const DXGI_FORMAT formats[FORMAT_COUNT] =
+			{
+				DXGI_FORMAT_UNKNOWN,
+				DXGI_FORMAT_R8G8B8A8_UNORM,
+				DXGI_FORMAT_BC1_UNORM,
+				DXGI_FORMAT_BC3_UNORM,
+				DXGI_FORMAT_BC5_UNORM,
+				DXGI_FORMAT_BC7_UNORM,
+				DXGI_FORMAT_R16_UINT,
+				DXGI_FORMAT_R32_UINT,
+				DXGI_FORMAT_R32G32_FLOAT,
+				DXGI_FORMAT_R32G32B32_FLOAT,
+				DXGI_FORMAT_R32G32B32A32_FLOAT,
+			};
+			return (format >= 0 && format < FORMAT_COUNT) ? formats[format] : DXGI_FORMAT_UNKNOWN;
+		}
+
+		void D3D11Device::Create(ID3D11Device1* device, ID3D11DeviceContext1* context)
+		{
+			m_device = device;
+			m_context = context;
+			m_device->AddRef();
+			m_context->AddRef();
+
+			// Binding by offset and appending with NO_OVERWRITE both need 11.1 runtime support.
+			D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+			ZeroMemory(&options, sizeof(options));
+			m_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+			m_caps.m_constantBufferOffsets = options.ConstantBufferOffsetting != FALSE;
+			m_caps.m_mapNoOverwriteConstants = options.MapNoOverwriteOnDynamicConstantBuffer != FALSE;
+
+			D3D11_QUERY_DESC queryDesc = { D3D11_QUERY_EVENT, 0 };
+			for (int i = 0; i < RHI_FRAMES_IN_FLIGHT; ++i)
+			{
+				HRESULT result = m_device->CreateQuery(&queryDesc, &m_frameQueries[i]);
+				assert(SUCCEEDED(result));
+			}
+		}
+		void D3D11Device::Destroy()
+		{
+			if (!m_device)
+				return;
+			WaitIdle();
+			// Whatever was never destroyed goes with the device.
+			m_buffers.ForEach([](BufferHandle, Buffer& buffer) { ReleaseBuffer(buffer); });
+			m_textures.ForEach([](TextureHandle, Texture& texture) { ReleaseTexture(texture); });
+			m_samplers.ForEach([](SamplerHandle, ID3D11SamplerState*& sampler) { sampler->Release(); });
+			m_pipelines.ForEach([](PipelineHandle, Pipeline& pipeline) { ReleasePipeline(pipeline); });
+			m_buffers = HandlePool<Buffer, BufferHandle>();
+			m_textures = HandlePool<Texture, TextureHandle>();
+			m_samplers = HandlePool<ID3D11SamplerState*, SamplerHandle>();
+			m_pipelines = HandlePool<Pipeline, PipelineHandle>();
+			for (int i = 0; i < RHI_FRAMES_IN_FLIGHT; ++i)
+			{
+				if (m_frameQueries[i])
+					m_frameQueries[i]->Release();
+				m_frameQueries[i] = nullptr;
+			}
+			m_context->Release();
+			m_device->Release();
+			m_context = nullptr;
+			m_device = nullptr;
+		}
+
+		// Resources
+		BufferHandle D3D11Device::CreateBuffer(const BufferDesc& desc, const void* data)
+		{
+			D3D11_BUFFER_DESC bufferDesc;
+			ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+			bufferDesc.ByteWidth = desc.m_size;
+			// Static buffers given their contents never change, the rest are copied into.
+			bufferDesc.Usage = desc.m_dynamic ? D3D11_USAGE_DYNAMIC : data ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DEFAULT;
+			bufferDesc.CPUAccessFlags = desc.m_dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+			if (desc.m_usage & BUFFER_VERTEX)
+				bufferDesc.BindFlags |= D3D11_BIND_VERTEX_BUFFER;
+			if (desc.m_usage & BUFFER_INDEX)
+				bufferDesc.BindFlags |= D3D11_BIND_INDEX_BUFFER;
+			if (desc.m_usage & BUFFER_CONSTANT)
+				bufferDesc.BindFlags |= D3D11_BIND_CONSTANT_BUFFER;
+			if (desc.m_usage & BUFFER_SHADER_RESOURCE)
+			{
+				bufferDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+				bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+				bufferDesc.StructureByteStride = desc.m_stride;
+			}
+
+			D3D11_SUBRESOURCE_DATA initialData;
+			ZeroMemory(&initialData, sizeof(D3D11_SUBRESOURCE_DATA));
+			initialData.pSysMem = data;
+
+			Buffer buffer;
+			buffer.m_dynamic = desc.m_dynamic;
+			HRESULT result = m_device->CreateBuffer(&bufferDesc, data ? &initialData : nullptr, &buffer.m_buffer);
+			if (FAILED(result))
+				return BufferHandle();
+			if (desc.m_usage & BUFFER_SHADER_RESOURCE)
+			{
+				D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+				ZeroMemory(&viewDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+				viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+				viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+				viewDesc.Buffer.NumElements = desc.m_size / desc.m_stride;
+				result = m_device->CreateShaderResourceView(buffer.m_buffer, &viewDesc, &buffer.m_view);
+				if (FAILED(result))
+				{
+					ReleaseBuffer(buffer);
+					return BufferHandle();
+				}
+			}
+			return m_buffers.Allocate(buffer);
+		}
+		TextureHandle D3D11Device::CreateTexture(const TextureDesc& desc, const SubresourceData* data)
+		{
+			D3D11_TEXTURE2D_DESC textureDesc;
+			ZeroMemory(&textureDesc, sizeof(D3D11_TEXTURE2D_DESC));
+			textureDesc.Width = desc.m_width;
+			textureDesc.Height = desc.m_height;
+			textureDesc.MipLevels = desc.m_mipCount;
+			textureDesc.ArraySize = desc.m_arraySize;
+			textureDesc.Format = GetDxgiFormat(desc.m_format);
+			textureDesc.SampleDesc.Count = 1;
+			textureDesc.SampleDesc.Quality = 0;
+			textureDesc.Usage = data ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DEFAULT;
+			textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+			std::vector<D3D11_SUBRESOURCE_DATA> initialData;
+			if (data)
+			{
+				initialData.resize((size_t)desc.m_mipCount * desc.m_arraySize);
+				for (size_t i = 0; i < initialData.size(); ++i)
+					initialData[i] = { data[i].m_data, data[i].m_rowPitch, 0 };
+			}
+
+			Texture texture;
+			HRESULT result = m_device->CreateTexture2D(&textureDesc, data ? initialData.data() : nullptr, &texture.m_texture);
+			if (FAILED(result))
+				return TextureHandle();
+
+			D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+			ZeroMemory(&viewDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+			viewDesc.Format = textureDesc.Format;
+			viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			viewDesc.Texture2DArray.MipLevels = desc.m_mipCount;
+			viewDesc.Texture2DArray.ArraySize = desc.m_arraySize;
+			result = m_device->CreateShaderResourceView(texture.m_texture, &viewDesc, &texture.m_view);
+			if (FAILED(result))
+			{
+				ReleaseTexture(texture);
+				return TextureHandle();
+			}
+			return m_textures.Allocate(texture);
+		}
+		SamplerHandle D3D11Device::CreateSampler(const SamplerDesc& desc)
+		{
+			static const D3D11_FILTER filters[] = { D3D11_FILTER_MIN_MAG_MIP_POINT, D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_FILTER_ANISOTROPIC };
+			static const D3D11_TEXTURE_ADDRESS_MODE addressModes[] = { D3D11_TEXTURE_ADDRESS_WRAP, D3D11_TEXTURE_ADDRESS_CLAMP, D3D11_TEXTURE_ADDRESS_BORDER };
+
+			D3D11_SAMPLER_DESC samplerDesc;
+			ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
+			samplerDesc.Filter = filters[desc.m_filter];
+			samplerDesc.AddressU = addressModes[desc.m_address];
+			samplerDesc.AddressV = addressModes[desc.m_address];
+			samplerDesc.AddressW = addressModes[desc.m_address];
+			samplerDesc.MipLODBias = 0.0f;
+			samplerDesc.MaxAnisotropy = desc.m_maxAnisotropy;
+			memcpy(samplerDesc.BorderColor, desc.m_borderColor, sizeof(samplerDesc.BorderColor));
+			samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+			samplerDesc.MinLOD = -FLT_MAX;
+			samplerDesc.MaxLOD = FLT_MAX;
+
+			ID3D11SamplerState* sampler = nullptr;
+			HRESULT result = m_device->CreateSamplerState(&samplerDesc, &sampler);
+			if (FAILED(result))
+				return SamplerHandle();
+			return m_samplers.Allocate(sampler);
+		}
+		PipelineHandle D3D11Device::CreatePipeline(const PipelineDesc& desc)
+		{
+			if (!desc.m_vertexCodeSize || !desc.m_pixelCodeSize)
+				return PipelineHandle();
+
+			Pipeline pipeline;
+			// Create Shaders
+			{
+				HRESULT result = m_device->CreateVertexShader(desc.m_vertexCode, desc.m_vertexCodeSize, nullptr, &pipeline.m_vertexShader);
+				if (SUCCEEDED(result))
+					result = m_device->CreatePixelShader(desc.m_pixelCode, desc.m_pixelCodeSize, nullptr, &pipeline.m_pixelShader);
+				if (FAILED(result))
+				{
+					ReleasePipeline(pipeline);
+					return PipelineHandle();
+				}
+			}
+			// Create Input Layout
+			if (desc.m_elementCount > 0)
+			{
+				std::vector<D3D11_INPUT_ELEMENT_DESC> elements(desc.m_elementCount);
+				for (uint32_t i = 0; i < desc.m_elementCount; ++i)
+				{
+					const VertexElement& e = desc.m_elements[i];
+					elements[i] = { e.m_semantic, e.m_semanticIndex, GetDxgiFormat(e.m_format), e.m_slot,
+						e.m_offset == AppendElement ? D3D11_APPEND_ALIGNED_ELEMENT : e.m_offset,
+						e.m_perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA, e.m_perInstance ? 1u : 0u };
+				}
+				HRESULT result = m_device->CreateInputLayout(elements.data(), desc.m_elementCount, desc.m_vertexCode, desc.m_vertexCodeSize, &pipeline.m_inputLayout);
+				if (FAILED(result))
+				{
+					ReleasePipeline(pipeline);
+					return PipelineHandle();
+				}
+			}
+			// Create States // Identical descriptions return the same state object, pipelines share them for free.
+			{
+				static const D3D11_CULL_MODE cullModes[] = { D3D11_CULL_NONE, D3D11_CULL_FRONT, D3D11_CULL_BACK };
+				D3D11_RASTERIZER_DESC rasterizerDesc;
+				ZeroMemory(&rasterizerDesc, sizeof(D3D11_RASTERIZER_DESC));
+				rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+				rasterizerDesc.CullMode = cullModes[desc.m_cullMode];
+				rasterizerDesc.FrontCounterClockwise = desc.m_frontCounterClockwise;
+				m_device->CreateRasterizerState(&rasterizerDesc, &pipeline.m_rasterizerState);
+
+				D3D11_DEPTH_STENCIL_DESC depthStencilDesc;
+				ZeroMemory(&depthStencilDesc, sizeof(D3D11_DEPTH_STENCIL_DESC));
+				depthStencilDesc.DepthEnable = desc.m_depthTest;
+				depthStencilDesc.DepthWriteMask = desc.m_depthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+				depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+				m_device->CreateDepthStencilState(&depthStencilDesc, &pipeline.m_depthStencilState);
+			}
+			return m_pipelines.Allocate(pipeline);
+		}
+
+		void D3D11Device::ReleaseBuffer(Buffer& buffer)
+		{
+			if (buffer.m_view)
+				buffer.m_view->Release();
+			if (buffer.m_buffer)
+				buffer.m_buffer->Release();
+		}
+		void D3D11Device::ReleaseTexture(Texture& texture)
+		{
+			if (texture.m_view)
+				texture.m_view->Release();
+			if (texture.m_texture)
+				texture.m_texture->Release();
+		}
+		void D3D11Device::ReleasePipeline(Pipeline& pipeline)
+		{
+			if (pipeline.m_vertexShader)
+				pipeline.m_vertexShader->Release();
+			if (pipeline.m_pixelShader)
+				pipeline.m_pixelShader->Release();
+			if (pipeline.m_inputLayout)
+				pipeline.m_inputLayout->Release();
+			if (pipeline.m_rasterizerState)
+				pipeline.m_rasterizerState->Release();
+			if (pipeline.m_depthStencilState)
+				pipeline.m_depthStencilState->Release();
+		}
+		void D3D11Device::Release(ResourceType type, uint32_t index, uint32_t generation)
+		{
+			switch (type)
+			{
+			case RESOURCE_BUFFER:
+				if (Buffer* buffer = m_buffers.Get(BufferHandle::Make(index, generation)))
+					ReleaseBuffer(*buffer);
+				m_buffers.Free(BufferHandle::Make(index, generation));
+				break;
+			case RESOURCE_TEXTURE:
+				if (Texture* texture = m_textures.Get(TextureHandle::Make(index, generation)))
+					ReleaseTexture(*texture);
+				m_textures.Free(TextureHandle::Make(index, generation));
+				break;
+			case RESOURCE_SAMPLER:
+				if (ID3D11SamplerState** sampler = m_samplers.Get(SamplerHandle::Make(index, generation)))
+					(*sampler)->Release();
+				m_samplers.Free(SamplerHandle::Make(index, generation));
+				break;
+			case RESOURCE_PIPELINE:
+				if (Pipeline* pipeline = m_pipelines.Get(PipelineHandle::Make(index, generation)))
+					ReleasePipeline(*pipeline);
+				m_pipelines.Free(PipelineHandle::Make(index, generation));
+				break;
+			}
+		}
+		void D3D11Device::CountResources(DeviceStats& stats)
+		{
+			stats.m_buffers = m_buffers.GetCount();
+			stats.m_textures = m_textures.GetCount();
+			stats.m_samplers = m_samplers.GetCount();
+			stats.m_pipelines = m_pipelines.GetCount();
+		}
+
+		void* D3D11Device::Map(BufferHandle handle, MapMode mode)
+		{
+			Buffer* buffer = m_buffers.Get(handle);
+			if (!buffer || !buffer->m_dynamic)
+				return nullptr;
+			D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+			HRESULT result = m_context->Map(buffer->m_buffer, 0, mode == MAP_WRITE_DISCARD ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedSubresource);
+			return SUCCEEDED(result) ? mappedSubresource.pData : nullptr;
+		}
+		void D3D11Device::Unmap(BufferHandle handle)
+		{
+			if (Buffer* buffer = m_buffers.Get(handle))
+				m_context->Unmap(buffer->m_buffer, 0);
+		}
+
+		void D3D11Device::Submit(const CommandList& commands)
+		{
+			// Stale handles bind nothing rather than whatever reused the slot.
+			m_stats.m_submits++;
+			m_stats.m_commands += commands.GetCommandCount();
+			m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			for (const Command& c : commands.GetCommands())
+			{
+				switch (c.m_type)
+				{
+				case COMMAND_SET_PIPELINE:
+				{
+					Pipeline empty;
+					Pipeline* pipeline = m_pipelines.Get(c.GetHandle<PipelineHandle>());
+					pipeline = pipeline ? pipeline : &empty;
+					m_context->IASetInputLayout(pipeline->m_inputLayout);
+					m_context->VSSetShader(pipeline->m_vertexShader, nullptr, 0);
+					m_context->PSSetShader(pipeline->m_pixelShader, nullptr, 0);
+					m_context->RSSetState(pipeline->m_rasterizerState);
+					m_context->OMSetDepthStencilState(pipeline->m_depthStencilState, 0);
+					break;
+				}
+				case COMMAND_SET_VERTEX_BUFFER:
+				{
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					ID3D11Buffer* d3dBuffer = buffer ? buffer->m_buffer : nullptr;
+					UINT stride = c.m_args[0], offset = c.m_args[1];
+					m_context->IASetVertexBuffers(c.m_slot, 1, &d3dBuffer, &stride, &offset);
+					break;
+				}
+				case COMMAND_SET_INDEX_BUFFER:
+				{
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					m_context->IASetIndexBuffer(buffer ? buffer->m_buffer : nullptr, GetDxgiFormat((Format)c.m_args[0]), c.m_args[1]);
+					break;
+				}
+				case COMMAND_SET_CONSTANT_BUFFER:
+				{
+					// Ranges are in 16 byte constants, whole 256 byte blocks.
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					ID3D11Buffer* d3dBuffer = buffer ? buffer->m_buffer : nullptr;
+					UINT firstConstant = c.m_args[0] / 16;
+					UINT numConstants = ((c.m_args[1] + ConstantAlignment - 1) & ~(ConstantAlignment - 1)) / 16;
+					if (d3dBuffer && m_caps.m_constantBufferOffsets)
+						m_context->VSSetConstantBuffers1(c.m_slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+					else
+						m_context->VSSetConstantBuffers(c.m_slot, 1, &d3dBuffer);
+					break;
+				}
+				case COMMAND_SET_TEXTURE:
+				{
+					Texture* texture = m_textures.Get(c.GetHandle<TextureHandle>());
+					ID3D11ShaderResourceView* view = texture ? texture->m_view : nullptr;
+					m_context->PSSetShaderResources(c.m_slot, 1, &view);
+					break;
+				}
+				case COMMAND_SET_SHADER_BUFFER:
+				{
+					// Both stages, structured data is as often indexed per vertex as per pixel.
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					ID3D11ShaderResourceView* view = buffer ? buffer->m_view : nullptr;
+					m_context->VSSetShaderResources(c.m_slot, 1, &view);
+					m_context->PSSetShaderResources(c.m_slot, 1, &view);
+					break;
+				}
+				case COMMAND_SET_SAMPLER:
+				{
+					ID3D11SamplerState** sampler = m_samplers.Get(c.GetHandle<SamplerHandle>());
+					ID3D11SamplerState* d3dSampler = sampler ? *sampler : nullptr;
+					m_context->PSSetSamplers(c.m_slot, 1, &d3dSampler);
+					break;
+				}
+				case COMMAND_DRAW_INDEXED:
+					m_context->DrawIndexed(c.m_args[0], c.m_args[1], (INT)c.m_args[2]);
+					break;
+				case COMMAND_DRAW_INDEXED_INSTANCED:
+					m_context->DrawIndexedInstanced(c.m_args[0], c.m_args[3], c.m_args[1], (INT)c.m_args[2], c.m_args[4]);
+					break;
+				case COMMAND_BUFFER_BARRIER:
+				case COMMAND_TEXTURE_BARRIER:
+					break;
+				case COMMAND_UPDATE_BUFFER:
+				{
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					if (!buffer)
+						break;
+					const uint8_t* data = commands.GetPayload(c.m_args[2]);
+					if (buffer->m_dynamic)
+					{
+						// Appending never stalls, writing from the start renames the buffer.
+						D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+						D3D11_MAP mapType = c.m_args[0] == 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+						if (SUCCEEDED(m_context->Map(buffer->m_buffer, 0, mapType, 0, &mappedSubresource)))
+						{
+							memcpy((uint8_t*)mappedSubresource.pData + c.m_args[0], data, c.m_args[1]);
+							m_context->Unmap(buffer->m_buffer, 0);
+						}
+					}
+					else
+					{
+						D3D11_BOX box = { c.m_args[0], 0, 0, c.m_args[0] + c.m_args[1], 1, 1 };
+						m_context->UpdateSubresource1(buffer->m_buffer, 0, &box, data, 0, 0, 0);
+					}
+					break;
+				}
+				default:
+					break;
+				}
+			}
+		}
+
+		// Frames
+		void D3D11Device::SignalFrame(uint64_t frame)
+		{
+			m_context->End(m_frameQueries[frame % RHI_FRAMES_IN_FLIGHT]);
+		}
+		bool D3D11Device::PollFrame(uint64_t frame, bool wait)
+		{
+			ID3D11Query* query = m_frameQueries[frame % RHI_FRAMES_IN_FLIGHT];
+			BOOL done = FALSE;
+			if (!wait)
+				return m_context->GetData(query, &done, sizeof(done), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+			while (m_context->GetData(query, &done, sizeof(done), 0) != S_OK)
+				YieldProcessor();
+			return true;
+		}
+	}
+}
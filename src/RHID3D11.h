@@ -0,0 +1,83 @@
+#pragma once
+
+#include "RHI.h"
+
+#include <d3d11_1.h>
+
+namespace Renderer
+{
+	namespace RHI
+	{
+		// D3D11 Device // Resources on an existing device, command lists replayed on its immediate context at submit.
+		// Barriers are dropped, the driver tracks hazards itself. Frame fences are event queries.
+		class D3D11Device : public Device
+		{
+		public:
+			D3D11Device() { }
+			~D3D11Device() { Destroy(); }
+
+			// The renderer keeps the device, context and swap chain, a reference is held on each.
+			void Create(ID3D11Device1* device, ID3D11DeviceContext1* context);
+			void Destroy();
+			using Device::Destroy;
+
+			const char* GetName() override { return "D3D11"; }
+			const DeviceCaps& GetCaps() override { return m_caps; }
+
+			BufferHandle CreateBuffer(const BufferDesc& desc, const void* data = nullptr) override;
+			TextureHandle CreateTexture(const TextureDesc& desc, const SubresourceData* data = nullptr) override;
+			SamplerHandle CreateSampler(const SamplerDesc& desc) override;
+			PipelineHandle CreatePipeline(const PipelineDesc& desc) override;
+
+			void* Map(BufferHandle buffer, MapMode mode) override;
+			void Unmap(BufferHandle buffer) override;
+
+			void Submit(const CommandList& commands) override;
+
+			D3D11Device(D3D11Device const&) = delete;
+			void operator=(D3D11Device const&) = delete;
+
+		protected:
+			void SignalFrame(uint64_t frame) override;
+			bool PollFrame(uint64_t frame, bool wait) override;
+			void Release(ResourceType type, uint32_t index, uint32_t generation) override;
+			void CountResources(DeviceStats& stats) override;
+
+		private:
+			struct Buffer
+			{
+				ID3D11Buffer* m_buffer = nullptr;
+				ID3D11ShaderResourceView* m_view = nullptr; // Structured buffers.
+				bool m_dynamic = false;
+			};
+			struct Texture
+			{
+				ID3D11Texture2D* m_texture = nullptr;
+				ID3D11ShaderResourceView* m_view = nullptr;
+			};
+			struct Pipeline
+			{
+				ID3D11VertexShader* m_vertexShader = nullptr;
+				ID3D11PixelShader* m_pixelShader = nullptr;
+				ID3D11InputLayout* m_inputLayout = nullptr;
+				ID3D11RasterizerState* m_rasterizerState = nullptr;
+				ID3D11DepthStencilState* m_depthStencilState = nullptr;
+			};
+			static void ReleaseBuffer(Buffer& buffer);
+			static void ReleaseTexture(Texture& texture);
+			static void ReleasePipeline(Pipeline& pipeline);
+
+		private:
+			ID3D11Device1* m_device = nullptr;
+			ID3D11DeviceContext1* m_context = nullptr;
+			DeviceCaps m_caps;
+			ID3D11Query* m_frameQueries[RHI_FRAMES_IN_FLIGHT] = {}; // Signalled when the GPU is done with a frame.
+
+			HandlePool<Buffer, BufferHandle> m_buffers;
+			HandlePool<Texture, TextureHandle> m_textures;
+			HandlePool<ID3D11SamplerState*, SamplerHandle> m_samplers;
+			HandlePool<Pipeline, PipelineHandle> m_pipelines;
+
+		};
+	}
+}
@@ -0,0 +1,493 @@
+#include "RHIRecording.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Renderer
+{
+	namespace RHI
+	{
+		static ResourceState GetUsageState(uint32_t usage)
+		{
+			// The lowest usage bit when a buffer has several.
+			if (usage & BUFFER_VERTEX)
+				return STATE_VERTEX_BUFFER;
+			if (usage & BUFFER_INDEX)
+				return STATE_INDEX_BUFFER;
+			if (usage & BUFFER_CONSTANT)
+				return STATE_CONSTANT_BUFFER;
+			if (usage & BUFFER_SHADER_RESOURCE)
+				return STATE_SHADER_RESOURCE;
+			return STATE_UNDEFINED;
+		}
+		static const char* GetCommandName(CommandType type)
+		{
+			static const char* names[COMMAND_COUNT] = { "set pipeline", "set vertex buffer", "set index buffer", "set constant buffer", "set texture",
+				"set shader buffer", "set sampler", "draw indexed", "draw indexed instanced", "buffer barrier", "texture barrier", "update buffer" };
+			return (type >= 0 && type < COMMAND_COUNT) ? names[type] : "invalid";
+		}
+
+		void RecordingDevice::Error(const char* format, ...)
+		{
+			m_recordingStats.m_errors++;
+			if (m_errors.size() >= RHI_RECORDING_MAX_ERRORS)
+				return;
+			char message[256];
+			va_list args;
+			va_start(args, format);
+			vsnprintf(message, sizeof(message), format, args);
+			va_end(args);
+			m_errors.push_back(m_context + message);
+		}
+
+		// Resources
+		BufferHandle RecordingDevice::CreateBuffer(const BufferDesc& desc, const void* data)
+		{
+			m_context = std::string("Create buffer '") + desc.m_name + "': ";
+			if (desc.m_size == 0 || desc.m_usage == 0)
+			{
+				Error("empty size or usage");
+				return BufferHandle();
+			}
+			if ((desc.m_usage & BUFFER_CONSTANT) && desc.m_size % 16 != 0)
+			{
+				Error("constant buffers are whole 16 byte constants, %u bytes", desc.m_size);
+				return BufferHandle();
+			}
+			if ((desc.m_usage & BUFFER_SHADER_RESOURCE) && (desc.m_stride == 0 || desc.m_size % desc.m_stride != 0))
+			{
+				Error("structured buffers need a stride dividing the size, %u bytes by %u", desc.m_size, desc.m_stride);
+				return BufferHandle();
+			}
+			Buffer buffer;
+			buffer.m_desc = desc;
+			buffer.m_name = desc.m_name;
+			// Dynamic and initialised buffers start ready for their usage, empty static ones wait for a copy.
+			buffer.m_state = (desc.m_dynamic || data) ? GetUsageState(desc.m_usage) : STATE_COPY_DEST;
+			if (desc.m_dynamic)
+			{
+				buffer.m_memory.resize(desc.m_size);
+				if (data)
+					memcpy(buffer.m_memory.data(), data, desc.m_size);
+			}
+			return m_buffers.Allocate(buffer);
+		}
+		TextureHandle RecordingDevice::CreateTexture(const TextureDesc& desc, const SubresourceData* data)
+		{
+			m_context = std::string("Create texture '") + desc.m_name + "': ";
+			uint32_t fullChain = 1;
+			while ((desc.m_width >> fullChain) > 0 || (desc.m_height >> fullChain) > 0)
+				fullChain++;
+			if (desc.m_width == 0 || desc.m_height == 0 || desc.m_arraySize == 0 || desc.m_mipCount == 0 || desc.m_mipCount > fullChain)
+			{
+				Error("%ux%u, %u mips, %u slices", desc.m_width, desc.m_height, desc.m_mipCount, desc.m_arraySize);
+				return TextureHandle();
+			}
+			if (desc.m_format != FORMAT_RGBA8 && !IsBlockCompressed(desc.m_format))
+			{
+				Error("format %d is not a texture format", desc.m_format);
+				return TextureHandle();
+			}
+			if (data)
+			{
+				for (uint32_t slice = 0; slice < desc.m_arraySize; ++slice)
+				{
+					for (uint32_t mip = 0; mip < desc.m_mipCount; ++mip)
+					{
+						const SubresourceData& level = data[slice * desc.m_mipCount + mip];
+						uint32_t width = desc.m_width >> mip;
+						width = width ? width : 1;
+						uint32_t rowPitch = IsBlockCompressed(desc.m_format) ? (width + 3) / 4 * GetFormatSize(desc.m_format) : width * GetFormatSize(desc.m_format);
+						if (!level.m_data || level.m_rowPitch < rowPitch)
+						{
+							Error("slice %u mip %u has no data or a %u byte row pitch under %u", slice, mip, level.m_rowPitch, rowPitch);
+							return TextureHandle();
+						}
+					}
+				}
+			}
+			Texture texture;
+			texture.m_desc = desc;
+			texture.m_name = desc.m_name;
+			texture.m_state = data ? STATE_SHADER_RESOURCE : STATE_COPY_DEST;
+			return m_textures.Allocate(texture);
+		}
+		SamplerHandle RecordingDevice::CreateSampler(const SamplerDesc& desc)
+		{
+			m_context = "Create sampler: ";
+			if (desc.m_filter == FILTER_ANISOTROPIC && (desc.m_maxAnisotropy < 1 || desc.m_maxAnisotropy > 16))
+			{
+				Error("anisotropy %u outside 1 to 16", desc.m_maxAnisotropy);
+				return SamplerHandle();
+			}
+			return m_samplers.Allocate(desc);
+		}
+		PipelineHandle RecordingDevice::CreatePipeline(const PipelineDesc& desc)
+		{
+			m_context = "Create pipeline: ";
+			if ((desc.m_vertexCodeSize == 0) != (desc.m_pixelCodeSize == 0))
+			{
+				Error("vertex and pixel bytecode must both be given or both be empty");
+				return PipelineHandle();
+			}
+			Pipeline pipeline;
+			uint32_t slotEnd[MaxVertexBuffers] = {};
+			for (uint32_t i = 0; i < desc.m_elementCount; ++i)
+			{
+				const VertexElement& e = desc.m_elements[i];
+				uint32_t size = GetFormatSize(e.m_format);
+				if (e.m_slot >= MaxVertexBuffers || size == 0 || IsBlockCompressed(e.m_format))
+				{
+					Error("element %s%u has slot %u or format %d", e.m_semantic, e.m_semanticIndex, e.m_slot, e.m_format);
+					return PipelineHandle();
+				}
+				uint32_t bit = 1u << e.m_slot;
+				if ((pipeline.m_vertexSlots & bit) && ((pipeline.m_instanceSlots & bit) != 0) != e.m_perInstance)
+				{
+					Error("slot %u mixes per vertex and per instance elements", e.m_slot);
+					return PipelineHandle();
+				}
+				pipeline.m_vertexSlots |= bit;
+				if (e.m_perInstance)
+					pipeline.m_instanceSlots |= bit;
+				uint32_t offset = (e.m_offset == AppendElement) ? slotEnd[e.m_slot] : e.m_offset;
+				slotEnd[e.m_slot] = offset + size > slotEnd[e.m_slot] ? offset + size : slotEnd[e.m_slot];
+				if (e.m_perInstance)
+					pipeline.m_instanceStride[e.m_slot] = slotEnd[e.m_slot];
+			}
+			return m_pipelines.Allocate(pipeline);
+		}
+		void RecordingDevice::Release(ResourceType type, uint32_t index, uint32_t generation)
+		{
+			m_context = "Destroy: ";
+			bool released = false;
+			switch (type)
+			{
+			case RESOURCE_BUFFER:
+				if (Buffer* buffer = m_buffers.Get(BufferHandle::Make(index, generation)))
+				{
+					if (buffer->m_mapped)
+						Error("buffer '%s' is still mapped", buffer->m_name.c_str());
+				}
+				released = m_buffers.Free(BufferHandle::Make(index, generation));
+				break;
+			case RESOURCE_TEXTURE:
+				released = m_textures.Free(TextureHandle::Make(index, generation));
+				break;
+			case RESOURCE_SAMPLER:
+				released = m_samplers.Free(SamplerHandle::Make(index, generation));
+				break;
+			case RESOURCE_PIPELINE:
+				released = m_pipelines.Free(PipelineHandle::Make(index, generation));
+				break;
+			}
+			if (!released)
+				Error("resource %d at %u generation %u was already destroyed", type, index, generation);
+		}
+		void RecordingDevice::CountResources(DeviceStats& stats)
+		{
+			stats.m_buffers = m_buffers.GetCount();
+			stats.m_textures = m_textures.GetCount();
+			stats.m_samplers = m_samplers.GetCount();
+			stats.m_pipelines = m_pipelines.GetCount();
+		}
+
+		void* RecordingDevice::Map(BufferHandle handle, MapMode mode)
+		{
+			m_context = "Map: ";
+			Buffer* buffer = m_buffers.Get(handle);
+			if (!buffer || !buffer->m_desc.m_dynamic || buffer->m_mapped)
+			{
+				Error("%s", !buffer ? "stale buffer" : buffer->m_mapped ? "buffer is already mapped" : "buffer is not dynamic");
+				return nullptr;
+			}
+			if (mode != MAP_WRITE_DISCARD && mode != MAP_WRITE_NO_OVERWRITE)
+			{
+				Error("unknown map mode %d", (int)mode);
+				return nullptr;
+			}
+			if (mode == MAP_WRITE_NO_OVERWRITE)
+			{
+				if ((buffer->m_desc.m_usage & BUFFER_CONSTANT) && !m_caps.m_mapNoOverwriteConstants)
+					Error("'%s' is a constant buffer, the device does not map those without overwrite", buffer->m_name.c_str());
+				else if (!buffer->m_discarded)
+					Error("'%s' was never mapped with discard, there are no contents to write around", buffer->m_name.c_str());
+			}
+			buffer->m_discarded = buffer->m_discarded || mode == MAP_WRITE_DISCARD;
+			buffer->m_mapped = true;
+			return buffer->m_memory.data();
+		}
+		void RecordingDevice::Unmap(BufferHandle handle)
+		{
+			m_context = "Unmap: ";
+			Buffer* buffer = m_buffers.Get(handle);
+			if (!buffer || !buffer->m_mapped)
+			{
+				Error("%s", !buffer ? "stale buffer" : "buffer is not mapped");
+				return;
+			}
+			buffer->m_mapped = false;
+		}
+
+		ResourceState RecordingDevice::GetState(BufferHandle handle)
+		{
+			Buffer* buffer = m_buffers.Get(handle);
+			return buffer ? buffer->m_state : STATE_UNDEFINED;
+		}
+		ResourceState RecordingDevice::GetState(TextureHandle handle)
+		{
+			Texture* texture = m_textures.Get(handle);
+			return texture ? texture->m_state : STATE_UNDEFINED;
+		}
+		const uint8_t* RecordingDevice::GetContents(BufferHandle handle)
+		{
+			Buffer* buffer = m_buffers.Get(handle);
+			return (buffer && buffer->m_desc.m_dynamic) ? buffer->m_memory.data() : nullptr;
+		}
+
+		// Submit
+		RecordingDevice::Buffer* RecordingDevice::GetBuffer(BufferHandle handle, uint32_t usage, const char* what)
+		{
+			Buffer* buffer = m_buffers.Get(handle);
+			if (!buffer)
+				Error("stale %s", what);
+			else if (!(buffer->m_desc.m_usage & usage))
+				Error("%s '%s' lacks the usage", what, buffer->m_name.c_str());
+			else
+				return buffer;
+			return nullptr;
+		}
+		bool RecordingDevice::CheckBuffer(BufferHandle handle, ResourceState state, const char* what)
+		{
+			Buffer* buffer = m_buffers.Get(handle);
+			if (!buffer)
+			{
+				Error("%s was destroyed", what);
+				return false;
+			}
+			if (buffer->m_mapped)
+				Error("%s '%s' is mapped", what, buffer->m_name.c_str());
+			if (buffer->m_state != state)
+				Error("%s '%s' is in %s, not %s", what, buffer->m_name.c_str(), GetStateName(buffer->m_state), GetStateName(state));
+			return true;
+		}
+		void RecordingDevice::CheckDraw(uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount, uint32_t firstInstance)
+		{
+			Pipeline* pipeline = m_pipelines.Get(m_bindings.m_pipeline);
+			if (!pipeline)
+			{
+				Error("no pipeline");
+				return;
+			}
+			if (!m_bindings.m_indexBuffer.IsValid())
+				Error("no index buffer");
+			else if (CheckBuffer(m_bindings.m_indexBuffer, STATE_INDEX_BUFFER, "index buffer"))
+			{
+				const Buffer* buffer = m_buffers.Get(m_bindings.m_indexBuffer);
+				uint64_t end = m_bindings.m_indexOffset + ((uint64_t)firstIndex + indexCount) * m_bindings.m_indexSize;
+				if (end > buffer->m_desc.m_size)
+					Error("indices %u to %u run past the %u byte index buffer '%s'", firstIndex, firstIndex + indexCount, buffer->m_desc.m_size, buffer->m_name.c_str());
+			}
+			for (uint32_t slot = 0; slot < MaxVertexBuffers; ++slot)
+			{
+				if (!(pipeline->m_vertexSlots & (1u << slot)))
+					continue;
+				const VertexBinding& binding = m_bindings.m_vertexBuffers[slot];
+				if (!binding.m_buffer.IsValid())
+				{
+					Error("pipeline reads vertex slot %u, nothing is bound", slot);
+					continue;
+				}
+				if (!CheckBuffer(binding.m_buffer, STATE_VERTEX_BUFFER, "vertex buffer"))
+					continue;
+				const Buffer* buffer = m_buffers.Get(binding.m_buffer);
+				if ((pipeline->m_instanceSlots & (1u << slot)) && binding.m_offset + ((uint64_t)firstInstance + instanceCount) * binding.m_stride > buffer->m_desc.m_size)
+					Error("instances %u to %u run past the %u byte buffer '%s'", firstInstance, firstInstance + instanceCount, buffer->m_desc.m_size, buffer->m_name.c_str());
+				if ((pipeline->m_instanceSlots & (1u << slot)) && binding.m_stride < pipeline->m_instanceStride[slot])
+					Error("slot %u stride %u is under the %u bytes read per instance", slot, binding.m_stride, pipeline->m_instanceStride[slot]);
+			}
+			for (uint32_t slot = 0; slot < MaxConstantBuffers; ++slot)
+			{
+				if (m_bindings.m_constantBuffers[slot].IsValid())
+					CheckBuffer(m_bindings.m_constantBuffers[slot], STATE_CONSTANT_BUFFER, "constant buffer");
+			}
+			for (uint32_t slot = 0; slot < MaxTextures; ++slot)
+			{
+				if (m_bindings.m_shaderBuffers[slot].IsValid())
+					CheckBuffer(m_bindings.m_shaderBuffers[slot], STATE_SHADER_RESOURCE, "shader buffer");
+				if (!m_bindings.m_textures[slot].IsValid())
+					continue;
+				const Texture* texture = m_textures.Get(m_bindings.m_textures[slot]);
+				if (!texture)
+					Error("texture in slot %u was destroyed", slot);
+				else if (texture->m_state != STATE_SHADER_RESOURCE)
+					Error("texture '%s' is in %s, not shader resource", texture->m_name.c_str(), GetStateName(texture->m_state));
+			}
+			m_recordingStats.m_draws++;
+			m_recordingStats.m_instances += instanceCount;
+			m_recordingStats.m_indices += indexCount;
+		}
+
+		void RecordingDevice::Submit(const CommandList& commands)
+		{
+			// Every list starts from nothing bound, as a deferred context does.
+			m_bindings = Bindings();
+			m_stats.m_submits++;
+			m_stats.m_commands += commands.GetCommandCount();
+			char context[64];
+			for (size_t i = 0; i < commands.GetCommands().size(); ++i)
+			{
+				const Command& c = commands.GetCommands()[i];
+				snprintf(context, sizeof(context), "Submit %llu, command %zu (%s): ", (unsigned long long)m_stats.m_submits, i, GetCommandName(c.m_type));
+				m_context = context;
+				bool slotValid = true;
+				switch (c.m_type)
+				{
+				case COMMAND_SET_PIPELINE:
+				{
+					PipelineHandle pipeline = c.GetHandle<PipelineHandle>();
+					if (pipeline.IsValid() && !m_pipelines.Get(pipeline))
+						Error("stale pipeline");
+					m_bindings.m_pipeline = pipeline;
+					m_recordingStats.m_pipelineBinds++;
+					break;
+				}
+				case COMMAND_SET_VERTEX_BUFFER:
+				{
+					slotValid = c.m_slot < MaxVertexBuffers;
+					if (!slotValid)
+						break;
+					BufferHandle buffer = c.GetHandle<BufferHandle>();
+					if (buffer.IsValid())
+						GetBuffer(buffer, BUFFER_VERTEX, "vertex buffer");
+					m_bindings.m_vertexBuffers[c.m_slot] = { buffer, c.m_args[0], c.m_args[1] };
+					break;
+				}
+				case COMMAND_SET_INDEX_BUFFER:
+				{
+					BufferHandle buffer = c.GetHandle<BufferHandle>();
+					if (buffer.IsValid())
+						GetBuffer(buffer, BUFFER_INDEX, "index buffer");
+					if (c.m_args[0] != FORMAT_R16_UINT && c.m_args[0] != FORMAT_R32_UINT)
+						Error("index format %u", c.m_args[0]);
+					m_bindings.m_indexBuffer = buffer;
+					m_bindings.m_indexSize = GetFormatSize((Format)c.m_args[0]);
+					m_bindings.m_indexOffset = c.m_args[1];
+					break;
+				}
+				case COMMAND_SET_CONSTANT_BUFFER:
+				{
+					slotValid = c.m_slot < MaxConstantBuffers;
+					if (!slotValid)
+						break;
+					BufferHandle handle = c.GetHandle<BufferHandle>();
+					if (handle.IsValid())
+					{
+						if (const Buffer* buffer = GetBuffer(handle, BUFFER_CONSTANT, "constant buffer"))
+						{
+							if (c.m_args[0] % ConstantAlignment != 0 || c.m_args[0] + c.m_args[1] > buffer->m_desc.m_size)
+								Error("range %u + %u in the %u byte buffer '%s'", c.m_args[0], c.m_args[1], buffer->m_desc.m_size, buffer->m_name.c_str());
+							if (c.m_args[0] != 0 && !m_caps.m_constantBufferOffsets)
+								Error("constant buffer offsets are not supported");
+						}
+					}
+					m_bindings.m_constantBuffers[c.m_slot] = handle;
+					break;
+				}
+				case COMMAND_SET_TEXTURE:
+				{
+					slotValid = c.m_slot < MaxTextures;
+					if (!slotValid)
+						break;
+					TextureHandle texture = c.GetHandle<TextureHandle>();
+					if (texture.IsValid() && !m_textures.Get(texture))
+						Error("stale texture");
+					m_bindings.m_textures[c.m_slot] = texture;
+					m_bindings.m_shaderBuffers[c.m_slot] = BufferHandle();
+					break;
+				}
+				case COMMAND_SET_SHADER_BUFFER:
+				{
+					slotValid = c.m_slot < MaxTextures;
+					if (!slotValid)
+						break;
+					BufferHandle buffer = c.GetHandle<BufferHandle>();
+					if (buffer.IsValid())
+						GetBuffer(buffer, BUFFER_SHADER_RESOURCE, "shader buffer");
+					m_bindings.m_shaderBuffers[c.m_slot] = buffer;
+					m_bindings.m_textures[c.m_slot] = TextureHandle();
+					break;
+				}
+				case COMMAND_SET_SAMPLER:
+				{
+					slotValid = c.m_slot < MaxSamplers;
+					SamplerHandle sampler = c.GetHandle<SamplerHandle>();
+					if (sampler.IsValid() && !m_samplers.Get(sampler))
+						Error("stale sampler");
+					break;
+				}
+				case COMMAND_DRAW_INDEXED:
+					CheckDraw(c.m_args[0], c.m_args[1], 1, 0);
+					break;
+				case COMMAND_DRAW_INDEXED_INSTANCED:
+					CheckDraw(c.m_args[0], c.m_args[1], c.m_args[3], c.m_args[4]);
+					break;
+				case COMMAND_BUFFER_BARRIER:
+				case COMMAND_TEXTURE_BARRIER:
+				{
+					ResourceState* state = nullptr;
+					if (c.m_type == COMMAND_BUFFER_BARRIER)
+					{
+						Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+						state = buffer ? &buffer->m_state : nullptr;
+					}
+					else
+					{
+						Texture* texture = m_textures.Get(c.GetHandle<TextureHandle>());
+						state = texture ? &texture->m_state : nullptr;
+					}
+					if (!state)
+					{
+						Error("stale resource");
+						break;
+					}
+					if (*state != (ResourceState)c.m_args[0])
+						Error("resource is in %s, the barrier expects %s", GetStateName(*state), GetStateName((ResourceState)c.m_args[0]));
+					*state = (ResourceState)c.m_args[1];
+					m_recordingStats.m_barriers++;
+					break;
+				}
+				case COMMAND_UPDATE_BUFFER:
+				{
+					Buffer* buffer = m_buffers.Get(c.GetHandle<BufferHandle>());
+					if (!buffer)
+					{
+						Error("stale buffer");
+						break;
+					}
+					if ((uint64_t)c.m_args[0] + c.m_args[1] > buffer->m_desc.m_size)
+					{
+						Error("%u + %u bytes run past the %u byte buffer '%s'", c.m_args[0], c.m_args[1], buffer->m_desc.m_size, buffer->m_name.c_str());
+						break;
+					}
+					if (buffer->m_mapped)
+						Error("buffer '%s' is mapped", buffer->m_name.c_str());
+					if (buffer->m_desc.m_dynamic)
+						memcpy(buffer->m_memory.data() + c.m_args[0], commands.GetPayload(c.m_args[2]), c.m_args[1]);
+					else if (buffer->m_state != STATE_COPY_DEST)
+						Error("buffer '%s' is in %s, not copy dest", buffer->m_name.c_str(), GetStateName(buffer->m_state));
+					m_recordingStats.m_updates++;
+					m_recordingStats.m_updateBytes += c.m_args[1];
+					break;
+				}
+				default:
+					Error("unknown command");
+					break;
+				}
+				if (!slotValid)
+					Error("slot %u out of range", c.m_slot);
+			}
+		}
+	}
+}
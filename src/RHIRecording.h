@@ -0,0 +1,123 @@
+#pragma once
+
+#include "RHI.h"
+
+#include <string>
+#include <vector>
+
+namespace Renderer
+{
+	namespace RHI
+	{
+		struct RecordingStats
+		{
+			uint64_t m_draws = 0;
+			uint64_t m_instances = 0;
+			uint64_t m_indices = 0; // Per instance.
+			uint64_t m_pipelineBinds = 0;
+			uint64_t m_barriers = 0;
+			uint64_t m_updates = 0;
+			uint64_t m_updateBytes = 0;
+			uint64_t m_errors = 0; // Every error, GetErrors keeps the first RHI_RECORDING_MAX_ERRORS.
+		};
+
+		// Recording Device // Nothing reaches a GPU. Every call and submitted command is checked against the resource
+		// descriptions, usage flags and states a stricter API would enforce, and counted. Dynamic buffers are backed by
+		// memory, so Map and UpdateBuffer behave as on a GPU and their contents can be read back.
+		class RecordingDevice : public Device
+		{
+		public:
+			const char* GetName() override { return "Recording"; }
+			const DeviceCaps& GetCaps() override { return m_caps; }
+
+			BufferHandle CreateBuffer(const BufferDesc& desc, const void* data = nullptr) override;
+			TextureHandle CreateTexture(const TextureDesc& desc, const SubresourceData* data = nullptr) override;
+			SamplerHandle CreateSampler(const SamplerDesc& desc) override;
+			PipelineHandle CreatePipeline(const PipelineDesc& desc) override;
+
+			void* Map(BufferHandle buffer, MapMode mode) override;
+			void Unmap(BufferHandle buffer) override;
+
+			void Submit(const CommandList& commands) override;
+
+			// Frames complete this many EndFrames after their own, 0 completes them at once.
+			void SetLatency(uint32_t frames) { m_latency = frames; }
+
+			const RecordingStats& GetRecordingStats() { return m_recordingStats; }
+			const std::vector<std::string>& GetErrors() { return m_errors; }
+			void ClearErrors() { m_errors.clear(); m_recordingStats.m_errors = 0; }
+
+			// Inspection // STATE_UNDEFINED and nullptr for stale handles.
+			ResourceState GetState(BufferHandle buffer);
+			ResourceState GetState(TextureHandle texture);
+			const uint8_t* GetContents(BufferHandle buffer); // Dynamic buffers only.
+
+		protected:
+			void SignalFrame(uint64_t frame) override { m_signaled = frame + 1; }
+			bool PollFrame(uint64_t frame, bool wait) override { return wait || m_signaled - frame > m_latency; }
+			void Release(ResourceType type, uint32_t index, uint32_t generation) override;
+			void CountResources(DeviceStats& stats) override;
+
+		private:
+			struct Buffer
+			{
+				BufferDesc m_desc;
+				std::string m_name;
+				ResourceState m_state = STATE_UNDEFINED;
+				std::vector<uint8_t> m_memory; // Dynamic buffers.
+				bool m_mapped = false;
+				bool m_discarded = false; // No-overwrite maps write into contents a discard map first handed out.
+			};
+			struct Texture
+			{
+				TextureDesc m_desc;
+				std::string m_name;
+				ResourceState m_state = STATE_UNDEFINED;
+			};
+			struct Pipeline
+			{
+				uint32_t m_vertexSlots = 0; // Bit per input slot read.
+				uint32_t m_instanceSlots = 0; // Of those, stepped per instance.
+				uint32_t m_instanceStride[MaxVertexBuffers] = {}; // Bytes read per instance.
+			};
+			// Bindings while a list is checked.
+			struct VertexBinding
+			{
+				BufferHandle m_buffer;
+				uint32_t m_stride = 0;
+				uint32_t m_offset = 0;
+			};
+			struct Bindings
+			{
+				PipelineHandle m_pipeline;
+				VertexBinding m_vertexBuffers[MaxVertexBuffers];
+				BufferHandle m_indexBuffer;
+				uint32_t m_indexSize = 0;
+				uint32_t m_indexOffset = 0;
+				BufferHandle m_constantBuffers[MaxConstantBuffers];
+				TextureHandle m_textures[MaxTextures];
+				BufferHandle m_shaderBuffers[MaxTextures];
+			};
+
+			void Error(const char* format, ...);
+			Buffer* GetBuffer(BufferHandle buffer, uint32_t usage, const char* what);
+			bool CheckBuffer(BufferHandle buffer, ResourceState state, const char* what);
+			void CheckDraw(uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount, uint32_t firstInstance);
+
+		private:
+			DeviceCaps m_caps;
+			HandlePool<Buffer, BufferHandle> m_buffers;
+			HandlePool<Texture, TextureHandle> m_textures;
+			HandlePool<SamplerDesc, SamplerHandle> m_samplers;
+			HandlePool<Pipeline, PipelineHandle> m_pipelines;
+
+			Bindings m_bindings;
+			std::string m_context; // Command being checked, prefixed to errors.
+			uint64_t m_signaled = 0;
+			uint32_t m_latency = 0;
+			RecordingStats m_recordingStats;
+			std::vector<std::string> m_errors;
+
+		};
+	}
+}
@@ -0,0 +1,159 @@
+#include "RenderQueue.h"
+
+#include <string.h>
+
+namespace Renderer
+{
+	uint64_t SortKey::Make(RenderPass pass, unsigned int shader, unsigned int material, float depth)
+	{
+		// Positive floats sort correctly as unsigned integers.
+		if (depth < 0.0f)
+			depth = 0.0f;
+		uint32_t depthBits;
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+		// Transparent draws are drawn back to front.
+		if (pass == PASS_TRANSPARENT)
+			depthBits = ~depthBits;
+
+		return ((uint64_t)(pass & 0xf) << 60)
+			| ((uint64_t)(shader & 0xfff) << 48)
+			| ((uint64_t)(material & 0xffff) << 32)
+			| (uint64_t)depthBits;
+	}
+
+	uint64_t SortKey::MakeInstanced(RenderPass pass, unsigned int shader, unsigned int material, unsigned int mesh)
+	{
+		return ((uint64_t)(pass & 0xf) << 60)
+			| ((uint64_t)(shader & 0xfff) << 48)
+			| ((uint64_t)(material & 0xffff) << 32)
+			| (uint64_t)mesh;
+	}
+
+	float SortKey::ViewDepth(const Math::Matrix4F& model, const Math::Matrix4F& view)
+	{
+		// The z row of model * view applied to the origin, negated as the camera looks down -z.
+		return -(model.m03 * view.m20 + model.m13 * view.m21 + model.m23 * view.m22 + model.m33 * view.m23);
+	}
+
+	void RenderQueue::Submit(uint64_t key, const DrawItem& item)
+	{
+		m_entries.push_back({ key, (uint32_t)m_items.size() });
+		m_items.push_back(item);
+	}
+	void RenderQueue::Sort()
+	{
+		// LSD radix sort, 16 bits per pass, skipping passes where every key shares the digit.
+		size_t count = m_entries.size();
+		m_scratch.resize(count);
+		m_histogram.resize(1 << 16);
+		uint32_t* histogram = m_histogram.data();
+		for (int shift = 0; shift < 64; shift += 16)
+		{
+			memset(histogram, 0, m_histogram.size() * sizeof(uint32_t));
+			for (size_t i = 0; i < count; ++i)
+				histogram[(m_entries[i].m_key >> shift) & 0xffff]++;
+			if (count == 0 || histogram[(m_entries[0].m_key >> shift) & 0xffff] == count)
+				continue;
+
+			uint32_t sum = 0;
+			for (int d = 0; d < (1 << 16); ++d)
+			{
+				uint32_t c = histogram[d];
+				histogram[d] = sum;
+				sum += c;
+			}
+			for (size_t i = 0; i < count; ++i)
+				m_scratch[histogram[(m_entries[i].m_key >> shift) & 0xffff]++] = m_entries[i];
+			m_entries.swap(m_scratch);
+		}
+	}
+	void RenderQueue::Execute(CommandSink& sink)
+	{
+		m_stats = {};
+		Execute(sink, 0, m_entries.size(), m_instances, m_stats);
+	}
+	void RenderQueue::Execute(CommandSink& sink, size_t begin, size_t end, std::vector<Math::Matrix4F>& instances, RenderQueueStats& stats)
+	{
+		// Every range starts with nothing bound, so ranges can be recorded apart.
+		Meshes::Shader* shader = nullptr;
+		Meshes::Texture* texture = nullptr;
+		RHI::BufferHandle constants;
+		uint32_t constantOffset = 0;
+		Meshes::Mesh* mesh = nullptr;
+		uint32_t material = 0;
+		bool first = true;
+		for (size_t i = begin; i < end;)
+		{
+			const DrawItem& item = m_items[m_entries[i].m_index];
+			if (first || item.m_shader != shader)
+			{
+				shader = item.m_shader;
+				sink.BindShader(shader);
+				stats.m_shaderBinds++;
+			}
+			else
+				stats.m_stateChangesSaved++;
+			if (first || item.m_texture != texture)
+			{
+				texture = item.m_texture;
+				sink.BindTexture(texture);
+				stats.m_textureBinds++;
+			}
+			else
+				stats.m_stateChangesSaved++;
+			if (first || item.m_constantBuffer != constants || item.m_constantOffset != constantOffset)
+			{
+				constants = item.m_constantBuffer;
+				constantOffset = item.m_constantOffset;
+				sink.BindConstants(constants, constantOffset, item.m_constantSize);
+				stats.m_constantBinds++;
+			}
+			else
+				stats.m_stateChangesSaved++;
+			if (first || item.m_mesh != mesh)
+			{
+				mesh = item.m_mesh;
+				sink.BindMesh(mesh);
+				stats.m_meshBinds++;
+			}
+			else
+				stats.m_stateChangesSaved++;
+			if (first || item.m_material != material)
+			{
+				material = item.m_material;
+				sink.BindMaterial(material);
+				stats.m_materialBinds++;
+			}
+			else
+				stats.m_stateChangesSaved++;
+			first = false;
+
+			if (!item.m_instanced)
+			{
+				sink.Draw(item);
+				stats.m_draws++;
+				i++;
+				continue;
+			}
+			// Instancing // Gather the run of matching items into one transform array.
+			instances.clear();
+			for (; i < end && instances.size() < INSTANCE_BUFFER_CAPACITY; ++i)
+			{
+				const DrawItem& next = m_items[m_entries[i].m_index];
+				if (!next.m_instanced || next.m_mesh != item.m_mesh || next.m_shader != item.m_shader || next.m_texture != item.m_texture || next.m_material != item.m_material
+					|| next.m_firstIndex != item.m_firstIndex || next.m_indexCount != item.m_indexCount)
+					break;
+				instances.push_back(next.m_modelViewProj);
+			}
+			sink.DrawInstanced(item, instances.data(), (uint32_t)instances.size());
+			stats.m_draws++;
+			stats.m_instancedDraws++;
+			stats.m_instances += (unsigned int)instances.size();
+		}
+	}
+	void RenderQueue::Clear()
+	{
+		m_items.clear();
+		m_entries.clear();
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Math.h"
+#include "RHI.h"
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace Renderer
+{
+	class Renderer;
+	namespace Meshes
+	{
+		struct Mesh;
+		struct Shader;
+		struct Texture;
+	}
+
+	// Draw call captured by the null backend.
+	struct DrawRecord
+	{
+		const void* m_mesh;
+		uint32_t m_indexCount;
+		Math::Matrix4F m_modelViewProj; // First instance when instanced.
+		uint32_t m_instanceCount;
+	};
+
+	typedef enum
+	{
+		PASS_OPAQUE,
+		PASS_TRANSPARENT,
+		PASS_MAX
+	} RenderPass;
+
+	// Sort Key Layout (MSB to LSB) // pass:4 | shader:12 | material:16 | depth:32
+	// The material field is the texture's sort id, materials sharing a texture or texture array draw together without rebinding it.
+	// Instanced draws put the mesh id where the depth was, so every copy of a mesh lands next to each other.
+	struct SortKey
+	{
+		static uint64_t Make(RenderPass pass, unsigned int shader, unsigned int material, float depth);
+		static uint64_t MakeInstanced(RenderPass pass, unsigned int shader, unsigned int material, unsigned int mesh);
+		// Distance in front of the camera of the model's origin, the view space depth the projection divides by.
+		static float ViewDepth(const Math::Matrix4F& model, const Math::Matrix4F& view);
+	};
+
+	struct DrawItem
+	{
+		Meshes::Mesh* m_mesh;
+		Meshes::Shader* m_shader;
+		Meshes::Texture* m_texture;
+		RHI::BufferHandle m_constantBuffer;
+		uint32_t m_constantOffset = 0; // Bytes into m_constantBuffer, a multiple of 256.
+		uint32_t m_constantSize = 0;
+		Math::Matrix4F m_modelViewProj;
+		uint32_t m_material = 0; // Material library id, indexes the material buffer.
+		bool m_instanced = false; // Merged with neighbouring draws of the same mesh, shader and texture.
+		uint32_t m_firstIndex = 0; // Range drawn, the whole mesh or a run of visible meshlets.
+		uint32_t m_indexCount = 0;
+	};
+
+	struct RenderQueueStats
+	{
+		unsigned int m_draws;
+		unsigned int m_instancedDraws;
+		unsigned int m_instances; // Items drawn through instanced draws.
+		unsigned int m_shaderBinds;
+		unsigned int m_textureBinds;
+		unsigned int m_constantBinds;
+		unsigned int m_meshBinds;
+		unsigned int m_materialBinds;
+		unsigned int m_stateChangesSaved;
+		unsigned int m_commandLists;
+		double m_recordMs; // Recording every command list, across however many threads.
+		double m_submitMs; // Handing them to the device in order, main thread.
+	};
+
+	// Receives the state changes left after elision // Implemented per backend. Every change is forwarded, a null texture included.
+	class CommandSink
+	{
+	public:
+		virtual ~CommandSink() { }
+
+		virtual void BindShader(Meshes::Shader* shader) = 0;
+		virtual void BindTexture(Meshes::Texture* texture) = 0;
+		virtual void BindConstants(RHI::BufferHandle constantBuffer, uint32_t offset, uint32_t size) = 0;
+		virtual void BindMesh(Meshes::Mesh* mesh) = 0;
+		virtual void BindMaterial(uint32_t material) = 0;
+		virtual void Draw(const DrawItem& item) = 0;
+		// Never more than INSTANCE_BUFFER_CAPACITY transforms per call.
+		virtual void DrawInstanced(const DrawItem& item, const Math::Matrix4F* transforms, uint32_t count) = 0;
+	};
+
+	// Per-frame command buffer // Draws are submitted with a sort key, radix-sorted, then executed with redundant binds elided.
+	// On an RHI device the sorted draws are cut into runs of RHI_RECORD_CHUNK, each recorded into its own command list on a
+	// job system worker. Lists are submitted in queue order, the commands do not depend on the thread count.
+	// The backend sinks and recording live in RenderQueueSinks.cpp, the rest needs no device.
+	class RenderQueue
+	{
+	public:
+		void Submit(uint64_t key, const DrawItem& item);
+		void Sort();
+		void Execute(CommandSink& sink);
+		void Execute(Renderer& renderer);
+		void Clear();
+
+		size_t GetCount() { return m_items.size(); }
+		const RenderQueueStats& GetStats() { return m_stats; }
+
+		// Recording // Lists of the last Execute, in submission order.
+		void SetRecordThreadCount(int threads) { m_recordThreads = threads; }
+		size_t GetCommandListCount() { return m_chunkCount; }
+		const RHI::CommandList& GetCommandList(size_t index) { return m_chunks[index]->m_commands; }
+
+	private:
+		struct Entry
+		{
+			uint64_t m_key;
+			uint32_t m_index;
+		};
+		// One command list's share of the queue, only touched by the job recording it.
+		struct Chunk
+		{
+			RHI::CommandList m_commands;
+			std::vector<Math::Matrix4F> m_instances;
+			std::vector<DrawRecord> m_draws; // Null backend, appended to the renderer's in order.
+			RenderQueueStats m_stats;
+			uint32_t m_firstInstance; // Reserved in the instance ring before recording starts.
+		};
+
+		void Execute(CommandSink& sink, size_t begin, size_t end, std::vector<Math::Matrix4F>& instances, RenderQueueStats& stats);
+		void Record(Renderer& renderer);
+
+		std::vector<DrawItem> m_items;
+		std::vector<Entry> m_entries;
+		std::vector<Entry> m_scratch;
+		std::vector<uint32_t> m_histogram;
+		std::vector<Math::Matrix4F> m_instances;
+		std::vector<std::unique_ptr<Chunk>> m_chunks; // Kept across frames, lists reuse their memory.
+		size_t m_chunkCount = 0;
+		int m_recordThreads = RHI_RECORD_THREAD_COUNT;
+
+		RenderQueueStats m_stats = {};
+
+	};
+}
@@ -0,0 +1,202 @@
+#include "RenderQueue.h"
+#include "Renderer.h"
+#include "Meshes.h"
+#include "Jobs.h"
+#include "Material.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+namespace Renderer
+{
+	// Command List Sink // Records a range of the queue into one command list, on whichever thread runs it.
+	// On the null backend the device is the recording one, which checks every command, and the draws are kept as well.
+	class CommandListSink : public CommandSink
+	{
+	public:
+		CommandListSink(Renderer& renderer, RHI::CommandList& commands, uint32_t firstInstance, std::vector<DrawRecord>* draws)
+			: m_renderer(renderer)
+			, m_commands(commands)
+			, m_nextInstance(firstInstance)
+			, m_draws(draws)
+		{
+			m_commands.Reset();
+			// Instance transforms stay bound to slot 1, mesh binds only touch slot 0.
+			m_commands.SetVertexBuffer(1, m_renderer.GetInstanceBuffer(), sizeof(Math::Matrix4F));
+			// Every material for the whole list, draws only move the id table offset.
+			if (Materials.GetBuffer().IsValid())
+				m_commands.SetShaderBuffer(1, Materials.GetBuffer());
+		}
+
+		void BindShader(Meshes::Shader* shader) override { m_commands.SetPipeline(shader->m_pipeline); }
+		void BindTexture(Meshes::Texture* texture) override
+		{
+			// Untextured draws unbind the slot, the sampler left bound is never read.
+			m_commands.SetTexture(0, texture ? texture->m_texture : RHI::TextureHandle());
+			if (texture)
+				m_commands.SetSampler(0, texture->m_sampler);
+		}
+		void BindConstants(RHI::BufferHandle constantBuffer, uint32_t offset, uint32_t size) override { m_commands.SetConstantBuffer(0, constantBuffer, offset, size); }
+		void BindMesh(Meshes::Mesh* mesh) override
+		{
+			m_commands.SetVertexBuffer(0, mesh->m_vertexBuffer, mesh->m_stride, mesh->m_offset);
+			m_commands.SetIndexBuffer(mesh->m_indexBuffer, mesh->GetIndexFormat());
+		}
+		void BindMaterial(uint32_t material) override
+		{
+			if (Materials.GetIdTable().IsValid())
+				m_commands.SetConstantBuffer(1, Materials.GetIdTable(), material * RHI::ConstantAlignment, sizeof(uint32_t) * 4);
+		}
+		void Draw(const DrawItem& item) override
+		{
+			if (m_draws)
+				m_draws->push_back({ item.m_mesh, item.m_indexCount, item.m_modelViewProj, 1 });
+			m_commands.DrawIndexed(item.m_indexCount, item.m_firstIndex);
+		}
+		void DrawInstanced(const DrawItem& item, const Math::Matrix4F* transforms, uint32_t count) override
+		{
+			if (m_draws)
+				m_draws->push_back({ item.m_mesh, item.m_indexCount, transforms[0], count });
+			// Inside the range reserved for this list, one transform per instanced item.
+			m_renderer.WriteInstances(m_commands, m_nextInstance, transforms, count);
+			m_commands.DrawIndexedInstanced(item.m_indexCount, count, item.m_firstIndex, 0, m_nextInstance);
+			m_nextInstance += count;
+		}
+
+	private:
+		Renderer& m_renderer;
+		RHI::CommandList& m_commands;
+		uint32_t m_nextInstance;
+		std::vector<DrawRecord>* m_draws;
+	};
+
+	// Software Sink // Records like the null sink and hands every draw to the software rasterizer, which runs at the end of the frame.
+	class RasterSink : public CommandSink
+	{
+	public:
+		RasterSink(Renderer& renderer)
+			: m_renderer(renderer)
+			, m_rasterizer(renderer.GetSoftwareRasterizer())
+		{ }
+
+		void BindShader(Meshes::Shader* shader) override { }
+		void BindTexture(Meshes::Texture* texture) override { m_texture = texture ? texture->m_softwareTexture : nullptr; }
+		void BindConstants(RHI::BufferHandle constantBuffer, uint32_t offset, uint32_t size) override { }
+		void BindMesh(Meshes::Mesh* mesh) override { m_mesh = mesh; }
+		void BindMaterial(uint32_t material) override { }
+		void Draw(const DrawItem& item) override
+		{
+			m_renderer.RecordDraw(item.m_mesh, item.m_indexCount, item.m_modelViewProj);
+			Rasterize(item, item.m_modelViewProj);
+		}
+		void DrawInstanced(const DrawItem& item, const Math::Matrix4F* transforms, uint32_t count) override
+		{
+			m_renderer.RecordDraw(item.m_mesh, item.m_indexCount, transforms[0], count);
+			for (uint32_t i = 0; i < count; ++i)
+				Rasterize(item, transforms[i]);
+		}
+
+	private:
+		void Rasterize(const DrawItem& item, const Math::Matrix4F& modelViewProj)
+		{
+			// Needs the CPU copies, cooked meshes keep them on the software backend.
+			if (!m_mesh || m_mesh->m_vertices.empty() || item.m_firstIndex + item.m_indexCount > m_mesh->m_indices.size())
+				return;
+			m_rasterizer.DrawIndexed(modelViewProj, m_mesh->m_vertices.data(), (uint32_t)m_mesh->m_vertices.size(), sizeof(Meshes::TexVertex3D),
+				m_mesh->m_indices.data() + item.m_firstIndex, item.m_indexCount, m_texture);
+		}
+
+	private:
+		Renderer& m_renderer;
+		SoftwareRasterizer& m_rasterizer;
+		Meshes::Mesh* m_mesh = nullptr;
+		const SoftwareTexture* m_texture = nullptr;
+	};
+
+	void RenderQueue::Execute(Renderer& renderer)
+	{
+		Sort();
+		if (renderer.IsSoftware())
+		{
+			RasterSink sink(renderer);
+			Execute((CommandSink&)sink);
+		}
+		else
+			Record(renderer);
+		Clear();
+	}
+	void RenderQueue::Record(Renderer& renderer)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point start = Clock::now();
+		Materials.Update(); // Before any list binds the buffers, growing them changes the handles.
+		size_t count = m_entries.size();
+		m_chunkCount = (count + RHI_RECORD_CHUNK - 1) / RHI_RECORD_CHUNK;
+		while (m_chunks.size() < m_chunkCount)
+			m_chunks.push_back(std::make_unique<Chunk>());
+
+		// Instance ranges are reserved here in queue order, so no list shares a cursor and the offsets never depend on timing.
+		static_assert(RHI_RECORD_CHUNK <= INSTANCE_BUFFER_CAPACITY, "A chunk's instances must fit the instance ring.");
+		for (size_t c = 0; c < m_chunkCount; ++c)
+		{
+			Chunk& chunk = *m_chunks[c];
+			uint32_t instanced = 0;
+			for (size_t i = c * RHI_RECORD_CHUNK; i < std::min(count, (c + 1) * RHI_RECORD_CHUNK); ++i)
+				instanced += m_items[m_entries[i].m_index].m_instanced ? 1 : 0;
+			chunk.m_firstInstance = instanced ? renderer.ReserveInstances(instanced) : 0;
+			chunk.m_stats = {};
+			chunk.m_draws.clear();
+		}
+		bool keepDraws = renderer.IsNull();
+		auto record = [this, &renderer, count, keepDraws](size_t c)
+		{
+			Chunk& chunk = *m_chunks[c];
+			CommandListSink sink(renderer, chunk.m_commands, chunk.m_firstInstance, keepDraws ? &chunk.m_draws : nullptr);
+			Execute(sink, c * RHI_RECORD_CHUNK, std::min(count, (c + 1) * RHI_RECORD_CHUNK), chunk.m_instances, chunk.m_stats);
+		};
+		int workers = JobSystem.GetWorkerCount();
+		int jobs = (workers <= 1) ? 1 : std::max(1, std::min((int)m_chunkCount, (m_recordThreads > 0) ? m_recordThreads : workers));
+		if (jobs <= 1)
+		{
+			for (size_t c = 0; c < m_chunkCount; ++c)
+				record(c);
+		}
+		else
+		{
+			// Chunks are pulled one at a time, draw costs vary with the binds they need.
+			std::atomic<size_t> next = 0;
+			Jobs::Counter counter = 0;
+			JobSystem.Dispatch(jobs, 1, [this, &next, &record](int, int)
+				{
+					for (size_t c = next++; c < m_chunkCount; c = next++)
+						record(c);
+				}, &counter);
+			JobSystem.Wait(&counter);
+		}
+		Clock::time_point recorded = Clock::now();
+
+		// Submit // In queue order, the device sees the same commands at any thread count.
+		m_stats = {};
+		RHI::Device* device = renderer.GetRHI();
+		for (size_t c = 0; c < m_chunkCount; ++c)
+		{
+			Chunk& chunk = *m_chunks[c];
+			const RenderQueueStats& s = chunk.m_stats;
+			m_stats.m_draws += s.m_draws;
+			m_stats.m_instancedDraws += s.m_instancedDraws;
+			m_stats.m_instances += s.m_instances;
+			m_stats.m_shaderBinds += s.m_shaderBinds;
+			m_stats.m_textureBinds += s.m_textureBinds;
+			m_stats.m_constantBinds += s.m_constantBinds;
+			m_stats.m_meshBinds += s.m_meshBinds;
+			m_stats.m_materialBinds += s.m_materialBinds;
+			m_stats.m_stateChangesSaved += s.m_stateChangesSaved;
+			for (const DrawRecord& d : chunk.m_draws)
+				renderer.RecordDraw(d.m_mesh, d.m_indexCount, d.m_modelViewProj, d.m_instanceCount);
+			device->Submit(chunk.m_commands);
+		}
+		m_stats.m_commandLists = (unsigned int)m_chunkCount;
+		m_stats.m_recordMs = std::chrono::duration<double, std::milli>(recorded - start).count();
+		m_stats.m_submitMs = std::chrono::duration<double, std::milli>(Clock::now() - recorded).count();
+	}
+}
@@ -1,4 +1,7 @@
 #include "Renderer.h"
+#include "Profiler.h"
+#include "RHID3D11.h"
+
 
 namespace Renderer
 {
@@ -8,13 +11,20 @@ namespace Renderer
 		, m_deviceContext(nullptr)
 		, m_frameBuffer(nullptr)
 		, m_depthBuffer(nullptr)
-		, m_rasterizerState(nullptr)
-		, m_depthStencilState(nullptr)
+		, m_recording(nullptr)
+		, m_instanceOffset(INSTANCE_BUFFER_CAPACITY)
+		, m_constantsMapped(nullptr)
+		, m_constantNoOverwrite(false)
 		, m_infoQueue(nullptr)
+		, m_null(false)
+		, m_software(false)
 	{ }
 	Renderer::~Renderer()
 	{ }
 
+	// The ring sizes only fit a frame at a time if the device never runs further ahead than the ring retires.
+	static_assert(CONSTANT_RING_FRAMES <= RHI_FRAMES_IN_FLIGHT, "Constant ring frames outlive the device's frame fences.");
+
 	void Renderer::Create(Window& window)
 	{
 		m_window = window;
@@ -33,8 +43,45 @@ namespace Renderer
 		ImGui_ImplWin32_Init(window.GetWindowHandle());
 		ImGui_ImplDX11_Init(m_device, m_deviceContext);
 	}
+	void Renderer::CreateNull()
+	{
+		m_null = true;
+		m_recording = new RHI::RecordingDevice();
+		m_rhi.reset(m_recording);
+		CreateRingBuffers();
+
+		// ImGui // Context only, the UI is built every frame but never rendered.
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO();
+		io.IniFilename = 0; // Disable Config
+		io.DisplaySize = ImVec2((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT);
+		unsigned char* fontPixels;
+		int fontWidth, fontHeight;
+		io.Fonts->GetTexDataAsRGBA32(&fontPixels, &fontWidth, &fontHeight);
+	}
+	void Renderer::CreateSoftware(int width, int height)
+	{
+		CreateNull();
+		m_software = true;
+		m_softwareRasterizer.Create(width, height);
+		ImGui::GetIO().DisplaySize = ImVec2((float)width, (float)height);
+	}
 	void Renderer::Destroy()
 	{
+		// Handles still held by objects destroyed after this are ignored, see Mesh::Destroy.
+		m_rhi->Destroy(m_instanceBuffer);
+		m_rhi->Destroy(m_constantRing);
+		m_rhi->WaitIdle();
+		m_constantAllocator.Destroy();
+		if (m_null)
+		{
+			m_softwareRasterizer.Destroy();
+			ImGui::DestroyContext();
+			m_rhi.reset();
+			m_recording = nullptr;
+			return;
+		}
 		ImGui_ImplDX11_Shutdown();
 		ImGui_ImplWin32_Shutdown();
 		ImGui::DestroyContext();
@@ -44,17 +91,23 @@ namespace Renderer
 
 	void Renderer::BeginFrame(void)
 	{
+		float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
+		if (m_null)
+		{
+			m_drawRecords.clear();
+			if (m_software)
+				m_softwareRasterizer.Clear(clearColor);
+			ImGui::GetIO().DeltaTime = 1.0f / WINDOW_FPS;
+			ImGui::NewFrame();
+			return;
+		}
 		ImGui_ImplDX11_NewFrame();
 		ImGui_ImplWin32_NewFrame();
 		ImGui::NewFrame();
 
-		float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
 		m_deviceContext->ClearRenderTargetView(m_frameBuffer, clearColor);
 		m_deviceContext->ClearDepthStencilView(m_depthBuffer, D3D11_CLEAR_DEPTH, 1.0f, 0);
 
-		m_deviceContext->RSSetState(m_rasterizerState);
-		m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 0);
-
 		RECT winRect;
 		GetClientRect(m_window.GetWindowHandle(), &winRect);
 		D3D11_VIEWPORT viewport = { 
@@ -70,9 +123,34 @@ namespace Renderer
 	}
 	void Renderer::EndFrame(void)
 	{
-		ImGui::Render();
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		if (m_constantsMapped)
+			m_rhi->Unmap(m_constantRing);
+		m_constantsMapped = nullptr;
+		{
+			PROFILE_SCOPE("Render Queue");
+			m_renderQueue.Execute(*this);
+		}
+		if (m_software)
+		{
+			PROFILE_SCOPE("Rasterize");
+			m_softwareRasterizer.Flush();
+		}
+		// Constant Ring // The frame's constants stay live until the device completes it.
+		m_constantAllocator.EndFrame();
+		m_rhi->EndFrame();
+		if (!m_constantNoOverwrite)
+			m_constantAllocator.RetireFrame(); // A discard hands out fresh memory anyway.
+		else
+			RetireConstantFrames(m_constantAllocator.GetFramesInFlight() >= CONSTANT_RING_FRAMES);
+		{
+			PROFILE_SCOPE("ImGui");
+			ImGui::Render();
+			if (m_null)
+				return;
+			ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		}
 
+		PROFILE_SCOPE("Present");
 		m_swapChain->Present(1, 0);
 	}
 
@@ -207,28 +285,95 @@ namespace Renderer
 			depthBuffer->Release();
 		}
 
-		// Create States
+		// RHI
 		{
-			D3D11_RASTERIZER_DESC rasterizerDesc;
-			ZeroMemory(&rasterizerDesc, sizeof(D3D11_RASTERIZER_DESC));
-			rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-			rasterizerDesc.CullMode = D3D11_CULL_BACK;
-			rasterizerDesc.FrontCounterClockwise = true;
-			m_device->CreateRasterizerState(&rasterizerDesc, &m_rasterizerState);
-
-			D3D11_DEPTH_STENCIL_DESC depthStencilDesc;
-			ZeroMemory(&depthStencilDesc, sizeof(D3D11_DEPTH_STENCIL_DESC));
-			depthStencilDesc.DepthEnable = true;
-			depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-			depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
-			m_device->CreateDepthStencilState(&depthStencilDesc, &m_depthStencilState);
+			RHI::D3D11Device* device = new RHI::D3D11Device();
+			device->Create(m_device, m_deviceContext);
+			m_rhi.reset(device);
+			assert(device->GetCaps().m_constantBufferOffsets);
+			CreateRingBuffers();
 		}
 	}
+	void Renderer::CreateRingBuffers()
+	{
+		// Create Instance Buffer
+		{
+			RHI::BufferDesc instanceBufferDesc;
+			instanceBufferDesc.m_size = INSTANCE_BUFFER_CAPACITY * sizeof(Math::Matrix4F);
+			instanceBufferDesc.m_usage = RHI::BUFFER_VERTEX;
+			instanceBufferDesc.m_dynamic = true;
+			instanceBufferDesc.m_name = "Instances";
+			m_instanceBuffer = m_rhi->CreateBuffer(instanceBufferDesc);
+			assert(m_instanceBuffer.IsValid());
+		}
+
+		// Create Constant Ring
+		{
+			m_constantNoOverwrite = m_rhi->GetCaps().m_mapNoOverwriteConstants;
+
+			RHI::BufferDesc constantRingDesc;
+			constantRingDesc.m_size = CONSTANT_RING_SIZE;
+			constantRingDesc.m_usage = RHI::BUFFER_CONSTANT;
+			constantRingDesc.m_dynamic = true;
+			constantRingDesc.m_name = "Constant Ring";
+			m_constantRing = m_rhi->CreateBuffer(constantRingDesc);
+			assert(m_constantRing.IsValid());
+			m_constantAllocator.Create(CONSTANT_RING_SIZE);
+		}
+	}
+	void* Renderer::AllocateConstants(UINT size, UINT& offset)
+	{
+		// Offsets are counted in 16 byte constants and must be multiples of 16 of them.
+		size_t allocation = m_constantAllocator.Allocate(size, RHI::ConstantAlignment);
+		if (allocation == Memory::RingAllocator::InvalidOffset && m_constantNoOverwrite && m_constantAllocator.GetFramesInFlight() > 0)
+		{
+			// Full // Wait for the oldest frame, the GPU is the bottleneck at this point.
+			RetireConstantFrames(true);
+			allocation = m_constantAllocator.Allocate(size, RHI::ConstantAlignment);
+		}
+		if (allocation == Memory::RingAllocator::InvalidOffset)
+			return nullptr;
+		offset = (UINT)allocation;
+
+		if (!m_constantsMapped)
+		{
+			// One map per frame, discarding only when nothing in the ring is still in flight.
+			RHI::MapMode mapMode = m_constantAllocator.GetFramesInFlight() > 0 ? RHI::MAP_WRITE_NO_OVERWRITE : RHI::MAP_WRITE_DISCARD;
+			m_constantsMapped = (uint8_t*)m_rhi->Map(m_constantRing, mapMode);
+			assert(m_constantsMapped);
+		}
+		return m_constantsMapped + offset;
+	}
+	void Renderer::RetireConstantFrames(bool wait)
+	{
+		// Frames complete in order, stop at the first one still running. The ring's frames are the device's latest.
+		while (m_constantAllocator.GetFramesInFlight() > 0)
+		{
+			if (!m_rhi->IsFrameComplete(m_rhi->GetFrameIndex() - m_constantAllocator.GetFramesInFlight(), wait))
+				break;
+			wait = false;
+			m_constantAllocator.RetireFrame();
+		}
+	}
+
+	UINT Renderer::ReserveInstances(UINT count)
+	{
+		// Append without stalling, wrap only once the ring is full. The write at offset 0 discards.
+		if (m_instanceOffset + count > INSTANCE_BUFFER_CAPACITY)
+			m_instanceOffset = 0;
+		UINT firstInstance = m_instanceOffset;
+		m_instanceOffset += count;
+		return firstInstance;
+	}
+	void Renderer::WriteInstances(RHI::CommandList& commands, UINT firstInstance, const Math::Matrix4F* transforms, UINT count)
+	{
+		commands.UpdateBuffer(m_instanceBuffer, firstInstance * sizeof(Math::Matrix4F), transforms, count * sizeof(Math::Matrix4F));
+	}
+
 	void Renderer::DestroyDX()
 	{
+		m_rhi.reset();
 		m_swapChain->Release();
-		m_depthStencilState->Release();
-		m_rasterizerState->Release();
 		m_depthBuffer->Release();
 		m_frameBuffer->Release();
 		m_device->Release();
@@ -1,11 +1,20 @@
 #pragma once
 
 #include "Common.h"
+#include "Math.h"
 #include "Window.h"
+#include "RenderQueue.h"
+#include "Memory.h"
+#include "SoftwareRasterizer.h"
+#include "RHI.h"
+#include "RHIRecording.h"
 
 #include <d3d11_1.h>
 #include <d3dcompiler.h>
 
+#include <memory>
+#include <vector>
+
 namespace Renderer
 {
 	class Renderer
@@ -15,6 +24,9 @@ namespace Renderer
 		~Renderer();
 
 		void Create(Window& window);
+		void CreateNull();
+		// Null backend that also draws, into a software rasterizer target of the given size.
+		void CreateSoftware(int width = WINDOW_WIDTH, int height = WINDOW_HEIGHT);
 		void Destroy();
 
 		void BeginFrame(void);
@@ -26,12 +38,51 @@ namespace Renderer
 		ID3D11DeviceContext1* GetDeviceContext(void) { return m_deviceContext; }
 		ID3D11InfoQueue* GetInfoQueue(void) { return m_infoQueue; }
 
+		RenderQueue& GetRenderQueue(void) { return m_renderQueue; }
+
+		// RHI // Every mesh, texture, shader and draw goes through this device. The D3D11 one on a window, the recording one
+		// on the null and software backends. The device and context above stay for the swap chain and ImGui.
+		RHI::Device* GetRHI(void) { return m_rhi.get(); }
+		RHI::RecordingDevice* GetRecordingDevice(void) { return m_recording; } // Null backends only.
+
+		// Null Backend // No device is created, draws are recorded instead of issued.
+		bool IsNull(void) { return m_null; }
+		void RecordDraw(const void* mesh, UINT indexCount, const Math::Matrix4F& modelViewProj, UINT instanceCount = 1) { m_drawRecords.push_back({ mesh, indexCount, modelViewProj, instanceCount }); }
+		const std::vector<DrawRecord>& GetDrawRecords(void) { return m_drawRecords; }
+
+		// Software Backend // Null backend whose render queue is rasterized on the CPU at the end of each frame.
+		bool IsSoftware(void) { return m_software; }
+		SoftwareRasterizer& GetSoftwareRasterizer(void) { return m_softwareRasterizer; }
+
+		// Instancing // Per-instance transforms in a ring buffer bound to input slot 1. Ranges are reserved on the main thread
+		// in submission order, then written by a command on the list recording the draws, from any thread.
+		UINT ReserveInstances(UINT count);
+		void WriteInstances(RHI::CommandList& commands, UINT firstInstance, const Math::Matrix4F* transforms, UINT count);
+		RHI::BufferHandle GetInstanceBuffer(void) { return m_instanceBuffer; }
+
+		// Constant Ring // Per-object constants sub-allocated from one buffer, mapped once per frame and bound by offset.
+		// Returns the destination to write size bytes to, or nullptr when every byte is still in use by the GPU.
+		void* AllocateConstants(UINT size, UINT& offset);
+		RHI::BufferHandle GetConstantRing(void) { return m_constantRing; }
+		Memory::RingAllocator& GetConstantAllocator(void) { return m_constantAllocator; }
+
 	private:
 		void InitDX();
 		void DestroyDX();
+		void CreateRingBuffers();
+		void RetireConstantFrames(bool wait);
 
 	private:
 		Window m_window;
+		bool m_null;
+		std::vector<DrawRecord> m_drawRecords;
+		bool m_software;
+		SoftwareRasterizer m_softwareRasterizer;
+
+		RenderQueue m_renderQueue;
+
+		std::unique_ptr<RHI::Device> m_rhi;
+		RHI::RecordingDevice* m_recording;
 
 		IDXGISwapChain1* m_swapChain;
 		ID3D11Device1* m_device;
@@ -41,8 +92,13 @@ namespace Renderer
 		ID3D11RenderTargetView* m_frameBuffer;
 		ID3D11DepthStencilView* m_depthBuffer;
 
-		ID3D11RasterizerState* m_rasterizerState;
-		ID3D11DepthStencilState* m_depthStencilState;
+		RHI::BufferHandle m_instanceBuffer;
+		UINT m_instanceOffset;
+
+		RHI::BufferHandle m_constantRing;
+		Memory::RingAllocator m_constantAllocator;
+		uint8_t* m_constantsMapped; // Between the first allocation of a frame and EndFrame.
+		bool m_constantNoOverwrite; // Device allows NO_OVERWRITE on constant buffers, otherwise every frame discards.
 
 	};
 }
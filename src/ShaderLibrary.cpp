@@ -0,0 +1,311 @@
+#include "ShaderLibrary.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+namespace Renderer
+{
+	// FNV-1a
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::string ShaderPermutation::GetKey() const
+	{
+		std::string key = std::filesystem::path(m_path).generic_string();
+		key += "|" + m_entryPoint + "|" + m_profile;
+		for (const auto& d : m_defines)
+			key += "|" + d.first + "=" + d.second;
+		return key;
+	}
+
+	void ShaderLibrary::Create(Renderer& renderer, const char* cacheDirectory)
+	{
+		m_renderer = &renderer;
+		m_cacheDirectory = cacheDirectory;
+		std::error_code error;
+		std::filesystem::create_directories(m_cacheDirectory, error);
+	}
+	void ShaderLibrary::Destroy()
+	{
+		ClearMemoryCache();
+		for (auto& p : m_programs)
+		{
+			if (m_renderer && m_renderer->GetRHI())
+				m_renderer->GetRHI()->Destroy(p.second.m_pipeline);
+			if (p.first.first)
+				p.first.first->Release();
+			if (p.first.second)
+				p.first.second->Release();
+		}
+		m_programs.clear();
+		m_renderer = nullptr;
+	}
+
+	ID3DBlob* ShaderLibrary::GetBytecode(const ShaderPermutation& permutation)
+	{
+		std::string key = permutation.GetKey();
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			auto it = m_bytecode.find(key);
+			if (it != m_bytecode.end())
+			{
+				m_stats.m_memoryHits++;
+				it->second->AddRef();
+				return it->second;
+			}
+		}
+
+		// Source // The disk cache name covers the source text and every compile option.
+		std::ifstream file(std::filesystem::path(permutation.m_path), std::ios::binary);
+		if (!file)
+		{
+			const char* errorString = "D3DCompileFromFile error: File not found.";
+			MessageBox(0, errorString, "Error", MB_OK);
+			OutputDebugString(errorString);
+			OutputDebugString("\n");
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.m_failures++;
+			return nullptr;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		std::string source = stream.str();
+		uint64_t hash = HashBytes(key.data(), key.size(), HashBytes(source.data(), source.size()));
+		char cacheName[32];
+		snprintf(cacheName, sizeof(cacheName), "%016llx.cso", (unsigned long long)hash);
+		std::string cacheFile = m_cacheDirectory + cacheName;
+
+		// Disk, then compile.
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point start = Clock::now();
+		ID3DBlob* blob = m_diskCache ? ReadCache(cacheFile) : nullptr;
+		bool fromDisk = blob != nullptr;
+		if (!blob)
+		{
+			blob = CompileSource(permutation, source);
+			if (blob && m_diskCache)
+				WriteCache(cacheFile, blob);
+		}
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		if (!blob)
+		{
+			m_stats.m_failures++;
+			return nullptr;
+		}
+		if (fromDisk)
+		{
+			m_stats.m_diskHits++;
+			m_stats.m_diskMs += ms;
+		}
+		else
+		{
+			m_stats.m_compiles++;
+			m_stats.m_compileMs += ms;
+		}
+		auto it = m_bytecode.find(key);
+		if (it != m_bytecode.end())
+		{
+			// Another thread got there first, keep one copy.
+			blob->Release();
+			blob = it->second;
+		}
+		else
+			m_bytecode[key] = blob;
+		blob->AddRef();
+		return blob;
+	}
+	bool ShaderLibrary::Compile(LPCWSTR path, Meshes::ShaderBlobs& blobs, bool instanced)
+	{
+		// Only the vertex shader changes when instanced, the pixel shader bytecode is shared.
+		ShaderPermutation vertex = { path, "vs_main", "vs_5_0" };
+		ShaderPermutation pixel = { path, "ps_main", "ps_5_0" };
+		if (instanced)
+			vertex.m_defines.push_back({ "INSTANCED", "1" });
+		blobs.m_vertexBlob = GetBytecode(vertex);
+		blobs.m_pixelBlob = GetBytecode(pixel);
+		blobs.m_instanced = instanced;
+		if (!blobs.m_vertexBlob || !blobs.m_pixelBlob)
+		{
+			blobs.Release();
+			return false;
+		}
+		return true;
+	}
+
+	ID3DBlob* ShaderLibrary::CompileSource(const ShaderPermutation& permutation, const std::string& source)
+	{
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const auto& d : permutation.m_defines)
+			macros.push_back({ d.first.c_str(), d.second.c_str() });
+		macros.push_back({ nullptr, nullptr });
+		std::string sourceName = std::filesystem::path(permutation.m_path).string();
+
+		ID3DBlob* blob = nullptr;
+		ID3DBlob* shaderCompileErrors = nullptr;
+		HRESULT result = D3DCompile(
+			source.data(),
+			source.size(),
+			sourceName.c_str(),
+			macros.data(),
+			nullptr,
+			permutation.m_entryPoint.c_str(),
+			permutation.m_profile.c_str(),
+			0,
+			0,
+			&blob,
+			&shaderCompileErrors
+		);
+		if (FAILED(result))
+		{
+			const char* errorString = shaderCompileErrors ? (const char*)shaderCompileErrors->GetBufferPointer() : "Unknown error.";
+			MessageBox(0, errorString, "Error", MB_OK);
+			OutputDebugString("D3DCompile error: ");
+			OutputDebugString(errorString);
+			OutputDebugString("\n");
+			if (shaderCompileErrors)
+				shaderCompileErrors->Release();
+			if (blob)
+				blob->Release();
+			return nullptr;
+		}
+		if (shaderCompileErrors)
+			shaderCompileErrors->Release();
+		return blob;
+	}
+	ID3DBlob* ShaderLibrary::ReadCache(const std::string& file)
+	{
+		FILE* f = fopen(file.c_str(), "rb");
+		if (!f)
+			return nullptr;
+		fseek(f, 0, SEEK_END);
+		long size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		ID3DBlob* blob = nullptr;
+		if (size <= 0 || FAILED(D3DCreateBlob((SIZE_T)size, &blob)) || fread(blob->GetBufferPointer(), 1, size, f) != (size_t)size)
+		{
+			if (blob)
+				blob->Release();
+			blob = nullptr;
+		}
+		fclose(f);
+		return blob;
+	}
+	void ShaderLibrary::WriteCache(const std::string& file, ID3DBlob* blob)
+	{
+		// Written to a temporary name first so a concurrent reader never sees half a file.
+		std::string temp = file + ".tmp";
+		FILE* f = fopen(temp.c_str(), "wb");
+		if (!f)
+			return;
+		bool written = fwrite(blob->GetBufferPointer(), 1, blob->GetBufferSize(), f) == blob->GetBufferSize();
+		fclose(f);
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(temp, file, error);
+		else
+			std::filesystem::remove(temp, error);
+	}
+
+	void ShaderLibrary::CreateShader(const Meshes::ShaderBlobs& blobs, Meshes::Shader& shader)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::pair<ID3DBlob*, ID3DBlob*> key(blobs.m_vertexBlob, blobs.m_pixelBlob);
+		auto it = m_programs.find(key);
+		if (it != m_programs.end())
+		{
+			m_stats.m_programHits++;
+		}
+		else
+		{
+			static unsigned int nextId = 1;
+			Meshes::Shader program;
+			program.m_id = nextId++;
+			program.m_instanced = blobs.m_instanced;
+			if (m_renderer && m_renderer->GetRHI())
+			{
+				// Input Layout // Instanced shaders also read one transform per instance from slot 1.
+				const RHI::VertexElement elements[] =
+				{
+					{ "POSITION", 0, RHI::FORMAT_RGB32_FLOAT, 0, 0, false },
+					{ "TEXCOORD", 0, RHI::FORMAT_RG32_FLOAT, 0, RHI::AppendElement, false },
+					{ "INSTANCE", 0, RHI::FORMAT_RGBA32_FLOAT, 1, 0, true },
+					{ "INSTANCE", 1, RHI::FORMAT_RGBA32_FLOAT, 1, RHI::AppendElement, true },
+					{ "INSTANCE", 2, RHI::FORMAT_RGBA32_FLOAT, 1, RHI::AppendElement, true },
+					{ "INSTANCE", 3, RHI::FORMAT_RGBA32_FLOAT, 1, RHI::AppendElement, true },
+				};
+				// Without bytecode only the recording device creates a pipeline, the layout is still checked against draws.
+				RHI::PipelineDesc pipelineDesc;
+				if (blobs.m_vertexBlob && blobs.m_pixelBlob)
+				{
+					pipelineDesc.m_vertexCode = blobs.m_vertexBlob->GetBufferPointer();
+					pipelineDesc.m_vertexCodeSize = blobs.m_vertexBlob->GetBufferSize();
+					pipelineDesc.m_pixelCode = blobs.m_pixelBlob->GetBufferPointer();
+					pipelineDesc.m_pixelCodeSize = blobs.m_pixelBlob->GetBufferSize();
+				}
+				pipelineDesc.m_elements = elements;
+				pipelineDesc.m_elementCount = blobs.m_instanced ? ARRAYSIZE(elements) : 2;
+				program.m_pipeline = m_renderer->GetRHI()->CreatePipeline(pipelineDesc);
+			}
+			// The key holds a reference so the pointers stay unique while the program lives.
+			if (key.first)
+				key.first->AddRef();
+			if (key.second)
+				key.second->AddRef();
+			it = m_programs.emplace(key, program).first;
+			m_stats.m_programs++;
+		}
+
+		// Pipelines live until the library is destroyed, every Shader shares the handle.
+		shader = it->second;
+	}
+
+	int ShaderLibrary::Precompile(const char* directory)
+	{
+		int failures = 0;
+		std::error_code error;
+		for (auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			if (!entry.is_regular_file() || entry.path().extension() != ".hlsl")
+				continue;
+			for (int instanced = 0; instanced < 2; ++instanced)
+			{
+				Meshes::ShaderBlobs blobs;
+				if (!Compile(entry.path().wstring().c_str(), blobs, instanced != 0))
+					failures++;
+				blobs.Release();
+			}
+		}
+		return failures;
+	}
+	void ShaderLibrary::ClearMemoryCache()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		for (auto& b : m_bytecode)
+			b.second->Release();
+		m_bytecode.clear();
+	}
+
+	ShaderLibraryStats ShaderLibrary::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_stats;
+	}
+	void ShaderLibrary::ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stats = ShaderLibraryStats();
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Common.h"
+#include "Meshes.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define Shaders (Renderer::ShaderLibrary::Instance())
+
+namespace Renderer
+{
+	// One compiled entry point of a shader file.
+	struct ShaderPermutation
+	{
+		std::wstring m_path;
+		std::string m_entryPoint;
+		std::string m_profile;
+		std::vector<std::pair<std::string, std::string>> m_defines;
+
+		std::string GetKey() const;
+	};
+
+	struct ShaderLibraryStats
+	{
+		UINT m_memoryHits = 0;
+		UINT m_diskHits = 0;
+		UINT m_compiles = 0; // Misses, compiled from source.
+		UINT m_failures = 0;
+		UINT m_programs = 0; // Unique shader objects created.
+		UINT m_programHits = 0; // Shader objects shared instead of created.
+		double m_compileMs = 0.0;
+		double m_diskMs = 0.0;
+	};
+
+	// Shader Library // Each permutation is compiled once, bytecode is cached in memory and on disk by a hash of its source and options.
+	// Pipelines are created once per vertex and pixel bytecode pair and shared by every Shader using it.
+	class ShaderLibrary
+	{
+	public:
+		void Create(Renderer& renderer, const char* cacheDirectory = SHADER_CACHE_PATH);
+		void Destroy();
+
+		// Thread-safe // Returns an AddRef'd blob, or nullptr on failure.
+		ID3DBlob* GetBytecode(const ShaderPermutation& permutation);
+		bool Compile(LPCWSTR path, Meshes::ShaderBlobs& blobs, bool instanced = false);
+
+		// Main thread.
+		void CreateShader(const Meshes::ShaderBlobs& blobs, Meshes::Shader& shader);
+
+		// Offline // Compiles every .hlsl under a directory into the disk cache, plain and instanced, returns the number that failed.
+		int Precompile(const char* directory);
+		void ClearMemoryCache();
+		void SetDiskCache(bool enabled) { m_diskCache = enabled; }
+
+		ShaderLibraryStats GetStats();
+		void ResetStats();
+
+	private:
+		ID3DBlob* CompileSource(const ShaderPermutation& permutation, const std::string& source);
+		ID3DBlob* ReadCache(const std::string& file);
+		void WriteCache(const std::string& file, ID3DBlob* blob);
+
+	private:
+		Renderer* m_renderer = nullptr;
+		std::string m_cacheDirectory;
+		bool m_diskCache = true;
+
+		std::mutex m_lock;
+		std::unordered_map<std::string, ID3DBlob*> m_bytecode;
+		std::map<std::pair<ID3DBlob*, ID3DBlob*>, Meshes::Shader> m_programs;
+		ShaderLibraryStats m_stats;
+
+	private:
+		ShaderLibrary() { }
+
+	public:
+		// Singleton Design Pattern
+		static ShaderLibrary& Instance()
+		{
+			static ShaderLibrary instance;
+			return instance;
+		}
+
+		ShaderLibrary(ShaderLibrary const&) = delete;
+		void operator=(ShaderLibrary const&) = delete;
+
+	};
+}
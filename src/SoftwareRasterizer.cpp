@@ -0,0 +1,751 @@
+#include "SoftwareRasterizer.h"
+#include "Jobs.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Renderer
+{
+	static_assert(RASTER_TILE_SIZE % 8 == 0, "RASTER_TILE_SIZE must be a multiple of the 8x8 depth blocks.");
+
+	static const uint32_t VertexRangeSize = 4096;
+	static const uint32_t MinBatchSize = 1024; // Triangles per binning job.
+	static const float GuardBand = 8.0f; // Viewports each side, screen positions stay small enough to snap exactly.
+	static const int SubpixelBits = 8; // As D3D.
+	static const float SubpixelScale = (float)(1 << SubpixelBits);
+
+	static inline int RoundToInt(float value)
+	{
+#if defined(MATH_SIMD_SSE)
+		return _mm_cvtss_si32(_mm_set_ss(value));
+#else
+		return (int)lrintf(value);
+#endif
+	}
+
+	static inline int CountBits(int mask)
+	{
+		static const int counts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+		return counts[mask & 15];
+	}
+	static inline uint32_t PackColor(const float color[4])
+	{
+		uint32_t packed = 0;
+		for (int i = 0; i < 4; ++i)
+			packed |= (uint32_t)(std::min(std::max(color[i], 0.0f), 1.0f) * 255.0f + 0.5f) << (i * 8);
+		return packed;
+	}
+
+	// Sampling // Wrap addressing, texel centres on half integers, the nearest mip level by the screen space footprint.
+	static inline int Wrap(int i, int size)
+	{
+		i %= size;
+		return (i < 0) ? i + size : i;
+	}
+	static inline uint32_t Lerp(uint32_t a, uint32_t b, uint32_t t)
+	{
+		// Two channels per multiply, t is 0 to 256.
+		uint32_t rb = (((a & 0x00ff00ff) * (256 - t) + (b & 0x00ff00ff) * t) >> 8) & 0x00ff00ff;
+		uint32_t ga = (((a >> 8) & 0x00ff00ff) * (256 - t) + ((b >> 8) & 0x00ff00ff) * t) & 0xff00ff00;
+		return rb | ga;
+	}
+	static inline uint32_t SampleBilinear(const SoftwareTexture::Level& level, float u, float v)
+	{
+		float x = u * level.m_width - 0.5f, y = v * level.m_height - 0.5f;
+		if (!(fabsf(x) < 1.0e8f) || !(fabsf(y) < 1.0e8f))
+			x = y = 0.0f; // Degenerate coordinates, keep the integer conversion defined.
+		float fx = floorf(x), fy = floorf(y);
+		int x0 = Wrap((int)fx, level.m_width), y0 = Wrap((int)fy, level.m_height);
+		int x1 = (x0 + 1 == level.m_width) ? 0 : x0 + 1;
+		int y1 = (y0 + 1 == level.m_height) ? 0 : y0 + 1;
+		uint32_t tx = (uint32_t)((x - fx) * 256.0f), ty = (uint32_t)((y - fy) * 256.0f);
+		const uint32_t* row0 = level.m_texels.data() + (size_t)y0 * level.m_width;
+		const uint32_t* row1 = level.m_texels.data() + (size_t)y1 * level.m_width;
+		return Lerp(Lerp(row0[x0], row0[x1], tx), Lerp(row1[x0], row1[x1], tx), ty);
+	}
+
+	void SoftwareRasterizer::Create(int width, int height)
+	{
+		const float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
+		Resize(width, height);
+		Clear(clearColor, 1.0f);
+	}
+	void SoftwareRasterizer::Destroy()
+	{
+		m_color = std::vector<uint32_t>();
+		m_depth = std::vector<float>();
+		m_blockMaxZ = std::vector<float>();
+		m_draws = std::vector<Draw>();
+		m_clipVertices = std::vector<ClipVertex>();
+		m_vertexRanges = std::vector<VertexRange>();
+		m_batches = std::vector<Batch>();
+		m_tileStats = std::vector<TileStats>();
+		m_width = m_height = m_pitch = m_rows = 0;
+		m_tilesX = m_tilesY = m_blocksX = 0;
+	}
+	void SoftwareRasterizer::Resize(int width, int height)
+	{
+		m_width = std::max(width, 1);
+		m_height = std::max(height, 1);
+		m_tilesX = (m_width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		m_tilesY = (m_height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		m_pitch = m_tilesX * RASTER_TILE_SIZE;
+		m_rows = m_tilesY * RASTER_TILE_SIZE;
+		m_blocksX = m_pitch / 8;
+		m_color.assign((size_t)m_pitch * m_rows, m_clearColor);
+		m_depth.assign((size_t)m_pitch * m_rows, m_clearDepth);
+		m_blockMaxZ.assign((size_t)m_blocksX * (m_rows / 8), m_clearDepth);
+		for (Batch& batch : m_batches)
+			batch.m_bins.clear();
+	}
+
+	void SoftwareRasterizer::Clear(const float color[4], float depth)
+	{
+		m_clearColor = PackColor(color);
+		m_clearDepth = depth;
+		m_clearPending = true;
+	}
+	void SoftwareRasterizer::DrawIndexed(const Math::Matrix4F& modelViewProj, const void* vertices, uint32_t vertexCount, uint32_t stride,
+		const uint32_t* indices, uint32_t indexCount, const SoftwareTexture* texture)
+	{
+		if (!vertices || !indices || vertexCount == 0 || indexCount < 3)
+			return;
+		Draw draw;
+		draw.m_modelViewProj = modelViewProj;
+		draw.m_vertices = (const uint8_t*)vertices;
+		draw.m_vertexCount = vertexCount;
+		draw.m_stride = stride;
+		draw.m_indices = indices;
+		draw.m_indexCount = indexCount - indexCount % 3;
+		draw.m_texture = (texture && !texture->m_levels.empty()) ? texture : nullptr;
+		draw.m_firstVertex = 0;
+		draw.m_firstTriangle = 0;
+		m_draws.push_back(draw);
+	}
+
+	int SoftwareRasterizer::GetJobCount(int count)
+	{
+		int workers = JobSystem.GetWorkerCount();
+		if (workers <= 1)
+			return 1;
+		return std::max(1, std::min(count, (m_threadCount > 0) ? m_threadCount : workers));
+	}
+	void SoftwareRasterizer::Parallel(int count, void (*function)(SoftwareRasterizer&, int))
+	{
+		int jobs = GetJobCount(count);
+		if (jobs <= 1)
+		{
+			for (int i = 0; i < count; ++i)
+				function(*this, i);
+			return;
+		}
+		// Items are pulled one at a time, tiles differ too much in cost for a fixed split.
+		std::atomic<int> next = 0;
+		Jobs::Counter counter = 0;
+		JobSystem.Dispatch(jobs, 1, [this, &next, count, function](int, int)
+			{
+				for (int i = next++; i < count; i = next++)
+					function(*this, i);
+			}, &counter);
+		JobSystem.Wait(&counter);
+	}
+
+	void SoftwareRasterizer::Flush()
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		m_stats = RasterStats();
+		m_stats.m_draws = (uint32_t)m_draws.size();
+
+		// Vertices // Every vertex of every draw to clip space, instances of a mesh are transformed once each.
+		Clock::time_point start = Clock::now();
+		uint32_t vertexCount = 0, triangleCount = 0;
+		m_vertexRanges.clear();
+		for (uint32_t d = 0; d < (uint32_t)m_draws.size(); ++d)
+		{
+			Draw& draw = m_draws[d];
+			draw.m_firstVertex = vertexCount;
+			draw.m_firstTriangle = triangleCount;
+			for (uint32_t first = 0; first < draw.m_vertexCount; first += VertexRangeSize)
+				m_vertexRanges.push_back({ d, first, std::min(VertexRangeSize, draw.m_vertexCount - first) });
+			vertexCount += draw.m_vertexCount;
+			triangleCount += draw.m_indexCount / 3;
+		}
+		m_stats.m_triangles = triangleCount;
+		m_clipVertices.resize(vertexCount);
+		{
+			PROFILE_SCOPE("Raster Vertices");
+			Parallel((int)m_vertexRanges.size(), TransformRange);
+		}
+		Clock::time_point vertices = Clock::now();
+
+		// Triangles // Clipped, set up and binned in runs of consecutive triangles, each run keeps its own bins.
+		// Tiles read the runs in order, so the submission order survives without any job waiting on another.
+		uint32_t batchSize = std::max(MinBatchSize, (triangleCount + GetJobCount(INT_MAX) * 4 - 1) / (GetJobCount(INT_MAX) * 4));
+		m_batchCount = (triangleCount + batchSize - 1) / batchSize;
+		if (m_batches.size() < m_batchCount)
+			m_batches.resize(m_batchCount);
+		for (uint32_t b = 0; b < m_batchCount; ++b)
+		{
+			m_batches[b].m_firstTriangle = b * batchSize;
+			m_batches[b].m_triangleCount = std::min(batchSize, triangleCount - b * batchSize);
+		}
+		{
+			PROFILE_SCOPE("Raster Binning");
+			Parallel((int)m_batchCount, BinBatch);
+		}
+		for (uint32_t b = 0; b < m_batchCount; ++b)
+		{
+			const Batch& batch = m_batches[b];
+			m_stats.m_trianglesClipped += batch.m_clipped;
+			m_stats.m_trianglesCulled += batch.m_culled;
+			m_stats.m_trianglesBinned += (uint32_t)batch.m_triangles.size();
+			for (const std::vector<uint32_t>& bin : batch.m_bins)
+				m_stats.m_binEntries += (uint32_t)bin.size();
+		}
+		Clock::time_point binned = Clock::now();
+
+		// Tiles // One job per tile at a time, each owns its pixels outright.
+		m_tileStats.assign((size_t)m_tilesX * m_tilesY, TileStats());
+		{
+			PROFILE_SCOPE("Raster Tiles");
+			Parallel(m_tilesX * m_tilesY, RasterTile);
+		}
+		m_clearPending = false;
+		for (const TileStats& tile : m_tileStats)
+		{
+			m_stats.m_blocksRejected += tile.m_blocksRejected;
+			m_stats.m_pixelsCovered += tile.m_pixelsCovered;
+			m_stats.m_pixelsShaded += tile.m_pixelsShaded;
+		}
+		Clock::time_point end = Clock::now();
+		m_stats.m_vertexMs = std::chrono::duration<double, std::milli>(vertices - start).count();
+		m_stats.m_binMs = std::chrono::duration<double, std::milli>(binned - vertices).count();
+		m_stats.m_rasterMs = std::chrono::duration<double, std::milli>(end - binned).count();
+		m_draws.clear();
+	}
+
+	void SoftwareRasterizer::TransformRange(SoftwareRasterizer& rasterizer, int range)
+	{
+		const VertexRange& r = rasterizer.m_vertexRanges[range];
+		const Draw& draw = rasterizer.m_draws[r.m_draw];
+		const float* m0 = draw.m_modelViewProj.m[0];
+		const float* m1 = draw.m_modelViewProj.m[1];
+		const float* m2 = draw.m_modelViewProj.m[2];
+		const float* m3 = draw.m_modelViewProj.m[3];
+		ClipVertex* out = rasterizer.m_clipVertices.data() + draw.m_firstVertex + r.m_first;
+		const uint8_t* in = draw.m_vertices + (size_t)r.m_first * draw.m_stride;
+		for (uint32_t i = 0; i < r.m_count; ++i, in += draw.m_stride)
+		{
+			// Clip space rows, as the vertex shader's mul(float4(position, 1), modelViewProj).
+			const float* p = (const float*)in;
+			const float* uv = p + 3;
+			out[i].m_x = m0[0] * p[0] + m0[1] * p[1] + m0[2] * p[2] + m0[3];
+			out[i].m_y = m1[0] * p[0] + m1[1] * p[1] + m1[2] * p[2] + m1[3];
+			out[i].m_z = m2[0] * p[0] + m2[1] * p[1] + m2[2] * p[2] + m2[3];
+			out[i].m_w = m3[0] * p[0] + m3[1] * p[1] + m3[2] * p[2] + m3[3];
+			out[i].m_u = uv[0];
+			out[i].m_v = uv[1];
+		}
+	}
+
+	void SoftwareRasterizer::BinBatch(SoftwareRasterizer& rasterizer, int index)
+	{
+		Batch& batch = rasterizer.m_batches[index];
+		batch.m_triangles.clear();
+		batch.m_bins.resize((size_t)rasterizer.m_tilesX * rasterizer.m_tilesY);
+		for (std::vector<uint32_t>& bin : batch.m_bins)
+			bin.clear();
+		batch.m_clipped = 0;
+		batch.m_culled = 0;
+		if (batch.m_triangleCount == 0)
+			return;
+
+		// First draw holding the run's first triangle.
+		const std::vector<Draw>& draws = rasterizer.m_draws;
+		size_t d = std::upper_bound(draws.begin(), draws.end(), batch.m_firstTriangle, [](uint32_t triangle, const Draw& draw) { return triangle < draw.m_firstTriangle; }) - draws.begin() - 1;
+		uint32_t end = batch.m_firstTriangle + batch.m_triangleCount;
+		for (uint32_t t = batch.m_firstTriangle; t < end; ++t)
+		{
+			while (t >= draws[d].m_firstTriangle + draws[d].m_indexCount / 3)
+				d++;
+			const Draw& draw = draws[d];
+			const uint32_t* indices = draw.m_indices + (size_t)(t - draw.m_firstTriangle) * 3;
+			if (indices[0] >= draw.m_vertexCount || indices[1] >= draw.m_vertexCount || indices[2] >= draw.m_vertexCount)
+			{
+				batch.m_culled++;
+				continue;
+			}
+			const ClipVertex* vertices = rasterizer.m_clipVertices.data() + draw.m_firstVertex;
+			rasterizer.ClipTriangle(batch, vertices[indices[0]], vertices[indices[1]], vertices[indices[2]], draw.m_texture);
+		}
+	}
+
+	// Clipping // Near and far as D3D (0 <= z <= w), the sides only at the guard band, the viewport scissors the rest.
+	static inline float PlaneDistance(const float* v, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return v[2];
+		case 1: return v[3] - v[2];
+		case 2: return v[0] + GuardBand * v[3];
+		case 3: return GuardBand * v[3] - v[0];
+		case 4: return v[1] + GuardBand * v[3];
+		default: return GuardBand * v[3] - v[1];
+		}
+	}
+	static inline uint32_t OutCode(const float* v)
+	{
+		uint32_t code = 0;
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			if (PlaneDistance(v, plane) < 0.0f)
+				code |= 1u << plane;
+		}
+		// View volume sides, only used to reject.
+		code |= (v[0] < -v[3]) ? (1u << 6) : 0;
+		code |= (v[0] > v[3]) ? (1u << 7) : 0;
+		code |= (v[1] < -v[3]) ? (1u << 8) : 0;
+		code |= (v[1] > v[3]) ? (1u << 9) : 0;
+		return code;
+	}
+	void SoftwareRasterizer::ClipTriangle(Batch& batch, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftwareTexture* texture)
+	{
+		uint32_t codeA = OutCode(&a.m_x), codeB = OutCode(&b.m_x), codeC = OutCode(&c.m_x);
+		if (codeA & codeB & codeC)
+		{
+			batch.m_culled++;
+			return;
+		}
+		uint32_t planes = (codeA | codeB | codeC) & 0x3f;
+		if (!planes)
+		{
+			SetupTriangle(batch, a, b, c, texture);
+			return;
+		}
+
+		// Sutherland-Hodgman, each plane adds at most one vertex.
+		batch.m_clipped++;
+		ClipVertex polygons[2][9];
+		ClipVertex* in = polygons[0];
+		ClipVertex* out = polygons[1];
+		in[0] = a;
+		in[1] = b;
+		in[2] = c;
+		int count = 3;
+		for (int plane = 0; plane < 6 && count >= 3; ++plane)
+		{
+			if (!(planes & (1u << plane)))
+				continue;
+			int outCount = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				const ClipVertex& current = in[i];
+				const ClipVertex& next = in[(i + 1 == count) ? 0 : i + 1];
+				float dc = PlaneDistance(&current.m_x, plane), dn = PlaneDistance(&next.m_x, plane);
+				if (dc >= 0.0f)
+					out[outCount++] = current;
+				if ((dc >= 0.0f) == (dn >= 0.0f))
+					continue;
+				// Always from the inside vertex, so both triangles sharing the edge get the same point.
+				const ClipVertex& inside = (dc >= 0.0f) ? current : next;
+				const ClipVertex& outside = (dc >= 0.0f) ? next : current;
+				float di = (dc >= 0.0f) ? dc : dn, dout = (dc >= 0.0f) ? dn : dc;
+				float t = di / (di - dout);
+				const float* p = &inside.m_x;
+				const float* q = &outside.m_x;
+				float* r = &out[outCount++].m_x;
+				for (int k = 0; k < 6; ++k)
+					r[k] = p[k] + (q[k] - p[k]) * t;
+			}
+			std::swap(in, out);
+			count = outCount;
+		}
+		if (count < 3)
+		{
+			batch.m_culled++;
+			return;
+		}
+		for (int i = 1; i + 1 < count; ++i)
+			SetupTriangle(batch, in[0], in[i], in[i + 1], texture);
+	}
+
+	void SoftwareRasterizer::SetupTriangle(Batch& batch, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftwareTexture* texture)
+	{
+		// Project // D3D viewport, y down, depth 0 to 1. Positions snap to the subpixel grid, which keeps the edge slopes exact.
+		const ClipVertex* input[3] = { &a, &b, &c };
+		int fixedX[3], fixedY[3];
+		float x[3], y[3], z[3], invW[3], uOverW[3], vOverW[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const ClipVertex& v = *input[i];
+			float inv = 1.0f / v.m_w;
+			fixedX[i] = RoundToInt((v.m_x * inv * 0.5f + 0.5f) * m_width * SubpixelScale);
+			fixedY[i] = RoundToInt((0.5f - v.m_y * inv * 0.5f) * m_height * SubpixelScale);
+			x[i] = fixedX[i] / SubpixelScale;
+			y[i] = fixedY[i] / SubpixelScale;
+		}
+		// Counter-clockwise on screen is front facing, which is a negative area with y down. Back faces and slivers go,
+		// front faces are flipped to clockwise so every edge function is positive inside.
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (!(area < 0.0f))
+		{
+			batch.m_culled++;
+			return;
+		}
+		// Pixel centres inside the bounds, centre i is i + 0.5 pixels.
+		Triangle triangle;
+		const int half = 1 << (SubpixelBits - 1), round = (1 << SubpixelBits) - 1;
+		triangle.m_minX = std::max(0, (std::min({ fixedX[0], fixedX[1], fixedX[2] }) - half + round) >> SubpixelBits);
+		triangle.m_minY = std::max(0, (std::min({ fixedY[0], fixedY[1], fixedY[2] }) - half + round) >> SubpixelBits);
+		triangle.m_maxX = std::min(m_width - 1, (std::max({ fixedX[0], fixedX[1], fixedX[2] }) - half) >> SubpixelBits);
+		triangle.m_maxY = std::min(m_height - 1, (std::max({ fixedY[0], fixedY[1], fixedY[2] }) - half) >> SubpixelBits);
+		if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY)
+		{
+			batch.m_culled++;
+			return;
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			const ClipVertex& v = *input[(i == 0) ? 0 : 3 - i]; // Flipped to clockwise.
+			float inv = 1.0f / v.m_w;
+			z[i] = v.m_z * inv;
+			invW[i] = inv;
+			uOverW[i] = v.m_u * inv;
+			vOverW[i] = v.m_v * inv;
+		}
+		area = -area;
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+
+		// Edge i is opposite vertex i. A shared edge is set up from the same two vertices in the other order on the
+		// neighbouring triangle, its coefficients and values are exact negations, so the top-left rule leaves no gaps or overlaps.
+		triangle.m_topLeft = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			int from = (i + 1) % 3, to = (i + 2) % 3;
+			float A = y[from] - y[to];
+			float B = x[to] - x[from];
+			float C = x[from] * y[to] - y[from] * x[to];
+			triangle.m_edgeA[i] = A;
+			triangle.m_edgeB[i] = B;
+			triangle.m_edgeC[i] = C;
+			triangle.m_acceptBias[i] = (fabsf(A) * m_pitch + fabsf(B) * m_rows + fabsf(C)) * 4.0f * FLT_EPSILON;
+			if (A > 0.0f || (A == 0.0f && B > 0.0f))
+				triangle.m_topLeft |= 1u << i;
+		}
+		// Planes // Barycentrics are the edge functions over the area. Depth is linear in screen space, the uv
+		// is interpolated over w along with 1 / w and divided per pixel.
+		float invArea = 1.0f / area;
+		auto plane = [&](const float* values, float* out)
+		{
+			float px = (values[0] * triangle.m_edgeA[0] + values[1] * triangle.m_edgeA[1] + values[2] * triangle.m_edgeA[2]) * invArea;
+			float py = (values[0] * triangle.m_edgeB[0] + values[1] * triangle.m_edgeB[1] + values[2] * triangle.m_edgeB[2]) * invArea;
+			out[0] = values[0] - px * x[0] - py * y[0];
+			out[1] = px;
+			out[2] = py;
+		};
+		plane(z, triangle.m_z);
+		plane(invW, triangle.m_invW);
+		plane(uOverW, triangle.m_uOverW);
+		plane(vOverW, triangle.m_vOverW);
+		triangle.m_minZ = std::min({ z[0], z[1], z[2] });
+		triangle.m_texture = texture;
+
+		// Bin
+		uint32_t index = (uint32_t)batch.m_triangles.size();
+		batch.m_triangles.push_back(triangle);
+		int tileX0 = triangle.m_minX / RASTER_TILE_SIZE, tileX1 = triangle.m_maxX / RASTER_TILE_SIZE;
+		int tileY0 = triangle.m_minY / RASTER_TILE_SIZE, tileY1 = triangle.m_maxY / RASTER_TILE_SIZE;
+		for (int ty = tileY0; ty <= tileY1; ++ty)
+		{
+			for (int tx = tileX0; tx <= tileX1; ++tx)
+				batch.m_bins[(size_t)ty * m_tilesX + tx].push_back(index);
+		}
+	}
+
+	void SoftwareRasterizer::RasterTile(SoftwareRasterizer& rasterizer, int tile)
+	{
+		int tileX = tile % rasterizer.m_tilesX, tileY = tile / rasterizer.m_tilesX;
+		if (rasterizer.m_clearPending)
+		{
+			int pitch = rasterizer.m_pitch;
+			for (int y = tileY * RASTER_TILE_SIZE; y < (tileY + 1) * RASTER_TILE_SIZE; ++y)
+			{
+				size_t row = (size_t)y * pitch + tileX * RASTER_TILE_SIZE;
+				std::fill_n(rasterizer.m_color.data() + row, RASTER_TILE_SIZE, rasterizer.m_clearColor);
+				std::fill_n(rasterizer.m_depth.data() + row, RASTER_TILE_SIZE, rasterizer.m_clearDepth);
+			}
+			for (int by = tileY * RASTER_TILE_SIZE / 8; by < (tileY + 1) * RASTER_TILE_SIZE / 8; ++by)
+				std::fill_n(rasterizer.m_blockMaxZ.data() + (size_t)by * rasterizer.m_blocksX + tileX * RASTER_TILE_SIZE / 8, RASTER_TILE_SIZE / 8, rasterizer.m_clearDepth);
+		}
+		TileStats& stats = rasterizer.m_tileStats[tile];
+		for (uint32_t b = 0; b < rasterizer.m_batchCount; ++b)
+		{
+			const Batch& batch = rasterizer.m_batches[b];
+			for (uint32_t index : batch.m_bins[tile])
+				rasterizer.RasterTriangle(batch.m_triangles[index], tileX, tileY, stats);
+		}
+	}
+
+	void SoftwareRasterizer::RasterTriangle(const Triangle& triangle, int tileX, int tileY, TileStats& stats)
+	{
+		int x0 = std::max(triangle.m_minX, tileX * RASTER_TILE_SIZE), x1 = std::min(triangle.m_maxX, tileX * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1);
+		int y0 = std::max(triangle.m_minY, tileY * RASTER_TILE_SIZE), y1 = std::min(triangle.m_maxY, tileY * RASTER_TILE_SIZE + RASTER_TILE_SIZE - 1);
+		for (int blockY = y0 & ~7; blockY <= y1; blockY += 8)
+		{
+			for (int blockX = x0 & ~7; blockX <= x1; blockX += 8)
+			{
+				// Hierarchical Depth // Nothing in the block can pass when the triangle's nearest point is behind its farthest pixel.
+				if (triangle.m_minZ >= m_blockMaxZ[(size_t)(blockY / 8) * m_blocksX + blockX / 8])
+				{
+					stats.m_blocksRejected++;
+					continue;
+				}
+				// Corners of the block's pixel centres inside the bounds, edge functions are linear so they bound the rest.
+				int bx0 = std::max(blockX, x0), bx1 = std::min(blockX + 7, x1);
+				int by0 = std::max(blockY, y0), by1 = std::min(blockY + 7, y1);
+				float cx0 = bx0 + 0.5f, cx1 = bx1 + 0.5f, cy0 = by0 + 0.5f, cy1 = by1 + 0.5f;
+				bool outside = false, inside = true;
+				for (int e = 0; e < 3 && !outside; ++e)
+				{
+					float A = triangle.m_edgeA[e], B = triangle.m_edgeB[e], C = triangle.m_edgeC[e];
+					float e00 = A * cx0 + (B * cy0 + C), e10 = A * cx1 + (B * cy0 + C);
+					float e01 = A * cx0 + (B * cy1 + C), e11 = A * cx1 + (B * cy1 + C);
+					outside = std::max({ e00, e10, e01, e11 }) < 0.0f;
+					inside = inside && std::min({ e00, e10, e01, e11 }) > triangle.m_acceptBias[e];
+				}
+				if (outside)
+					continue;
+				if (RasterBlock(triangle, blockX, bx0, by0, bx1, by1, inside, stats))
+					UpdateBlockDepth(blockX / 8, blockY / 8);
+			}
+		}
+	}
+
+	// Mip level for the screen footprint at (px, py), from the derivatives of u = (u / w) / (1 / w).
+	static inline int SelectLevel(const SoftwareTexture& texture, const float* invW, const float* uOverW, const float* vOverW, float px, float py)
+	{
+		int levels = (int)texture.m_levels.size();
+		if (levels == 1)
+			return 0;
+		float iw = invW[1] * px + (invW[2] * py + invW[0]);
+		float u = (uOverW[1] * px + (uOverW[2] * py + uOverW[0])) / iw;
+		float v = (vOverW[1] * px + (vOverW[2] * py + vOverW[0])) / iw;
+		float width = (float)texture.m_levels[0].m_width, height = (float)texture.m_levels[0].m_height;
+		float dudx = (uOverW[1] - u * invW[1]) / iw * width, dvdx = (vOverW[1] - v * invW[1]) / iw * height;
+		float dudy = (uOverW[2] - u * invW[2]) / iw * width, dvdy = (vOverW[2] - v * invW[2]) / iw * height;
+		float rho = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+		if (!(rho > 1.0f))
+			return 0;
+		int level = (int)floorf(0.5f * log2f(rho) + 0.5f);
+		return std::min(level, levels - 1);
+	}
+
+#if defined(MATH_SIMD_SSE)
+	// SSE Path // Four pixels of a block row per iteration. The arithmetic matches the scalar path operation for operation.
+	bool SoftwareRasterizer::RasterBlock(const Triangle& triangle, int blockX, int x0, int y0, int x1, int y1, bool inside, TileStats& stats)
+	{
+		const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		alignas(16) static const uint32_t laneMasks[16][4] = {
+			{ 0, 0, 0, 0 }, { ~0u, 0, 0, 0 }, { 0, ~0u, 0, 0 }, { ~0u, ~0u, 0, 0 },
+			{ 0, 0, ~0u, 0 }, { ~0u, 0, ~0u, 0 }, { 0, ~0u, ~0u, 0 }, { ~0u, ~0u, ~0u, 0 },
+			{ 0, 0, 0, ~0u }, { ~0u, 0, 0, ~0u }, { 0, ~0u, 0, ~0u }, { ~0u, ~0u, 0, ~0u },
+			{ 0, 0, ~0u, ~0u }, { ~0u, 0, ~0u, ~0u }, { 0, ~0u, ~0u, ~0u }, { ~0u, ~0u, ~0u, ~0u },
+		};
+		__m128 edgeA[3];
+		for (int e = 0; e < 3; ++e)
+			edgeA[e] = _mm_set1_ps(triangle.m_edgeA[e]);
+		__m128 zx = _mm_set1_ps(triangle.m_z[1]);
+		__m128 iwx = _mm_set1_ps(triangle.m_invW[1]);
+		__m128 uwx = _mm_set1_ps(triangle.m_uOverW[1]);
+		__m128 vwx = _mm_set1_ps(triangle.m_vOverW[1]);
+		const SoftwareTexture* texture = triangle.m_texture;
+		bool written = false;
+		for (int y = y0; y <= y1; ++y)
+		{
+			float py = y + 0.5f;
+			__m128 rowEdge[3];
+			for (int e = 0; e < 3; ++e)
+				rowEdge[e] = _mm_set1_ps(triangle.m_edgeB[e] * py + triangle.m_edgeC[e]);
+			__m128 rowZ = _mm_set1_ps(triangle.m_z[2] * py + triangle.m_z[0]);
+			for (int x = blockX; x < blockX + 8; x += 4)
+			{
+				// Lanes inside the bounds.
+				int mask = 0;
+				for (int lane = 0; lane < 4; ++lane)
+					mask |= (x + lane >= x0 && x + lane <= x1) ? (1 << lane) : 0;
+				if (!mask)
+					continue;
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+				if (!inside)
+				{
+					for (int e = 0; e < 3; ++e)
+					{
+						__m128 value = _mm_add_ps(_mm_mul_ps(edgeA[e], px), rowEdge[e]);
+						mask &= _mm_movemask_ps((triangle.m_topLeft & (1u << e)) ? _mm_cmpge_ps(value, zero) : _mm_cmpgt_ps(value, zero));
+					}
+					if (!mask)
+						continue;
+				}
+				stats.m_pixelsCovered += CountBits(mask);
+
+				// Depth LESS
+				float* depth = m_depth.data() + (size_t)y * m_pitch + x;
+				__m128 z = _mm_add_ps(_mm_mul_ps(zx, px), rowZ);
+				__m128 d = _mm_loadu_ps(depth);
+				mask &= _mm_movemask_ps(_mm_cmplt_ps(z, d));
+				if (!mask)
+					continue;
+				__m128 write = _mm_load_ps((const float*)laneMasks[mask]);
+				_mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(write, z), _mm_andnot_ps(write, d)));
+				stats.m_pixelsShaded += CountBits(mask);
+				written = true;
+
+				// Shade // The texture sampled at the perspective correct uv.
+				uint32_t* color = m_color.data() + (size_t)y * m_pitch + x;
+				if (!texture)
+				{
+					for (int lane = 0; lane < 4; ++lane)
+					{
+						if (mask & (1 << lane))
+							color[lane] = 0xffffffff;
+					}
+					continue;
+				}
+				__m128 iw = _mm_add_ps(_mm_mul_ps(iwx, px), _mm_set1_ps(triangle.m_invW[2] * py + triangle.m_invW[0]));
+				__m128 uw = _mm_add_ps(_mm_mul_ps(uwx, px), _mm_set1_ps(triangle.m_uOverW[2] * py + triangle.m_uOverW[0]));
+				__m128 vw = _mm_add_ps(_mm_mul_ps(vwx, px), _mm_set1_ps(triangle.m_vOverW[2] * py + triangle.m_vOverW[0]));
+				alignas(16) float u[4], v[4];
+				_mm_store_ps(u, _mm_div_ps(uw, iw));
+				_mm_store_ps(v, _mm_div_ps(vw, iw));
+				const SoftwareTexture::Level& level = texture->m_levels[SelectLevel(*texture, triangle.m_invW, triangle.m_uOverW, triangle.m_vOverW, x + 0.5f, py)];
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					if (mask & (1 << lane))
+						color[lane] = SampleBilinear(level, u[lane], v[lane]);
+				}
+			}
+		}
+		return written;
+	}
+	void SoftwareRasterizer::UpdateBlockDepth(int blockX, int blockY)
+	{
+		const float* depth = m_depth.data() + (size_t)blockY * 8 * m_pitch + blockX * 8;
+		__m128 farthest = _mm_loadu_ps(depth);
+		for (int y = 0; y < 8; ++y, depth += m_pitch)
+			farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(depth), _mm_loadu_ps(depth + 4)));
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+		farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+		m_blockMaxZ[(size_t)blockY * m_blocksX + blockX] = _mm_cvtss_f32(farthest);
+	}
+#else
+	bool SoftwareRasterizer::RasterBlock(const Triangle& triangle, int blockX, int x0, int y0, int x1, int y1, bool inside, TileStats& stats)
+	{
+		const SoftwareTexture* texture = triangle.m_texture;
+		bool written = false;
+		for (int y = y0; y <= y1; ++y)
+		{
+			float py = y + 0.5f;
+			float rowEdge[3];
+			for (int e = 0; e < 3; ++e)
+				rowEdge[e] = triangle.m_edgeB[e] * py + triangle.m_edgeC[e];
+			float rowZ = triangle.m_z[2] * py + triangle.m_z[0];
+			for (int x = x0; x <= x1; ++x)
+			{
+				float px = x + 0.5f;
+				bool covered = true;
+				for (int e = 0; e < 3 && covered && !inside; ++e)
+				{
+					float value = triangle.m_edgeA[e] * px + rowEdge[e];
+					covered = (triangle.m_topLeft & (1u << e)) ? value >= 0.0f : value > 0.0f;
+				}
+				if (!covered)
+					continue;
+				stats.m_pixelsCovered++;
+				float* depth = m_depth.data() + (size_t)y * m_pitch + x;
+				float z = triangle.m_z[1] * px + rowZ;
+				if (!(z < *depth))
+					continue;
+				*depth = z;
+				stats.m_pixelsShaded++;
+				written = true;
+				uint32_t* color = m_color.data() + (size_t)y * m_pitch + x;
+				if (!texture)
+				{
+					*color = 0xffffffff;
+					continue;
+				}
+				float iw = triangle.m_invW[1] * px + (triangle.m_invW[2] * py + triangle.m_invW[0]);
+				float u = (triangle.m_uOverW[1] * px + (triangle.m_uOverW[2] * py + triangle.m_uOverW[0])) / iw;
+				float v = (triangle.m_vOverW[1] * px + (triangle.m_vOverW[2] * py + triangle.m_vOverW[0])) / iw;
+				// Level per group of four, as the SSE path.
+				int group = x & ~3;
+				*color = SampleBilinear(texture->m_levels[SelectLevel(*texture, triangle.m_invW, triangle.m_uOverW, triangle.m_vOverW, group + 0.5f, py)], u, v);
+			}
+		}
+		return written;
+	}
+	void SoftwareRasterizer::UpdateBlockDepth(int blockX, int blockY)
+	{
+		const float* depth = m_depth.data() + (size_t)blockY * 8 * m_pitch + blockX * 8;
+		float farthest = depth[0];
+		for (int y = 0; y < 8; ++y, depth += m_pitch)
+		{
+			for (int x = 0; x < 8; ++x)
+				farthest = std::max(farthest, depth[x]);
+		}
+		m_blockMaxZ[(size_t)blockY * m_blocksX + blockX] = farthest;
+	}
+#endif
+
+	bool SoftwareRasterizer::WriteImage(const char* filePath)
+	{
+		return ::Renderer::WriteImage(filePath, m_width, m_height, m_pitch, m_color.data());
+	}
+
+	bool ReadImage(const char* filePath, int& width, int& height, std::vector<uint32_t>& pixels)
+	{
+		FILE* file = fopen(filePath, "rb");
+		if (!file)
+			return false;
+		int maxValue = 0;
+		bool valid = fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) == 3 && maxValue == 255 && width > 0 && height > 0 && fgetc(file) != EOF;
+		std::vector<uint8_t> rgb(valid ? (size_t)width * height * 3 : 0);
+		valid = valid && fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+		fclose(file);
+		if (!valid)
+			return false;
+		pixels.resize((size_t)width * height);
+		for (size_t i = 0; i < pixels.size(); ++i)
+			pixels[i] = rgb[i * 3] | (rgb[i * 3 + 1] << 8) | (rgb[i * 3 + 2] << 16) | 0xff000000;
+		return true;
+	}
+	bool WriteImage(const char* filePath, int width, int height, int pitch, const uint32_t* pixels)
+	{
+		FILE* file = fopen(filePath, "wb");
+		if (!file)
+			return false;
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		std::vector<uint8_t> row((size_t)width * 3);
+		bool written = true;
+		for (int y = 0; y < height && written; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				uint32_t pixel = pixels[(size_t)y * pitch + x];
+				row[x * 3] = pixel & 0xff;
+				row[x * 3 + 1] = (pixel >> 8) & 0xff;
+				row[x * 3 + 2] = (pixel >> 16) & 0xff;
+			}
+			written = fwrite(row.data(), 1, row.size(), file) == row.size();
+		}
+		fclose(file);
+		return written;
+	}
+}
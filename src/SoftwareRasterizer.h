@@ -0,0 +1,181 @@
+#pragma once
+
+#include "Common.h"
+#include "Math.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace Renderer
+{
+	// Software Texture // RGBA8 mip chain sampled by the software rasterizer, texels packed R in the low byte.
+	struct SoftwareTexture
+	{
+		struct Level
+		{
+			int m_width = 0;
+			int m_height = 0;
+			std::vector<uint32_t> m_texels;
+		};
+		std::vector<Level> m_levels;
+	};
+
+	struct RasterStats
+	{
+		uint32_t m_draws = 0;
+		uint32_t m_triangles = 0; // Submitted.
+		uint32_t m_trianglesClipped = 0; // Crossed the near, far or guard band planes.
+		uint32_t m_trianglesCulled = 0; // Back facing, outside the frustum or covering no pixel centre.
+		uint32_t m_trianglesBinned = 0;
+		uint32_t m_binEntries = 0; // Triangle and tile pairs.
+		uint32_t m_blocksRejected = 0; // 8x8 blocks skipped by the hierarchical depth test.
+		uint64_t m_pixelsCovered = 0; // Inside a triangle, before the depth test.
+		uint64_t m_pixelsShaded = 0;
+		double m_vertexMs = 0.0;
+		double m_binMs = 0.0;
+		double m_rasterMs = 0.0;
+	};
+
+	// Software Rasterizer // Renders indexed triangle lists into an offscreen RGBA8 colour and float depth buffer, following
+	// the D3D11 pipeline state the renderer sets: counter-clockwise front faces, back faces culled, depth LESS, top-left fill rule.
+	// Draws are queued, Flush transforms the vertices, clips and bins the triangles into RASTER_TILE_SIZE tiles, then rasterizes
+	// each tile on its own job. Triangles keep their submission order within a tile, so the image is the same on any thread count.
+	// Each 8x8 block keeps its farthest depth, blocks a triangle cannot pass are skipped before any pixel is tested.
+	class SoftwareRasterizer
+	{
+	public:
+		SoftwareRasterizer() { }
+		~SoftwareRasterizer() { Destroy(); }
+
+		void Create(int width, int height);
+		void Destroy();
+		void Resize(int width, int height);
+		// Jobs in flight per phase, 0 uses every job system worker. 1 runs everything on the calling thread.
+		void SetThreadCount(int threads) { m_threadCount = threads; }
+
+		// Applied by the next Flush, tile by tile.
+		void Clear(const float color[4], float depth = 1.0f);
+		// Vertices start with a float3 position followed by a float2 uv (the TexVertex3D layout), indices index into them.
+		// Nothing is copied, the vertices, indices and texture must stay alive until Flush. A null texture samples white.
+		void DrawIndexed(const Math::Matrix4F& modelViewProj, const void* vertices, uint32_t vertexCount, uint32_t stride,
+			const uint32_t* indices, uint32_t indexCount, const SoftwareTexture* texture);
+		void Flush();
+
+		int GetWidth() { return m_width; }
+		int GetHeight() { return m_height; }
+		// Row pitch of both buffers, in pixels.
+		int GetPitch() { return m_pitch; }
+		const uint32_t* GetColor() { return m_color.data(); }
+		const float* GetDepth() { return m_depth.data(); }
+		uint32_t GetPixel(int x, int y) { return m_color[(size_t)y * m_pitch + x]; }
+		// Last Flush.
+		const RasterStats& GetStats() { return m_stats; }
+
+		// Binary PPM, alpha dropped.
+		bool WriteImage(const char* filePath);
+
+		SoftwareRasterizer(SoftwareRasterizer const&) = delete;
+		void operator=(SoftwareRasterizer const&) = delete;
+
+	private:
+		// Clip space position and texture coordinates.
+		struct ClipVertex
+		{
+			float m_x, m_y, m_z, m_w;
+			float m_u, m_v;
+		};
+		// Screen space setup // Edge functions are A * x + B * y + C, positive inside. Planes are P0 + Px * x + Py * y.
+		struct Triangle
+		{
+			float m_edgeA[3];
+			float m_edgeB[3];
+			float m_edgeC[3];
+			float m_acceptBias[3]; // Rounding bound, a block is fully inside an edge when every corner exceeds it.
+			uint32_t m_topLeft; // Bit per edge, pixel centres exactly on these edges are inside.
+			float m_z[3];
+			float m_invW[3];
+			float m_uOverW[3];
+			float m_vOverW[3];
+			float m_minZ;
+			int m_minX, m_minY, m_maxX, m_maxY; // Pixel centres, inclusive.
+			const SoftwareTexture* m_texture;
+		};
+		struct Draw
+		{
+			Math::Matrix4F m_modelViewProj;
+			const uint8_t* m_vertices;
+			uint32_t m_vertexCount;
+			uint32_t m_stride;
+			const uint32_t* m_indices;
+			uint32_t m_indexCount;
+			const SoftwareTexture* m_texture;
+			uint32_t m_firstVertex; // Into m_clipVertices.
+			uint32_t m_firstTriangle; // Across every draw of the flush.
+		};
+		// Run of vertices transformed by one job.
+		struct VertexRange
+		{
+			uint32_t m_draw;
+			uint32_t m_first;
+			uint32_t m_count;
+		};
+		// Run of consecutive triangles set up and binned by one job.
+		struct Batch
+		{
+			uint32_t m_firstTriangle;
+			uint32_t m_triangleCount;
+			std::vector<Triangle> m_triangles;
+			std::vector<std::vector<uint32_t>> m_bins; // Per tile, into m_triangles.
+			uint32_t m_clipped;
+			uint32_t m_culled;
+		};
+		struct TileStats
+		{
+			uint32_t m_blocksRejected;
+			uint64_t m_pixelsCovered;
+			uint64_t m_pixelsShaded;
+		};
+
+		int GetJobCount(int count);
+		void Parallel(int count, void (*function)(SoftwareRasterizer&, int));
+		static void TransformRange(SoftwareRasterizer& rasterizer, int range);
+		static void BinBatch(SoftwareRasterizer& rasterizer, int batch);
+		static void RasterTile(SoftwareRasterizer& rasterizer, int tile);
+
+		void ClipTriangle(Batch& batch, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftwareTexture* texture);
+		void SetupTriangle(Batch& batch, const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftwareTexture* texture);
+		void RasterTriangle(const Triangle& triangle, int tileX, int tileY, TileStats& stats);
+		bool RasterBlock(const Triangle& triangle, int blockX, int x0, int y0, int x1, int y1, bool inside, TileStats& stats);
+		void UpdateBlockDepth(int blockX, int blockY);
+
+	private:
+		int m_width = 0;
+		int m_height = 0;
+		int m_pitch = 0; // Padded to whole tiles, so blocks never read past a row.
+		int m_rows = 0;
+		int m_tilesX = 0;
+		int m_tilesY = 0;
+		int m_blocksX = 0;
+		int m_threadCount = RASTER_THREAD_COUNT;
+
+		std::vector<uint32_t> m_color;
+		std::vector<float> m_depth;
+		std::vector<float> m_blockMaxZ; // Farthest depth per 8x8 block.
+		bool m_clearPending = false;
+		uint32_t m_clearColor = 0;
+		float m_clearDepth = 1.0f;
+
+		std::vector<Draw> m_draws;
+		std::vector<ClipVertex> m_clipVertices;
+		std::vector<VertexRange> m_vertexRanges;
+		std::vector<Batch> m_batches;
+		uint32_t m_batchCount = 0; // In use this flush, m_batches only grows.
+		std::vector<TileStats> m_tileStats;
+		RasterStats m_stats;
+
+	};
+
+	// Binary PPM to RGBA8 and back, used by the golden image tests.
+	bool ReadImage(const char* filePath, int& width, int& height, std::vector<uint32_t>& pixels);
+	bool WriteImage(const char* filePath, int width, int height, int pitch, const uint32_t* pixels);
+}
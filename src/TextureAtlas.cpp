@@ -0,0 +1,243 @@
+#include "TextureAtlas.h"
+
+#include "external/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits.h>
+#include <string.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		static bool Contains(const AtlasRect& outer, const AtlasRect& inner)
+		{
+			return inner.m_x >= outer.m_x && inner.m_y >= outer.m_y
+				&& inner.m_x + inner.m_width <= outer.m_x + outer.m_width && inner.m_y + inner.m_height <= outer.m_y + outer.m_height;
+		}
+		static bool Overlaps(const AtlasRect& a, const AtlasRect& b)
+		{
+			return a.m_x < b.m_x + b.m_width && b.m_x < a.m_x + a.m_width && a.m_y < b.m_y + b.m_height && b.m_y < a.m_y + a.m_height;
+		}
+
+		// MaxRects Packer
+		void MaxRectsPacker::Reset(int width, int height)
+		{
+			m_width = width;
+			m_height = height;
+			m_usedArea = 0;
+			m_free.clear();
+			AtlasRect all;
+			all.m_width = width;
+			all.m_height = height;
+			m_free.push_back(all);
+		}
+		bool MaxRectsPacker::Insert(int width, int height, AtlasRect& rect)
+		{
+			// Best Short Side Fit // Least leftover on the tighter side, ties go to the least on the other.
+			int best = -1, bestShort = INT_MAX, bestLong = INT_MAX;
+			for (size_t i = 0; i < m_free.size(); ++i)
+			{
+				const AtlasRect& f = m_free[i];
+				if (f.m_width < width || f.m_height < height)
+					continue;
+				int leftoverShort = std::min(f.m_width - width, f.m_height - height);
+				int leftoverLong = std::max(f.m_width - width, f.m_height - height);
+				if (leftoverShort < bestShort || (leftoverShort == bestShort && leftoverLong < bestLong))
+				{
+					best = (int)i;
+					bestShort = leftoverShort;
+					bestLong = leftoverLong;
+				}
+			}
+			if (best < 0)
+				return false;
+			rect.m_x = m_free[best].m_x;
+			rect.m_y = m_free[best].m_y;
+			rect.m_width = width;
+			rect.m_height = height;
+			m_usedArea += (int64_t)width * height;
+
+			// Split // Every free rectangle the new one overlaps leaves up to four maximal pieces around it.
+			m_scratch.clear();
+			for (const AtlasRect& f : m_free)
+			{
+				if (!Overlaps(f, rect))
+				{
+					m_scratch.push_back(f);
+					continue;
+				}
+				if (rect.m_x > f.m_x)
+					m_scratch.push_back({ f.m_x, f.m_y, rect.m_x - f.m_x, f.m_height });
+				if (rect.m_x + rect.m_width < f.m_x + f.m_width)
+					m_scratch.push_back({ rect.m_x + rect.m_width, f.m_y, f.m_x + f.m_width - (rect.m_x + rect.m_width), f.m_height });
+				if (rect.m_y > f.m_y)
+					m_scratch.push_back({ f.m_x, f.m_y, f.m_width, rect.m_y - f.m_y });
+				if (rect.m_y + rect.m_height < f.m_y + f.m_height)
+					m_scratch.push_back({ f.m_x, rect.m_y + rect.m_height, f.m_width, f.m_y + f.m_height - (rect.m_y + rect.m_height) });
+			}
+			// Prune // Rectangles inside another are redundant, of two equal ones the first is kept.
+			m_free.clear();
+			for (size_t i = 0; i < m_scratch.size(); ++i)
+			{
+				bool contained = false;
+				for (size_t j = 0; j < m_scratch.size() && !contained; ++j)
+					contained = i != j && Contains(m_scratch[j], m_scratch[i]) && (j < i || !Contains(m_scratch[i], m_scratch[j]));
+				if (!contained)
+					m_free.push_back(m_scratch[i]);
+			}
+			return true;
+		}
+
+		int GetAtlasMipCount(const AtlasSettings& settings)
+		{
+			int mips = 1;
+			while ((1 << mips) <= settings.m_gutter && (settings.m_pageSize >> mips) > 0)
+				mips++;
+			return mips;
+		}
+
+		int PackAtlas(const AtlasRect* sizes, size_t count, const AtlasSettings& settings, std::vector<AtlasPlacement>& placements, AtlasStats* stats)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			int gutter = settings.m_gutter;
+			auto padded = [gutter](int size) { return gutter > 0 ? (size + 2 * gutter + gutter - 1) / gutter * gutter : size; };
+
+			// Largest first, by longer side then area, leaves the small ones to fill the gaps.
+			std::vector<uint32_t> order(count);
+			for (uint32_t i = 0; i < (uint32_t)count; ++i)
+				order[i] = i;
+			std::stable_sort(order.begin(), order.end(), [sizes](uint32_t a, uint32_t b)
+			{
+				int sideA = std::max(sizes[a].m_width, sizes[a].m_height), sideB = std::max(sizes[b].m_width, sizes[b].m_height);
+				if (sideA != sideB)
+					return sideA > sideB;
+				return (int64_t)sizes[a].m_width * sizes[a].m_height > (int64_t)sizes[b].m_width * sizes[b].m_height;
+			});
+
+			placements.assign(count, AtlasPlacement());
+			std::vector<MaxRectsPacker> pages;
+			int64_t inputArea = 0, paddedArea = 0;
+			int packed = 0;
+			for (uint32_t i : order)
+			{
+				int width = sizes[i].m_width, height = sizes[i].m_height;
+				int paddedWidth = padded(width), paddedHeight = padded(height);
+				if (width <= 0 || height <= 0 || width > settings.m_maxSize || height > settings.m_maxSize
+					|| paddedWidth > settings.m_pageSize || paddedHeight > settings.m_pageSize)
+					continue;
+				AtlasRect rect;
+				size_t page = 0;
+				for (; page < pages.size(); ++page)
+				{
+					if (pages[page].Insert(paddedWidth, paddedHeight, rect))
+						break;
+				}
+				if (page == pages.size())
+				{
+					pages.emplace_back();
+					pages.back().Reset(settings.m_pageSize, settings.m_pageSize);
+					pages.back().Insert(paddedWidth, paddedHeight, rect);
+				}
+				AtlasPlacement& p = placements[i];
+				p.m_page = (int)page;
+				p.m_rect.m_x = rect.m_x + gutter;
+				p.m_rect.m_y = rect.m_y + gutter;
+				p.m_rect.m_width = width;
+				p.m_rect.m_height = height;
+				p.m_uvScale[0] = (float)width / settings.m_pageSize;
+				p.m_uvScale[1] = (float)height / settings.m_pageSize;
+				p.m_uvOffset[0] = (float)p.m_rect.m_x / settings.m_pageSize;
+				p.m_uvOffset[1] = (float)p.m_rect.m_y / settings.m_pageSize;
+				inputArea += (int64_t)width * height;
+				paddedArea += (int64_t)paddedWidth * paddedHeight;
+				packed++;
+			}
+			if (stats)
+			{
+				double pageArea = (double)pages.size() * settings.m_pageSize * settings.m_pageSize;
+				stats->m_inputs = (int)count;
+				stats->m_packed = packed;
+				stats->m_pages = (int)pages.size();
+				stats->m_occupancy = pages.empty() ? 0.0f : (float)(inputArea / pageArea);
+				stats->m_paddedOccupancy = pages.empty() ? 0.0f : (float)(paddedArea / pageArea);
+				stats->m_packMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+			return (int)pages.size();
+		}
+
+		void BuildTextureAtlas(const TextureImage* const* images, size_t count, const AtlasSettings& settings, TextureAtlas& atlas)
+		{
+			std::vector<AtlasRect> sizes(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				sizes[i].m_width = images[i]->m_width;
+				sizes[i].m_height = images[i]->m_height;
+			}
+			atlas.m_stats = AtlasStats();
+			atlas.m_pageSize = settings.m_pageSize;
+			atlas.m_mipCount = GetAtlasMipCount(settings);
+			int pageCount = PackAtlas(sizes.data(), count, settings, atlas.m_placements, &atlas.m_stats);
+
+			// Copy // Coordinates past an edge clamp to it, filling the gutter with the border texels.
+			auto start = std::chrono::high_resolution_clock::now();
+			int size = settings.m_pageSize, gutter = settings.m_gutter;
+			std::vector<TextureImage> pages(pageCount);
+			for (TextureImage& page : pages)
+			{
+				page.m_width = size;
+				page.m_height = size;
+				page.m_pixels.assign((size_t)size * size * 4, 0);
+			}
+			for (size_t i = 0; i < count; ++i)
+			{
+				const AtlasPlacement& p = atlas.m_placements[i];
+				if (p.m_page < 0)
+					continue;
+				const TextureImage& image = *images[i];
+				uint8_t* destination = pages[p.m_page].m_pixels.data();
+				for (int y = -gutter; y < image.m_height + gutter; ++y)
+				{
+					int sourceY = std::min(std::max(y, 0), image.m_height - 1);
+					const uint8_t* row = image.m_pixels.data() + (size_t)sourceY * image.m_width * 4;
+					uint8_t* out = destination + ((size_t)(p.m_rect.m_y + y) * size + p.m_rect.m_x) * 4;
+					for (int x = -gutter; x < 0; ++x)
+						memcpy(out + x * 4, row, 4);
+					memcpy(out, row, (size_t)image.m_width * 4);
+					for (int x = image.m_width; x < image.m_width + gutter; ++x)
+						memcpy(out + x * 4, row + (image.m_width - 1) * 4, 4);
+				}
+			}
+			auto copied = std::chrono::high_resolution_clock::now();
+			atlas.m_stats.m_copyMs = std::chrono::duration<double, std::milli>(copied - start).count();
+
+			// Mips // Same filter as loose textures, cut where the gutters run out.
+			atlas.m_pages.resize(pageCount);
+			for (int page = 0; page < pageCount; ++page)
+			{
+				GenerateMips(pages[page].m_pixels.data(), size, size, MIP_FILTER_BOX, true, atlas.m_pages[page]);
+				atlas.m_pages[page].resize(atlas.m_mipCount);
+			}
+			atlas.m_stats.m_mipMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - copied).count();
+		}
+
+		bool ReadAtlasSourceSize(const char* filePath, int& width, int& height)
+		{
+			int channels;
+			return stbi_info(filePath, &width, &height, &channels) != 0;
+		}
+		bool ReadAtlasSource(const char* filePath, TextureImage& image)
+		{
+			int width, height, channels;
+			unsigned char* pixels = stbi_load(filePath, &width, &height, &channels, 4);
+			if (!pixels)
+				return false;
+			image.m_width = width;
+			image.m_height = height;
+			image.m_pixels.assign(pixels, pixels + (size_t)width * height * 4);
+			stbi_image_free(pixels);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Common.h"
+#include "CookedTexture.h"
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Renderer
+{
+	namespace Meshes
+	{
+		// Texture Atlas // CPU only, runs offline or on streaming threads. Small RGBA8 textures are packed into square pages,
+		// every page a slice of one texture array, so meshes using any of them share a texture bind.
+		struct AtlasRect
+		{
+			int m_x = 0;
+			int m_y = 0;
+			int m_width = 0;
+			int m_height = 0;
+		};
+
+		// MaxRects Packer // Free space kept as every maximal empty rectangle. Each insert takes the best short side fit,
+		// splits the free rectangles it overlaps and drops those contained in another. No rotation, UVs are not swapped.
+		class MaxRectsPacker
+		{
+		public:
+			void Reset(int width, int height);
+			bool Insert(int width, int height, AtlasRect& rect);
+
+			int64_t GetUsedArea() const { return m_usedArea; }
+			float GetOccupancy() const { return (float)((double)m_usedArea / ((double)m_width * m_height)); }
+
+		private:
+			int m_width = 0;
+			int m_height = 0;
+			int64_t m_usedArea = 0;
+			std::vector<AtlasRect> m_free;
+			std::vector<AtlasRect> m_scratch;
+		};
+
+		struct AtlasSettings
+		{
+			int m_pageSize = TEXTURE_ATLAS_SIZE;
+			int m_maxSize = TEXTURE_ATLAS_MAX_INPUT; // Larger textures are left out.
+			int m_gutter = TEXTURE_ATLAS_GUTTER; // Power of two, or 0 for none.
+		};
+		// Where one input landed. m_rect covers its texels only, the gutter lies around it.
+		struct AtlasPlacement
+		{
+			int m_page = -1; // -1 when left out.
+			AtlasRect m_rect;
+			float m_uvScale[2] = { 1.0f, 1.0f };
+			float m_uvOffset[2] = { 0.0f, 0.0f };
+		};
+		struct AtlasStats
+		{
+			int m_inputs = 0;
+			int m_packed = 0;
+			int m_pages = 0;
+			float m_occupancy = 0.0f; // Input texels over page texels.
+			float m_paddedOccupancy = 0.0f; // Gutters and alignment counted as used.
+			double m_packMs = 0.0;
+			double m_copyMs = 0.0;
+			double m_mipMs = 0.0;
+		};
+		struct TextureAtlas
+		{
+			int m_pageSize = 0;
+			int m_mipCount = 0; // Per page, levels where gutters still keep the inputs apart.
+			std::vector<std::vector<TextureImage>> m_pages; // Mip chain per page.
+			std::vector<AtlasPlacement> m_placements; // Same order as the inputs.
+			AtlasStats m_stats;
+		};
+
+		// Mip-Safe Gutters // Each input is padded by the gutter and rounded up to a multiple of it, so every rectangle starts on a
+		// gutter boundary. Down to level log2(gutter) the inputs stay a texel or more apart, and the pages stop there.
+		int GetAtlasMipCount(const AtlasSettings& settings);
+		// Packing only, sizes are read from m_width and m_height. Largest first, pages are opened as needed. Returns the page count.
+		int PackAtlas(const AtlasRect* sizes, size_t count, const AtlasSettings& settings, std::vector<AtlasPlacement>& placements, AtlasStats* stats = nullptr);
+		// Packs, copies each input with its edges repeated into the gutter, then builds the page mips.
+		void BuildTextureAtlas(const TextureImage* const* images, size_t count, const AtlasSettings& settings, TextureAtlas& atlas);
+
+		// Sources // Any stb_image supported file, expanded to RGBA8. The size is read from the header alone.
+		bool ReadAtlasSourceSize(const char* filePath, int& width, int& height);
+		bool ReadAtlasSource(const char* filePath, TextureImage& image);
+	}
+}
@@ -0,0 +1,228 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace Renderer
+{
+	void TextureCache::Create(Renderer& renderer, size_t budgetBytes)
+	{
+		m_renderer = &renderer;
+		m_budget = budgetBytes;
+	}
+	void TextureCache::Destroy()
+	{
+		for (int i = 0; i < (int)m_entries.size(); ++i)
+			Evict(i);
+		m_entries.clear();
+		m_freeEntries.clear();
+		m_lookup.clear();
+		if (m_renderer && m_renderer->GetRHI())
+		{
+			for (auto& s : m_samplers)
+				m_renderer->GetRHI()->Destroy(s.second);
+		}
+		m_samplers.clear();
+		m_stats = TextureCacheStats();
+		m_renderer = nullptr;
+	}
+
+	std::string TextureCache::Canonicalize(const char* filePath)
+	{
+		// "./res/a.png", "res\\A.png" and "res/../res/a.png" all share one entry.
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::weakly_canonical(std::filesystem::absolute(filePath, error), error);
+		std::string canonical = error ? std::string(filePath) : path.generic_string();
+		std::transform(canonical.begin(), canonical.end(), canonical.begin(), [](char c) { return (c == '\\') ? '/' : (char)tolower((unsigned char)c); });
+		return canonical;
+	}
+
+	int TextureCache::Find(const std::string& path, bool& created)
+	{
+		auto it = m_lookup.find(path);
+		if (it != m_lookup.end())
+		{
+			created = false;
+			return it->second;
+		}
+		created = true;
+		int entry;
+		if (!m_freeEntries.empty())
+		{
+			entry = m_freeEntries.back();
+			m_freeEntries.pop_back();
+			m_entries[entry] = Entry();
+		}
+		else
+		{
+			entry = (int)m_entries.size();
+			m_entries.emplace_back();
+		}
+		m_entries[entry].m_path = path;
+		m_lookup[path] = entry;
+		return entry;
+	}
+	void TextureCache::Finish(int entry, Meshes::TextureData& data)
+	{
+		Entry& e = m_entries[entry];
+		e.m_bytes = data.m_bytes;
+		e.m_texture = e.m_texture.Upload(*m_renderer, e.m_path.c_str(), data, RHI::SamplerHandle());
+		e.m_texture.m_cacheEntry = entry;
+		e.m_loading = false;
+		m_stats.m_residentBytes += e.m_bytes;
+		m_stats.m_loads++;
+	}
+	Meshes::Texture TextureCache::Reference(int entry, RHI::SamplerHandle sampler)
+	{
+		Entry& e = m_entries[entry];
+		e.m_refCount++;
+		e.m_lastUse = ++m_useClock;
+		Meshes::Texture texture = e.m_texture;
+		texture.m_sampler = sampler;
+		return texture;
+	}
+
+	Meshes::Texture TextureCache::Acquire(const char* filePath, const RHI::SamplerDesc* samplerDesc)
+	{
+		RHI::SamplerHandle sampler = GetSampler(samplerDesc ? *samplerDesc : Meshes::Texture::DefaultSampler());
+		bool created;
+		int entry = Find(Canonicalize(filePath), created);
+		if (!created && !m_entries[entry].m_loading)
+		{
+			m_stats.m_hits++;
+			return Reference(entry, sampler);
+		}
+		if (created)
+			m_entries[entry].m_loading = true;
+
+		// Blocking load, also completes an in-flight streamed load of the same file early.
+		Meshes::TextureData data;
+		if ((!m_renderer->IsNull() || m_renderer->IsSoftware()) && Meshes::Texture::Decode(m_entries[entry].m_path.c_str(), data))
+			m_stats.m_decodes++;
+		Finish(entry, data);
+		Meshes::Texture texture = Reference(entry, sampler);
+		Trim();
+		return texture;
+	}
+	void TextureCache::AcquireAsync(const char* filePath, AcquireFunction complete, const RHI::SamplerDesc* samplerDesc, Assets::AssetPriority priority)
+	{
+		RHI::SamplerHandle sampler = GetSampler(samplerDesc ? *samplerDesc : Meshes::Texture::DefaultSampler());
+		bool created;
+		int entry = Find(Canonicalize(filePath), created);
+		Entry& e = m_entries[entry];
+		if (!created && !e.m_loading)
+		{
+			m_stats.m_hits++;
+			complete(Reference(entry, sampler));
+			return;
+		}
+
+		// Everyone asking while the decode is in flight waits on the same one.
+		e.m_waiters.push_back([this, entry, sampler, complete](const Meshes::Texture&) { complete(Reference(entry, sampler)); });
+		if (!created)
+			return;
+		e.m_loading = true;
+
+		std::shared_ptr<Meshes::TextureData> data = std::make_shared<Meshes::TextureData>();
+		std::string path = e.m_path;
+		bool decode = !m_renderer->IsNull() || m_renderer->IsSoftware();
+		AssetLoader.Request(path.c_str(),
+			[data, path, decode]() { return !decode || Meshes::Texture::Decode(path.c_str(), *data); },
+			[this, entry, data, decode](bool result)
+			{
+				if (decode && result)
+					m_stats.m_decodes++;
+				Entry& e = m_entries[entry];
+				if (e.m_loading)
+					Finish(entry, *data);
+				else
+					data->Release(); // A blocking Acquire got there first.
+				std::vector<AcquireFunction> waiters;
+				waiters.swap(e.m_waiters);
+				for (auto& w : waiters)
+					w(e.m_texture);
+				Trim();
+			},
+			priority);
+	}
+	void TextureCache::Release(Meshes::Texture& texture)
+	{
+		int entry = texture.m_cacheEntry;
+		texture = Meshes::Texture();
+		if (entry < 0 || entry >= (int)m_entries.size() || m_entries[entry].m_refCount <= 0)
+			return;
+		m_entries[entry].m_refCount--;
+		Trim();
+	}
+
+	RHI::SamplerHandle TextureCache::GetSampler(const RHI::SamplerDesc& desc)
+	{
+		std::string key((const char*)&desc, sizeof(desc));
+		auto it = m_samplers.find(key);
+		if (it != m_samplers.end())
+			return it->second;
+
+		RHI::SamplerHandle sampler;
+		if (m_renderer && m_renderer->GetRHI())
+		{
+			sampler = m_renderer->GetRHI()->CreateSampler(desc);
+			assert(sampler.IsValid());
+		}
+		m_samplers[key] = sampler;
+		return sampler;
+	}
+
+	void TextureCache::SetBudget(size_t budgetBytes)
+	{
+		m_budget = budgetBytes;
+		Trim();
+	}
+	void TextureCache::Trim()
+	{
+		// Evict unreferenced textures, least recently used first, until back under budget.
+		while (m_stats.m_residentBytes > m_budget)
+		{
+			int victim = -1;
+			for (int i = 0; i < (int)m_entries.size(); ++i)
+			{
+				const Entry& e = m_entries[i];
+				if (e.m_path.empty() || e.m_refCount > 0 || e.m_loading || !e.m_waiters.empty())
+					continue;
+				if (victim < 0 || e.m_lastUse < m_entries[victim].m_lastUse)
+					victim = i;
+			}
+			if (victim < 0)
+				return; // Everything left is in use.
+			Evict(victim);
+			m_stats.m_evictions++;
+		}
+	}
+	void TextureCache::Evict(int entry)
+	{
+		Entry& e = m_entries[entry];
+		if (e.m_path.empty())
+			return;
+		// Released by the device once the frames sampling it are done.
+		if (m_renderer && m_renderer->GetRHI())
+			m_renderer->GetRHI()->Destroy(e.m_texture.m_texture);
+		delete e.m_texture.m_softwareTexture;
+		m_stats.m_residentBytes -= e.m_bytes;
+		m_lookup.erase(e.m_path);
+		e = Entry();
+		m_freeEntries.push_back(entry);
+	}
+
+	const TextureCacheStats& TextureCache::GetStats()
+	{
+		m_stats.m_entries = (UINT)m_lookup.size();
+		m_stats.m_referenced = 0;
+		for (const auto& e : m_entries)
+		{
+			if (e.m_refCount > 0)
+				m_stats.m_referenced++;
+		}
+		m_stats.m_samplers = (UINT)m_samplers.size();
+		m_stats.m_budgetBytes = m_budget;
+		return m_stats;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Common.h"
+#include "Meshes.h"
+#include "Assets.h"
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define Textures (Renderer::TextureCache::Instance())
+
+namespace Renderer
+{
+	struct TextureCacheStats
+	{
+		UINT m_entries = 0;
+		UINT m_referenced = 0; // Entries with a live reference.
+		UINT m_samplers = 0;
+		size_t m_residentBytes = 0;
+		size_t m_budgetBytes = 0;
+		UINT m_loads = 0; // Cache misses, each is one upload.
+		UINT m_decodes = 0; // Files actually decoded, a null renderer skips decoding and a streamed decode beaten by a blocking one still counts.
+		UINT m_hits = 0;
+		UINT m_evictions = 0;
+	};
+
+	// Texture Cache // One GPU texture per canonical path, shared and reference counted across every MeshRenderer.
+	// Sampler states are shared by description. Unreferenced textures stay resident until the budget is exceeded, then the least recently used go first.
+	class TextureCache
+	{
+	public:
+		typedef std::function<void(const Meshes::Texture&)> AcquireFunction;
+
+		void Create(Renderer& renderer, size_t budgetBytes = TEXTURE_CACHE_BUDGET);
+		void Destroy();
+
+		Meshes::Texture Acquire(const char* filePath, const RHI::SamplerDesc* samplerDesc = nullptr);
+		void AcquireAsync(const char* filePath, AcquireFunction complete, const RHI::SamplerDesc* samplerDesc = nullptr, Assets::AssetPriority priority = Assets::PRIORITY_NORMAL);
+		void Release(Meshes::Texture& texture);
+
+		RHI::SamplerHandle GetSampler(const RHI::SamplerDesc& desc);
+		void SetBudget(size_t budgetBytes);
+		void Trim();
+
+		const TextureCacheStats& GetStats();
+		static std::string Canonicalize(const char* filePath);
+
+	private:
+		struct Entry
+		{
+			std::string m_path;
+			Meshes::Texture m_texture;
+			size_t m_bytes = 0;
+			int m_refCount = 0;
+			uint64_t m_lastUse = 0;
+			bool m_loading = false;
+			std::vector<AcquireFunction> m_waiters;
+		};
+
+		int Find(const std::string& path, bool& created);
+		void Finish(int entry, Meshes::TextureData& data);
+		Meshes::Texture Reference(int entry, RHI::SamplerHandle sampler);
+		void Evict(int entry);
+
+	private:
+		Renderer* m_renderer = nullptr;
+
+		std::deque<Entry> m_entries; // Stable addresses, textures point at m_path.
+		std::vector<int> m_freeEntries;
+		std::unordered_map<std::string, int> m_lookup;
+		std::unordered_map<std::string, RHI::SamplerHandle> m_samplers; // Keyed by the raw sampler description.
+
+		size_t m_budget = 0;
+		uint64_t m_useClock = 0;
+		TextureCacheStats m_stats;
+
+	private:
+		TextureCache() { }
+
+	public:
+		// Singleton Design Pattern
+		static TextureCache& Instance()
+		{
+			static TextureCache instance;
+			return instance;
+		}
+
+		TextureCache(TextureCache const&) = delete;
+		void operator=(TextureCache const&) = delete;
+
+	};
+}
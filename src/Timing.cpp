@@ -1,5 +1,58 @@
 #include "Timing.h"
 
+#include <timeapi.h>
+
+#pragma comment(lib, "winmm")
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// System Clock
+void SystemClock::Create()
+{
+	LARGE_INTEGER perfFreq;
+	QueryPerformanceFrequency(&perfFreq);
+	m_frequency = perfFreq.QuadPart;
+	// High resolution timers need Windows 10 1803, older systems raise the scheduler resolution instead.
+	m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!m_timer)
+		m_timerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+}
+void SystemClock::Destroy()
+{
+	if (m_timer)
+		CloseHandle(m_timer);
+	m_timer = nullptr;
+	if (m_timerPeriod)
+		timeEndPeriod(1);
+	m_timerPeriod = false;
+}
+
+uint64_t SystemClock::Now()
+{
+	LARGE_INTEGER perfCount;
+	QueryPerformanceCounter(&perfCount);
+	// Split so the multiply cannot overflow.
+	uint64_t count = (uint64_t)perfCount.QuadPart;
+	return (count / m_frequency) * 1000000000ull + (count % m_frequency) * 1000000000ull / m_frequency;
+}
+void SystemClock::Sleep(uint64_t ns)
+{
+	if (m_timer)
+	{
+		LARGE_INTEGER due;
+		due.QuadPart = -(LONGLONG)(ns / 100); // Relative, in 100 ns units.
+		if (SetWaitableTimerEx(m_timer, &due, 0, nullptr, nullptr, nullptr, 0))
+		{
+			WaitForSingleObject(m_timer, INFINITE);
+			return;
+		}
+	}
+	::Sleep((DWORD)(ns / 1000000));
+}
+
+// Timing
 void Timing::Create()
 {
 	startPerfCount = 0;
@@ -13,12 +66,27 @@ void Timing::Create()
 		perfCounterFreq = perfFreq.QuadPart;
 	}
 	currentTimeInSeconds = 0.0f;
+	deltaTime = 0.0f;
+	alpha = 1.0f;
+	clock.Create();
+	pacer.Create(clock);
 }
 void Timing::Destroy()
-{ }
+{
+	pacer.Destroy();
+	clock.Destroy();
+}
 
 void Timing::CalculateTimings()
 {
+	alpha = 1.0f;
+	if (fixedStep > 0.0f)
+	{
+		currentTimeInSeconds += fixedStep;
+		deltaTime = fixedStep;
+		return;
+	}
+
 	double previousTimeInSeconds = currentTimeInSeconds;
 	LARGE_INTEGER perfCount;
 	QueryPerformanceCounter(&perfCount);
@@ -28,3 +96,22 @@ void Timing::CalculateTimings()
 	//if (deltaTime > (1.0f / WINDOW_FPS))
 		//deltaTime = (1.0f / WINDOW_FPS);
 }
+
+int Timing::BeginFrame()
+{
+	if (fixedStep > 0.0f)
+	{
+		CalculateTimings();
+		return 1;
+	}
+	int steps = pacer.BeginFrame();
+	deltaTime = (float)pacer.GetFixedStep();
+	currentTimeInSeconds = pacer.GetSimulationTime();
+	alpha = (float)pacer.GetAlpha();
+	return steps;
+}
+void Timing::EndFrame()
+{
+	if (fixedStep <= 0.0f)
+		pacer.EndFrame();
+}
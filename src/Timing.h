@@ -1,30 +1,67 @@
 #pragma once
 
 #include "Common.h"
+#include "FramePacer.h"
 #include <Windows.h>
 
 #define GameTime (Timing::Instance())
 
+// System Clock // QueryPerformanceCounter, waits on a high resolution waitable timer where the OS has one.
+class SystemClock : public PacerClock
+{
+public:
+	void Create();
+	void Destroy();
+
+	uint64_t Now() override;
+	void Sleep(uint64_t ns) override;
+	void Spin() override { YieldProcessor(); }
+
+private:
+	LONGLONG m_frequency = 1;
+	HANDLE m_timer = nullptr;
+	bool m_timerPeriod = false; // timeBeginPeriod fallback in use.
+};
+
 class Timing
 {
 private:
 	double currentTimeInSeconds;
 	float deltaTime;
+	float alpha;
 
 	LONGLONG startPerfCount;
 	LONGLONG perfCounterFreq;
 
+	float fixedStep;
+
+	SystemClock clock;
+	FramePacer pacer;
+
 public:
 	void Create();
 	void Destroy();
 
 	void CalculateTimings();
 
+	// Paced Loop // BeginFrame returns the fixed steps due this frame, GetDelta is the fixed step while they run.
+	// EndFrame waits out the rest of the frame budget.
+	int BeginFrame();
+	void EndFrame();
+
+	// Fixed Step // Advance time by a constant step instead of reading the clock, 0 disables.
+	void SetFixedStep(float step) { fixedStep = step; }
+
 	double GetTime() { return currentTimeInSeconds; }
 	float GetDelta() { return deltaTime; }
+	float GetAlpha() { return alpha; } // Render interpolation between the last two steps, 1 when not paced.
+	FramePacer& GetPacer() { return pacer; }
 
 private:
-	Timing() { }
+	Timing()
+		: alpha(1.0f)
+		, fixedStep(0.0f)
+	{ }
 
 public:
 	// Singleton Design Pattern
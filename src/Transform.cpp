@@ -0,0 +1,280 @@
+#include "Transform.h"
+
+#include <algorithm>
+
+namespace Objects
+{
+	void TransformSystem::Create()
+	{
+		m_orderDirty = false;
+	}
+	void TransformSystem::Destroy()
+	{
+		m_local.clear();
+		m_global.clear();
+		m_previous.clear();
+		m_resolved.clear();
+		m_parent.clear();
+		m_dirty.clear();
+		m_indexToHandle.clear();
+		m_localBounds.clear();
+		m_worldBounds.clear();
+		m_movedBounds.clear();
+		m_handleToIndex.clear();
+		m_parentHandle.clear();
+		m_freeHandles.clear();
+		m_firstChild.clear();
+		m_nextSibling.clear();
+		m_previousSibling.clear();
+	}
+
+	void TransformSystem::Update()
+	{
+		if (m_orderDirty)
+			SortHierarchy();
+
+		// Single linear pass, parents are always resolved before their children.
+		m_movedBounds.clear();
+		size_t count = m_local.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			int p = m_parent[i];
+			if (p >= 0)
+			{
+				m_dirty[i] |= m_dirty[p];
+				if (m_dirty[i])
+					m_global[i] = m_global[p] * m_local[i];
+			}
+			else if (m_dirty[i])
+			{
+				m_global[i] = m_local[i];
+			}
+			if (m_dirty[i] && !m_resolved[i])
+			{
+				m_previous[i] = m_global[i]; // New nodes start where they are, not at the origin.
+				m_resolved[i] = 1;
+			}
+			if (m_dirty[i] && !m_localBounds[i].IsEmpty())
+			{
+				m_worldBounds[i] = m_localBounds[i].Transform(m_global[i]);
+				m_movedBounds.push_back(m_indexToHandle[i]);
+			}
+		}
+		std::fill(m_dirty.begin(), m_dirty.end(), (uint8_t)0);
+	}
+
+	TransformHandle TransformSystem::Allocate()
+	{
+		TransformHandle handle;
+		if (!m_freeHandles.empty())
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+		else
+		{
+			handle = (TransformHandle)m_handleToIndex.size();
+			m_handleToIndex.push_back(-1);
+			m_parentHandle.push_back(InvalidTransform);
+			m_firstChild.push_back(InvalidTransform);
+			m_nextSibling.push_back(InvalidTransform);
+			m_previousSibling.push_back(InvalidTransform);
+		}
+
+		// New nodes have no parent, so appending keeps the parent-before-child order.
+		m_handleToIndex[handle] = (int)m_local.size();
+		m_parentHandle[handle] = InvalidTransform;
+		m_local.push_back(Math::Matrix4F(1.0f));
+		m_global.push_back(Math::Matrix4F(1.0f));
+		m_previous.push_back(Math::Matrix4F(1.0f));
+		m_resolved.push_back(0);
+		m_parent.push_back(-1);
+		m_dirty.push_back(0);
+		m_indexToHandle.push_back(handle);
+		m_localBounds.push_back(Math::BoundingBox());
+		m_worldBounds.push_back(Math::BoundingBox());
+		return handle;
+	}
+	void TransformSystem::Free(TransformHandle handle)
+	{
+		if (handle == InvalidTransform || handle >= (TransformHandle)m_handleToIndex.size() || m_handleToIndex[handle] < 0)
+			return;
+
+		// Orphan any children still attached, then leave the parent's list.
+		while (m_firstChild[handle] != InvalidTransform)
+			SetParent(m_firstChild[handle], InvalidTransform);
+		Unlink(handle);
+
+		// Swap-remove, the order is rebuilt on the next update.
+		int index = m_handleToIndex[handle];
+		int last = (int)m_local.size() - 1;
+		if (index != last)
+		{
+			m_local[index] = m_local[last];
+			m_global[index] = m_global[last];
+			m_previous[index] = m_previous[last];
+			m_resolved[index] = m_resolved[last];
+			m_dirty[index] = m_dirty[last];
+			m_indexToHandle[index] = m_indexToHandle[last];
+			m_localBounds[index] = m_localBounds[last];
+			m_worldBounds[index] = m_worldBounds[last];
+			m_handleToIndex[m_indexToHandle[index]] = index;
+		}
+		m_local.pop_back();
+		m_global.pop_back();
+		m_previous.pop_back();
+		m_resolved.pop_back();
+		m_parent.pop_back();
+		m_dirty.pop_back();
+		m_indexToHandle.pop_back();
+		m_localBounds.pop_back();
+		m_worldBounds.pop_back();
+
+		m_handleToIndex[handle] = -1;
+		m_parentHandle[handle] = InvalidTransform;
+		m_freeHandles.push_back(handle);
+		m_orderDirty = true;
+	}
+
+	void TransformSystem::SetParent(TransformHandle handle, TransformHandle parent)
+	{
+		Unlink(handle);
+		m_parentHandle[handle] = parent;
+		if (parent != InvalidTransform)
+		{
+			// Pushed at the front, sibling order carries no meaning.
+			TransformHandle first = m_firstChild[parent];
+			m_nextSibling[handle] = first;
+			if (first != InvalidTransform)
+				m_previousSibling[first] = handle;
+			m_firstChild[parent] = handle;
+		}
+		m_orderDirty = true;
+		MarkDirty(handle);
+	}
+	void TransformSystem::Unlink(TransformHandle handle)
+	{
+		TransformHandle parent = m_parentHandle[handle];
+		if (parent == InvalidTransform)
+			return;
+		TransformHandle previous = m_previousSibling[handle], next = m_nextSibling[handle];
+		if (previous != InvalidTransform)
+			m_nextSibling[previous] = next;
+		else
+			m_firstChild[parent] = next;
+		if (next != InvalidTransform)
+			m_previousSibling[next] = previous;
+		m_previousSibling[handle] = InvalidTransform;
+		m_nextSibling[handle] = InvalidTransform;
+	}
+
+	void TransformSystem::BeginStep()
+	{
+		size_t count = m_global.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (m_resolved[i])
+				m_previous[i] = m_global[i];
+		}
+	}
+	Math::Matrix4F TransformSystem::GetInterpolated(TransformHandle handle, float alpha)
+	{
+		// Component-wise, close enough for the rotation of a single step.
+		int index = m_handleToIndex[handle];
+		const Math::Matrix4F& a = m_previous[index];
+		const Math::Matrix4F& b = m_global[index];
+		if (!m_resolved[index] || alpha >= 1.0f)
+			return b;
+		Math::Matrix4F result;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				result.m[r][c] = a.m[r][c] + (b.m[r][c] - a.m[r][c]) * alpha;
+		}
+		return result;
+	}
+
+	void TransformSystem::SetBounds(TransformHandle handle, const Math::BoundingBox& local)
+	{
+		// Resolved against the current global right away, later moves are picked up by Update.
+		int index = m_handleToIndex[handle];
+		m_localBounds[index] = local;
+		m_worldBounds[index] = local.Transform(m_global[index]);
+	}
+
+	void TransformSystem::SortHierarchy()
+	{
+		size_t count = m_local.size();
+
+		// Depth of every node, walking up until a node with a known depth is found.
+		std::vector<int> depth(m_handleToIndex.size(), -1);
+		std::vector<TransformHandle> chain;
+		int maxDepth = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			TransformHandle h = m_indexToHandle[i];
+			chain.clear();
+			while (h != InvalidTransform && depth[h] < 0)
+			{
+				chain.push_back(h);
+				h = m_parentHandle[h];
+			}
+			int d = (h == InvalidTransform) ? -1 : depth[h];
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+				depth[*it] = ++d;
+			if (d > maxDepth)
+				maxDepth = d;
+		}
+
+		// Counting sort by depth gives a parent-before-child order.
+		std::vector<int> offsets(maxDepth + 2, 0);
+		for (size_t i = 0; i < count; ++i)
+			offsets[depth[m_indexToHandle[i]] + 1]++;
+		for (int d = 1; d <= maxDepth + 1; ++d)
+			offsets[d] += offsets[d - 1];
+
+		std::vector<TransformHandle> order(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			TransformHandle h = m_indexToHandle[i];
+			order[offsets[depth[h]]++] = h;
+		}
+
+		// Permute the dense arrays into the new order.
+		std::vector<Math::Matrix4F> local(count);
+		std::vector<Math::Matrix4F> global(count);
+		std::vector<Math::Matrix4F> previous(count);
+		std::vector<uint8_t> resolved(count);
+		std::vector<uint8_t> dirty(count);
+		std::vector<Math::BoundingBox> localBounds(count);
+		std::vector<Math::BoundingBox> worldBounds(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			int from = m_handleToIndex[order[i]];
+			local[i] = m_local[from];
+			global[i] = m_global[from];
+			previous[i] = m_previous[from];
+			resolved[i] = m_resolved[from];
+			dirty[i] = m_dirty[from];
+			localBounds[i] = m_localBounds[from];
+			worldBounds[i] = m_worldBounds[from];
+		}
+		for (size_t i = 0; i < count; ++i)
+			m_handleToIndex[order[i]] = (int)i;
+		for (size_t i = 0; i < count; ++i)
+		{
+			TransformHandle p = m_parentHandle[order[i]];
+			m_parent[i] = (p == InvalidTransform) ? -1 : m_handleToIndex[p];
+		}
+		m_local.swap(local);
+		m_global.swap(global);
+		m_previous.swap(previous);
+		m_resolved.swap(resolved);
+		m_dirty.swap(dirty);
+		m_localBounds.swap(localBounds);
+		m_worldBounds.swap(worldBounds);
+		m_indexToHandle.swap(order);
+
+		m_orderDirty = false;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Math.h"
+
+#include <vector>
+#include <stdint.h>
+
+#define Transforms (Objects::TransformSystem::Instance())
+
+namespace Objects
+{
+	typedef int TransformHandle;
+	const TransformHandle InvalidTransform = -1;
+
+	// Stores every transform in contiguous arrays sorted parent-before-child.
+	// Writes only mark a node dirty, all dirty globals are resolved once per frame in Update().
+	class TransformSystem
+	{
+	public:
+		void Create();
+		void Destroy();
+
+		void Update();
+
+		TransformHandle Allocate();
+		void Free(TransformHandle handle);
+
+		void SetParent(TransformHandle handle, TransformHandle parent);
+		void MarkDirty(TransformHandle handle) { m_dirty[m_handleToIndex[handle]] = 1; }
+
+		Math::Matrix4F& ModifyLocal(TransformHandle handle) { MarkDirty(handle); return m_local[m_handleToIndex[handle]]; }
+		const Math::Matrix4F& GetLocal(TransformHandle handle) { return m_local[m_handleToIndex[handle]]; }
+		const Math::Matrix4F& GetGlobal(TransformHandle handle) { return m_global[m_handleToIndex[handle]]; }
+
+		// Interpolation // BeginStep keeps every global before a simulation step, draws blend from it towards the latest.
+		void BeginStep();
+		Math::Matrix4F GetInterpolated(TransformHandle handle, float alpha);
+
+		int GetCount() { return (int)m_local.size(); }
+
+		// Bounds // Local bounds are carried into world space alongside the global transform, an empty box clears them.
+		void SetBounds(TransformHandle handle, const Math::BoundingBox& local);
+		const Math::BoundingBox& GetWorldBounds(TransformHandle handle) { return m_worldBounds[m_handleToIndex[handle]]; }
+		// Handles whose world bounds changed during the last Update.
+		const std::vector<TransformHandle>& GetMovedBounds() { return m_movedBounds; }
+
+	private:
+		void SortHierarchy();
+		void Unlink(TransformHandle handle);
+
+	private:
+		// Dense Arrays // Indexed by position in update order.
+		std::vector<Math::Matrix4F> m_local;
+		std::vector<Math::Matrix4F> m_global;
+		std::vector<Math::Matrix4F> m_previous; // Meaningless until the node is resolved.
+		std::vector<uint8_t> m_resolved; // Set by the first Update that computes the global.
+		std::vector<int> m_parent;
+		std::vector<uint8_t> m_dirty;
+		std::vector<TransformHandle> m_indexToHandle;
+		std::vector<Math::BoundingBox> m_localBounds;
+		std::vector<Math::BoundingBox> m_worldBounds;
+		std::vector<TransformHandle> m_movedBounds;
+
+		// Handle Table // Handles stay stable while the dense arrays are reordered.
+		std::vector<int> m_handleToIndex;
+		std::vector<TransformHandle> m_parentHandle;
+		std::vector<TransformHandle> m_freeHandles;
+
+		// Children // Per handle, the children of a node form a doubly linked list, so re-parenting and freeing only touch the nodes involved.
+		std::vector<TransformHandle> m_firstChild;
+		std::vector<TransformHandle> m_nextSibling;
+		std::vector<TransformHandle> m_previousSibling;
+
+		bool m_orderDirty = false;
+
+	private:
+		TransformSystem() { }
+
+	public:
+		// Singleton Design Pattern
+		static TransformSystem& Instance()
+		{
+			static TransformSystem instance;
+			return instance;
+		}
+
+		TransformSystem(TransformSystem const&) = delete;
+		void operator=(TransformSystem const&) = delete;
+
+	};
+}
@@ -2,8 +2,11 @@
 #include "Input.h"
 #include "Game.h"
 #include "Timing.h"
+#include "Profiler.h"
+#include "Memory.h"
 
 Window::Window()
+	: m_windowHandle(nullptr)
 { }
 Window::~Window()
 { }
@@ -86,7 +89,8 @@ void Window::Create()
 void Window::Destroy()
 {
 	Timing::Instance().Destroy();
-	DestroyWindow(m_windowHandle);
+	if (m_windowHandle)
+		DestroyWindow(m_windowHandle);
 }
 
 void Window::MessageLoop()
@@ -99,20 +103,29 @@ void Window::MessageLoop()
 	bool running = true;
 	while (running)
 	{
-		if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		// Every pending message is handled before the frame, not one per frame.
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
 			if (msg.message == WM_QUIT)
 				running = false;
 		}
-		else
-		{
-			// Game Loop
-			Timing::Instance().CalculateTimings();
+		if (!running)
+			break;
+
+		// Game Loop // Fixed simulation steps, one interpolated draw, then wait for the next frame.
+		Profiler.BeginFrame();
+		int steps = Timing::Instance().BeginFrame();
+		for (int i = 0; i < steps; ++i)
 			Game::Instance().Update();
-			Game::Instance().Draw();
+		Game::Instance().Draw();
+		{
+			PROFILE_SCOPE("Frame Pacing");
+			Timing::Instance().EndFrame();
 		}
+		Profiler.EndFrame();
+		FrameMemory.EndFrame();
 	}
 }
 
@@ -135,10 +148,11 @@ LRESULT Window::WindowProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, NULL, &size, sizeof(RAWINPUTHEADER));
 		if (size > 0)
 		{
-			std::unique_ptr<BYTE[]> rawData = std::make_unique<BYTE[]>(size);
-			if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, rawData.get(), &size, sizeof(RAWINPUTHEADER)) == size)
+			// Scratch memory, gone at the end of the frame.
+			BYTE* rawData = static_cast<BYTE*>(FrameMemory.Allocate(size, alignof(RAWINPUT)));
+			if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, rawData, &size, sizeof(RAWINPUTHEADER)) == size)
 			{
-				RAWINPUT* raw = reinterpret_cast<RAWINPUT*>(rawData.get());
+				RAWINPUT* raw = reinterpret_cast<RAWINPUT*>(rawData);
 				// Mouse Input
 				if (raw->header.dwType == RIM_TYPEMOUSE)
 				{
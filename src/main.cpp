@@ -2,12 +2,97 @@
 #define NOMINMAX
 #include <Windows.h>
 #include "Game.h"
+#include "CookedMesh.h"
+#include "CookedTexture.h"
+#include "ShaderLibrary.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
 
 // Main Entry
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
 {
-	Game::Instance().Create();
+	// Command Line // -cook <model> [output] | -cooktex <texture> [output] [-rgba|-bc1|-bc3|-bc5|-bc7] [-kaiser] | -compileshaders [dir] | -headless [-frames N] [-instances N] [-trace] [-software] | -loadtest
+	// Self checks and benchmarks live in the console test runner, see tests/Tests.h.
+
+	// Console // Tools and headless runs print to the console they were started from, if any.
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* stream = nullptr;
+		freopen_s(&stream, "CONOUT$", "w", stdout);
+		freopen_s(&stream, "CONOUT$", "w", stderr);
+	}
+
+	if (const char* compile = strstr(lpCmdLine, "-compileshaders"))
+	{
+		char directory[MAX_PATH] = "./res/shaders";
+		sscanf(compile + strlen("-compileshaders"), "%259s", directory);
+		Renderer::Renderer renderer;
+		renderer.CreateNull();
+		Shaders.Create(renderer);
+		int failures = Shaders.Precompile(directory);
+		Renderer::ShaderLibraryStats stats = Shaders.GetStats();
+		printf("Shaders: %u compiled, %u already cached, %d failed -> %s\n", stats.m_compiles, stats.m_diskHits, failures, SHADER_CACHE_PATH);
+		Shaders.Destroy();
+		renderer.Destroy();
+		return failures ? 1 : 0;
+	}
+	if (const char* cook = strstr(lpCmdLine, "-cooktex "))
+	{
+		using namespace Renderer::Meshes;
+		char srcPath[MAX_PATH] = {}, dstPath[MAX_PATH] = {};
+		int args = sscanf(cook + strlen("-cooktex "), "%259s %259s", srcPath, dstPath);
+		if (args < 2 || dstPath[0] == '-')
+			snprintf(dstPath, sizeof(dstPath), "%s%s", srcPath, COOKED_TEXTURE_EXTENSION);
+		CookedTextureFormat format = COOKED_BC7;
+		const char* formatNames[COOKED_FORMAT_MAX] = { "-rgba", "-bc1", "-bc3", "-bc5", "-bc7" };
+		for (int i = 0; i < COOKED_FORMAT_MAX; ++i)
+		{
+			if (strstr(lpCmdLine, formatNames[i]))
+				format = (CookedTextureFormat)i;
+		}
+		MipFilter filter = strstr(lpCmdLine, "-kaiser") ? MIP_FILTER_KAISER : MIP_FILTER_BOX;
+
+		CookTextureReport report;
+		bool cooked = args >= 1 && CookTexture(srcPath, dstPath, format, filter, &report);
+		printf("%s %s -> %s\n", cooked ? "Cooked" : "Failed to cook", srcPath, dstPath);
+		if (cooked)
+		{
+			printf("%dx%d, %d mips, %s, %zu -> %zu bytes, PSNR %.2f dB, %.2f ms, %.2f MPix/s\n",
+				report.m_width, report.m_height, report.m_mipCount, formatNames[report.m_format] + 1,
+				report.m_sourceBytes, report.m_cookedBytes, report.m_psnr, report.m_encodeMs, report.m_megapixelsPerSecond);
+		}
+		return cooked ? 0 : 1;
+	}
+	if (const char* cook = strstr(lpCmdLine, "-cook "))
+	{
+		char srcPath[MAX_PATH] = {}, dstPath[MAX_PATH] = {};
+		int args = sscanf(cook + strlen("-cook "), "%259s %259s", srcPath, dstPath);
+		if (args < 2)
+			snprintf(dstPath, sizeof(dstPath), "%s%s", srcPath, COOKED_MESH_EXTENSION);
+		bool cooked = args >= 1 && Renderer::Meshes::CookMesh(srcPath, dstPath);
+		printf("%s %s -> %s\n", cooked ? "Cooked" : "Failed to cook", srcPath, dstPath);
+		return cooked ? 0 : 1;
+	}
+
+	GameOptions options;
+	if (strstr(lpCmdLine, "-headless"))
+		options.headless = true;
+	if (const char* frames = strstr(lpCmdLine, "-frames "))
+		options.headlessFrames = atoi(frames + strlen("-frames "));
+	if (const char* instances = strstr(lpCmdLine, "-instances "))
+		options.instances = atoi(instances + strlen("-instances "));
+	if (strstr(lpCmdLine, "-trace"))
+		options.trace = true;
+	if (strstr(lpCmdLine, "-software"))
+		options.software = options.headless = true;
+	if (strstr(lpCmdLine, "-loadtest"))
+		options.loadTest = options.headless = true;
+
+	Game::Instance().Create(options);
+	int exitCode = Game::Instance().GetExitCode();
 	Game::Instance().Destroy();
 
-	return 0;
+	return exitCode;
 }
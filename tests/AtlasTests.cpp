@@ -0,0 +1,155 @@
+#include "Tests.h"
+#include "TextureAtlas.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Tests
+{
+	int AtlasBench(const char* args)
+	{
+		// Texture atlas packing efficiency and build time. Every image under the directory packed at a few gutter widths,
+		// then a fixed set of random rectangles through the packer alone, checked for overlaps, bounds and gutter alignment.
+		char directory[260] = "./res/textures";
+		if (args[0] == ' ' && args[1] != '-')
+			sscanf(args + 1, "%259s", directory);
+		bool passed = true;
+		auto check = [&passed](const char* name, bool condition)
+		{
+			printf("%s: %s\n", name, condition ? "ok" : "FAILED");
+			passed = passed && condition;
+		};
+		auto valid = [](const std::vector<Renderer::Meshes::AtlasPlacement>& placements, const Renderer::Meshes::AtlasSettings& settings)
+		{
+			int gutter = settings.m_gutter;
+			for (size_t i = 0; i < placements.size(); ++i)
+			{
+				const Renderer::Meshes::AtlasPlacement& a = placements[i];
+				if (a.m_page < 0)
+					continue;
+				const Renderer::Meshes::AtlasRect& r = a.m_rect;
+				if (r.m_x < gutter || r.m_y < gutter || r.m_x + r.m_width + gutter > settings.m_pageSize || r.m_y + r.m_height + gutter > settings.m_pageSize)
+					return false;
+				if (gutter > 0 && ((r.m_x - gutter) % gutter != 0 || (r.m_y - gutter) % gutter != 0))
+					return false;
+				for (size_t j = i + 1; j < placements.size(); ++j)
+				{
+					const Renderer::Meshes::AtlasRect& o = placements[j].m_rect;
+					if (placements[j].m_page == a.m_page && r.m_x - gutter < o.m_x + o.m_width + gutter && o.m_x - gutter < r.m_x + r.m_width + gutter
+						&& r.m_y - gutter < o.m_y + o.m_height + gutter && o.m_y - gutter < r.m_y + r.m_height + gutter)
+						return false;
+				}
+			}
+			return true;
+		};
+
+		// The packed texels are the source texels, the gutter repeats the edge.
+		auto copied = [&valid](const std::vector<Renderer::Meshes::TextureImage>& images, const Renderer::Meshes::TextureAtlas& atlas, const Renderer::Meshes::AtlasSettings& settings)
+		{
+			int gutter = settings.m_gutter;
+			bool same = valid(atlas.m_placements, settings);
+			for (size_t i = 0; i < images.size() && same; ++i)
+			{
+				const Renderer::Meshes::AtlasPlacement& p = atlas.m_placements[i];
+				if (p.m_page < 0)
+					continue;
+				const Renderer::Meshes::TextureImage& page = atlas.m_pages[p.m_page][0];
+				for (int y = -gutter; y < images[i].m_height + gutter && same; ++y)
+				{
+					int sourceY = std::min(std::max(y, 0), images[i].m_height - 1);
+					const uint8_t* row = &page.m_pixels[((size_t)(p.m_rect.m_y + y) * page.m_width + p.m_rect.m_x) * 4];
+					const uint8_t* source = &images[i].m_pixels[(size_t)sourceY * images[i].m_width * 4];
+					same = memcmp(row, source, (size_t)images[i].m_width * 4) == 0 && (gutter == 0 || memcmp(row - 4, source, 4) == 0);
+				}
+			}
+			return same;
+		};
+
+		// Source Images
+		std::vector<Renderer::Meshes::TextureImage> images;
+		auto decodeStart = std::chrono::high_resolution_clock::now();
+		std::error_code error;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+			if (extension != ".png" && extension != ".jpg" && extension != ".jpeg" && extension != ".tga" && extension != ".bmp")
+				continue;
+			Renderer::Meshes::TextureImage image;
+			if (!Renderer::Meshes::ReadAtlasSource(entry.path().string().c_str(), image))
+				continue;
+			printf("%s: %dx%d\n", entry.path().string().c_str(), image.m_width, image.m_height);
+			images.push_back(std::move(image));
+		}
+		double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+		printf("%zu images decoded in %.2f ms\n", images.size(), decodeMs);
+		if (images.empty())
+			printf("No source images under %s, the directory atlas is not checked\n", directory);
+		std::vector<const Renderer::Meshes::TextureImage*> sources;
+		for (const auto& image : images)
+			sources.push_back(&image);
+		for (int gutter : { 0, 2, 4, 8, 16 })
+		{
+			Renderer::Meshes::AtlasSettings settings;
+			settings.m_gutter = gutter;
+			Renderer::Meshes::TextureAtlas atlas;
+			Renderer::Meshes::BuildTextureAtlas(sources.data(), sources.size(), settings, atlas);
+			const Renderer::Meshes::AtlasStats& stats = atlas.m_stats;
+			printf("Gutter %2d: %d of %d packed, %d pages of %d, %d mips, %5.1f%% occupied (%5.1f%% padded), pack %.3f ms, copy %.2f ms, mips %.2f ms\n",
+				gutter, stats.m_packed, stats.m_inputs, stats.m_pages, settings.m_pageSize, atlas.m_mipCount, stats.m_occupancy * 100.0f,
+				stats.m_paddedOccupancy * 100.0f, stats.m_packMs, stats.m_copyMs, stats.m_mipMs);
+			if (gutter == TEXTURE_ATLAS_GUTTER && !images.empty())
+				check("Directory atlas", copied(images, atlas, settings));
+		}
+
+		// Synthetic // Random texels in images of a fixed seed through the whole build, then 500 small rectangles through packing alone.
+		srand(7);
+		std::vector<Renderer::Meshes::TextureImage> noise(40);
+		std::vector<const Renderer::Meshes::TextureImage*> noiseSources;
+		for (Renderer::Meshes::TextureImage& image : noise)
+		{
+			image.m_width = 8 + rand() % 121;
+			image.m_height = 8 + rand() % 121;
+			image.m_pixels.resize((size_t)image.m_width * image.m_height * 4);
+			for (uint8_t& v : image.m_pixels)
+				v = (uint8_t)(rand() % 256);
+			noiseSources.push_back(&image);
+		}
+		{
+			Renderer::Meshes::AtlasSettings settings;
+			settings.m_gutter = TEXTURE_ATLAS_GUTTER;
+			Renderer::Meshes::TextureAtlas atlas;
+			Renderer::Meshes::BuildTextureAtlas(noiseSources.data(), noiseSources.size(), settings, atlas);
+			const Renderer::Meshes::AtlasStats& stats = atlas.m_stats;
+			printf("Synthetic images, gutter %2d: %d of %d packed, %d pages, copy %.2f ms, mips %.2f ms\n",
+				settings.m_gutter, stats.m_packed, stats.m_inputs, stats.m_pages, stats.m_copyMs, stats.m_mipMs);
+			check("Synthetic atlas", stats.m_packed == (int)noise.size() && copied(noise, atlas, settings));
+		}
+		std::vector<Renderer::Meshes::AtlasRect> sizes(500);
+		for (Renderer::Meshes::AtlasRect& size : sizes)
+		{
+			size.m_width = 4 + rand() % 125;
+			size.m_height = 4 + rand() % 125;
+		}
+		for (int gutter : { 0, TEXTURE_ATLAS_GUTTER })
+		{
+			Renderer::Meshes::AtlasSettings settings;
+			settings.m_gutter = gutter;
+			std::vector<Renderer::Meshes::AtlasPlacement> placements;
+			Renderer::Meshes::AtlasStats stats;
+			Renderer::Meshes::PackAtlas(sizes.data(), sizes.size(), settings, placements, &stats);
+			printf("Synthetic, gutter %2d: %d rectangles, %d pages, %5.1f%% occupied (%5.1f%% padded), %.2f ms\n",
+				gutter, stats.m_packed, stats.m_pages, stats.m_occupancy * 100.0f, stats.m_paddedOccupancy * 100.0f, stats.m_packMs);
+			check(gutter ? "Synthetic with gutter" : "Synthetic", stats.m_packed == (int)sizes.size() && valid(placements, settings));
+		}
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,92 @@
+#include "Tests.h"
+#include "Entities.h"
+#include "Jobs.h"
+#include "Memory.h"
+#ifdef TESTS_ENGINE
+#include "GameObject.h"
+#endif
+
+#include <atomic>
+#include <stdio.h>
+#include <vector>
+
+namespace Tests
+{
+	int EcsTest(const char* args)
+	{
+		// Archetype moves, chunk compaction, queries and system stages, then the GameObject tree against entities.
+		int entities = 100000;
+		sscanf(args, "%d", &entities);
+		struct Id { int m_value; };
+		struct Tag { int m_value; };
+		bool passed = true;
+		{
+			Entities::World world;
+			world.Create();
+			Entities::Entity a = world.CreateEntity(Id{ 1 });
+			world.AddComponent(a, Tag{ 2 });
+			bool moved = world.GetComponent<Id>(a)->m_value == 1 && world.GetComponent<Tag>(a)->m_value == 2;
+			world.RemoveComponent<Id>(a);
+			moved = moved && !world.HasComponent<Id>(a) && world.GetComponent<Tag>(a)->m_value == 2;
+			world.DestroyEntity(a);
+			Entities::Entity b = world.CreateEntity(Id{ 3 });
+			bool recycled = !world.IsAlive(a) && world.IsAlive(b) && b.m_index == a.m_index && !world.GetComponent<Tag>(a);
+
+			// Every other entity destroyed, the rest keep their values and the chunks stay packed.
+			std::vector<Entities::Entity> many;
+			for (int i = 0; i < 10000; ++i)
+				many.push_back(i % 3 ? world.CreateEntity(Id{ i }) : world.CreateEntity(Id{ i }, Tag{ i }));
+			uint32_t chunksBefore = world.GetStats().m_chunks;
+			for (int i = 0; i < 10000; i += 2)
+				world.DestroyEntity(many[i]);
+			bool intact = true;
+			for (int i = 1; i < 10000; i += 2)
+				intact = intact && world.GetComponent<Id>(many[i])->m_value == i;
+			Entities::Query ids, untagged;
+			ids.All<Id>();
+			untagged.All<Id>().None<Tag>();
+			int sum = 0, expected = 0;
+			world.Each<const Id>(untagged, [&sum](const Id& id) { sum += id.m_value; });
+			for (int i = 1; i < 10000; i += 2)
+				expected += (i % 3) ? i : 0;
+			bool queried = world.Count(ids) == 5001 && sum == expected + 3 && world.GetStats().m_chunks < chunksBefore;
+			printf("world: moves %d, recycled %d, intact %d, queried %d, %u archetypes, %u chunks%s\n", moved, recycled, intact, queried,
+				world.GetStats().m_archetypes, world.GetStats().m_chunks, moved && recycled && intact && queried ? "" : " FAILED");
+			passed = passed && moved && recycled && intact && queried;
+		}
+		JobSystem.Create();
+		FrameMemory.Create();
+		{
+			// Readers of a component share a stage after its writer, unrelated writers run alongside, exclusive systems run alone.
+			Entities::SystemScheduler scheduler;
+			std::atomic<int> written = 0;
+			std::atomic<int> early = 0;
+			scheduler.Add("Write Id", Entities::SystemAccess().Write<Id>(), [&written](Entities::World&) { written = 1; });
+			scheduler.Add("Read Id", Entities::SystemAccess().Read<Id>(), [&written, &early](Entities::World&) { early += !written; });
+			scheduler.Add("Read Id Again", Entities::SystemAccess().Read<Id>(), [&written, &early](Entities::World&) { early += !written; });
+			scheduler.Add("Write Tag", Entities::SystemAccess().Write<Tag>(), [](Entities::World&) { });
+			scheduler.Add("Exclusive", Entities::SystemAccess().Exclusive(), [](Entities::World&) { });
+			Entities::World world;
+			world.Create();
+			scheduler.Run(world);
+			bool staged = scheduler.GetStage("Write Id") == 0 && scheduler.GetStage("Read Id") == 1 && scheduler.GetStage("Read Id Again") == 1
+				&& scheduler.GetStage("Write Tag") == 0 && scheduler.GetStage("Exclusive") == 2 && scheduler.GetStageCount() == 3 && early == 0;
+			printf("scheduler: %d stages, %d workers%s\n", scheduler.GetStageCount(), JobSystem.GetWorkerCount(), staged ? "" : " FAILED");
+			passed = passed && staged;
+		}
+#ifdef TESTS_ENGINE
+		Objects::EntityBenchmarkReport report = Objects::RunEntityBenchmark(entities, 100);
+		printf("Update: %d entities, tree %.3f ms (parallel %.3f ms), entities %.3f ms (parallel %.3f ms), %.1fx, %u chunks\n", report.m_entities,
+			report.m_treeMs, report.m_treeParallelMs, report.m_entityMs, report.m_entityParallelMs, report.m_entityMs > 0.0 ? report.m_treeMs / report.m_entityMs : 0.0, report.m_chunks);
+		bool agree = report.m_maxDifference < 1e-3f;
+		printf("Transforms: max difference %g%s\n", report.m_maxDifference, agree ? "" : " FAILED");
+		passed = passed && agree;
+#else
+		(void)entities;
+#endif
+		FrameMemory.Destroy();
+		JobSystem.Destroy();
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,152 @@
+#include "Tests.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "Culling.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace Tests
+{
+	int PaceTest(const char* args)
+	{
+		// Mocked clock, so the result is the same on every machine.
+		double workMs = 8.0;
+		sscanf(args, "%lf", &workMs);
+		FramePacerSimulationReport report = RunFramePacerSimulation(6000, workMs);
+		printf("Pacing: %d frames, %.2f ms work, target %.3f ms, average %.3f ms, jitter %.3f ms, worst %.3f ms\n",
+			report.m_frames, workMs, report.m_targetMs, report.m_averageMs, report.m_jitterMs, report.m_worstMs);
+		printf("CPU: %.1f%% (spin only %.1f%%), %.3f steps/frame, drift %.3f ms, %llu spikes clamped\n",
+			report.m_cpuUsage * 100.0, report.m_spinOnlyCpuUsage * 100.0, report.m_stepsPerFrame, report.m_driftMs, (unsigned long long)report.m_spikes);
+		// Below budget the pacer must hold the target with sub-millisecond jitter and sleep for part of every frame.
+		bool paced = workMs * 1.25 >= report.m_targetMs || (fabs(report.m_averageMs - report.m_targetMs) < 0.01 && report.m_jitterMs < 1.0 && report.m_cpuUsage < report.m_spinOnlyCpuUsage);
+		bool passed = paced && report.m_alphaInRange && fabs(report.m_driftMs) < FramePacerSettings().smoothing * report.m_worstMs;
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int ProfTest(const char* args)
+	{
+		// Marker overhead, enabled, nested and switched off at runtime.
+		int markers = 1000000;
+		sscanf(args, "%d", &markers);
+		Profiler.Create();
+		Profiling::ProfilerBenchmarkReport report = Profiling::RunProfilerBenchmark(markers);
+		printf("Profiler: %d markers, loop %.2f ns, marker %.2f ns, nested %.2f ns, disabled %.2f ns, collect %.2f ns/event\n",
+			report.m_markers, report.m_loopNs, report.m_markerNs, report.m_nestedNs, report.m_disabledNs, report.m_collectNs);
+		Profiler.Destroy();
+		return 0;
+	}
+
+	int CullTest(const char* args)
+	{
+		// Brute force and BVH culling of random boxes, every result checked against the scalar reference.
+		int objects = 100000;
+		sscanf(args, "%d", &objects);
+		Renderer::CullingBenchmarkReport report = Renderer::RunCullingBenchmark(objects, 100);
+		printf("Culling: %d objects, %d frames, %.1f visible/frame, build %.2f ms\n", report.m_objects, report.m_frames, report.m_visible, report.m_buildMs);
+		printf("Per Frame: scalar %.3f ms, simd %.3f ms, bvh %.3f ms (%u nodes tested), update %.3f ms\n", report.m_scalarMs, report.m_simdMs, report.m_bvhMs, report.m_bvh.m_nodesTested, report.m_updateMs);
+		printf("BVH: %u nodes, cost %.2f, %u rebuilds, %d mismatches, %s\n", report.m_bvh.m_nodes, report.m_bvh.m_cost, report.m_bvh.m_rebuilds, report.m_mismatches, report.m_valid ? "valid" : "INVALID");
+		// The tree has to pay for itself against testing every box.
+		bool faster = report.m_bvhMs <= report.m_simdMs;
+		printf("BVH against brute force: %.2fx, %s\n", report.m_simdMs / report.m_bvhMs, faster ? "ok" : "FAILED");
+
+		Math::Matrix4F projection(1.0f);
+		projection.Perspective(16.0f / 9.0f, Math::DegreesToRadians(75.0f), 0.1f, 400.0f);
+		Renderer::Frustum frustum(projection);
+
+		// Incremental // Leaves culled before they are placed, placed one at a time, moved and removed between updates.
+		Renderer::BoundingVolumeHierarchy bvh;
+		std::vector<Math::BoundingBox> boxes;
+		std::vector<Renderer::BvhProxy> proxies;
+		std::vector<uint8_t> removed;
+		srand(7);
+		auto add = [&](int count)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				Math::Vector3F center((float)(rand() % 400 - 200), (float)(rand() % 400 - 200), (float)(rand() % 400 - 300));
+				Math::Vector3F extents(1.0f + rand() % 4, 1.0f + rand() % 4, 1.0f + rand() % 4);
+				boxes.push_back(Math::BoundingBox(center - extents, center + extents));
+				proxies.push_back(bvh.Insert(boxes.back(), (int)proxies.size()));
+				removed.push_back(0);
+			}
+		};
+		auto matches = [&]()
+		{
+			std::vector<int> visible;
+			bvh.Cull(frustum, visible);
+			std::vector<int> seen(boxes.size(), 0);
+			for (int v : visible)
+				seen[v]++;
+			for (size_t i = 0; i < boxes.size(); ++i)
+			{
+				int expected = removed[i] ? 0 : (frustum.TestScalar(boxes[i]) != Renderer::CULL_OUTSIDE);
+				if (seen[i] != expected)
+					return false;
+			}
+			return bvh.Validate();
+		};
+		add(2000);
+		bool incremental = matches();
+		bvh.Update();
+		incremental = incremental && matches();
+		add(200);
+		incremental = incremental && matches();
+		bvh.Update();
+		incremental = incremental && matches();
+		for (size_t i = 0; i < boxes.size(); i += 3)
+		{
+			bvh.Remove(proxies[i]);
+			removed[i] = 1;
+		}
+		incremental = incremental && matches();
+		for (size_t i = 1; i < boxes.size(); i += 3)
+		{
+			boxes[i] = Math::BoundingBox(boxes[i].minimum + Math::Vector3F(0.0f, 0.0f, -30.0f), boxes[i].maximum + Math::Vector3F(0.0f, 0.0f, -30.0f));
+			bvh.Move(proxies[i], boxes[i]);
+		}
+		bvh.Update();
+		incremental = incremental && matches();
+		printf("Incremental: %u leaves, %u rebuilds, %s\n", bvh.GetStats().m_leaves, bvh.GetStats().m_rebuilds, incremental ? "ok" : "FAILED");
+
+		// Meshlets // A strip of meshlets along the view, each index covered exactly when its meshlet is not outside, with no
+		// two ranges that could have merged.
+		const int meshletCount = 256;
+		std::vector<Renderer::Meshes::Meshlet> meshlets(meshletCount);
+		srand(7);
+		for (int i = 0; i < meshletCount; ++i)
+		{
+			Renderer::Meshes::Meshlet& meshlet = meshlets[i];
+			meshlet.m_firstIndex = (uint32_t)i * 96 + (i % 7 == 6 ? 3 : 0); // Every seventh leaves a gap before it.
+			meshlet.m_indexCount = 93;
+			float x = (float)(rand() % 200 - 100), y = (float)(rand() % 200 - 100), z = -(float)(rand() % 300);
+			for (int k = 0; k < 3; ++k)
+			{
+				meshlet.m_min[k] = (k == 0 ? x : (k == 1 ? y : z)) - 1.0f;
+				meshlet.m_max[k] = meshlet.m_min[k] + 2.0f;
+			}
+		}
+		std::vector<Renderer::IndexRange> ranges;
+		Renderer::CullMeshlets(frustum, meshlets.data(), meshlets.size(), ranges);
+		bool covered = true;
+		int visible = 0;
+		size_t r = 0;
+		for (const Renderer::Meshes::Meshlet& meshlet : meshlets)
+		{
+			Math::BoundingBox box(Math::Vector3F(meshlet.m_min[0], meshlet.m_min[1], meshlet.m_min[2]), Math::Vector3F(meshlet.m_max[0], meshlet.m_max[1], meshlet.m_max[2]));
+			bool inside = frustum.TestScalar(box) != Renderer::CULL_OUTSIDE;
+			while (r < ranges.size() && ranges[r].m_firstIndex + ranges[r].m_indexCount <= meshlet.m_firstIndex)
+				r++;
+			bool inRange = r < ranges.size() && ranges[r].m_firstIndex <= meshlet.m_firstIndex && meshlet.m_firstIndex + meshlet.m_indexCount <= ranges[r].m_firstIndex + ranges[r].m_indexCount;
+			covered = covered && inside == inRange;
+			visible += inside;
+		}
+		for (size_t i = 1; i < ranges.size(); ++i)
+			covered = covered && ranges[i - 1].m_firstIndex + ranges[i - 1].m_indexCount < ranges[i].m_firstIndex;
+		printf("Meshlets: %d of %d visible in %zu ranges, %s\n", visible, meshletCount, ranges.size(), covered ? "ok" : "FAILED");
+		return (report.m_mismatches == 0 && report.m_valid && faster && incremental && covered && visible > 0 && visible < meshletCount) ? 0 : 1;
+	}
+}
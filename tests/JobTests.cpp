@@ -0,0 +1,348 @@
+#include "Tests.h"
+#include "Jobs.h"
+#ifdef TESTS_ENGINE
+#include "GameObject.h"
+#include "Memory.h"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Tests
+{
+	// A few microseconds of arithmetic the optimizer cannot drop.
+	static float Work(int seed, int iterations)
+	{
+		float x = (float)seed;
+		for (int i = 0; i < iterations; ++i)
+			x = sinf(x) + 1.0f;
+		return x;
+	}
+
+	int JobTest(const char* args)
+	{
+		// Dispatch coverage, a chain of continuations that must run in order and once each, and jobs pushed from threads outside
+		// the scheduler. Run with more workers than cores so stealing and sleeping are exercised on any machine.
+		int workers = 8;
+		sscanf(args, "%d", &workers);
+		bool passed = true;
+		auto check = [&passed](const char* name, bool ok)
+		{
+			printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+			passed = passed && ok;
+		};
+		JobSystem.Create(workers);
+		printf("Workers: %d\n", JobSystem.GetWorkerCount());
+
+		// Dispatch // Every index visited once.
+		{
+			const int count = 100000;
+			std::vector<std::atomic<int>> visits(count);
+			Jobs::Counter counter = 0;
+			JobSystem.Dispatch(count, 97, [&visits](int start, int end)
+			{
+				for (int i = start; i < end; ++i)
+					visits[i].fetch_add(1);
+			}, &counter);
+			JobSystem.Wait(&counter);
+			bool once = true;
+			for (std::atomic<int>& v : visits)
+				once = once && v.load() == 1;
+			check("Dispatch", once);
+		}
+
+		// Continuations // Each link waits on the previous one and releases a few siblings, which must all find it already run.
+		{
+			const int links = 2000, fan = 4;
+			std::vector<Jobs::Counter> counters(links);
+			Jobs::Counter siblings = 0;
+			std::atomic<int> order = 0, runs = 0;
+			std::vector<int> ranAt(links, -1);
+			std::atomic<bool> ordered = true;
+			for (int i = 0; i < links; ++i)
+			{
+				counters[i] = 0;
+				Jobs::Counter* dependency = i ? &counters[i - 1] : nullptr;
+				JobSystem.Run([&, i]()
+				{
+					ranAt[i] = order.fetch_add(1);
+					runs.fetch_add(1);
+					Work(i, 50);
+				}, &counters[i], dependency);
+				for (int f = 0; f < fan; ++f)
+				{
+					JobSystem.Run([&, i]()
+					{
+						if (ranAt[i] < 0)
+							ordered = false;
+						runs.fetch_add(1);
+					}, &siblings, &counters[i]);
+				}
+			}
+			JobSystem.Wait(&counters[links - 1]);
+			bool chained = true;
+			for (int i = 1; i < links; ++i)
+				chained = chained && ranAt[i] > ranAt[i - 1];
+			JobSystem.Wait(&siblings);
+			check("Chain order", chained && ordered.load());
+			check("Each job run once", runs.load() == links * (fan + 1));
+		}
+
+		// Outside threads // Each pushes and waits on its own counter, more threads than there are external queues.
+		{
+			const int threads = JOB_EXTERNAL_QUEUES + 4, jobs = 500;
+			std::atomic<int> executed = 0;
+			std::atomic<int> workerRuns = 0, inside = 0;
+			std::vector<std::thread> pushers;
+			for (int t = 0; t < threads; ++t)
+			{
+				pushers.emplace_back([&]()
+				{
+					Jobs::Counter counter = 0;
+					for (int i = 0; i < jobs; ++i)
+					{
+						JobSystem.Run([&]()
+						{
+							executed.fetch_add(1);
+							if (Jobs::Scheduler::GetWorkerIndex() >= 0)
+								workerRuns.fetch_add(1);
+						}, &counter);
+					}
+					JobSystem.Wait(&counter);
+					if (Jobs::Scheduler::GetWorkerIndex() != -1)
+						inside.fetch_add(1);
+				});
+			}
+			for (std::thread& t : pushers)
+				t.join();
+			check("Outside threads", executed.load() == threads * jobs && inside.load() == 0);
+			printf("Outside threads: %d of %d jobs run by workers\n", workerRuns.load(), threads * jobs);
+		}
+
+		JobSystem.Destroy();
+		check("Index after destroy", Jobs::Scheduler::GetWorkerIndex() == -1);
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int JobBench(const char* args)
+	{
+		// Scaling from one worker up to the given count, doubling, with the speedup over one worker. Small jobs measure the
+		// scheduler's own cost, heavy ones the parallel throughput, and the chain how fast continuations are released.
+		int maxWorkers = std::max((int)std::thread::hardware_concurrency(), 1);
+		sscanf(args, "%d", &maxWorkers);
+		typedef std::chrono::high_resolution_clock Clock;
+		std::vector<int> workers;
+		for (int w = 1; w < maxWorkers; w *= 2)
+			workers.push_back(w);
+		workers.push_back(maxWorkers);
+
+		volatile float sink = 0.0f;
+		double small1 = 0.0, heavy1 = 0.0, chain1 = 0.0;
+		for (int w : workers)
+		{
+			JobSystem.Create(w);
+			auto time = [](auto&& body)
+			{
+				body();
+				Clock::time_point start = Clock::now();
+				body();
+				return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			};
+
+			// Small // 100k single jobs doing almost nothing.
+			const int smallJobs = 100000;
+			double smallMs = time([&]()
+			{
+				Jobs::Counter counter = 0;
+				for (int i = 0; i < smallJobs; ++i)
+					JobSystem.Run([&sink, i]() { sink = sink + (float)i; }, &counter);
+				JobSystem.Wait(&counter);
+			});
+
+			// Heavy // 4096 items of real work in groups of 16.
+			const int items = 4096;
+			std::vector<float> results(items);
+			double heavyMs = time([&]()
+			{
+				Jobs::Counter counter = 0;
+				JobSystem.Dispatch(items, 16, [&results](int start, int end)
+				{
+					for (int i = start; i < end; ++i)
+						results[i] = Work(i, 2000);
+				}, &counter);
+				JobSystem.Wait(&counter);
+			});
+
+			// Chain // 10k continuations in sequence, each released by the one before.
+			const int links = 10000;
+			std::vector<Jobs::Counter> counters(links);
+			double chainMs = time([&]()
+			{
+				for (int i = 0; i < links; ++i)
+				{
+					counters[i] = 0;
+					JobSystem.Run([&sink]() { sink = sink + 1.0f; }, &counters[i], i ? &counters[i - 1] : nullptr);
+				}
+				JobSystem.Wait(&counters[links - 1]);
+			});
+
+			if (w == 1)
+			{
+				small1 = smallMs;
+				heavy1 = heavyMs;
+				chain1 = chainMs;
+			}
+			printf("%d workers: small %.1f ns/job (%.2fx), heavy %.2f ms (%.2fx), chain %.1f ns/link (%.2fx)\n", w,
+				smallMs * 1e6 / smallJobs, small1 / smallMs, heavyMs, heavy1 / heavyMs, chainMs * 1e6 / links, chain1 / chainMs);
+			JobSystem.Destroy();
+		}
+		return 0;
+	}
+
+#ifdef TESTS_ENGINE
+	// Spins by a fixed step each update, from a local transform it can be put back to.
+	class SceneNode : public Objects::GameObject
+	{
+	public:
+		void Update() override
+		{
+			Rotate(0.01f * (1 + m_transform % 7), 0.0f, 1.0f, (float)(m_transform % 2));
+			GameObject::Update();
+		}
+		void Reset() { Transforms.ModifyLocal(m_transform) = m_initial; }
+		Objects::TransformHandle GetHandle() { return m_transform; }
+
+		Math::Matrix4F m_initial;
+	};
+
+	int SceneBench(const char* args)
+	{
+		// GameObject::UpdateParallel from one worker up to every core, doubling, on a wide tree of many small groups and a deep one
+		// of a few long chains. Each run starts from the same locals and must end on the globals of the serial Update.
+		int objects = 16384;
+		sscanf(args, "%d", &objects);
+		int maxWorkers = std::max((int)std::thread::hardware_concurrency(), 1);
+		std::vector<int> workers;
+		for (int w = 1; w < maxWorkers; w *= 2)
+			workers.push_back(w);
+		workers.push_back(maxWorkers);
+		typedef std::chrono::high_resolution_clock Clock;
+		const int frames = 20;
+		FrameMemory.Create();
+		Transforms.Create();
+
+		struct Scene
+		{
+			const char* m_name;
+			int m_groups; // Children of the root, each the top of a chain or a group.
+			bool m_deep;
+			SceneNode m_root;
+			std::vector<std::unique_ptr<SceneNode>> m_nodes;
+			std::vector<Math::Matrix4F> m_reference;
+			double m_serialMs = 0.0;
+		};
+		Scene scenes[2];
+		scenes[0].m_name = "wide";
+		scenes[0].m_groups = 64;
+		scenes[0].m_deep = false;
+		scenes[1].m_name = "deep";
+		scenes[1].m_groups = 16;
+		scenes[1].m_deep = true;
+		for (Scene& scene : scenes)
+		{
+			scene.m_root.Create();
+			scene.m_root.m_initial = Math::Matrix4F(1.0f);
+			int perGroup = std::max(objects / scene.m_groups, 1);
+			for (int g = 0; g < scene.m_groups; ++g)
+			{
+				// Wide groups are one node over the rest as leaves, deep ones a chain each child of the last.
+				SceneNode* parent = &scene.m_root;
+				for (int i = 0; i < perGroup; ++i)
+				{
+					std::unique_ptr<SceneNode> node = std::make_unique<SceneNode>();
+					node->Create();
+					node->m_initial = Math::Matrix4F(1.0f);
+					node->m_initial.SetTranslation((float)(g % 8), (float)i * 0.01f, (float)(g / 8));
+					node->Reset();
+					parent->AddChild(*node);
+					if (scene.m_deep || i == 0)
+						parent = node.get();
+					scene.m_nodes.push_back(std::move(node));
+				}
+			}
+		}
+		auto reset = [](Scene& scene)
+		{
+			scene.m_root.Reset();
+			for (auto& node : scene.m_nodes)
+				node->Reset();
+			Transforms.Update();
+		};
+
+		// Serial // The reference globals and time, on the calling thread alone.
+		for (Scene& scene : scenes)
+		{
+			reset(scene);
+			double ms = 0.0;
+			for (int f = 0; f < frames; ++f)
+			{
+				Clock::time_point start = Clock::now();
+				scene.m_root.Update();
+				ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				Transforms.Update();
+			}
+			scene.m_serialMs = ms / frames;
+			for (auto& node : scene.m_nodes)
+				scene.m_reference.push_back(Transforms.GetGlobal(node->GetHandle()));
+			printf("%s: %zu objects, serial update %.3f ms/frame\n", scene.m_name, scene.m_nodes.size(), scene.m_serialMs);
+		}
+
+		bool passed = true;
+		for (int w : workers)
+		{
+			JobSystem.Create(w);
+			printf("%d workers:", w);
+			for (Scene& scene : scenes)
+			{
+				reset(scene);
+				double ms = 0.0;
+				for (int f = 0; f < frames; ++f)
+				{
+					Clock::time_point start = Clock::now();
+					scene.m_root.UpdateParallel();
+					ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+					Transforms.Update();
+					FrameMemory.EndFrame();
+				}
+				ms /= frames;
+				bool same = true;
+				for (size_t i = 0; i < scene.m_nodes.size() && same; ++i)
+					same = memcmp(&Transforms.GetGlobal(scene.m_nodes[i]->GetHandle()), &scene.m_reference[i], sizeof(Math::Matrix4F)) == 0;
+				printf(" %s %.3f ms (%.2fx serial)%s", scene.m_name, ms, scene.m_serialMs / ms, same ? "" : " FAILED");
+				passed = passed && same;
+			}
+			printf("\n");
+			JobSystem.Destroy();
+		}
+
+		for (Scene& scene : scenes)
+		{
+			for (auto& node : scene.m_nodes)
+				node->Destroy();
+			scene.m_root.Destroy();
+		}
+		Transforms.Destroy();
+		FrameMemory.Destroy();
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+#endif
+}
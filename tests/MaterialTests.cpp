@@ -0,0 +1,137 @@
+#include "Tests.h"
+#include "Material.h"
+#ifdef TESTS_ENGINE
+#include "Renderer.h"
+#include "Camera.h"
+#include "Meshes.h"
+#include "TextureCache.h"
+#include "ShaderLibrary.h"
+#include "Jobs.h"
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace Tests
+{
+	int MaterialTest(const char* args)
+	{
+		// Deduplication and packing on the CPU. With the engine, then the material buffers through the null backend, read back from
+		// the recording device.
+		bool passed = true;
+		auto check = [&passed](const char* name, bool condition)
+		{
+			printf("%s: %s\n", name, condition ? "ok" : "FAILED");
+			passed = passed && condition;
+		};
+
+		// Deduplication // Equal descriptions share an id, one differing field does not. Released ids are reused.
+		Renderer::MaterialDesc red;
+		red.m_baseColor[1] = red.m_baseColor[2] = 0.0f;
+		Renderer::MaterialDesc green = red;
+		green.m_baseColor[0] = 0.0f;
+		green.m_baseColor[1] = 1.0f;
+		uint32_t redId = Materials.Acquire(red);
+		check("Shared", Materials.Acquire(red) == redId && redId != 0);
+		uint32_t greenId = Materials.Acquire(green);
+		check("Distinct", greenId != redId && greenId != 0);
+		check("Default", Materials.Acquire(Renderer::MaterialDesc()) == 0);
+		Materials.Release(redId);
+		check("Still referenced", Materials.Acquire(red) == redId);
+		Materials.Release(redId);
+		Materials.Release(redId);
+		Renderer::MaterialDesc blue = green;
+		blue.m_baseColor[1] = 0.0f;
+		blue.m_baseColor[2] = 1.0f;
+		uint32_t blueId = Materials.Acquire(blue);
+		check("Id reuse", blueId == redId);
+		check("Released lookup", Materials.Acquire(red) != blueId);
+		Renderer::MaterialDesc textured;
+		textured.m_textures[Renderer::MATERIAL_TEXTURE_DIFFUSE] = Renderer::RHI::TextureHandle::Make(7, 1);
+		textured.m_layers[Renderer::MATERIAL_TEXTURE_DIFFUSE] = 3;
+		uint32_t texturedId = Materials.Acquire(textured);
+		Renderer::MaterialDesc otherLayer = textured;
+		otherLayer.m_layers[Renderer::MATERIAL_TEXTURE_DIFFUSE] = 4;
+		check("Layer distinct", Materials.Acquire(otherLayer) != texturedId);
+		// Many objects, few materials.
+		unsigned int acquires = Materials.GetStats().m_acquires, shared = Materials.GetStats().m_shared, materials = Materials.GetStats().m_materials;
+		for (int i = 0; i < 1000; ++i)
+		{
+			Renderer::MaterialDesc desc;
+			desc.m_shader = i % 4;
+			desc.m_roughness = (float)(i % 5) / 8.0f; // Never 1, that and shader 0 is the default material.
+			Materials.Acquire(desc);
+		}
+		const Renderer::MaterialLibraryStats& stats = Materials.GetStats();
+		printf("1000 acquires: %u materials, %u shared\n", stats.m_materials - materials, stats.m_shared - shared);
+		check("Deduplicated", stats.m_acquires - acquires == 1000 && stats.m_materials - materials == 20 && stats.m_shared - shared == 980);
+
+		// Packing // Texture validity sets the flag, every field lands where the shader reads it.
+		Renderer::MaterialConstants packed = Renderer::MaterialLibrary::Pack(textured);
+		check("Pack layout", sizeof(Renderer::MaterialConstants) == 48 && offsetof(Renderer::MaterialConstants, m_uvTransform) == 16 && offsetof(Renderer::MaterialConstants, m_diffuseLayer) == 32);
+		check("Pack textured", packed.m_flags == Renderer::MATERIAL_FLAG_DIFFUSE && packed.m_diffuseLayer == 3 && packed.m_baseColor[3] == 1.0f && packed.m_uvTransform[0] == 1.0f && packed.m_roughness == 1.0f);
+		check("Pack untextured", Renderer::MaterialLibrary::Pack(green).m_flags == 0 && Renderer::MaterialLibrary::Pack(green).m_baseColor[1] == 1.0f);
+		std::vector<Renderer::MaterialConstants> all;
+		Materials.PackAll(all);
+		Renderer::MaterialConstants greenPacked = Renderer::MaterialLibrary::Pack(green);
+		check("Pack all", all.size() > texturedId && memcmp(&all[greenId], &greenPacked, sizeof(greenPacked)) == 0);
+
+#ifdef TESTS_ENGINE
+		// GPU Buffers // Grown past the starting capacity, bound by every draw of a few frames, free of validation errors.
+		{
+			JobSystem.Create();
+			Renderer::Renderer renderer;
+			renderer.CreateNull();
+			Textures.Create(renderer);
+			Shaders.Create(renderer);
+			Materials.Create(renderer);
+			for (int i = 0; i < MATERIAL_BUFFER_CAPACITY; ++i)
+			{
+				Renderer::MaterialDesc desc;
+				desc.m_metallic = (float)i;
+				Materials.Acquire(desc);
+			}
+			Renderer::Meshes::MeshRenderer first, second;
+			first.Create(renderer);
+			second.Create(renderer);
+			first.LoadModel("./res/models/heavy.dae");
+			UINT modelMaterials = Materials.GetStats().m_materials;
+			second.LoadModel("./res/models/heavy.dae");
+			check("Shared model", Materials.GetStats().m_materials == modelMaterials);
+			Renderer::Camera camera;
+			camera.CreatePerspective((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 60.0f, 0.1f, 100.0f);
+			Math::Matrix4F model(1.0f), view(1.0f);
+			view.m23 = -5.0f;
+			camera.Draw(view);
+			for (int f = 0; f < 4; ++f)
+			{
+				renderer.BeginFrame();
+				first.Draw(model, camera);
+				second.Draw(model, camera);
+				renderer.EndFrame();
+			}
+			Renderer::RHI::RecordingDevice* recording = renderer.GetRecordingDevice();
+			Materials.PackAll(all);
+			const uint8_t* contents = recording->GetContents(Materials.GetBuffer());
+			check("Buffer contents", contents && memcmp(contents, all.data(), all.size() * sizeof(Renderer::MaterialConstants)) == 0);
+			check("Buffer grown", Materials.GetStats().m_capacity >= all.size() && Materials.GetStats().m_capacity > MATERIAL_BUFFER_CAPACITY);
+			const Renderer::RenderQueueStats& queue = renderer.GetRenderQueue().GetStats();
+			printf("Null backend: %u draws, %u material binds, %u materials, %u uploads, %llu errors%s%s\n", queue.m_draws, queue.m_materialBinds,
+				Materials.GetStats().m_materials, Materials.GetStats().m_uploads, (unsigned long long)recording->GetRecordingStats().m_errors,
+				recording->GetErrors().empty() ? "" : ", first: ", recording->GetErrors().empty() ? "" : recording->GetErrors()[0].c_str());
+			check("Null backend", queue.m_materialBinds > 0 && recording->GetRecordingStats().m_draws > 0 && recording->GetRecordingStats().m_errors == 0);
+			first.Destroy();
+			second.Destroy();
+			Materials.Destroy();
+			Shaders.Destroy();
+			Textures.Destroy();
+			renderer.Destroy();
+			JobSystem.Destroy();
+		}
+#endif
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
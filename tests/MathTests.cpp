@@ -0,0 +1,181 @@
+#include "Tests.h"
+#include "Math.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Tests
+{
+#if defined(MATH_SIMD_AVX)
+	static const char* BackendName = "AVX";
+#elif defined(MATH_SIMD_SSE)
+	static const char* BackendName = "SSE";
+#else
+	static const char* BackendName = "scalar";
+#endif
+
+	static float Random(float low, float high) { return low + (high - low) * (rand() / (float)RAND_MAX); }
+	// Rotation, non-uniform scale and translation, the transforms the engine actually multiplies and inverts.
+	static Math::Matrix4F RandomTransform()
+	{
+		Math::Matrix4F m(1.0f);
+		m.RotateX(Random(-3.0f, 3.0f));
+		m.RotateY(Random(-3.0f, 3.0f));
+		m.RotateZ(Random(-3.0f, 3.0f));
+		m.Scale(Random(0.2f, 5.0f), Random(0.2f, 5.0f), Random(0.2f, 5.0f));
+		m.m30 = Random(-100.0f, 100.0f);
+		m.m31 = Random(-100.0f, 100.0f);
+		m.m32 = Random(-100.0f, 100.0f);
+		return m;
+	}
+	// Dense with a dominant diagonal, so every element takes part and the inverse stays well conditioned.
+	static Math::Matrix4F RandomDense()
+	{
+		Math::Matrix4F m;
+		for (int i = 0; i < 16; ++i)
+			m.m[i / 4][i % 4] = Random(-1.0f, 1.0f) + (i % 5 == 0 ? 4.0f : 0.0f);
+		return m;
+	}
+	// Largest difference relative to the magnitude of the reference, absolute below 1.
+	static float Difference(const float* a, const float* reference, int count)
+	{
+		float worst = 0.0f;
+		for (int i = 0; i < count; ++i)
+			worst = std::max(worst, fabsf(a[i] - reference[i]) / std::max(1.0f, fabsf(reference[i])));
+		return worst;
+	}
+
+	int MathTest(const char* args)
+	{
+		// The dispatched backend against the scalar reference path, over random transforms and dense matrices.
+		int count = 10000;
+		sscanf(args, "%d", &count);
+		bool passed = true;
+		auto check = [&passed](const char* name, float difference, float tolerance)
+		{
+			bool ok = difference <= tolerance;
+			printf("%s: max relative difference %g, tolerance %g%s\n", name, difference, tolerance, ok ? "" : " FAILED");
+			passed = passed && ok;
+		};
+		printf("Backend: %s\n", BackendName);
+
+		srand(7);
+		std::vector<Math::Matrix4F> matrices(count);
+		for (int i = 0; i < count; ++i)
+			matrices[i] = i % 2 ? RandomDense() : RandomTransform();
+		float multiply = 0.0f, transform = 0.0f, transpose = 0.0f, inverse = 0.0f, identity = 0.0f;
+		const Math::Matrix4F unit(1.0f);
+		for (int i = 0; i < count; ++i)
+		{
+			const Math::Matrix4F& a = matrices[i];
+			const Math::Matrix4F& b = matrices[(i + 1) % count];
+			Math::Matrix4F product = Math::Multiply(a, b), productReference = Math::Scalar::Multiply(a, b);
+			multiply = std::max(multiply, Difference(&product.m[0][0], &productReference.m[0][0], 16));
+			Math::Vector4F v(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), 1.0f);
+			Math::Vector4F t = Math::Transform(a, v), tReference = Math::Scalar::Transform(a, v);
+			transform = std::max(transform, Difference(t.v, tReference.v, 4));
+			Math::Matrix4F transposed = Math::Transpose(a), transposedReference = Math::Scalar::Transpose(a);
+			transpose = std::max(transpose, Difference(&transposed.m[0][0], &transposedReference.m[0][0], 16));
+			Math::Matrix4F inverted = Math::Inverse(a), invertedReference = Math::Scalar::Inverse(a);
+			inverse = std::max(inverse, Difference(&inverted.m[0][0], &invertedReference.m[0][0], 16));
+			Math::Matrix4F round = Math::Multiply(inverted, a);
+			identity = std::max(identity, Difference(&round.m[0][0], &unit.m[0][0], 16));
+		}
+		check("Multiply", multiply, 1e-5f);
+		check("Transform", transform, 1e-5f);
+		check("Transpose", transpose, 0.0f);
+		check("Inverse", inverse, 1e-4f);
+		check("Inverse round trip", identity, 1e-3f);
+
+		// Arrays // Odd lengths, so any tail handling is covered.
+		std::vector<Math::Vector3F> points(count + 3), pointsOut(count + 3), pointsReference(count + 3);
+		std::vector<Math::Vector4F> vectors(count + 3), vectorsOut(count + 3), vectorsReference(count + 3);
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			points[i] = Math::Vector3F(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+			vectors[i] = Math::Vector4F(points[i].x, points[i].y, points[i].z, Random(-1.0f, 1.0f));
+		}
+		Math::TransformArray(matrices[0], points.data(), pointsOut.data(), points.size());
+		Math::Scalar::TransformArray(matrices[0], points.data(), pointsReference.data(), points.size());
+		Math::TransformArray(matrices[1], vectors.data(), vectorsOut.data(), vectors.size());
+		Math::Scalar::TransformArray(matrices[1], vectors.data(), vectorsReference.data(), vectors.size());
+		float points3 = 0.0f, vectors4 = 0.0f;
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			points3 = std::max(points3, Difference(pointsOut[i].v, pointsReference[i].v, 3));
+			vectors4 = std::max(vectors4, Difference(vectorsOut[i].v, vectorsReference[i].v, 4));
+		}
+		check("Transform array 3", points3, 1e-5f);
+		check("Transform array 4", vectors4, 1e-5f);
+
+		// Singular // Both paths fall back to identity.
+		Math::Matrix4F singular(1.0f);
+		singular.m11 = 0.0f;
+		Math::Matrix4F fallback = Math::Inverse(singular), fallbackReference = Math::Scalar::Inverse(singular);
+		check("Singular", std::max(Difference(&fallback.m[0][0], &unit.m[0][0], 16), Difference(&fallbackReference.m[0][0], &unit.m[0][0], 16)), 0.0f);
+
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int MathBench(const char* args)
+	{
+		// Nanoseconds per operation for the scalar path and the dispatched backend, over arrays too large to stay in registers.
+		int iterations = 200;
+		sscanf(args, "%d", &iterations);
+		const int count = 1024;
+		srand(7);
+		std::vector<Math::Matrix4F> a(count), b(count), out(count);
+		std::vector<Math::Vector4F> vectors(count), vectorsOut(count);
+		std::vector<Math::Vector3F> points(count * 16), pointsOut(count * 16);
+		for (int i = 0; i < count; ++i)
+		{
+			a[i] = RandomTransform();
+			b[i] = RandomDense();
+			vectors[i] = Math::Vector4F(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), 1.0f);
+		}
+		for (Math::Vector3F& p : points)
+			p = Math::Vector3F(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f));
+
+		// Results are summed into a volatile so no loop is optimized away.
+		volatile float sink = 0.0f;
+		typedef std::chrono::high_resolution_clock Clock;
+		auto time = [&](auto&& body, size_t operations)
+		{
+			body();
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < iterations; ++i)
+				body();
+			double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			return ns / ((double)iterations * operations);
+		};
+		auto report = [&](const char* name, double scalarNs, double backendNs)
+		{
+			printf("%s: scalar %.2f ns, %s %.2f ns, %.2fx\n", name, scalarNs, BackendName, backendNs, backendNs > 0.0 ? scalarNs / backendNs : 0.0);
+		};
+
+		report("Multiply",
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Scalar::Multiply(a[i], b[i]); sink = sink + out[count - 1].m33; }, count),
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Multiply(a[i], b[i]); sink = sink + out[count - 1].m33; }, count));
+		report("Transform",
+			time([&]() { for (int i = 0; i < count; ++i) vectorsOut[i] = Math::Scalar::Transform(a[i], vectors[i]); sink = sink + vectorsOut[count - 1].w; }, count),
+			time([&]() { for (int i = 0; i < count; ++i) vectorsOut[i] = Math::Transform(a[i], vectors[i]); sink = sink + vectorsOut[count - 1].w; }, count));
+		report("Transpose",
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Scalar::Transpose(a[i]); sink = sink + out[count - 1].m03; }, count),
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Transpose(a[i]); sink = sink + out[count - 1].m03; }, count));
+		report("Inverse",
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Scalar::Inverse(b[i]); sink = sink + out[count - 1].m33; }, count),
+			time([&]() { for (int i = 0; i < count; ++i) out[i] = Math::Inverse(b[i]); sink = sink + out[count - 1].m33; }, count));
+		report("Transform array 3",
+			time([&]() { Math::Scalar::TransformArray(a[0], points.data(), pointsOut.data(), points.size()); sink = sink + pointsOut.back().z; }, points.size()),
+			time([&]() { Math::TransformArray(a[0], points.data(), pointsOut.data(), points.size()); sink = sink + pointsOut.back().z; }, points.size()));
+		report("Transform array 4",
+			time([&]() { Math::Scalar::TransformArray(a[0], vectors.data(), vectorsOut.data(), vectors.size()); sink = sink + vectorsOut.back().w; }, vectors.size()),
+			time([&]() { Math::TransformArray(a[0], vectors.data(), vectorsOut.data(), vectors.size()); sink = sink + vectorsOut.back().w; }, vectors.size()));
+		return 0;
+	}
+}
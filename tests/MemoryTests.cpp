@@ -0,0 +1,130 @@
+#include "Tests.h"
+#include "Memory.h"
+#include "Profiler.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace Tests
+{
+	int RingTest(const char* args)
+	{
+		// Constant ring sub-allocation with a GPU that lags a few frames, every live byte is owned by one frame at most.
+		bool passed = true;
+		const size_t capacity = 64 * 1024, granule = 16;
+		Memory::RingAllocator ring;
+		ring.Create(capacity);
+		{
+			// Alignment, then the wrap to the front, refused until the first frame is retired.
+			size_t a = ring.Allocate(1000, 256), b = ring.Allocate(100, 256);
+			ring.EndFrame();
+			size_t c = ring.Allocate(capacity - 2048, 256), d = ring.Allocate(1024, 256);
+			ring.EndFrame();
+			bool aligned = a == 0 && b == 1024 && c == 1280;
+			ring.RetireFrame();
+			size_t e = ring.Allocate(2048, 256), f = ring.Allocate(1024, 256);
+			bool wrapped = d == Memory::RingAllocator::InvalidOffset && e == Memory::RingAllocator::InvalidOffset && f == 0 && ring.GetWraps() == 1;
+			ring.RetireFrame();
+			ring.EndFrame();
+			ring.RetireFrame();
+			bool empty = ring.GetUsed() == 0 && ring.GetFramesInFlight() == 0 && ring.Allocate(capacity, 256) == 0;
+			printf("basics: aligned %d, wrapped %d, empty %d%s\n", aligned, wrapped, empty, aligned && wrapped && empty ? "" : " FAILED");
+			passed = passed && aligned && wrapped && empty;
+		}
+		ring.Create(capacity);
+		{
+			// Random sizes and alignments, retired CONSTANT_RING_FRAMES behind, waiting on the oldest frame when full like the renderer.
+			std::vector<int> owner(capacity / granule, -1);
+			std::vector<std::vector<size_t>> frames;
+			size_t allocations = 0, waits = 0, retired = 0;
+			bool overlap = false, misaligned = false;
+			srand(7);
+			auto retire = [&]()
+			{
+				for (size_t granuleIndex : frames[retired])
+					owner[granuleIndex] = -1;
+				ring.RetireFrame();
+				retired++;
+			};
+			for (int frame = 0; frame < 2000; ++frame)
+			{
+				frames.emplace_back();
+				int count = rand() % 64;
+				for (int i = 0; i < count; ++i)
+				{
+					size_t size = 16 + (size_t)(rand() % 1024), alignment = (size_t)16 << (rand() % 5);
+					size_t offset = ring.Allocate(size, alignment);
+					if (offset == Memory::RingAllocator::InvalidOffset && ring.GetFramesInFlight() > 0)
+					{
+						retire();
+						waits++;
+						offset = ring.Allocate(size, alignment);
+					}
+					if (offset == Memory::RingAllocator::InvalidOffset)
+						continue; // Only when the frame itself fills the ring.
+					misaligned = misaligned || offset % alignment != 0 || offset + size > capacity;
+					for (size_t g = offset / granule; g < (offset + size + granule - 1) / granule; ++g)
+					{
+						overlap = overlap || owner[g] != -1;
+						owner[g] = frame;
+						frames.back().push_back(g);
+					}
+					allocations++;
+				}
+				ring.EndFrame();
+				if (ring.GetFramesInFlight() >= CONSTANT_RING_FRAMES)
+					retire();
+			}
+			while (ring.GetFramesInFlight() > 0)
+				retire();
+			bool valid = !overlap && !misaligned && ring.GetUsed() == 0 && ring.GetWraps() > 0;
+			printf("stress: %zu allocations, %u wraps, %zu waits, overlap %d, misaligned %d%s\n",
+				allocations, ring.GetWraps(), waits, overlap, misaligned, valid ? "" : " FAILED");
+			passed = passed && valid;
+		}
+		ring.Destroy();
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int AllocTest(const char* args)
+	{
+		// Frame scratch and node churn through the heap, the frame arena and pools, then a profiled frame loop that must stop allocating.
+		int items = 1000;
+		sscanf(args, "%d", &items);
+		Memory::AllocatorBenchmarkReport report = Memory::RunAllocatorBenchmark(1000, items);
+		printf("Allocators: %d items/frame, vector heap %.4f ms, arena %.4f ms, map heap %.4f ms, pool %.4f ms\n",
+			report.m_itemsPerFrame, report.m_heapVectorMs, report.m_arenaVectorMs, report.m_heapMapMs, report.m_poolMapMs);
+		printf("Heap Allocations/Frame: heap %.2f, arena %.2f, pool %.2f%s\n",
+			report.m_heapAllocationsPerFrame, report.m_arenaAllocationsPerFrame, report.m_poolAllocationsPerFrame, report.m_tracking ? "" : " (tracking off)");
+		Profiler.Create();
+		FrameMemory.Create();
+		uint64_t steady = 0;
+		for (int f = 0; f < PROFILER_HISTORY + 100; ++f)
+		{
+			Profiler.BeginFrame();
+			{
+				PROFILE_SCOPE("Frame");
+				Memory::FrameVector<int> scratch(FrameMemory.GetAllocator());
+				for (int i = 0; i < items; ++i)
+				{
+					PROFILE_SCOPE("Item");
+					scratch.push_back(i);
+				}
+			}
+			Profiler.EndFrame();
+			FrameMemory.EndFrame();
+			// Every history slot grows on its first use, the frames after one full pass are steady.
+			if (f >= PROFILER_HISTORY)
+				steady += FrameMemory.GetStats().m_heapAllocations;
+		}
+		printf("Frame Loop: %llu heap allocations over 100 steady frames, arena %zu bytes\n", (unsigned long long)steady, FrameMemory.GetStats().m_arenaCapacity);
+		FrameMemory.Destroy();
+		Profiler.Destroy();
+		bool passed = !report.m_tracking || (report.m_arenaAllocationsPerFrame == 0.0 && report.m_poolAllocationsPerFrame == 0.0 && steady == 0);
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,465 @@
+#include "Tests.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#ifdef TESTS_ENGINE
+#include "CookedMesh.h"
+#include "Meshes.h"
+#endif
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace Tests
+{
+	// Same layout as the engine's textured vertex, so cooked and imported meshes compare directly.
+	struct Vertex { float x, y, z, u, v; };
+
+	int MeshOptTest(const char* args)
+	{
+		// Every mesh of the shipped models, plus a generated triangle soup grid, through both cache optimizers.
+		// Checked for identical triangles and no loss in cache efficiency. With the engine, each model's Assimp import is timed
+		// against loading it cooked.
+		struct TestMesh
+		{
+			std::string m_name;
+			std::vector<Vertex> m_vertices;
+			std::vector<uint32_t> m_indices;
+		};
+		std::vector<TestMesh> meshes;
+#ifdef TESTS_ENGINE
+		char path[260] = { };
+		if (args[0] == ' ' && args[1] != '-')
+			sscanf(args + 1, "%259s", path);
+		std::vector<std::string> models;
+		if (path[0])
+			models.push_back(path);
+		else
+			models = { "./res/models/heavy.dae", "./res/models/cube.blend" };
+		for (const std::string& model : models)
+		{
+			Renderer::Meshes::ModelData data;
+			data.m_optimize = false;
+			if (!Renderer::Meshes::MeshRenderer::Import(model.c_str(), nullptr, data) || data.m_cooked)
+			{
+				printf("%s: %s, skipped\n", model.c_str(), data.m_cooked ? "cooked" : "could not import");
+				continue;
+			}
+			for (size_t i = 0; i < data.m_meshes.size(); ++i)
+			{
+				Renderer::Meshes::Mesh& m = data.m_meshes[i];
+				const Vertex* vertices = (const Vertex*)m.m_vertices.data();
+				meshes.push_back({ model + "#" + std::to_string(i), std::vector<Vertex>(vertices, vertices + m.m_vertices.size()),
+					std::vector<uint32_t>(m.m_indices.begin(), m.m_indices.end()) });
+			}
+		}
+
+		// Load Time // Each model through Assimp, then cooked next to itself and loaded from the mapping, the same meshes either way.
+		bool loads = true;
+		for (const std::string& model : models)
+		{
+			std::string cookedPath = model + COOKED_MESH_EXTENSION;
+			if (FILE* f = fopen(cookedPath.c_str(), "rb"))
+			{
+				fclose(f);
+				printf("%s: already cooked, load time skipped\n", model.c_str());
+				continue;
+			}
+			Renderer::Meshes::ModelData imported, cooked;
+			imported.m_packTextures = cooked.m_packTextures = false;
+			auto start = std::chrono::high_resolution_clock::now();
+			bool ok = Renderer::Meshes::MeshRenderer::Import(model.c_str(), nullptr, imported) && !imported.m_cooked;
+			double importMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			start = std::chrono::high_resolution_clock::now();
+			ok = ok && Renderer::Meshes::CookMesh(model.c_str(), cookedPath.c_str());
+			double cookMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			start = std::chrono::high_resolution_clock::now();
+			ok = ok && Renderer::Meshes::MeshRenderer::Import(model.c_str(), nullptr, cooked) && cooked.m_cooked;
+			double cookedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			cooked.m_file.reset();
+			remove(cookedPath.c_str());
+			ok = ok && imported.m_meshes.size() == cooked.m_meshes.size();
+			for (size_t i = 0; ok && i < imported.m_meshes.size(); ++i)
+			{
+				const Renderer::Meshes::Mesh& a = imported.m_meshes[i];
+				const Renderer::Meshes::Mesh& b = cooked.m_meshes[i];
+				ok = a.m_vertexCount == b.m_vertexCount && a.m_indexCount == b.m_indexCount && a.m_indexSize == b.m_indexSize
+					&& a.m_meshlets.size() == b.m_meshlets.size() && a.m_lods.size() == b.m_lods.size();
+				for (size_t l = 0; ok && l < a.m_lods.size(); ++l)
+					ok = a.m_lods[l].m_indexCount == b.m_lods[l].m_indexCount;
+			}
+			printf("%s: assimp %.2f ms, cook %.2f ms, cooked %.2f ms, %.1fx faster%s\n", model.c_str(), importMs, cookMs, cookedMs,
+				importMs / (cookedMs > 0.0 ? cookedMs : 1e-6), ok ? "" : " FAILED");
+			loads = loads && ok;
+		}
+#else
+		bool loads = true;
+		if (args[0] == ' ' && args[1] != '-')
+			printf("Models need the engine build, only the grid is tested\n");
+#endif
+		{
+			// Unwelded, every triangle with its own vertices.
+			TestMesh grid = { "grid 64x64" };
+			for (int y = 0; y < 64; ++y)
+			{
+				for (int x = 0; x < 64; ++x)
+				{
+					float corners[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+					for (auto& c : corners)
+					{
+						grid.m_indices.push_back((uint32_t)grid.m_vertices.size());
+						grid.m_vertices.push_back({ x + c[0], y + c[1], 0.0f, (x + c[0]) / 64.0f, (y + c[1]) / 64.0f });
+					}
+				}
+			}
+			meshes.push_back(grid);
+		}
+
+		bool passed = loads;
+		const Renderer::Meshes::VertexCacheMethod methods[] = { Renderer::Meshes::VertexCacheMethod::Forsyth, Renderer::Meshes::VertexCacheMethod::Tipsify };
+		for (const TestMesh& mesh : meshes)
+		{
+			for (Renderer::Meshes::VertexCacheMethod method : methods)
+			{
+				std::vector<Vertex> vertices = mesh.m_vertices;
+				std::vector<uint32_t> indices = mesh.m_indices;
+				Renderer::Meshes::MeshOptimizationSettings settings;
+				settings.cache = method;
+				settings.analyzeOverdraw = true;
+				Renderer::Meshes::MeshOptimizationReport report = Renderer::Meshes::OptimizeMesh(vertices, indices, settings);
+				bool valid = Renderer::Meshes::CompareTriangles(mesh.m_vertices.data(), mesh.m_indices.data(), mesh.m_indices.size(),
+					vertices.data(), indices.data(), indices.size(), sizeof(Vertex));
+				for (uint32_t index : indices)
+					valid = valid && index < vertices.size();
+				valid = valid && report.m_after.m_acmr <= report.m_before.m_acmr && report.m_after.m_overdraw <= report.m_before.m_overdraw * 1.05f;
+				printf("%s (%s): %zu -> %zu vertices, %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overfetch %.2f -> %.2f, overdraw %.3f -> %.3f, %.2f ms%s\n",
+					mesh.m_name.c_str(), method == Renderer::Meshes::VertexCacheMethod::Forsyth ? "Forsyth" : "Tipsify",
+					report.m_verticesBefore, report.m_verticesAfter, report.m_trianglesAfter, report.m_before.m_acmr, report.m_after.m_acmr,
+					report.m_before.m_atvr, report.m_after.m_atvr, report.m_before.m_overfetch, report.m_after.m_overfetch,
+					report.m_before.m_overdraw, report.m_after.m_overdraw, report.m_ms, valid ? "" : " FAILED");
+				passed = passed && valid;
+			}
+		}
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int IndexTest(const char* args)
+	{
+		// Generated grids either side of the 16-bit limit, through optimization, index packing, meshlets and a cooked round trip.
+		bool passed = true;
+		auto makeGrid = [](int size, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			// Unwelded, welding leaves (size + 1)^2 vertices. Positions only, like the OBJ written from it.
+			vertices.clear();
+			indices.clear();
+			for (int y = 0; y < size; ++y)
+			{
+				for (int x = 0; x < size; ++x)
+				{
+					float corners[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+					for (auto& c : corners)
+					{
+						indices.push_back((uint32_t)vertices.size());
+						vertices.push_back({ x + c[0], y + c[1], sinf((x + c[0]) * 0.1f), 0.0f, 0.0f });
+					}
+				}
+			}
+		};
+		const int sizes[] = { 64, 300 };
+		for (int size : sizes)
+		{
+			std::vector<Vertex> source, vertices;
+			std::vector<uint32_t> sourceIndices, indices;
+			makeGrid(size, source, sourceIndices);
+			vertices = source;
+			indices = sourceIndices;
+			Renderer::Meshes::MeshOptimizationReport report = Renderer::Meshes::OptimizeMesh(vertices, indices);
+			bool valid = Renderer::Meshes::CompareTriangles(source.data(), sourceIndices.data(), sourceIndices.size(),
+				vertices.data(), indices.data(), indices.size(), sizeof(Vertex));
+
+			// Index Width // 16-bit exactly when every index fits.
+			uint32_t maxIndex = 0;
+			for (uint32_t index : indices)
+				maxIndex = std::max(maxIndex, index);
+			uint32_t indexSize = Renderer::Meshes::SelectIndexSize(vertices.size());
+			valid = valid && (indexSize == 2) == (maxIndex <= 0xFFFF) && (indexSize == 4) == (vertices.size() > 0x10000);
+			std::vector<uint8_t> packed(indices.size() * indexSize);
+			Renderer::Meshes::PackIndices(packed.data(), indices.data(), indices.size(), indexSize);
+			for (size_t i = 0; i < indices.size() && valid; ++i)
+				valid = (indexSize == 2 ? ((uint16_t*)packed.data())[i] : ((uint32_t*)packed.data())[i]) == indices[i];
+
+			// Meshlets // Within the limits, covering every index in order, bounds holding every vertex.
+			std::vector<Renderer::Meshes::Meshlet> meshlets;
+			Renderer::Meshes::BuildMeshlets(meshlets, indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			uint32_t next = 0;
+			uint32_t meshletVertices = 0;
+			for (const Renderer::Meshes::Meshlet& meshlet : meshlets)
+			{
+				valid = valid && meshlet.m_firstIndex == next && meshlet.m_indexCount % 3 == 0
+					&& meshlet.m_indexCount / 3 <= MESHLET_MAX_TRIANGLES && meshlet.m_vertexCount <= MESHLET_MAX_VERTICES;
+				for (uint32_t i = meshlet.m_firstIndex; i < meshlet.m_firstIndex + meshlet.m_indexCount && valid; ++i)
+				{
+					const float* p = &vertices[indices[i]].x;
+					float distance = 0.0f;
+					for (int k = 0; k < 3; ++k)
+					{
+						valid = valid && p[k] >= meshlet.m_min[k] && p[k] <= meshlet.m_max[k];
+						distance += (p[k] - meshlet.m_center[k]) * (p[k] - meshlet.m_center[k]);
+					}
+					valid = valid && sqrtf(distance) <= meshlet.m_radius * 1.0001f + 1e-5f;
+				}
+				next = meshlet.m_firstIndex + meshlet.m_indexCount;
+				meshletVertices += meshlet.m_vertexCount;
+			}
+			valid = valid && next == indices.size();
+
+			// Overdraw // A triangle past the last vertex is skipped, not read.
+			Renderer::Meshes::MeshStatistics overdraw, outOfRange;
+			Renderer::Meshes::AnalyzeOverdraw(overdraw, indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			std::vector<uint32_t> extended = indices;
+			extended.insert(extended.end(), { 0, 1, (uint32_t)vertices.size() + 1000000 });
+			Renderer::Meshes::AnalyzeOverdraw(outOfRange, extended.data(), extended.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+			valid = valid && outOfRange.m_overdraw == overdraw.m_overdraw;
+
+			printf("grid %dx%d: %zu -> %zu vertices, max index %u, %u-bit indices (%zu KB, %zu KB at 32-bit), %zu meshlets, %.2f vertices per triangle, ACMR %.3f%s\n",
+				size, size, report.m_verticesBefore, report.m_verticesAfter, maxIndex, indexSize * 8, packed.size() / 1024, indices.size() * 4 / 1024,
+				meshlets.size(), (float)meshletVertices / (indices.size() / 3), report.m_after.m_acmr, valid ? "" : " FAILED");
+			passed = passed && valid;
+
+#ifdef TESTS_ENGINE
+			// Cooked // Written as an OBJ, cooked and read back with the same triangles, width and meshlets.
+			char objPath[] = "indextest.obj";
+			char cookedPath[] = "indextest" COOKED_MESH_EXTENSION;
+			if (FILE* f = fopen(objPath, "w"))
+			{
+				for (const Vertex& v : source)
+					fprintf(f, "v %.9g %.9g %.9g\n", v.x, v.y, v.z);
+				for (size_t i = 0; i < sourceIndices.size(); i += 3)
+					fprintf(f, "f %u %u %u\n", sourceIndices[i] + 1, sourceIndices[i + 1] + 1, sourceIndices[i + 2] + 1);
+				fclose(f);
+			}
+			bool cooked = Renderer::Meshes::CookMesh(objPath, cookedPath);
+			std::vector<uint8_t> file;
+			if (FILE* f = fopen(cookedPath, "rb"))
+			{
+				fseek(f, 0, SEEK_END);
+				file.resize(ftell(f));
+				fseek(f, 0, SEEK_SET);
+				cooked = cooked && fread(file.data(), 1, file.size(), f) == file.size();
+				fclose(f);
+			}
+			remove(objPath);
+			remove(cookedPath);
+			const Renderer::Meshes::CookedMeshHeader* header = cooked ? Renderer::Meshes::ReadCookedMesh(file.data(), file.size()) : nullptr;
+			cooked = header && header->m_submeshCount == 1;
+			if (cooked)
+			{
+				const Renderer::Meshes::CookedSubmesh& sub = *(const Renderer::Meshes::CookedSubmesh*)(file.data() + header->m_submeshOffset);
+				const uint8_t* indexData = file.data() + header->m_indexOffset + sub.m_indexOffset;
+				std::vector<uint32_t> cookedIndices(sub.m_indexCount);
+				for (uint32_t i = 0; i < sub.m_indexCount; ++i)
+					cookedIndices[i] = sub.m_indexSize == 2 ? ((const uint16_t*)indexData)[i] : ((const uint32_t*)indexData)[i];
+				const Vertex* cookedVertices = (const Vertex*)(file.data() + header->m_vertexOffset) + sub.m_firstVertex;
+				cooked = sub.m_indexSize == indexSize && sub.m_vertexCount == vertices.size() && (sub.m_meshletCount > 0) == MESH_MESHLETS
+					&& Renderer::Meshes::CompareTriangles(cookedVertices, cookedIndices.data(), cookedIndices.size(), vertices.data(), indices.data(), indices.size(), sizeof(Vertex));
+			}
+			printf("grid %dx%d cooked: %zu bytes%s\n", size, size, file.size(), cooked ? "" : " FAILED");
+			passed = passed && cooked;
+
+			// Corrupted // A foreign vertex stride, a material index past the table and a path filling its field are all rejected.
+			if (cooked)
+			{
+				bool rejected = true;
+				for (int corruption = 0; corruption < 3; ++corruption)
+				{
+					std::vector<uint8_t> corrupt = file;
+					const Renderer::Meshes::CookedMeshHeader& h = *(const Renderer::Meshes::CookedMeshHeader*)corrupt.data();
+					Renderer::Meshes::CookedSubmesh& sub = *(Renderer::Meshes::CookedSubmesh*)(corrupt.data() + h.m_submeshOffset);
+					if (corruption == 0)
+						sub.m_vertexStride += 4;
+					else if (corruption == 1)
+						sub.m_material = (int32_t)h.m_materialCount;
+					else if (h.m_materialCount > 0)
+						memset(corrupt.data() + h.m_materialOffset, 'a', Renderer::Meshes::CookedMeshPathLength);
+					else
+						continue;
+					rejected = rejected && Renderer::Meshes::ReadCookedMesh(corrupt.data(), corrupt.size()) == nullptr;
+				}
+				printf("grid %dx%d corrupted: %s\n", size, size, rejected ? "rejected" : "ACCEPTED");
+				passed = passed && rejected;
+			}
+#endif
+		}
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+	int LodTest(const char* args)
+	{
+		// Simplification of generated meshes to triangle targets and error limits, the measured deviation never above the
+		// reported error nor the reported error above the limit, then LOD selection along a camera path with and without hysteresis.
+		struct TestMesh
+		{
+			const char* m_name;
+			std::vector<Vertex> m_vertices;
+			std::vector<uint32_t> m_indices;
+		};
+		std::vector<TestMesh> meshes(3);
+		{
+			// Closed UV sphere, one vertex per position.
+			TestMesh& sphere = meshes[0];
+			sphere.m_name = "sphere";
+			const int rings = 48, segments = 96;
+			sphere.m_vertices.push_back({ 0.0f, 1.0f, 0.0f, 0.0f, 0.0f });
+			for (int r = 1; r < rings; ++r)
+			{
+				for (int s = 0; s < segments; ++s)
+				{
+					float theta = (float)M_PI * r / rings, phi = 2.0f * (float)M_PI * s / segments;
+					sphere.m_vertices.push_back({ sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi), 0.0f, 0.0f });
+				}
+			}
+			sphere.m_vertices.push_back({ 0.0f, -1.0f, 0.0f, 0.0f, 0.0f });
+			uint32_t bottom = (uint32_t)sphere.m_vertices.size() - 1;
+			auto ring = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + s % segments); };
+			for (int s = 0; s < segments; ++s)
+				sphere.m_indices.insert(sphere.m_indices.end(), { 0, ring(1, s + 1), ring(1, s) });
+			for (int r = 1; r < rings - 1; ++r)
+			{
+				for (int s = 0; s < segments; ++s)
+					sphere.m_indices.insert(sphere.m_indices.end(), { ring(r, s), ring(r, s + 1), ring(r + 1, s), ring(r, s + 1), ring(r + 1, s + 1), ring(r + 1, s) });
+			}
+			for (int s = 0; s < segments; ++s)
+				sphere.m_indices.insert(sphere.m_indices.end(), { ring(rings - 1, s), ring(rings - 1, s + 1), bottom });
+		}
+		for (int g = 0; g < 2; ++g)
+		{
+			// Open grids, flat and rolling.
+			TestMesh& grid = meshes[1 + g];
+			grid.m_name = g == 0 ? "flat grid" : "wavy grid";
+			const int size = 100;
+			for (int y = 0; y <= size; ++y)
+			{
+				for (int x = 0; x <= size; ++x)
+					grid.m_vertices.push_back({ (float)x, (float)y, g == 0 ? 0.0f : 2.0f * sinf(x * 0.3f) * cosf(y * 0.2f), 0.0f, 0.0f });
+			}
+			for (int y = 0; y < size; ++y)
+			{
+				for (int x = 0; x < size; ++x)
+				{
+					uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+					grid.m_indices.insert(grid.m_indices.end(), { a, c, b, b, c, d });
+				}
+			}
+		}
+
+		bool passed = true;
+		const size_t stride = sizeof(Vertex);
+		for (TestMesh& mesh : meshes)
+		{
+			// Triangle Targets // Met within 10%, with no source vertex further from the surface than the reported error.
+			const float ratios[] = { 0.5f, 0.25f, 0.1f };
+			for (float ratio : ratios)
+			{
+				size_t target = (size_t)(mesh.m_indices.size() / 3 * ratio) * 3;
+				std::vector<uint32_t> simplified(mesh.m_indices.size());
+				float error = 0.0f;
+				size_t count = Renderer::Meshes::SimplifyMesh(simplified.data(), mesh.m_indices.data(), mesh.m_indices.size(), mesh.m_vertices.data(), mesh.m_vertices.size(), stride, target, FLT_MAX, &error);
+				float measured = Renderer::Meshes::MeasureSimplifyError(mesh.m_indices.data(), mesh.m_indices.size(), simplified.data(), count, mesh.m_vertices.data(), stride);
+				bool valid = count <= target && count >= target - target / 10 && measured <= error;
+				for (size_t i = 0; i < count; ++i)
+					valid = valid && simplified[i] < mesh.m_vertices.size();
+				printf("%s %.0f%%: %zu -> %zu triangles (target %zu), error %.5f, measured %.5f%s\n", mesh.m_name, ratio * 100.0f,
+					mesh.m_indices.size() / 3, count / 3, target / 3, error, measured, valid ? "" : " FAILED");
+				passed = passed && valid;
+			}
+			// Error Limits // Never exceeded, reported or measured, tighter limits keep more triangles.
+			const float limits[] = { 0.001f, 0.01f, 0.05f };
+			size_t previous = SIZE_MAX;
+			for (float limit : limits)
+			{
+				std::vector<uint32_t> simplified(mesh.m_indices.size());
+				float error = 0.0f;
+				size_t count = Renderer::Meshes::SimplifyMesh(simplified.data(), mesh.m_indices.data(), mesh.m_indices.size(), mesh.m_vertices.data(), mesh.m_vertices.size(), stride, 0, limit, &error);
+				float measured = Renderer::Meshes::MeasureSimplifyError(mesh.m_indices.data(), mesh.m_indices.size(), simplified.data(), count, mesh.m_vertices.data(), stride);
+				bool valid = error <= limit && measured <= error && count <= previous && count < mesh.m_indices.size();
+				printf("%s error %.3f: %zu triangles, error %.5f, measured %.5f%s\n", mesh.m_name, limit, count / 3, error, measured, valid ? "" : " FAILED");
+				previous = count;
+				passed = passed && valid;
+			}
+			// Levels // Appended in order, each smaller and no more accurate than the one before.
+			std::vector<Renderer::Meshes::MeshLod> lods;
+			std::vector<uint32_t> indices = mesh.m_indices;
+			Renderer::Meshes::GenerateLods(lods, indices, mesh.m_vertices.data(), mesh.m_vertices.size(), stride);
+			bool valid = !lods.empty();
+			uint32_t next = (uint32_t)mesh.m_indices.size();
+			for (size_t l = 0; l < lods.size(); ++l)
+			{
+				valid = valid && lods[l].m_firstIndex == next && lods[l].m_indexCount < (l ? lods[l - 1].m_indexCount : mesh.m_indices.size())
+					&& lods[l].m_error >= (l ? lods[l - 1].m_error : 0.0f);
+				next = lods[l].m_firstIndex + lods[l].m_indexCount;
+				printf("%s level %zu: %u triangles, error %.5f\n", mesh.m_name, l + 1, lods[l].m_indexCount / 3, lods[l].m_error);
+			}
+			valid = valid && next == indices.size();
+			passed = passed && valid;
+			if (!valid)
+				printf("%s levels FAILED\n", mesh.m_name);
+		}
+
+		// Selection // A camera backing away then returning, 1 pixel allowed. Levels only coarsen going out, only refine coming back,
+		// and jitter around a switch distance flips the level every frame without hysteresis but never with it.
+		{
+			const float errors[] = { 0.0f, 0.005f, 0.01f, 0.02f };
+			Math::Matrix4F projection(1.0f);
+			projection.Perspective((float)WINDOW_WIDTH / WINDOW_HEIGHT, Math::DegreesToRadians(75.0f), 0.01f, 1000.0f);
+			auto pixelsPerUnit = [&](float distance)
+			{
+				Math::Matrix4F model(1.0f);
+				model.SetTranslation(0.0f, 0.0f, -distance);
+				return Renderer::Meshes::ProjectedPixelsPerUnit(model * Math::Matrix4F(1.0f) * projection, Math::Vector3F(0.0f, 0.0f, 0.0f), WINDOW_WIDTH, WINDOW_HEIGHT);
+			};
+			bool valid = true;
+			int lod = 0, switches = 0;
+			for (int step = 0; step <= 400; ++step)
+			{
+				float distance = 0.5f + (step <= 200 ? step : 400 - step) * 0.1f;
+				int selected = Renderer::Meshes::SelectLod(errors, 4, pixelsPerUnit(distance), lod);
+				valid = valid && (step <= 200 ? selected >= lod : selected <= lod);
+				switches += selected != lod;
+				lod = selected;
+			}
+			valid = valid && switches == 6 && lod == 0;
+			float threshold = 0.0f;
+			for (float distance = 0.5f; distance < 50.0f && threshold == 0.0f; distance += 0.01f)
+			{
+				if (Renderer::Meshes::SelectLod(errors, 4, pixelsPerUnit(distance), 0, LOD_PIXEL_ERROR, 0.0f) > 0)
+					threshold = distance;
+			}
+			int flips[2] = { };
+			for (int h = 0; h < 2; ++h)
+			{
+				lod = 0;
+				for (int frame = 0; frame < 100; ++frame)
+				{
+					float distance = threshold * (frame % 2 ? 1.02f : 0.98f);
+					int selected = Renderer::Meshes::SelectLod(errors, 4, pixelsPerUnit(distance), lod, LOD_PIXEL_ERROR, h ? LOD_HYSTERESIS : 0.0f);
+					flips[h] += selected != lod;
+					lod = selected;
+				}
+			}
+			valid = valid && flips[0] > 90 && flips[1] == 0;
+			printf("selection: %d switches out and back, first switch at %.2f units, %d flips without hysteresis, %d with%s\n",
+				switches, threshold, flips[0], flips[1], valid ? "" : " FAILED");
+			passed = passed && valid;
+		}
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,426 @@
+#include "Tests.h"
+#include "RHIRecording.h"
+#include "Math.h"
+#ifdef TESTS_ENGINE
+#include "Renderer.h"
+#include "Camera.h"
+#include "Meshes.h"
+#include "TextureCache.h"
+#include "ShaderLibrary.h"
+#include "Jobs.h"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+namespace Tests
+{
+	int RHITest(const char* args)
+	{
+		// The recording device on its own: handle lifetimes, deferred releases, state tracking and draw validation, each case
+		// expecting an exact number of errors. Then headless frames of a model through the null backend, which must stay clean.
+		Renderer::RHI::RecordingDevice device;
+		bool passed = true;
+		uint64_t errors = 0;
+		auto expect = [&](const char* name, uint64_t expected, bool condition)
+		{
+			uint64_t found = device.GetRecordingStats().m_errors - errors;
+			errors = device.GetRecordingStats().m_errors;
+			bool ok = condition && found == expected;
+			printf("%s: %llu errors, expected %llu%s%s%s\n", name, (unsigned long long)found, (unsigned long long)expected, condition ? "" : ", CHECK FAILED",
+				(found > 0 && !device.GetErrors().empty()) ? ", last: " : "", (found > 0 && !device.GetErrors().empty()) ? device.GetErrors().back().c_str() : "");
+			passed = passed && ok;
+		};
+
+		// Handles // A destroyed slot is reused with a new generation, the old handle stays stale.
+		Renderer::RHI::BufferDesc vertexDesc;
+		vertexDesc.m_size = 64 * sizeof(float) * 5;
+		vertexDesc.m_usage = Renderer::RHI::BUFFER_VERTEX;
+		vertexDesc.m_name = "Vertices";
+		std::vector<float> vertexData(64 * 5, 0.0f);
+		Renderer::RHI::BufferHandle first = device.CreateBuffer(vertexDesc, vertexData.data());
+		device.Destroy(first);
+		device.EndFrame();
+		Renderer::RHI::BufferHandle second = device.CreateBuffer(vertexDesc, vertexData.data());
+		expect("Handle reuse", 0, second.m_index == first.m_index && second.m_generation != first.m_generation
+			&& device.GetState(first) == Renderer::RHI::STATE_UNDEFINED && device.GetState(second) == Renderer::RHI::STATE_VERTEX_BUFFER);
+		device.Destroy(first);
+		device.EndFrame();
+		expect("Stale destroy", 1, device.GetState(second) == Renderer::RHI::STATE_VERTEX_BUFFER);
+
+		// Deferred Release // Kept until every frame that could use it has completed.
+		device.SetLatency(2);
+		device.Destroy(second);
+		device.EndFrame();
+		bool kept = device.GetState(second) != Renderer::RHI::STATE_UNDEFINED && device.GetStats().m_pendingReleases == 1;
+		device.EndFrame();
+		kept = kept && device.GetState(second) != Renderer::RHI::STATE_UNDEFINED;
+		device.EndFrame();
+		device.EndFrame();
+		expect("Deferred release", 0, kept && device.GetState(second) == Renderer::RHI::STATE_UNDEFINED && device.GetStats().m_pendingReleases == 0);
+		device.SetLatency(0);
+
+		// Resources for the draws below.
+		Renderer::RHI::BufferHandle vertices = device.CreateBuffer(vertexDesc, vertexData.data());
+		const uint16_t indexData[6] = { 0, 1, 2, 0, 2, 3 };
+		Renderer::RHI::BufferDesc indexDesc;
+		indexDesc.m_size = sizeof(indexData);
+		indexDesc.m_usage = Renderer::RHI::BUFFER_INDEX;
+		indexDesc.m_name = "Indices";
+		Renderer::RHI::BufferHandle indices = device.CreateBuffer(indexDesc, indexData);
+		Renderer::RHI::BufferDesc constantDesc;
+		constantDesc.m_size = 1024;
+		constantDesc.m_usage = Renderer::RHI::BUFFER_CONSTANT;
+		constantDesc.m_dynamic = true;
+		constantDesc.m_name = "Constants";
+		Renderer::RHI::BufferHandle constants = device.CreateBuffer(constantDesc);
+		Renderer::RHI::BufferDesc instanceDesc;
+		instanceDesc.m_size = 4 * sizeof(Math::Matrix4F);
+		instanceDesc.m_usage = Renderer::RHI::BUFFER_VERTEX;
+		instanceDesc.m_dynamic = true;
+		instanceDesc.m_name = "Instances";
+		Renderer::RHI::BufferHandle instances = device.CreateBuffer(instanceDesc);
+		const Renderer::RHI::VertexElement elements[] =
+		{
+			{ "POSITION", 0, Renderer::RHI::FORMAT_RGB32_FLOAT, 0, 0, false },
+			{ "TEXCOORD", 0, Renderer::RHI::FORMAT_RG32_FLOAT, 0, Renderer::RHI::AppendElement, false },
+			{ "INSTANCE", 0, Renderer::RHI::FORMAT_RGBA32_FLOAT, 1, 0, true },
+			{ "INSTANCE", 1, Renderer::RHI::FORMAT_RGBA32_FLOAT, 1, Renderer::RHI::AppendElement, true },
+			{ "INSTANCE", 2, Renderer::RHI::FORMAT_RGBA32_FLOAT, 1, Renderer::RHI::AppendElement, true },
+			{ "INSTANCE", 3, Renderer::RHI::FORMAT_RGBA32_FLOAT, 1, Renderer::RHI::AppendElement, true },
+		};
+		Renderer::RHI::PipelineDesc pipelineDesc;
+		pipelineDesc.m_elements = elements;
+		pipelineDesc.m_elementCount = 2;
+		Renderer::RHI::PipelineHandle pipeline = device.CreatePipeline(pipelineDesc);
+		pipelineDesc.m_elementCount = 6;
+		Renderer::RHI::PipelineHandle instancedPipeline = device.CreatePipeline(pipelineDesc);
+		Renderer::RHI::TextureDesc textureDesc;
+		textureDesc.m_width = 4;
+		textureDesc.m_height = 4;
+		textureDesc.m_name = "Texture";
+		Renderer::RHI::TextureHandle texture = device.CreateTexture(textureDesc);
+		expect("Create", 0, vertices.IsValid() && indices.IsValid() && constants.IsValid() && instances.IsValid() && pipeline.IsValid() && instancedPipeline.IsValid() && texture.IsValid());
+
+		Renderer::RHI::CommandList commands;
+		auto bind = [&](Renderer::RHI::PipelineHandle p)
+		{
+			commands.Reset();
+			commands.SetPipeline(p);
+			commands.SetVertexBuffer(0, vertices, sizeof(float) * 5);
+			commands.SetIndexBuffer(indices, Renderer::RHI::FORMAT_R16_UINT);
+			commands.SetConstantBuffer(0, constants, 256, 64);
+		};
+
+		// Draws
+		bind(pipeline);
+		commands.DrawIndexed(6, 0);
+		device.Submit(commands);
+		expect("Draw", 0, device.GetRecordingStats().m_draws == 1);
+		bind(pipeline);
+		commands.DrawIndexed(9, 0);
+		device.Submit(commands);
+		expect("Index range", 1, true);
+		commands.Reset();
+		commands.SetVertexBuffer(0, vertices, sizeof(float) * 5);
+		commands.SetIndexBuffer(indices, Renderer::RHI::FORMAT_R16_UINT);
+		commands.DrawIndexed(6, 0);
+		device.Submit(commands);
+		expect("No pipeline", 1, true);
+		bind(pipeline);
+		commands.SetConstantBuffer(0, constants, 16, 64);
+		device.Submit(commands);
+		expect("Constant alignment", 1, true);
+		bind(instancedPipeline);
+		commands.DrawIndexedInstanced(6, 2, 0, 0, 0);
+		device.Submit(commands);
+		expect("Instance slot unbound", 1, true);
+		bind(instancedPipeline);
+		commands.SetVertexBuffer(1, instances, sizeof(Math::Matrix4F));
+		commands.DrawIndexedInstanced(6, 2, 0, 0, 3);
+		device.Submit(commands);
+		expect("Instance range", 1, true);
+
+		// States // Textures created empty are copy destinations until a barrier moves them.
+		bind(pipeline);
+		commands.SetTexture(0, texture);
+		commands.DrawIndexed(6, 0);
+		device.Submit(commands);
+		expect("Texture state", 1, device.GetState(texture) == Renderer::RHI::STATE_COPY_DEST);
+		bind(pipeline);
+		commands.Barrier(texture, Renderer::RHI::STATE_COPY_DEST, Renderer::RHI::STATE_SHADER_RESOURCE);
+		commands.SetTexture(0, texture);
+		commands.DrawIndexed(6, 0);
+		device.Submit(commands);
+		expect("Texture barrier", 0, device.GetState(texture) == Renderer::RHI::STATE_SHADER_RESOURCE);
+		commands.Reset();
+		commands.Barrier(texture, Renderer::RHI::STATE_COPY_DEST, Renderer::RHI::STATE_SHADER_RESOURCE);
+		device.Submit(commands);
+		expect("Barrier mismatch", 1, true);
+
+		// Updates // Static buffers take copies in copy dest only, dynamic ones read back what was written.
+		Renderer::RHI::BufferDesc staticDesc = vertexDesc;
+		staticDesc.m_name = "Static";
+		Renderer::RHI::BufferHandle staticBuffer = device.CreateBuffer(staticDesc);
+		commands.Reset();
+		commands.UpdateBuffer(staticBuffer, 0, vertexData.data(), 64);
+		commands.Barrier(staticBuffer, Renderer::RHI::STATE_COPY_DEST, Renderer::RHI::STATE_VERTEX_BUFFER);
+		commands.UpdateBuffer(staticBuffer, 0, vertexData.data(), 64);
+		device.Submit(commands);
+		expect("Copy state", 1, device.GetState(staticBuffer) == Renderer::RHI::STATE_VERTEX_BUFFER);
+		Math::Matrix4F transforms[2] = { Math::Matrix4F(1.0f), Math::Matrix4F(2.0f) };
+		commands.Reset();
+		commands.UpdateBuffer(instances, sizeof(Math::Matrix4F) * 2, transforms, sizeof(transforms));
+		commands.UpdateBuffer(instances, sizeof(Math::Matrix4F) * 3, transforms, sizeof(transforms));
+		device.Submit(commands);
+		const uint8_t* contents = device.GetContents(instances);
+		expect("Update contents", 1, contents && memcmp(contents + sizeof(Math::Matrix4F) * 2, transforms, sizeof(transforms)) == 0);
+		device.Map(constants, Renderer::RHI::MAP_WRITE_NO_OVERWRITE);
+		device.Unmap(constants);
+		expect("No-overwrite before discard", 1, true);
+		device.Map(constants, (Renderer::RHI::MapMode)7);
+		expect("Map mode", 1, true);
+		float* mapped = (float*)device.Map(constants, Renderer::RHI::MAP_WRITE_DISCARD);
+		if (mapped)
+			mapped[0] = 42.0f;
+		bind(pipeline);
+		commands.DrawIndexed(6, 0);
+		device.Submit(commands);
+		device.Unmap(constants);
+		expect("Mapped draw", 1, mapped && ((const float*)device.GetContents(constants))[0] == 42.0f);
+		mapped = (float*)device.Map(constants, Renderer::RHI::MAP_WRITE_NO_OVERWRITE);
+		if (mapped)
+			mapped[16] = 7.0f;
+		device.Unmap(constants);
+		expect("No-overwrite after discard", 0, mapped && ((const float*)device.GetContents(constants))[0] == 42.0f);
+
+		Renderer::RHI::BufferHandle all[] = { vertices, indices, constants, instances, staticBuffer };
+		for (Renderer::RHI::BufferHandle b : all)
+			device.Destroy(b);
+		device.Destroy(pipeline);
+		device.Destroy(instancedPipeline);
+		device.Destroy(texture);
+		device.WaitIdle();
+		const Renderer::RHI::DeviceStats& stats = device.GetStats();
+		expect("Shutdown", 0, stats.m_buffers == 0 && stats.m_textures == 0 && stats.m_pipelines == 0 && stats.m_pendingReleases == 0);
+
+#ifdef TESTS_ENGINE
+		// Null Backend // Every mesh, texture and draw of a few frames through the recording device.
+		{
+			JobSystem.Create();
+			Renderer::Renderer renderer;
+			renderer.CreateNull();
+			Textures.Create(renderer);
+			Shaders.Create(renderer);
+			Renderer::Meshes::MeshRenderer meshRenderer;
+			meshRenderer.Create(renderer);
+			meshRenderer.LoadModel("./res/models/cube.blend");
+			Renderer::Camera camera;
+			camera.CreatePerspective((float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, 60.0f, 0.1f, 100.0f);
+			Math::Matrix4F model(1.0f), view(1.0f);
+			view.m23 = -5.0f;
+			camera.Draw(view);
+			for (int f = 0; f < 8; ++f)
+			{
+				renderer.BeginFrame();
+				meshRenderer.Draw(model, camera);
+				renderer.EndFrame();
+			}
+			Renderer::RHI::RecordingDevice* recording = renderer.GetRecordingDevice();
+
+			// Constant Ring // Only non-instanced draws write to it and the models above are instanced, so it is driven directly.
+			// Blocks come back aligned and apart within a frame, and hold what was written once the frame is submitted.
+			bool ring = true;
+			for (int f = 0; f < CONSTANT_RING_FRAMES * 3; ++f)
+			{
+				renderer.BeginFrame();
+				UINT offsets[64];
+				for (int i = 0; i < 64; ++i)
+				{
+					float* constants = (float*)renderer.AllocateConstants(sizeof(Math::Matrix4F), offsets[i]);
+					ring = ring && constants && offsets[i] % Renderer::RHI::ConstantAlignment == 0 && (i == 0 || offsets[i] > offsets[i - 1]);
+					if (constants)
+						constants[0] = (float)(f * 64 + i);
+				}
+				renderer.EndFrame();
+				const float* contents = (const float*)recording->GetContents(renderer.GetConstantRing());
+				for (int i = 0; i < 64 && ring; ++i)
+					ring = contents && contents[offsets[i] / sizeof(float)] == (float)(f * 64 + i);
+			}
+			printf("Constant ring: %s, %u wraps\n", ring ? "ok" : "FAILED", renderer.GetConstantAllocator().GetWraps());
+			passed = passed && ring;
+
+			bool clean = recording->GetRecordingStats().m_draws > 0 && recording->GetRecordingStats().m_errors == 0;
+			printf("Null backend: %llu draws, %llu errors%s%s\n", (unsigned long long)recording->GetRecordingStats().m_draws, (unsigned long long)recording->GetRecordingStats().m_errors,
+				recording->GetErrors().empty() ? "" : ", first: ", recording->GetErrors().empty() ? "" : recording->GetErrors()[0].c_str());
+			passed = passed && clean;
+			meshRenderer.Destroy();
+			Shaders.Destroy();
+			Textures.Destroy();
+			renderer.Destroy();
+			JobSystem.Destroy();
+		}
+#endif
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+#ifdef TESTS_ENGINE
+	int RecordBench(const char* args)
+	{
+		// Distinct draws through the null backend, the render queue recorded at several thread counts. Items go straight into the
+		// queue, none instanced, each with constants of its own and one of many meshes, so every draw binds and records on its own.
+		// Per phase timings per frame, and the submitted commands hashed, they must not change with the thread count nor fail validation.
+		int draws = 12000;
+		sscanf(args, "%d", &draws);
+		JobSystem.Create();
+		Renderer::Renderer renderer;
+		renderer.CreateNull();
+		Textures.Create(renderer);
+		Shaders.Create(renderer);
+
+		// Meshes // Grids of a few sizes, built here so no importer is needed. The null backend compiles no shaders.
+		const int meshCount = 64;
+		std::vector<Renderer::Meshes::Mesh> meshes(meshCount);
+		Renderer::Meshes::ShaderBlobs blobs;
+		for (int m = 0; m < meshCount; ++m)
+		{
+			Renderer::Meshes::Mesh& mesh = meshes[m];
+			int size = 1 + m % 8;
+			for (int y = 0; y <= size; ++y)
+				for (int x = 0; x <= size; ++x)
+					mesh.m_vertices.push_back({ { { (float)x, (float)y, 0.0f } }, { { (float)x / size, (float)y / size } } });
+			for (int y = 0; y < size; ++y)
+			{
+				for (int x = 0; x < size; ++x)
+				{
+					uint32_t corner = y * (size + 1) + x;
+					mesh.m_indices.insert(mesh.m_indices.end(), { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 });
+				}
+			}
+			mesh.m_vertexCount = (UINT)mesh.m_vertices.size();
+			mesh.m_indexCount = (UINT)mesh.m_indices.size();
+			mesh.m_indexSize = Renderer::Meshes::SelectIndexSize(mesh.m_vertices.size());
+			mesh.m_stride = sizeof(Renderer::Meshes::TexVertex3D);
+			mesh.m_offset = 0;
+			mesh.m_mesh = nullptr;
+			mesh.Setup(renderer, blobs);
+		}
+		srand(7);
+		std::vector<Math::Matrix4F> transforms(draws, Math::Matrix4F(1.0f));
+		std::vector<int> meshOf(draws);
+		std::vector<float> depths(draws);
+		for (int i = 0; i < draws; ++i)
+		{
+			transforms[i].m03 = (float)(rand() % 200 - 100);
+			transforms[i].m13 = (float)(rand() % 200 - 100);
+			meshOf[i] = rand() % meshCount;
+			depths[i] = (float)(rand() % 1000); // Keys interleave the meshes, most draws bind one.
+		}
+		std::vector<int> threads = { 1 };
+		for (int t = 2; t < JobSystem.GetWorkerCount(); t *= 2)
+			threads.push_back(t);
+		if (JobSystem.GetWorkerCount() > 1)
+			threads.push_back(JobSystem.GetWorkerCount());
+
+		// FNV-1a over every command and the payload bytes of updates. The ring moves on between runs, so constant binds in it
+		// are hashed by the constants they point at rather than their offset.
+		Renderer::RHI::RecordingDevice* recording = renderer.GetRecordingDevice();
+		auto hashLists = [&renderer, recording]()
+		{
+			uint64_t hash = 14695981039346656037ull;
+			auto add = [&hash](const void* data, size_t size)
+			{
+				for (size_t i = 0; i < size; ++i)
+					hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+			};
+			Renderer::RenderQueue& queue = renderer.GetRenderQueue();
+			const uint8_t* ring = recording->GetContents(renderer.GetConstantRing());
+			for (size_t l = 0; l < queue.GetCommandListCount(); ++l)
+			{
+				const Renderer::RHI::CommandList& list = queue.GetCommandList(l);
+				for (const Renderer::RHI::Command& command : list.GetCommands())
+				{
+					Renderer::RHI::Command hashed = command;
+					if (command.m_type == Renderer::RHI::COMMAND_SET_CONSTANT_BUFFER && command.GetHandle<Renderer::RHI::BufferHandle>() == renderer.GetConstantRing() && ring)
+					{
+						add(ring + command.m_args[0], command.m_args[1]);
+						hashed.m_args[0] = 0;
+					}
+					add(&hashed, sizeof(hashed));
+					if (command.m_type == Renderer::RHI::COMMAND_UPDATE_BUFFER)
+						add(list.GetPayload(command.m_args[2]), command.m_args[1]);
+				}
+			}
+			return hash;
+		};
+
+		bool passed = true;
+		uint64_t reference = 0;
+		const int frames = 10;
+		typedef std::chrono::high_resolution_clock Clock;
+		for (int t : threads)
+		{
+			renderer.GetRenderQueue().SetRecordThreadCount(t);
+			double total = 0.0, recordMs = 0.0, submitMs = 0.0;
+			uint64_t errors = recording->GetRecordingStats().m_errors;
+			bool allocated = true;
+			for (int f = -1; f < frames; ++f)
+			{
+				// First frame grows the lists, untimed.
+				renderer.BeginFrame();
+				for (int i = 0; i < draws; ++i)
+				{
+					const Renderer::Meshes::Mesh& mesh = meshes[meshOf[i]];
+					UINT offset = 0;
+					Math::Matrix4F* constants = (Math::Matrix4F*)renderer.AllocateConstants(sizeof(Math::Matrix4F), offset);
+					allocated = allocated && constants;
+					if (!constants)
+						break;
+					*constants = transforms[i];
+					Renderer::DrawItem item;
+					item.m_mesh = &meshes[meshOf[i]];
+					item.m_shader = &meshes[meshOf[i]].m_shader;
+					item.m_texture = nullptr;
+					item.m_constantBuffer = renderer.GetConstantRing();
+					item.m_constantOffset = offset;
+					item.m_constantSize = sizeof(Math::Matrix4F);
+					item.m_modelViewProj = transforms[i];
+					item.m_indexCount = mesh.m_indexCount;
+					renderer.GetRenderQueue().Submit(Renderer::SortKey::Make(Renderer::PASS_OPAQUE, mesh.m_shader.m_id, 0, depths[i]), item);
+				}
+				Clock::time_point start = Clock::now();
+				renderer.EndFrame();
+				if (f < 0)
+					continue;
+				total += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+				recordMs += renderer.GetRenderQueue().GetStats().m_recordMs;
+				submitMs += renderer.GetRenderQueue().GetStats().m_submitMs;
+			}
+			uint64_t hash = hashLists();
+			if (t == threads[0])
+				reference = hash;
+			errors = recording->GetRecordingStats().m_errors - errors;
+			const Renderer::RenderQueueStats& stats = renderer.GetRenderQueue().GetStats();
+			bool ok = allocated && hash == reference && errors == 0 && stats.m_draws == (unsigned int)draws && stats.m_instancedDraws == 0;
+			printf("%d threads: %.3f ms/frame end (record %.3f, submit %.3f, %.3f us per draw), %u command lists, %u draws, %u mesh binds, %llu errors, hash %016llx%s\n",
+				t, total / frames, recordMs / frames, submitMs / frames, recordMs * 1000.0 / frames / draws, stats.m_commandLists, stats.m_draws, stats.m_meshBinds,
+				(unsigned long long)errors, (unsigned long long)hash, ok ? "" : " FAILED");
+			passed = passed && ok;
+		}
+		for (Renderer::Meshes::Mesh& mesh : meshes)
+			mesh.Destroy(renderer);
+		Shaders.Destroy();
+		Textures.Destroy();
+		renderer.Destroy();
+		JobSystem.Destroy();
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+#endif
+}
@@ -0,0 +1,349 @@
+#include "Tests.h"
+#include "SoftwareRasterizer.h"
+#include "Jobs.h"
+#include "Math.h"
+#ifdef TESTS_ENGINE
+#include "Renderer.h"
+#include "Camera.h"
+#include "Meshes.h"
+#include "TextureCache.h"
+#include "ShaderLibrary.h"
+#include "Profiler.h"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Tests
+{
+	int RasterTest(const char* args)
+	{
+		// Software rasterizer scenes checked against what they must look like, then against the golden images in the directory.
+		// A missing golden fails, -update writes them from this run.
+		char directory[260] = "./res/tests/raster";
+		if (args[0] == ' ' && args[1] != '-')
+			sscanf(args + 1, "%259s", directory);
+		bool update = strstr(args, "-update") != nullptr;
+		JobSystem.Create(std::max((int)std::thread::hardware_concurrency(), 4));
+		struct Vertex { float x, y, z, u, v; };
+		const int width = 160, height = 120;
+		Renderer::SoftwareRasterizer rasterizer;
+		rasterizer.Create(width, height);
+		const float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		Math::Matrix4F projection;
+		projection.Perspective((float)width / height, Math::DegreesToRadians(60.0f), 0.1f, 100.0f);
+		auto channel = [](uint32_t pixel, int c) { return (int)((pixel >> (c * 8)) & 0xff); };
+		auto solid = [](uint32_t color)
+		{
+			Renderer::SoftwareTexture texture;
+			texture.m_levels.push_back({ 1, 1, { color } });
+			return texture;
+		};
+		auto quad = [](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const Vertex* corners)
+		{
+			// Corners counter-clockwise seen from the front.
+			uint32_t first = (uint32_t)vertices.size();
+			vertices.insert(vertices.end(), corners, corners + 4);
+			for (uint32_t i : { 0, 1, 2, 0, 2, 3 })
+				indices.push_back(first + i);
+		};
+		bool passed = true;
+
+		// Depth // A tilted red quad through a flat green one, in both orders. Left of the crossing is green, right is red.
+		Renderer::SoftwareTexture red = solid(0xff0000ff), green = solid(0xff00ff00);
+		std::vector<Vertex> tilted, flat;
+		std::vector<uint32_t> tiltedIndices, flatIndices;
+		const Vertex tiltedCorners[4] = { { -1, -1, -4, 0, 0 }, { 1, -1, -2, 1, 0 }, { 1, 1, -2, 1, 1 }, { -1, 1, -4, 0, 1 } };
+		const Vertex flatCorners[4] = { { -1, -1, -3, 0, 0 }, { 1, -1, -3, 1, 0 }, { 1, 1, -3, 1, 1 }, { -1, 1, -3, 0, 1 } };
+		quad(tilted, tiltedIndices, tiltedCorners);
+		quad(flat, flatIndices, flatCorners);
+		std::vector<uint32_t> depthImage[2];
+		for (int order = 0; order < 2; ++order)
+		{
+			rasterizer.Clear(black);
+			for (int i = 0; i < 2; ++i)
+			{
+				if ((i == 0) == (order == 0))
+					rasterizer.DrawIndexed(projection, tilted.data(), 4, sizeof(Vertex), tiltedIndices.data(), 6, &red);
+				else
+					rasterizer.DrawIndexed(projection, flat.data(), 4, sizeof(Vertex), flatIndices.data(), 6, &green);
+			}
+			rasterizer.Flush();
+			depthImage[order].assign(rasterizer.GetColor(), rasterizer.GetColor() + (size_t)rasterizer.GetPitch() * height);
+		}
+		bool depthOrder = depthImage[0] == depthImage[1];
+		bool depthSides = rasterizer.GetPixel(width / 2 - 12, height / 2) == 0xff00ff00 && rasterizer.GetPixel(width / 2 + 12, height / 2) == 0xff0000ff;
+		printf("Depth: order independent %s, sides %s, %u blocks rejected\n", depthOrder ? "yes" : "NO", depthSides ? "correct" : "WRONG", rasterizer.GetStats().m_blocksRejected);
+		passed = passed && depthOrder && depthSides;
+
+		// Perspective // A checkered floor running behind the camera, so the near plane clips it. Every pixel well inside
+		// a square must show the colour the view ray hits, which affine interpolation would get wrong.
+		Renderer::SoftwareTexture checker;
+		checker.m_levels.push_back({ 16, 16, std::vector<uint32_t>(256) });
+		for (int i = 0; i < 256; ++i)
+			checker.m_levels[0].m_texels[i] = (((i % 16) / 8) ^ ((i / 16) / 8)) ? 0xffffffff : 0xff000000;
+		std::vector<Vertex> floor;
+		std::vector<uint32_t> floorIndices;
+		const Vertex floorCorners[4] = { { -20, -1, 5, -10, 2.5f }, { 20, -1, 5, 10, 2.5f }, { 20, -1, -60, 10, -30 }, { -20, -1, -60, -10, -30 } };
+		quad(floor, floorIndices, floorCorners);
+		rasterizer.Clear(black);
+		rasterizer.DrawIndexed(projection, floor.data(), 4, sizeof(Vertex), floorIndices.data(), 6, &checker);
+		rasterizer.Flush();
+		Renderer::RasterStats floorStats = rasterizer.GetStats();
+		std::vector<uint32_t> floorImage(rasterizer.GetColor(), rasterizer.GetColor() + (size_t)rasterizer.GetPitch() * height);
+		Math::Matrix4F inverse = Math::Inverse(projection);
+		auto unproject = [&](float x, float y, float z)
+		{
+			float clip[4] = { x, y, z, 1.0f }, p[4];
+			for (int i = 0; i < 4; ++i)
+				p[i] = inverse.m[i][0] * clip[0] + inverse.m[i][1] * clip[1] + inverse.m[i][2] * clip[2] + inverse.m[i][3] * clip[3];
+			return Math::Vector3F(p[0] / p[3], p[1] / p[3], p[2] / p[3]);
+		};
+		auto floorUv = [&](float x, float y, float& u, float& v)
+		{
+			float nx = x / width * 2.0f - 1.0f, ny = 1.0f - y / height * 2.0f;
+			Math::Vector3F a = unproject(nx, ny, 0.0f), b = unproject(nx, ny, 1.0f);
+			float t = (-1.0f - a.y) / (b.y - a.y);
+			u = (a.x + (b.x - a.x) * t) * 0.5f;
+			v = (a.z + (b.z - a.z) * t) * 0.5f;
+		};
+		int checked = 0, mismatches = 0;
+		for (int y = height / 2 + 2; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				// Only where a pixel spans less than a texel, further away subpixel snapping alone moves the sample across squares.
+				float u, v, nextU, nextV;
+				floorUv(x + 0.5f, y + 0.5f, u, v);
+				floorUv(x + 1.5f, y + 1.5f, nextU, nextV);
+				if (fabsf(nextU - u) * 16.0f > 1.0f || fabsf(nextV - v) * 16.0f > 1.0f)
+					continue;
+				// Texels from the nearest square edge, bilinear taps blend within one.
+				float tu = (u - floorf(u)) * 16.0f, tv = (v - floorf(v)) * 16.0f;
+				if (fabsf(tu - 8.0f) < 1.5f || fabsf(tv - 8.0f) < 1.5f || tu < 1.5f || tu > 14.5f || tv < 1.5f || tv > 14.5f)
+					continue;
+				uint32_t expected = checker.m_levels[0].m_texels[(int)tv * 16 + (int)tu];
+				checked++;
+				mismatches += (rasterizer.GetPixel(x, y) != expected) ? 1 : 0;
+			}
+		}
+		bool perspective = checked > width * height / 16 && mismatches <= checked / 200 && floorStats.m_trianglesClipped > 0;
+		printf("Perspective: %d pixels checked, %d mismatches, %u triangles clipped\n", checked, mismatches, floorStats.m_trianglesClipped);
+		passed = passed && perspective;
+
+		// Threads // The same floor on the calling thread alone gives the same image.
+		rasterizer.SetThreadCount(1);
+		rasterizer.Clear(black);
+		rasterizer.DrawIndexed(projection, floor.data(), 4, sizeof(Vertex), floorIndices.data(), 6, &checker);
+		rasterizer.Flush();
+		rasterizer.SetThreadCount(0);
+		bool deterministic = std::equal(floorImage.begin(), floorImage.end(), rasterizer.GetColor());
+		printf("Threads: 1 and %d give %s images\n", JobSystem.GetWorkerCount(), deterministic ? "identical" : "DIFFERENT");
+		passed = passed && deterministic;
+
+		// Watertight // A jittered grid overhanging the screen on every side. Every pixel is covered exactly once.
+		Renderer::SoftwareTexture white = solid(0xffffffff);
+		std::vector<Vertex> grid;
+		std::vector<uint32_t> gridIndices;
+		const int columns = 17, rows = 13;
+		srand(7);
+		for (int y = 0; y <= rows; ++y)
+		{
+			for (int x = 0; x <= columns; ++x)
+			{
+				float jitterX = (x > 0 && x < columns) ? (rand() / (float)RAND_MAX - 0.5f) * 0.08f : 0.0f;
+				float jitterY = (y > 0 && y < rows) ? (rand() / (float)RAND_MAX - 0.5f) * 0.08f : 0.0f;
+				grid.push_back({ -1.2f + 2.4f * x / columns + jitterX, -1.2f + 2.4f * y / rows + jitterY, 0.5f, 0.0f, 0.0f });
+			}
+		}
+		for (int y = 0; y < rows; ++y)
+		{
+			for (int x = 0; x < columns; ++x)
+			{
+				uint32_t v00 = y * (columns + 1) + x, v10 = v00 + 1, v01 = v00 + columns + 1, v11 = v01 + 1;
+				for (uint32_t i : { v00, v10, v11, v00, v11, v01 })
+					gridIndices.push_back(i);
+			}
+		}
+		rasterizer.Clear(black);
+		rasterizer.DrawIndexed(Math::Matrix4F(1.0f), grid.data(), (uint32_t)grid.size(), sizeof(Vertex), gridIndices.data(), (uint32_t)gridIndices.size(), &white);
+		rasterizer.Flush();
+		int holes = 0;
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+				holes += (rasterizer.GetPixel(x, y) != 0xffffffff) ? 1 : 0;
+		}
+		bool watertight = holes == 0 && rasterizer.GetStats().m_pixelsCovered == (uint64_t)width * height;
+		printf("Watertight: %d holes, %llu of %d pixels covered\n", holes, (unsigned long long)rasterizer.GetStats().m_pixelsCovered, width * height);
+		passed = passed && watertight;
+
+		// Untextured // The same grid without a texture shades white, as the software sink draws items with none bound.
+		rasterizer.Clear(black);
+		rasterizer.DrawIndexed(Math::Matrix4F(1.0f), grid.data(), (uint32_t)grid.size(), sizeof(Vertex), gridIndices.data(), (uint32_t)gridIndices.size(), nullptr);
+		rasterizer.Flush();
+		int unshaded = 0;
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+				unshaded += (rasterizer.GetPixel(x, y) != 0xffffffff) ? 1 : 0;
+		}
+		printf("Untextured: %d pixels not white\n", unshaded);
+		passed = passed && unshaded == 0;
+
+		// Bilinear // Two texels stretched over the screen, black at a quarter, grey halfway, white at three quarters.
+		Renderer::SoftwareTexture pair;
+		pair.m_levels.push_back({ 2, 1, { 0xff000000, 0xffffffff } });
+		std::vector<Vertex> screen;
+		std::vector<uint32_t> screenIndices;
+		const Vertex screenCorners[4] = { { -1, -1, 0.5f, 0, 1 }, { 1, -1, 0.5f, 1, 1 }, { 1, 1, 0.5f, 1, 0 }, { -1, 1, 0.5f, 0, 0 } };
+		quad(screen, screenIndices, screenCorners);
+		rasterizer.Clear(black);
+		rasterizer.DrawIndexed(Math::Matrix4F(1.0f), screen.data(), 4, sizeof(Vertex), screenIndices.data(), 6, &pair);
+		rasterizer.Flush();
+		int quarter = channel(rasterizer.GetPixel(width / 4, height / 2), 0);
+		int half = channel(rasterizer.GetPixel(width / 2, height / 2), 0);
+		int threeQuarters = channel(rasterizer.GetPixel(width * 3 / 4, height / 2), 0);
+		bool monotonic = true;
+		for (int x = width / 4 + 1; x <= width * 3 / 4; ++x)
+			monotonic = monotonic && channel(rasterizer.GetPixel(x, height / 2), 0) >= channel(rasterizer.GetPixel(x - 1, height / 2), 0);
+		bool bilinear = abs(quarter - 0) <= 4 && abs(half - 128) <= 4 && abs(threeQuarters - 255) <= 4 && monotonic;
+		printf("Bilinear: %d, %d, %d across, %s\n", quarter, half, threeQuarters, monotonic ? "monotonic" : "NOT MONOTONIC");
+		passed = passed && bilinear;
+
+		// Golden Images // Up to two channel steps off is rounding, a tenth of a percent of pixels past that is allowed.
+		if (update)
+			std::filesystem::create_directories(directory);
+		const char* names[3] = { "depth", "perspective", "bilinear" };
+		const std::vector<uint32_t>* images[3] = { &depthImage[0], &floorImage, nullptr };
+		std::vector<uint32_t> bilinearImage(rasterizer.GetColor(), rasterizer.GetColor() + (size_t)rasterizer.GetPitch() * height);
+		images[2] = &bilinearImage;
+		for (int i = 0; i < 3; ++i)
+		{
+			std::string path = std::string(directory) + "/" + names[i] + ".ppm";
+			int goldenWidth = 0, goldenHeight = 0;
+			std::vector<uint32_t> golden;
+			if (update)
+			{
+				bool written = Renderer::WriteImage(path.c_str(), width, height, rasterizer.GetPitch(), images[i]->data());
+				printf("Golden %s: %s %s\n", names[i], written ? "written to" : "FAILED to write", path.c_str());
+				passed = passed && written;
+				continue;
+			}
+			if (!Renderer::ReadImage(path.c_str(), goldenWidth, goldenHeight, golden))
+			{
+				printf("Golden %s: MISSING %s, -update writes it\n", names[i], path.c_str());
+				passed = false;
+				continue;
+			}
+			int different = 0;
+			for (int y = 0; y < height && goldenWidth == width && goldenHeight == height; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					uint32_t a = (*images[i])[(size_t)y * rasterizer.GetPitch() + x], b = golden[(size_t)y * width + x];
+					for (int c = 0; c < 3; ++c)
+					{
+						if (abs(channel(a, c) - channel(b, c)) > 2)
+						{
+							different++;
+							break;
+						}
+					}
+				}
+			}
+			bool matches = goldenWidth == width && goldenHeight == height && different <= width * height / 1000;
+			printf("Golden %s: %d pixels differ, %s\n", names[i], different, matches ? "match" : "MISMATCH");
+			passed = passed && matches;
+		}
+		rasterizer.Destroy();
+		JobSystem.Destroy();
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+
+#ifdef TESTS_ENGINE
+	int RasterBench(const char* args)
+	{
+		// A model drawn through the software backend at several resolutions and thread counts, per phase timings per frame.
+		char modelPath[260] = "./res/models/heavy.dae";
+		if (args[0] == ' ' && args[1] != '-')
+			sscanf(args + 1, "%259s", modelPath);
+		Profiler.Create();
+		JobSystem.Create();
+		Renderer::Renderer renderer;
+		renderer.CreateSoftware(320, 240);
+		Textures.Create(renderer);
+		Shaders.Create(renderer);
+		Renderer::Meshes::MeshRenderer meshRenderer;
+		meshRenderer.Create(renderer);
+		meshRenderer.LoadModel(modelPath);
+		Renderer::SoftwareRasterizer& rasterizer = renderer.GetSoftwareRasterizer();
+
+		// Camera // Backed off along +z until the bounding sphere fills the view.
+		Math::BoundingBox bounds = meshRenderer.GetBounds();
+		Math::Vector3F center = bounds.GetCenter();
+		float radius = center.Distance(bounds.maximum);
+		Math::Matrix4F model(1.0f), view(1.0f);
+		view.m03 = -center.x;
+		view.m13 = -center.y;
+		view.m23 = -center.z - radius * 2.0f;
+		std::vector<int> threads = { 1 };
+		for (int t = 2; t < JobSystem.GetWorkerCount(); t *= 2)
+			threads.push_back(t);
+		if (JobSystem.GetWorkerCount() > 1)
+			threads.push_back(JobSystem.GetWorkerCount());
+
+		const int sizes[4][2] = { { 320, 240 }, { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+		const int frames = 10;
+		typedef std::chrono::high_resolution_clock Clock;
+		for (const auto& size : sizes)
+		{
+			Renderer::Camera camera;
+			camera.CreatePerspective((float)size[0], (float)size[1], 60.0f, 0.1f, radius * 10.0f);
+			camera.Draw(view);
+			rasterizer.Resize(size[0], size[1]);
+			for (int t : threads)
+			{
+				rasterizer.SetThreadCount(t);
+				double total = 0.0, vertexMs = 0.0, binMs = 0.0, rasterMs = 0.0;
+				for (int f = -1; f < frames; ++f)
+				{
+					// First frame warms the caches and grows the bins, untimed.
+					Clock::time_point start = Clock::now();
+					renderer.BeginFrame();
+					meshRenderer.Draw(model, camera);
+					renderer.EndFrame();
+					if (f < 0)
+						continue;
+					total += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+					vertexMs += rasterizer.GetStats().m_vertexMs;
+					binMs += rasterizer.GetStats().m_binMs;
+					rasterMs += rasterizer.GetStats().m_rasterMs;
+				}
+				const Renderer::RasterStats& stats = rasterizer.GetStats();
+				printf("%dx%d, %d threads: %.3f ms/frame (vertices %.3f, binning %.3f, tiles %.3f), %u triangles, %u binned, %u tile entries, %llu pixels shaded, %u blocks rejected\n",
+					size[0], size[1], t, total / frames, vertexMs / frames, binMs / frames, rasterMs / frames, stats.m_triangles, stats.m_trianglesBinned,
+					stats.m_binEntries, (unsigned long long)stats.m_pixelsShaded, stats.m_blocksRejected);
+			}
+		}
+		meshRenderer.Destroy();
+		Shaders.Destroy();
+		Textures.Destroy();
+		renderer.Destroy();
+		JobSystem.Destroy();
+		Profiler.Destroy();
+		return 0;
+	}
+#endif
+}
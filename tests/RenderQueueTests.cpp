@@ -0,0 +1,195 @@
+#include "Tests.h"
+#include "RenderQueue.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+namespace Tests
+{
+	using namespace Renderer;
+
+	// Recording Sink // Tracks what is bound and logs each draw with the state it saw. Items carry their id in m03 of the transform.
+	class RecordingSink : public CommandSink
+	{
+	public:
+		struct Drawn
+		{
+			int m_id;
+			Meshes::Shader* m_shader;
+			Meshes::Texture* m_texture;
+			Meshes::Mesh* m_mesh;
+			uint32_t m_material;
+		};
+
+		void BindShader(Meshes::Shader* shader) override { m_shader = shader; m_binds[0]++; }
+		void BindTexture(Meshes::Texture* texture) override { m_texture = texture; m_binds[1]++; m_nullTextureBinds += texture == nullptr; }
+		void BindConstants(RHI::BufferHandle constantBuffer, uint32_t offset, uint32_t size) override { m_binds[2]++; }
+		void BindMesh(Meshes::Mesh* mesh) override { m_mesh = mesh; m_binds[3]++; }
+		void BindMaterial(uint32_t material) override { m_material = material; m_binds[4]++; }
+		void Draw(const DrawItem& item) override { m_drawn.push_back({ (int)item.m_modelViewProj.m03, m_shader, m_texture, m_mesh, m_material }); }
+		void DrawInstanced(const DrawItem& item, const Math::Matrix4F* transforms, uint32_t count) override
+		{
+			m_instancedDraws++;
+			m_largestInstancedDraw = std::max(m_largestInstancedDraw, count);
+			for (uint32_t i = 0; i < count; ++i)
+				m_drawn.push_back({ (int)transforms[i].m03, m_shader, m_texture, m_mesh, m_material });
+		}
+
+		Meshes::Shader* m_shader = nullptr;
+		Meshes::Texture* m_texture = nullptr;
+		Meshes::Mesh* m_mesh = nullptr;
+		uint32_t m_material = 0;
+		unsigned int m_binds[5] = {}; // Shader, texture, constants, mesh, material.
+		unsigned int m_nullTextureBinds = 0;
+		unsigned int m_instancedDraws = 0;
+		uint32_t m_largestInstancedDraw = 0;
+		std::vector<Drawn> m_drawn;
+	};
+
+	int QueueTest(const char* args)
+	{
+		// Items are submitted in shuffled order and executed into a recording sink. The draws must come out in stable key order,
+		// each once, with the state each item asked for bound, a null texture included, and one bind per change of state.
+		int count = 20000;
+		sscanf(args, "%d", &count);
+		bool passed = true;
+		auto check = [&passed](const char* name, bool ok)
+		{
+			printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+			passed = passed && ok;
+		};
+
+		// Only the addresses matter, nothing is dereferenced.
+		const int shaderCount = 4, textureCount = 6, meshCount = 5;
+		static char shaders[shaderCount], textures[textureCount], meshes[meshCount];
+		srand(7);
+		std::vector<DrawItem> items(count);
+		std::vector<uint64_t> keys(count);
+		for (int i = 0; i < count; ++i)
+		{
+			DrawItem& item = items[i];
+			int shader = rand() % shaderCount, texture = rand() % (textureCount + 1), mesh = rand() % meshCount;
+			RenderPass pass = (rand() % 4) ? PASS_OPAQUE : PASS_TRANSPARENT;
+			item.m_shader = (Meshes::Shader*)&shaders[shader];
+			item.m_texture = texture < textureCount ? (Meshes::Texture*)&textures[texture] : nullptr; // The last id is untextured.
+			item.m_mesh = (Meshes::Mesh*)&meshes[mesh];
+			item.m_material = (uint32_t)texture;
+			item.m_indexCount = 36;
+			item.m_instanced = pass == PASS_OPAQUE && rand() % 2;
+			item.m_modelViewProj = Math::Matrix4F(1.0f);
+			item.m_modelViewProj.m03 = (float)i;
+			// Depths repeat, so equal keys show whether the sort is stable.
+			keys[i] = item.m_instanced ? SortKey::MakeInstanced(pass, shader, texture, mesh) : SortKey::Make(pass, shader, texture, (float)(rand() % 64));
+		}
+		std::vector<int> order(count);
+		for (int i = 0; i < count; ++i)
+			order[i] = i;
+		for (int i = count - 1; i > 0; --i)
+			std::swap(order[i], order[rand() % (i + 1)]);
+
+		RenderQueue queue;
+		for (int i : order)
+			queue.Submit(keys[i], items[i]);
+		queue.Sort();
+		RecordingSink sink;
+		queue.Execute(sink);
+		const RenderQueueStats& stats = queue.GetStats();
+
+		// Expected // The same submissions through a stable sort.
+		std::vector<int> expected = order;
+		std::stable_sort(expected.begin(), expected.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+		bool sorted = sink.m_drawn.size() == expected.size();
+		for (size_t i = 0; sorted && i < expected.size(); ++i)
+			sorted = sink.m_drawn[i].m_id == expected[i];
+		check("Sorted", sorted);
+
+		bool bound = sorted;
+		unsigned int changes[5] = {}, instanced = 0, nullTextures = 0;
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			const DrawItem& item = items[expected[i]];
+			if (bound)
+			{
+				const RecordingSink::Drawn& drawn = sink.m_drawn[i];
+				bound = drawn.m_shader == item.m_shader && drawn.m_texture == item.m_texture && drawn.m_mesh == item.m_mesh && drawn.m_material == item.m_material;
+			}
+			const DrawItem* previous = i ? &items[expected[i - 1]] : nullptr;
+			changes[0] += !previous || previous->m_shader != item.m_shader;
+			changes[1] += !previous || previous->m_texture != item.m_texture;
+			changes[3] += !previous || previous->m_mesh != item.m_mesh;
+			changes[4] += !previous || previous->m_material != item.m_material;
+			nullTextures += item.m_texture == nullptr && (!previous || previous->m_texture != nullptr);
+			instanced += item.m_instanced;
+		}
+		check("Bound state", bound);
+
+		// Binds // One per change of state, null textures forwarded and counted like any other.
+		bool binds = sink.m_binds[0] == changes[0] && sink.m_binds[1] == changes[1] && sink.m_binds[3] == changes[3] && sink.m_binds[4] == changes[4]
+			&& sink.m_binds[0] == stats.m_shaderBinds && sink.m_binds[1] == stats.m_textureBinds && sink.m_binds[2] == stats.m_constantBinds
+			&& sink.m_binds[3] == stats.m_meshBinds && sink.m_binds[4] == stats.m_materialBinds;
+		printf("Binds: %u shader, %u texture (%u null), %u mesh, %u material, %u saved\n",
+			sink.m_binds[0], sink.m_binds[1], sink.m_nullTextureBinds, sink.m_binds[3], sink.m_binds[4], stats.m_stateChangesSaved);
+		check("Bind counts", binds && sink.m_nullTextureBinds == nullTextures && nullTextures > 0);
+
+		// Instancing // Every instanced item drawn through a merged draw, none past the instance buffer.
+		printf("Instancing: %u items in %u draws, %u drawn alone\n", stats.m_instances, stats.m_instancedDraws, stats.m_draws - stats.m_instancedDraws);
+		check("Instancing", stats.m_instances == instanced && stats.m_instancedDraws == sink.m_instancedDraws && stats.m_instancedDraws < instanced
+			&& sink.m_largestInstancedDraw <= INSTANCE_BUFFER_CAPACITY);
+
+		// Depth // A moved and turned camera. Opaque items come out near to far and transparent ones far to near, by the depth
+		// of each origin in view space worked out here. The view's translation is not the camera position, so distances to it
+		// would order them differently.
+		Math::Matrix4F view(1.0f);
+		view.RotateY(0.7f);
+		view.RotateX(-0.3f);
+		view.SetTranslation(12.0f, -4.0f, -30.0f);
+		const int depthCount = 500;
+		std::vector<float> depths(depthCount), distances(depthCount);
+		RenderQueue depthQueue;
+		bool viewDepth = true;
+		int distanceOrder = 0;
+		for (int i = 0; i < depthCount; ++i)
+		{
+			Math::Matrix4F model(1.0f);
+			model.SetTranslation((float)(rand() % 200 - 100), (float)(rand() % 40 - 20), (float)(rand() % 200 - 100));
+			model.m03 += 0.5f; // Apart from every other item's depth.
+			float z = view.m20 * model.m03 + view.m21 * model.m13 + view.m22 * model.m23 + view.m23;
+			depths[i] = std::max(-z, 0.0f);
+			float depth = SortKey::ViewDepth(model, view);
+			viewDepth = viewDepth && fabsf(depth + z) < 1e-3f && fabsf(depth + (model * view).m23) < 1e-3f;
+			distances[i] = Math::Vector3F(model.m03, model.m13, model.m23).Distance(Math::Vector3F(view.m03, view.m13, view.m23));
+			distanceOrder += i > 0 && (distances[i] < distances[i - 1]) != (depths[i] < depths[i - 1]);
+			DrawItem item;
+			item.m_shader = (Meshes::Shader*)&shaders[0];
+			item.m_texture = nullptr;
+			item.m_mesh = (Meshes::Mesh*)&meshes[i % meshCount];
+			item.m_modelViewProj = Math::Matrix4F(1.0f);
+			item.m_modelViewProj.m03 = (float)i;
+			item.m_indexCount = 36;
+			RenderPass pass = (i % 3) ? PASS_OPAQUE : PASS_TRANSPARENT;
+			depthQueue.Submit(SortKey::Make(pass, 0, 0, depth), item);
+		}
+		depthQueue.Sort();
+		RecordingSink depthSink;
+		depthQueue.Execute(depthSink);
+		bool nearFirst = depthSink.m_drawn.size() == depthCount;
+		for (size_t i = 1; nearFirst && i < depthSink.m_drawn.size(); ++i)
+		{
+			int a = depthSink.m_drawn[i - 1].m_id, b = depthSink.m_drawn[i].m_id;
+			bool opaqueA = a % 3 != 0, opaqueB = b % 3 != 0;
+			if (opaqueA == opaqueB)
+				nearFirst = opaqueA ? depths[a] <= depths[b] : depths[a] >= depths[b];
+			else
+				nearFirst = opaqueA; // Opaque pass first.
+		}
+		printf("Depth: %d of %d neighbouring items ordered apart by distance to the view translation\n", distanceOrder, depthCount - 1);
+		check("View depth", viewDepth && distanceOrder > 0);
+		check("Depth order", nearFirst);
+
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,77 @@
+#include "Tests.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace Tests
+{
+	static const Test AllTests[] =
+	{
+		{ "-mathtest", "[count]", MathTest, false },
+		{ "-mathbench", "[iterations]", MathBench, true },
+		{ "-meshopt", "[model]", MeshOptTest, false },
+		{ "-indextest", "", IndexTest, false },
+		{ "-lodtest", "", LodTest, false },
+		{ "-transformbench", "[nodes]", TransformBench, true },
+		{ "-jobtest", "[workers]", JobTest, false },
+		{ "-jobbench", "[maxWorkers]", JobBench, true },
+		{ "-ringtest", "", RingTest, false },
+		{ "-alloctest", "[items]", AllocTest, false },
+		{ "-ecstest", "[entities]", EcsTest, false },
+		{ "-rastertest", "[directory] [-update]", RasterTest, false },
+		{ "-rhitest", "", RHITest, false },
+		{ "-queuetest", "[draws]", QueueTest, false },
+		{ "-texturetest", "", TextureTest, false },
+		{ "-atlasbench", "[directory]", AtlasBench, false },
+		{ "-pacetest", "[workMs]", PaceTest, false },
+		{ "-proftest", "[markers]", ProfTest, true },
+		{ "-culltest", "[objects]", CullTest, false },
+		{ "-materialtest", "", MaterialTest, false },
+#ifdef TESTS_ENGINE
+		{ "-rasterbench", "[model]", RasterBench, true },
+		{ "-scenebench", "[objects]", SceneBench, true },
+		{ "-recordbench", "[draws]", RecordBench, false },
+#endif
+	};
+}
+
+// Test Entry // Named tests run in table order with what follows each name as its arguments. Without names every test but the
+// benchmarks runs with its defaults. Exits non-zero when any of them failed.
+int main(int argc, char** argv)
+{
+	std::string commandLine;
+	for (int i = 1; i < argc; ++i)
+		commandLine += std::string(" ") + argv[i];
+
+	if (strstr(commandLine.c_str(), "-help"))
+	{
+		printf("Usage: tests [-test [args]]...\n");
+		for (const Tests::Test& test : Tests::AllTests)
+			printf("  %s %s%s\n", test.m_name, test.m_usage, test.m_benchmark ? " (benchmark)" : "");
+		return 0;
+	}
+
+	bool named = false;
+	for (const Tests::Test& test : Tests::AllTests)
+		named = named || strstr(commandLine.c_str(), test.m_name);
+
+	int run = 0, failed = 0;
+	for (const Tests::Test& test : Tests::AllTests)
+	{
+		const char* args = strstr(commandLine.c_str(), test.m_name);
+		if (named ? !args : test.m_benchmark)
+			continue;
+		printf("%s\n", test.m_name);
+		fflush(stdout);
+		int result = test.m_function(args ? args + strlen(test.m_name) : "");
+		fflush(stdout);
+		run++;
+		failed += result != 0;
+	}
+	if (run == 0)
+		printf("No tests run, -help lists them.\n");
+	else if (run > 1)
+		printf("%d of %d tests passed\n", run - failed, run);
+	return failed ? 1 : 0;
+}
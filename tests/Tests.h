@@ -0,0 +1,52 @@
+#pragma once
+
+// Tests // Console runner for the engine's self checks and benchmarks. Each test prints a line per case and returns 0 when every
+// case passed, its arguments are whatever follows its name on the command line. Parts that need a device, the importer or the
+// renderer are built only with TESTS_ENGINE, the rest builds and runs on any platform.
+namespace Tests
+{
+	typedef int (*TestFunction)(const char* args);
+	struct Test
+	{
+		const char* m_name;
+		const char* m_usage;
+		TestFunction m_function;
+		bool m_benchmark; // Only run when named, timings rather than checks.
+	};
+
+	// Math
+	int MathTest(const char* args);
+	int MathBench(const char* args);
+	// Meshes
+	int MeshOptTest(const char* args);
+	int IndexTest(const char* args);
+	int LodTest(const char* args);
+	// Transforms
+	int TransformBench(const char* args);
+	// Jobs
+	int JobTest(const char* args);
+	int JobBench(const char* args);
+	int SceneBench(const char* args);
+	// Memory
+	int RingTest(const char* args);
+	int AllocTest(const char* args);
+	// Entities
+	int EcsTest(const char* args);
+	// Software Rasterizer
+	int RasterTest(const char* args);
+	int RasterBench(const char* args);
+	// Render Hardware Interface
+	int RHITest(const char* args);
+	int RecordBench(const char* args);
+	int MaterialTest(const char* args);
+	// Render Queue
+	int QueueTest(const char* args);
+	// Textures
+	int TextureTest(const char* args);
+	// Texture Atlas
+	int AtlasBench(const char* args);
+	// Frame
+	int PaceTest(const char* args);
+	int ProfTest(const char* args);
+	int CullTest(const char* args);
+}
@@ -0,0 +1,344 @@
+#include "Tests.h"
+#include "CookedTexture.h"
+#ifdef TESTS_ENGINE
+#include "Renderer.h"
+#include "TextureCache.h"
+#include "Assets.h"
+#include "Jobs.h"
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Tests
+{
+	using namespace Renderer::Meshes;
+
+	// An image of 4x4 blocks split along a random BC7 two subset partition, each side scattered between two colours of its own.
+	// Four unrelated colours lie on no one line, two lines through them are what the partitioned modes store.
+	static TextureImage PartitionedImage(int size, bool alpha)
+	{
+		static const uint16_t shapes[4] = { 0xcccc, 0xff00, 0x6666, 0x0ff0 }; // Partitions 0, 13, 26 and 29.
+		TextureImage image;
+		image.m_width = image.m_height = size;
+		image.m_pixels.resize((size_t)size * size * 4);
+		for (int by = 0; by < size / 4; ++by)
+		{
+			for (int bx = 0; bx < size / 4; ++bx)
+			{
+				uint8_t colors[4][4];
+				for (int k = 0; k < 4; ++k)
+					for (int c = 0; c < 4; ++c)
+						colors[k][c] = (c < 3 || alpha) ? (uint8_t)(rand() % 256) : 255;
+				uint16_t shape = shapes[rand() % 4];
+				for (int i = 0; i < 16; ++i)
+					memcpy(&image.m_pixels[(((size_t)by * 4 + i / 4) * size + bx * 4 + i % 4) * 4], colors[((shape >> i) & 1) * 2 + rand() % 2], 4);
+			}
+		}
+		return image;
+	}
+
+	// BC7 Reference Layout // Field widths per mode from the format specification, written independently of the cooker.
+	struct Bc7Layout
+	{
+		int m_subsets, m_partitionBits, m_rotationBits, m_selectionBits, m_colorBits, m_alphaBits, m_endpointPBits, m_sharedPBits, m_indexBits, m_secondaryBits;
+	};
+	static const Bc7Layout Bc7Layouts[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 }, { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 }, { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 }, { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 }, { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 }, { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 }, { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	// A block whose first endpoints are all zero bits and second all one bits in every subset. Pixels take the highest index,
+	// anchors the highest their one bit shorter field holds. Partition 1 of the three subset table anchors at 3 and 8, partition 17
+	// of the two subset table at 2. Returns the expected decode.
+	static void BuildBc7Block(int mode, int rotation, int selection, uint8_t block[16], uint8_t expected[64])
+	{
+		const Bc7Layout& layout = Bc7Layouts[mode];
+		int partition = (layout.m_subsets == 3) ? 1 : (layout.m_subsets == 2 ? 17 : 0);
+		bool anchors[16] = {};
+		anchors[0] = true;
+		if (layout.m_subsets == 3)
+			anchors[3] = anchors[8] = true;
+		else if (layout.m_subsets == 2)
+			anchors[2] = true;
+
+		uint64_t bits[2] = {};
+		int position = 0;
+		auto write = [&](uint32_t value, int count)
+		{
+			for (int i = 0; i < count; ++i, ++position)
+			{
+				if (value & (1u << i))
+					bits[position >> 6] |= 1ull << (position & 63);
+			}
+		};
+		write(1u << mode, mode + 1);
+		write(partition, layout.m_partitionBits);
+		write(rotation, layout.m_rotationBits);
+		write(selection, layout.m_selectionBits);
+		for (int c = 0; c < 4; ++c)
+		{
+			int width = (c < 3) ? layout.m_colorBits : layout.m_alphaBits;
+			for (int s = 0; s < layout.m_subsets; ++s)
+			{
+				write(0, width);
+				write((1u << width) - 1, width);
+			}
+		}
+		for (int s = 0; s < layout.m_subsets; ++s)
+		{
+			if (layout.m_endpointPBits)
+				write(2, 2);
+			else if (layout.m_sharedPBits)
+				write(1, 1);
+		}
+		for (int i = 0; i < 16; ++i)
+			write(anchors[i] ? (1u << (layout.m_indexBits - 1)) - 1 : (1u << layout.m_indexBits) - 1, layout.m_indexBits - (anchors[i] ? 1 : 0));
+		for (int i = 0; i < 16 && layout.m_secondaryBits; ++i)
+			write(i == 0 ? (1u << (layout.m_secondaryBits - 1)) - 1 : (1u << layout.m_secondaryBits) - 1, layout.m_secondaryBits - (i == 0 ? 1 : 0));
+		memcpy(block, bits, 16);
+
+		// Endpoints expanded to 8 bits, the top bits repeated below. A shared p-bit of 1 lifts the low one off zero.
+		auto expand = [](int value, int width) { return (value << (8 - width)) | (value >> (2 * width - 8)); };
+		int hasP = layout.m_endpointPBits | layout.m_sharedPBits;
+		int low = expand(layout.m_sharedPBits, layout.m_colorBits + hasP), high = 255;
+		// Two, three and four bit weights at the index below the top half, 21, 27 and 30 out of 64.
+		auto anchorValue = [&](int indexBits)
+		{
+			int w = (indexBits == 2) ? 21 : (indexBits == 3 ? 27 : 30);
+			return (uint8_t)(((64 - w) * low + w * high + 32) >> 6);
+		};
+		for (int i = 0; i < 16; ++i)
+		{
+			uint8_t color = anchors[i] ? anchorValue(layout.m_indexBits) : 255;
+			uint8_t alpha = layout.m_alphaBits ? color : 255;
+			if (layout.m_secondaryBits)
+			{
+				uint8_t other = (i == 0) ? anchorValue(layout.m_secondaryBits) : 255;
+				if (selection)
+				{
+					alpha = color;
+					color = other;
+				}
+				else
+					alpha = other;
+			}
+			uint8_t* pixel = expected + i * 4;
+			pixel[0] = pixel[1] = pixel[2] = color;
+			pixel[3] = alpha;
+			if (rotation)
+			{
+				uint8_t t = pixel[3];
+				pixel[3] = pixel[rotation - 1];
+				pixel[rotation - 1] = t;
+			}
+		}
+	}
+
+	int TextureTest(const char* args)
+	{
+		// Mip chains have every level down to 1x1 and filter sRGB in linear space. Every block format round trips a synthetic
+		// image above a quality floor. BC7 keeps blocks of four colours on two lines, which one subset cannot, and decodes a hand
+		// built block in every mode the way the format specifies. With the engine, a texture referenced several times is decoded once.
+		bool passed = true;
+		auto check = [&passed](const char* name, bool ok)
+		{
+			printf("%s: %s\n", name, ok ? "ok" : "FAILED");
+			passed = passed && ok;
+		};
+		srand(7);
+
+		// Mips // Sizes and levels of a non square chain, an sRGB gradient against a 2x2 average in linear light, a linear ramp
+		// through the Kaiser filter away from the clamped edges, and a flat image through both filters.
+		auto toLinear = [](int v) { double c = v / 255.0; return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4); };
+		auto toSrgb = [](double c) { return (int)((c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1.0 / 2.4) - 0.055) * 255.0 + 0.5); };
+		TextureImage gradient;
+		gradient.m_width = 64;
+		gradient.m_height = 16;
+		gradient.m_pixels.resize(64 * 16 * 4);
+		for (int y = 0; y < 16; ++y)
+		{
+			for (int x = 0; x < 64; ++x)
+			{
+				uint8_t* pixel = &gradient.m_pixels[((size_t)y * 64 + x) * 4];
+				pixel[0] = (uint8_t)(x * 4);
+				pixel[1] = (uint8_t)(y * 16);
+				pixel[2] = (uint8_t)(255 - x * 4);
+				pixel[3] = (uint8_t)(x * 2 + y * 8);
+			}
+		}
+		std::vector<TextureImage> mips;
+		GenerateMips(gradient.m_pixels.data(), 64, 16, MIP_FILTER_BOX, true, mips);
+		bool chain = mips.size() == 7;
+		for (size_t i = 0; i < mips.size() && chain; ++i)
+		{
+			int width = 64 >> i, height = (16 >> i) ? (16 >> i) : 1;
+			chain = mips[i].m_width == width && mips[i].m_height == height && mips[i].m_pixels.size() == (size_t)width * height * 4;
+		}
+		check("Mip chain", chain && mips[0].m_pixels == gradient.m_pixels);
+		int srgbError = chain ? 0 : 255;
+		for (int y = 0; y < 8 && chain; ++y)
+		{
+			for (int x = 0; x < 32; ++x)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					int sum = 0;
+					double linear = 0.0;
+					for (int k = 0; k < 4; ++k)
+					{
+						int v = gradient.m_pixels[((size_t)(y * 2 + k / 2) * 64 + x * 2 + k % 2) * 4 + c];
+						sum += v;
+						linear += toLinear(v) / 4.0;
+					}
+					int expected = (c == 3) ? (sum + 2) / 4 : toSrgb(linear);
+					srgbError = std::max(srgbError, abs(mips[1].m_pixels[((size_t)y * 32 + x) * 4 + c] - expected));
+				}
+			}
+		}
+		check("sRGB box mip", srgbError <= 1);
+		uint8_t checker[16] = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255 };
+		std::vector<TextureImage> checkerSrgb, checkerLinear;
+		GenerateMips(checker, 2, 2, MIP_FILTER_BOX, true, checkerSrgb);
+		GenerateMips(checker, 2, 2, MIP_FILTER_BOX, false, checkerLinear);
+		check("sRGB average", checkerSrgb[1].m_pixels[0] == toSrgb(0.5) && checkerLinear[1].m_pixels[0] == 128 && checkerSrgb[1].m_pixels[3] == 255);
+		GenerateMips(gradient.m_pixels.data(), 64, 16, MIP_FILTER_KAISER, false, mips);
+		int kaiserError = 0;
+		for (int x = 3; x < 29; ++x)
+			kaiserError = std::max(kaiserError, abs(mips[1].m_pixels[((size_t)4 * 32 + x) * 4] - (x * 8 + 2)));
+		check("Kaiser ramp", mips.size() == 7 && kaiserError <= 1);
+		std::vector<uint8_t> flat(32 * 32 * 4, 93);
+		bool constant = true;
+		for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER })
+		{
+			GenerateMips(flat.data(), 32, 32, filter, true, mips);
+			for (const TextureImage& mip : mips)
+				for (uint8_t v : mip.m_pixels)
+					constant = constant && v == 93;
+		}
+		check("Flat mips", constant);
+
+		// Formats // Smooth gradients under mild noise, with alpha.
+		TextureImage image;
+		image.m_width = image.m_height = 64;
+		image.m_pixels.resize(64 * 64 * 4);
+		for (int y = 0; y < 64; ++y)
+		{
+			for (int x = 0; x < 64; ++x)
+			{
+				uint8_t* pixel = &image.m_pixels[((size_t)y * 64 + x) * 4];
+				pixel[0] = (uint8_t)(x * 4 + rand() % 6);
+				pixel[1] = (uint8_t)(y * 4 + rand() % 6);
+				pixel[2] = (uint8_t)(128 + 100 * sinf(x * 0.2f) * cosf(y * 0.15f));
+				pixel[3] = (uint8_t)(255 - x * 2);
+			}
+		}
+		const char* names[COOKED_FORMAT_MAX] = { "RGBA8", "BC1", "BC3", "BC5", "BC7" };
+		const double floors[COOKED_FORMAT_MAX] = { 1000.0, 30.0, 30.0, 36.0, 38.0 };
+		for (int f = 0; f < COOKED_FORMAT_MAX; ++f)
+		{
+			std::vector<uint8_t> compressed;
+			TextureImage decoded;
+			auto start = std::chrono::high_resolution_clock::now();
+			CompressImage(image, (CookedTextureFormat)f, compressed);
+			double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			DecompressImage(compressed.data(), (CookedTextureFormat)f, image.m_width, image.m_height, decoded);
+			double psnr = ComputePSNR(image, decoded, (CookedTextureFormat)f);
+			bool ok = psnr >= floors[f] && compressed.size() == (f ? GetMipSize((CookedTextureFormat)f, 64, 64) : image.m_pixels.size());
+			printf("%s: %zu bytes, %.2f dB, floor %.0f dB, encode %.3f ms, %.1f MPix/s%s\n", names[f], compressed.size(), psnr, floors[f],
+				encodeMs, 64 * 64 / 1000.0 / (encodeMs > 0.0 ? encodeMs : 1e-6), ok ? "" : " FAILED");
+			passed = passed && ok;
+		}
+
+		// Partitioned // Four colours per block, a single line through them loses most of the detail.
+		for (int alpha = 0; alpha < 2; ++alpha)
+		{
+			TextureImage partitioned = PartitionedImage(64, alpha != 0);
+			std::vector<uint8_t> compressed;
+			TextureImage decoded;
+			CompressImage(partitioned, COOKED_BC7, compressed);
+			DecompressImage(compressed.data(), COOKED_BC7, 64, 64, decoded);
+			int modes[8] = {};
+			for (size_t b = 0; b < compressed.size(); b += 16)
+			{
+				int mode = 0;
+				while (mode < 8 && !(compressed[b + mode / 8] & (1 << (mode % 8))))
+					mode++;
+				modes[mode < 8 ? mode : 0]++;
+			}
+			double psnr = ComputePSNR(partitioned, decoded, COOKED_BC7);
+			double floor = alpha ? 36.0 : 44.0;
+			printf("Partitioned %s: %.2f dB, floor %.0f dB, modes 1/3/6/7 %d/%d/%d/%d%s\n", alpha ? "RGBA" : "RGB", psnr, floor,
+				modes[1], modes[3], modes[6], modes[7], psnr >= floor ? "" : " FAILED");
+			passed = passed && psnr >= floor && (alpha ? modes[7] > 0 : modes[1] + modes[3] > 0);
+		}
+
+		// Modes // A hand built block per mode, then the rotation and index selection of modes 4 and 5.
+		bool decoded = true;
+		int cases[10][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 }, { 3, 0, 0 }, { 4, 0, 0 }, { 5, 0, 0 }, { 6, 0, 0 }, { 7, 0, 0 }, { 4, 2, 1 }, { 5, 1, 0 } };
+		for (const int* c : cases)
+		{
+			uint8_t block[16], expected[64];
+			BuildBc7Block(c[0], c[1], c[2], block, expected);
+			TextureImage result;
+			DecompressImage(block, COOKED_BC7, 4, 4, result);
+			bool same = memcmp(result.m_pixels.data(), expected, 64) == 0;
+			if (!same)
+				printf("Mode %d, rotation %d, selection %d: pixel 0 %d %d %d %d, expected %d %d %d %d\n", c[0], c[1], c[2],
+					result.m_pixels[0], result.m_pixels[1], result.m_pixels[2], result.m_pixels[3], expected[0], expected[1], expected[2], expected[3]);
+			decoded = decoded && same;
+		}
+		uint8_t reserved[16] = {};
+		TextureImage result;
+		DecompressImage(reserved, COOKED_BC7, 4, 4, result);
+		for (uint8_t v : result.m_pixels)
+			decoded = decoded && v == 0;
+		check("Every BC7 mode decoded", decoded);
+
+#ifdef TESTS_ENGINE
+		// Texture Cache // The committed textures asked for several times each, blocking under different spellings of the path and
+		// streamed while the first request is still in flight. The software backend decodes for real, where the null one skips it.
+		{
+			JobSystem.Create();
+			AssetLoader.Create();
+			Renderer::Renderer renderer;
+			renderer.CreateSoftware(64, 64);
+			Textures.Create(renderer);
+			const char* blocking[] = { "./res/textures/test.png", "res/textures/test.png", "res/textures/../textures/test.png", "./res/textures/./test.png" };
+			const char* streamed = "./res/textures/heavy/eyeball_l.png";
+			const int references = 4;
+			std::vector<Texture> acquired;
+			for (const char* path : blocking)
+				acquired.push_back(Textures.Acquire(path));
+			for (int i = 0; i < references; ++i)
+				Textures.AcquireAsync(streamed, [&acquired](const Texture& texture) { acquired.push_back(texture); });
+			AssetLoader.WaitAll();
+			acquired.push_back(Textures.Acquire(streamed));
+
+			const Renderer::TextureCacheStats& stats = Textures.GetStats();
+			bool shared = acquired.size() == 2 * references + 1 && acquired[0].m_softwareTexture != acquired.back().m_softwareTexture;
+			for (size_t i = 0; i < acquired.size() && shared; ++i)
+				shared = acquired[i].m_softwareTexture && acquired[i].m_softwareTexture == acquired[((int)i < references) ? 0 : acquired.size() - 1].m_softwareTexture;
+			printf("Texture cache: %zu references, %u decodes, %u loads, %u hits\n", acquired.size(), stats.m_decodes, stats.m_loads, stats.m_hits);
+			check("Decoded once per texture", stats.m_decodes == 2 && stats.m_loads == 2 && stats.m_hits == references);
+			check("Shared decode", shared);
+			for (Texture& texture : acquired)
+				Textures.Release(texture);
+			Textures.Destroy();
+			renderer.Destroy();
+			AssetLoader.Destroy();
+			JobSystem.Destroy();
+		}
+#endif
+
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}
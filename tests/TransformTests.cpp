@@ -0,0 +1,141 @@
+#include "Tests.h"
+#include "Transform.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Tests
+{
+	// RAND_MAX may be as small as 32767.
+	static int RandomBelow(int n) { return (int)((((uint32_t)rand() << 15) ^ (uint32_t)rand()) % (uint32_t)n); }
+
+	int TransformBench(const char* args)
+	{
+		// Random forests of 10k nodes up to the given count, tenfold each step. Build, the first sorted update, steady updates with
+		// a tenth of the nodes moving, then a tenth freed with their children orphaned. Sampled globals are checked against a walk up
+		// the parents, and interpolation is checked on a transform whose m33 is zero.
+		int maxNodes = 1000000;
+		sscanf(args, "%d", &maxNodes);
+		bool passed = true;
+		typedef std::chrono::high_resolution_clock Clock;
+		auto since = [](Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); };
+		srand(7);
+		for (int count = 10000; count <= maxNodes; count *= 10)
+		{
+			Transforms.Create();
+			std::vector<Objects::TransformHandle> handles(count);
+			std::vector<int> parents(count, -1);
+			std::vector<Math::Matrix4F> locals(count, Math::Matrix4F(1.0f));
+
+			// Build // Nine in ten nodes hang under an earlier one, so the trees run a few dozen levels deep.
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < count; ++i)
+				handles[i] = Transforms.Allocate();
+			for (int i = 1; i < count; ++i)
+			{
+				if (rand() % 10)
+				{
+					parents[i] = RandomBelow(i);
+					Transforms.SetParent(handles[i], handles[parents[i]]);
+				}
+			}
+			for (int i = 0; i < count; ++i)
+			{
+				locals[i].SetTranslation((float)(rand() % 7) - 3.0f, (float)(rand() % 7) - 3.0f, 0.0f);
+				Transforms.ModifyLocal(handles[i]) = locals[i];
+			}
+			double buildMs = since(start);
+			start = Clock::now();
+			Transforms.Update();
+			double sortMs = since(start);
+
+			// Steady // A tenth of the nodes moved every frame, their subtrees follow.
+			const int frames = 10;
+			double updateMs = 0.0;
+			for (int f = 0; f < frames; ++f)
+			{
+				for (int i = 0; i < count / 10; ++i)
+				{
+					int n = RandomBelow(count);
+					locals[n].Translate(0.0f, 0.0f, 1.0f);
+					Transforms.ModifyLocal(handles[n]) = locals[n];
+				}
+				start = Clock::now();
+				Transforms.BeginStep();
+				Transforms.Update();
+				updateMs += since(start);
+			}
+
+			// Free // Every tenth node, its children become roots. Each free touches only its own children.
+			std::vector<uint8_t> freed(count, 0);
+			start = Clock::now();
+			for (int i = 0; i < count; i += 10)
+			{
+				Transforms.Free(handles[i]);
+				freed[i] = 1;
+			}
+			double freeMs = since(start);
+			start = Clock::now();
+			Transforms.Update();
+			double resortMs = since(start);
+			for (int i = 0; i < count; ++i)
+			{
+				if (parents[i] >= 0 && freed[parents[i]])
+					parents[i] = -1;
+			}
+
+			// Check // Globals of sampled live nodes, composed root first like Update does.
+			float worst = 0.0f;
+			int checked = 0;
+			for (int i = 1; i < count; i += std::max(1, count / 1000))
+			{
+				if (freed[i])
+					continue;
+				std::vector<int> chain;
+				for (int n = i; n >= 0; n = parents[n])
+					chain.push_back(n);
+				Math::Matrix4F reference = locals[chain.back()];
+				for (auto it = chain.rbegin() + 1; it != chain.rend(); ++it)
+					reference = reference * locals[*it];
+				const Math::Matrix4F& global = Transforms.GetGlobal(handles[i]);
+				for (int r = 0; r < 4; ++r)
+				{
+					for (int c = 0; c < 4; ++c)
+						worst = std::max(worst, fabsf(global.m[r][c] - reference.m[r][c]));
+				}
+				checked++;
+			}
+			bool valid = worst < 1e-3f && Transforms.GetCount() == count - (count + 9) / 10;
+			printf("%d nodes: build %.2f ms, first update %.2f ms, update %.3f ms/frame, free %d %.3f ms (%.1f ns each), re-sort %.2f ms, %d checked, max error %g%s\n",
+				count, buildMs, sortMs, updateMs / frames, (count + 9) / 10, freeMs, freeMs * 1e6 / ((count + 9) / 10), resortMs, checked, worst, valid ? "" : " FAILED");
+			passed = passed && valid;
+			Transforms.Destroy();
+		}
+
+		// Interpolation // A projective global with m33 of zero still blends from its previous value.
+		{
+			Transforms.Create();
+			Objects::TransformHandle handle = Transforms.Allocate();
+			Math::Matrix4F projective(1.0f);
+			projective.m33 = 0.0f;
+			projective.m32 = -1.0f;
+			Transforms.ModifyLocal(handle) = projective;
+			Transforms.Update();
+			Transforms.BeginStep();
+			Transforms.ModifyLocal(handle).m03 = 2.0f;
+			Transforms.Update();
+			Math::Matrix4F halfway = Transforms.GetInterpolated(handle, 0.5f);
+			bool blended = fabsf(halfway.m03 - 1.0f) < 1e-6f && halfway.m33 == 0.0f;
+			printf("Interpolation with m33 of zero: m03 %.3f halfway, %s\n", halfway.m03, blended ? "blended" : "NOT BLENDED");
+			passed = passed && blended;
+			Transforms.Destroy();
+		}
+		printf("%s\n", passed ? "Passed" : "FAILED");
+		return passed ? 0 : 1;
+	}
+}